@@ -20,7 +20,9 @@
 #include <algorithm>
 #include <cstring>
 #include <memory>
+#include <mutex>
 #include <ostream>
+#include <utility>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
@@ -74,6 +76,8 @@ DEFINE_bool(cfile_verify_checksums, true,
             "Verify the checksum for each block on read if one exists");
 TAG_FLAG(cfile_verify_checksums, evolving);
 
+using kudu::fs::BlockManager;
+using kudu::fs::BlockReadRequest;
 using kudu::fs::ReadableBlock;
 using kudu::pb_util::SecureDebugString;
 using std::string;
@@ -197,6 +201,118 @@ Status CFileReader::Init() {
   return Status::OK();
 }
 
+Status CFileReader::InitBatch(BlockManager* block_manager,
+                              const vector<CFileReader*>& readers) {
+  vector<CFileReader*> to_init;
+  vector<CFileReader*> to_prefetch;
+  for (CFileReader* reader : readers) {
+    if (reader->initted()) {
+      continue;
+    }
+    to_init.push_back(reader);
+    // Files too short to hold a header and footer are left for Init() to
+    // reject.
+    if (reader->file_size_ > 2 * kMagicAndLengthSize) {
+      to_prefetch.push_back(reader);
+    }
+  }
+
+  if (to_prefetch.size() > 1) {
+    // First read the "pre-header" and "post-footer" of each file, which give
+    // the lengths of the header and footer. Then read the header and footer,
+    // along with their checksums, if any. Any problem is left for Init() to
+    // find and report with the file's context.
+    Status s = [&]() {
+      vector<uint8_t> mal_scratch(2 * kMagicAndLengthSize * to_prefetch.size());
+      vector<BlockReadRequest> requests;
+      for (size_t i = 0; i < to_prefetch.size(); i++) {
+        const CFileReader* reader = to_prefetch[i];
+        uint8_t* mal = &mal_scratch[2 * kMagicAndLengthSize * i];
+        requests.push_back({ reader->block_.get(), 0,
+                             Slice(mal, kMagicAndLengthSize) });
+        requests.push_back({ reader->block_.get(), reader->file_size_ - kMagicAndLengthSize,
+                             Slice(mal + kMagicAndLengthSize, kMagicAndLengthSize) });
+      }
+      RETURN_NOT_OK(block_manager->ReadBlocks(&requests));
+
+      vector<std::pair<CFileReader*, std::pair<uint64_t, vector<uint8_t>>>> ranges;
+      for (size_t i = 0; i < to_prefetch.size(); i++) {
+        CFileReader* reader = to_prefetch[i];
+        const uint8_t* mal = &mal_scratch[2 * kMagicAndLengthSize * i];
+        uint8_t version;
+        uint32_t header_size;
+        uint32_t footer_size;
+        if (!ParseMagicAndLength(Slice(mal, kMagicAndLengthSize),
+                                 &version, &header_size).ok() ||
+            !ParseMagicAndLength(Slice(mal + kMagicAndLengthSize, kMagicAndLengthSize),
+                                 &version, &footer_size).ok()) {
+          continue;
+        }
+        uint64_t header_range_size = kMagicAndLengthSize + header_size + kChecksumSize;
+        uint64_t footer_range_size = kChecksumSize + footer_size + kMagicAndLengthSize;
+        if (header_range_size > reader->file_size_ || footer_range_size > reader->file_size_) {
+          continue;
+        }
+        ranges.emplace_back(reader, std::make_pair(0, vector<uint8_t>(header_range_size)));
+        ranges.emplace_back(reader, std::make_pair(reader->file_size_ - footer_range_size,
+                                                   vector<uint8_t>(footer_range_size)));
+      }
+      requests.clear();
+      for (auto& range : ranges) {
+        requests.push_back({ range.first->block_.get(), range.second.first,
+                             Slice(range.second.second.data(), range.second.second.size()) });
+      }
+      RETURN_NOT_OK(block_manager->ReadBlocks(&requests));
+
+      for (auto& range : ranges) {
+        CFileReader* reader = range.first;
+        std::lock_guard<simple_spinlock> l(reader->prefetched_lock_);
+        if (!reader->initted()) {
+          reader->prefetched_.emplace_back(std::move(range.second));
+        }
+      }
+      return Status::OK();
+    }();
+    if (PREDICT_FALSE(!s.ok())) {
+      VLOG(1) << "Unable to read CFile headers and footers in a batch: " << s.ToString();
+    }
+  }
+
+  Status first_error;
+  for (CFileReader* reader : to_init) {
+    Status s = reader->Init();
+    {
+      std::lock_guard<simple_spinlock> l(reader->prefetched_lock_);
+      reader->prefetched_.clear();
+    }
+    if (first_error.ok()) {
+      first_error = s;
+    }
+  }
+  return first_error;
+}
+
+Status CFileReader::ReadMetadataV(uint64_t offset, vector<Slice>* results) const {
+  size_t length = 0;
+  for (const Slice& result : *results) {
+    length += result.size();
+  }
+  {
+    std::lock_guard<simple_spinlock> l(prefetched_lock_);
+    for (const auto& range : prefetched_) {
+      if (offset >= range.first && offset + length <= range.first + range.second.size()) {
+        const uint8_t* src = range.second.data() + (offset - range.first);
+        for (Slice& result : *results) {
+          memcpy(result.mutable_data(), src, result.size());
+          src += result.size();
+        }
+        return Status::OK();
+      }
+    }
+  }
+  return block_->ReadV(offset, results);
+}
+
 Status CFileReader::ReadAndParseHeader() {
   TRACE_EVENT1("io", "CFileReader::ReadAndParseHeader",
                "cfile", ToString());
@@ -207,7 +323,8 @@ Status CFileReader::ReadAndParseHeader() {
   // proper protobuf header.
   uint8_t mal_scratch[kMagicAndLengthSize];
   Slice mal(mal_scratch, kMagicAndLengthSize);
-  RETURN_NOT_OK_PREPEND(block_->Read(0, &mal),
+  vector<Slice> mal_results = { mal };
+  RETURN_NOT_OK_PREPEND(ReadMetadataV(0, &mal_results),
                         "failed to read CFile pre-header");
   uint32_t header_size;
   RETURN_NOT_OK_PREPEND(ParseMagicAndLength(mal, &cfile_version_, &header_size),
@@ -230,7 +347,7 @@ Status CFileReader::ReadAndParseHeader() {
   if (has_checksums() && FLAGS_cfile_verify_checksums) {
     results.push_back(checksum);
   }
-  RETURN_NOT_OK(block_->ReadV(off, &results));
+  RETURN_NOT_OK(ReadMetadataV(off, &results));
 
   if (has_checksums() && FLAGS_cfile_verify_checksums) {
     RETURN_NOT_OK(VerifyChecksum({ mal, header }, checksum));
@@ -259,7 +376,8 @@ Status CFileReader::ReadAndParseFooter() {
   // and the length of the actual protobuf footer.
   uint8_t mal_scratch[kMagicAndLengthSize];
   Slice mal(mal_scratch, kMagicAndLengthSize);
-  RETURN_NOT_OK(block_->Read(file_size_ - kMagicAndLengthSize, &mal));
+  vector<Slice> mal_results = { mal };
+  RETURN_NOT_OK(ReadMetadataV(file_size_ - kMagicAndLengthSize, &mal_results));
   uint32_t footer_size;
   RETURN_NOT_OK(ParseMagicAndLength(mal, &cfile_version_, &footer_size));
 
@@ -281,7 +399,7 @@ Status CFileReader::ReadAndParseFooter() {
   // This is done to avoid the need for a follow up read call.
   vector<Slice> results = { checksum, footer };
   uint64_t off = file_size_ - kMagicAndLengthSize - footer_size - kChecksumSize;
-  RETURN_NOT_OK(block_->ReadV(off, &results));
+  RETURN_NOT_OK(ReadMetadataV(off, &results));
 
   // Parse the protobuf footer.
   // This needs to be done before validating the checksum since the
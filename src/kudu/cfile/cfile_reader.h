@@ -22,6 +22,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <glog/logging.h>
@@ -39,6 +40,7 @@
 #include "kudu/gutil/port.h"
 #include "kudu/util/compression/compression.pb.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/object_pool.h"
 #include "kudu/util/once.h"
@@ -87,6 +89,18 @@ class CFileReader {
   // May be called multiple times; subsequent calls will no-op.
   Status Init();
 
+  // Like calling Init() on each of 'readers', but reads the headers and
+  // footers of those not yet initialized in two batches through
+  // 'block_manager', which must have opened their blocks. Returns the first
+  // error encountered.
+  static Status InitBatch(fs::BlockManager* block_manager,
+                          const std::vector<CFileReader*>& readers);
+
+  // Can be called before Init().
+  bool initted() const {
+    return init_once_.initted();
+  }
+
   enum CacheControl {
     CACHE_BLOCK,
     DONT_CACHE_BLOCK
@@ -193,6 +207,10 @@ class CFileReader {
 
   Status ReadAndParseHeader();
   Status ReadAndParseFooter();
+
+  // Reads into 'results' from 'offset' as per ReadableBlock::ReadV(),
+  // copying from the ranges prefetched by InitBatch() if they cover it.
+  Status ReadMetadataV(uint64_t offset, std::vector<Slice>* results) const;
   Status VerifyChecksum(const std::vector<Slice>& data, const Slice& checksum) const;
 
   // Returns the memory usage of the object including the object itself.
@@ -214,6 +232,11 @@ class CFileReader {
 
   KuduOnceDynamic init_once_;
 
+  // Ranges of the block read by InitBatch() for use by InitOnce(), keyed by
+  // offset. Discarded once initialized.
+  mutable simple_spinlock prefetched_lock_;
+  std::vector<std::pair<uint64_t, std::vector<uint8_t>>> prefetched_;
+
   ScopedTrackedConsumption mem_consumption_;
 };
 
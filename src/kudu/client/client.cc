@@ -1228,6 +1228,17 @@ Status KuduScanner::SetSnapshotRaw(uint64_t snapshot_timestamp) {
   return Status::OK();
 }
 
+Status KuduScanner::SetMaxStalenessMillis(int max_staleness_ms) {
+  if (data_->open_) {
+    return Status::IllegalState("Maximum staleness must be set before Open()");
+  }
+  if (max_staleness_ms <= 0) {
+    return Status::InvalidArgument("Maximum staleness must be greater than 0");
+  }
+  data_->mutable_configuration()->SetMaxStalenessMillis(max_staleness_ms);
+  return Status::OK();
+}
+
 Status KuduScanner::SetSelection(KuduClient::ReplicaSelection selection) {
   if (data_->open_) {
     return Status::IllegalState("Replica selection must be set before Open()");
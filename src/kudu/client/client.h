@@ -2020,6 +2020,27 @@ class KUDU_EXPORT KuduScanner {
   /// @return Operation result status.
   Status SetSnapshotRaw(uint64_t snapshot_timestamp) WARN_UNUSED_RESULT;
 
+  /// Bound the staleness of a scan in @c READ_AT_SNAPSHOT mode for which no
+  /// snapshot timestamp is set.
+  ///
+  /// Instead of scanning at the current time, which a follower may first need
+  /// to catch up with, a replica then scans at the latest time up to which it
+  /// is known to have all data, as long as that is at most
+  /// @c max_staleness_ms in the past. Replicas that are further behind are
+  /// skipped. Together with the @c CLOSEST_REPLICA selection policy, this
+  /// lets followers serve scans that tolerate slightly stale data.
+  ///
+  /// All tablets are scanned at the snapshot picked for the first one.
+  ///
+  /// @note This method is experimental and will either disappear or
+  ///   change in a future release.
+  ///
+  /// @param [in] max_staleness_ms
+  ///   Maximum staleness (in milliseconds). Must be greater than 0, and
+  ///   should be greater than the servers' Raft heartbeat interval.
+  /// @return Operation result status.
+  Status SetMaxStalenessMillis(int max_staleness_ms) WARN_UNUSED_RESULT;
+
   /// Set the maximum time that Open() and NextBatch() are allowed to take.
   ///
   /// @param [in] millis
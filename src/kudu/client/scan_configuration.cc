@@ -176,6 +176,10 @@ void ScanConfiguration::SetSnapshotMicros(uint64_t snapshot_timestamp_micros) {
   snapshot_timestamp_ = snapshot_timestamp_micros << kHtTimestampBitsToShift;
 }
 
+void ScanConfiguration::SetMaxStalenessMillis(int max_staleness_ms) {
+  max_staleness_ = MonoDelta::FromMilliseconds(max_staleness_ms);
+}
+
 void ScanConfiguration::SetSnapshotRaw(uint64_t snapshot_timestamp) {
   snapshot_timestamp_ = snapshot_timestamp;
 }
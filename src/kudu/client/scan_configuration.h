@@ -87,6 +87,8 @@ class ScanConfiguration {
 
   void SetSnapshotRaw(uint64_t snapshot_timestamp);
 
+  void SetMaxStalenessMillis(int max_staleness_ms);
+
   void SetTimeoutMillis(int millis);
 
   Status SetRowFormatFlags(uint64_t flags);
@@ -145,6 +147,15 @@ class ScanConfiguration {
     return snapshot_timestamp_;
   }
 
+  bool has_max_staleness() const {
+    return max_staleness_.Initialized();
+  }
+
+  const MonoDelta& max_staleness() const {
+    CHECK(has_max_staleness());
+    return max_staleness_;
+  }
+
   const MonoDelta& timeout() const {
     return timeout_;
   }
@@ -185,6 +196,10 @@ class ScanConfiguration {
 
   uint64_t snapshot_timestamp_;
 
+  // The maximum staleness of a READ_AT_SNAPSHOT scan without a snapshot
+  // timestamp, if it's a bounded-staleness scan.
+  MonoDelta max_staleness_;
+
   MonoDelta timeout_;
 
   // Manages interior allocations for the scan spec and copied bounds.
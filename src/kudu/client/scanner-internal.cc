@@ -117,6 +117,10 @@ Status KuduScanner::Data::HandleError(const ScanRpcStatus& err,
     case ScanRpcStatus::TABLET_NOT_RUNNING:
       blacklist_location = true;
       break;
+    case ScanRpcStatus::REPLICA_TOO_STALE:
+      // Another replica, e.g. the leader, may be fresh enough.
+      blacklist_location = true;
+      break;
     case ScanRpcStatus::TABLET_NOT_FOUND:
       // There was either a tablet configuration change or the table was
       // deleted, since at the time of this writing we don't support splits.
@@ -246,6 +250,8 @@ ScanRpcStatus KuduScanner::Data::AnalyzeResponse(const Status& rpc_status,
       return ScanRpcStatus{ScanRpcStatus::SCANNER_EXPIRED, server_status};
     case tserver::TabletServerErrorPB::TABLET_NOT_RUNNING:
       return ScanRpcStatus{ScanRpcStatus::TABLET_NOT_RUNNING, server_status};
+    case tserver::TabletServerErrorPB::REPLICA_TOO_STALE:
+      return ScanRpcStatus{ScanRpcStatus::REPLICA_TOO_STALE, server_status};
     case tserver::TabletServerErrorPB::TABLET_FAILED: // fall-through
     case tserver::TabletServerErrorPB::TABLET_NOT_FOUND:
       return ScanRpcStatus{ScanRpcStatus::TABLET_NOT_FOUND, server_status};
@@ -291,6 +297,10 @@ ScanRpcStatus KuduScanner::Data::SendScanRpc(const MonoTime& overall_deadline,
   if (configuration().row_format_flags() & KuduScanner::PAD_UNIXTIME_MICROS_TO_16_BYTES) {
     controller_.RequireServerFeature(TabletServerFeatures::PAD_UNIXTIME_MICROS_TO_16_BYTES);
   }
+  if (next_req_.has_new_scan_request() &&
+      next_req_.new_scan_request().has_max_staleness_us()) {
+    controller_.RequireServerFeature(TabletServerFeatures::BOUNDED_STALENESS_SCANS);
+  }
   ScanRpcStatus scan_status = AnalyzeResponse(
       proxy_->Scan(next_req_,
                    &last_response_,
@@ -318,11 +328,20 @@ Status KuduScanner::Data::OpenTablet(const string& partition_key,
         LOG(WARNING) << "Ignoring snapshot timestamp since "
                         "not in READ_AT_SNAPSHOT mode.";
       }
+      if (configuration_.has_max_staleness()) {
+        LOG(WARNING) << "Ignoring maximum staleness since "
+                        "not in READ_AT_SNAPSHOT mode.";
+      }
       break;
     case KuduScanner::READ_AT_SNAPSHOT:
       scan->set_read_mode(kudu::READ_AT_SNAPSHOT);
       if (configuration_.has_snapshot_timestamp()) {
         scan->set_snap_timestamp(configuration_.snapshot_timestamp());
+        // Once the first tablet picked the snapshot, the remaining tablets
+        // are scanned at it.
+        scan->clear_max_staleness_us();
+      } else if (configuration_.has_max_staleness()) {
+        scan->set_max_staleness_us(configuration_.max_staleness().ToMicroseconds());
       }
       break;
     default:
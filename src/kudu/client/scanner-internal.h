@@ -103,6 +103,9 @@ struct ScanRpcStatus {
     // The destination tablet does not exist (e.g. because the replica was deleted).
     TABLET_NOT_FOUND,
 
+    // The destination replica was too stale to serve a bounded-staleness scan.
+    REPLICA_TOO_STALE,
+
     // Some other unknown tablet server error. This indicates that the TS was running
     // but some problem occurred other than the ones enumerated above.
     OTHER_TS_ERROR
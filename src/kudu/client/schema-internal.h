@@ -52,6 +52,8 @@ class KuduColumnSpec::Data {
         has_encoding(false),
         has_compression(false),
         has_block_size(false),
+        has_ttl(false),
+        has_time_windowed_compaction(false),
         has_nullable(false),
         primary_key(false),
         has_default(false),
@@ -78,6 +80,12 @@ class KuduColumnSpec::Data {
   bool has_block_size;
   int32_t block_size;
 
+  bool has_ttl;
+  int64_t ttl_seconds;
+
+  bool has_time_windowed_compaction;
+  bool time_windowed_compaction;
+
   bool has_nullable;
   bool nullable;
 
@@ -187,6 +187,18 @@ KuduColumnSpec* KuduColumnSpec::BlockSize(int32_t block_size) {
   return this;
 }
 
+KuduColumnSpec* KuduColumnSpec::TimeToLive(int64_t ttl_seconds) {
+  data_->has_ttl = true;
+  data_->ttl_seconds = ttl_seconds;
+  return this;
+}
+
+KuduColumnSpec* KuduColumnSpec::TimeWindowedCompaction(bool enabled) {
+  data_->has_time_windowed_compaction = true;
+  data_->time_windowed_compaction = enabled;
+  return this;
+}
+
 KuduColumnSpec* KuduColumnSpec::PrimaryKey() {
   data_->primary_key = true;
   return this;
@@ -264,6 +276,20 @@ Status KuduColumnSpec::ToColumnSchema(KuduColumnSchema* col) const {
                           default_val,
                           KuduColumnStorageAttributes(encoding, compression, block_size));
 
+  // The TTL and the compaction policy aren't part of the public storage
+  // attributes, so set them directly.
+  if (data_->has_ttl || data_->has_time_windowed_compaction) {
+    ColumnSchemaDelta delta(data_->name);
+    if (data_->has_ttl) {
+      delta.ttl_seconds = boost::optional<int64_t>(data_->ttl_seconds);
+    }
+    if (data_->has_time_windowed_compaction) {
+      delta.time_windowed_compaction =
+          boost::optional<bool>(data_->time_windowed_compaction);
+    }
+    RETURN_NOT_OK(col->col_->ApplyDelta(delta));
+  }
+
   return Status::OK();
 }
 
@@ -308,6 +334,15 @@ Status KuduColumnSpec::ToColumnSchemaDelta(ColumnSchemaDelta* col_delta) const {
     col_delta->cfile_block_size = boost::optional<int32_t>(data_->block_size);
   }
 
+  if (data_->has_ttl) {
+    col_delta->ttl_seconds = boost::optional<int64_t>(data_->ttl_seconds);
+  }
+
+  if (data_->has_time_windowed_compaction) {
+    col_delta->time_windowed_compaction =
+        boost::optional<bool>(data_->time_windowed_compaction);
+  }
+
   return Status::OK();
 }
 
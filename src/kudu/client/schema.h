@@ -289,6 +289,41 @@ class KUDU_EXPORT KuduColumnSpec {
   /// @return Pointer to the modified object.
   KuduColumnSpec* BlockSize(int32_t block_size);
 
+  /// Make this column the time-to-live column of the table.
+  ///
+  /// Rows whose value in this column is more than @c ttl_seconds in the past
+  /// are expired: scans no longer return them, an INSERT or UPSERT of their
+  /// key replaces them as if they were absent, and the servers reclaim their
+  /// storage in the background without the need to delete them. A snapshot
+  /// scan evaluates expiry as of its snapshot timestamp. Until its storage
+  /// is reclaimed, an UPDATE or DELETE applies to an expired row like to any
+  /// other; an UPDATE which moves its value in this column forward makes the
+  /// row visible again. While the servers drop storage whose rows have all
+  /// expired, writes to those rows fail with a retriable
+  /// Status::ServiceUnavailable error.
+  ///
+  /// @note The column must be a non-nullable UNIXTIME_MICROS column, and
+  ///   at most one column of a table may have a TTL. Setting a TTL of 0
+  ///   while altering a table removes the TTL.
+  ///
+  /// @param [in] ttl_seconds
+  ///   Age (in seconds) after which rows expire.
+  /// @return Pointer to the modified object.
+  KuduColumnSpec* TimeToLive(int64_t ttl_seconds);
+
+  /// Mark this column as ordering the keys of the table by time.
+  ///
+  /// The tablets of such a table use a compaction policy meant for time
+  /// series data: only the most recent data is compacted, and older data,
+  /// which is expected not to be updated anymore, is never rewritten.
+  ///
+  /// @note Only the first primary key column may be marked.
+  ///
+  /// @param [in] enabled
+  ///   Whether the table's tablets use the time-windowed compaction policy.
+  /// @return Pointer to the modified object.
+  KuduColumnSpec* TimeWindowedCompaction(bool enabled = true);
+
   /// @name Operations only relevant for Create Table
   ///
   ///@{
@@ -176,6 +176,87 @@ TEST_F(TestSchema, TestReset) {
   ASSERT_TRUE(schema2.initialized());
 }
 
+TEST_F(TestSchema, TestTtlColumn) {
+  ColumnStorageAttributes ttl_attrs;
+  ttl_attrs.ttl_seconds = 3600;
+
+  Schema schema;
+  ASSERT_OK(schema.Reset({ ColumnSchema("key", STRING),
+                           ColumnSchema("ts", UNIXTIME_MICROS, false, nullptr, nullptr,
+                                        ttl_attrs) },
+                         1));
+  ASSERT_EQ(1, schema.ttl_column_idx());
+
+  // A copy of the schema keeps track of the TTL column.
+  Schema copy(schema);
+  ASSERT_EQ(1, copy.ttl_column_idx());
+
+  // Nullable or non-timestamp columns may not have a TTL.
+  Status s = schema.Reset({ ColumnSchema("key", STRING),
+                            ColumnSchema("ts", UNIXTIME_MICROS, true, nullptr, nullptr,
+                                         ttl_attrs) },
+                          1);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = schema.Reset({ ColumnSchema("key", STRING),
+                     ColumnSchema("ts", INT64, false, nullptr, nullptr, ttl_attrs) },
+                   1);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  // Only one column may have a TTL.
+  s = schema.Reset({ ColumnSchema("key", STRING),
+                     ColumnSchema("ts1", UNIXTIME_MICROS, false, nullptr, nullptr, ttl_attrs),
+                     ColumnSchema("ts2", UNIXTIME_MICROS, false, nullptr, nullptr, ttl_attrs) },
+                   1);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "Only one column may have a TTL");
+
+  // A TTL can be added through an alter.
+  ASSERT_OK(schema.Reset({ ColumnSchema("key", STRING),
+                           ColumnSchema("ts", UNIXTIME_MICROS) },
+                         1));
+  ASSERT_EQ(Schema::kColumnNotFound, schema.ttl_column_idx());
+  SchemaBuilder builder(schema);
+  ColumnSchemaDelta delta("ts");
+  delta.ttl_seconds = 60;
+  ASSERT_OK(builder.ApplyColumnSchemaDelta(delta));
+  Schema altered = builder.Build();
+  ASSERT_EQ(1, altered.ttl_column_idx());
+  ASSERT_EQ(60, altered.column(1).attributes().ttl_seconds);
+}
+
+TEST_F(TestSchema, TestTimeWindowedCompaction) {
+  ColumnStorageAttributes twc_attrs;
+  twc_attrs.time_windowed_compaction = true;
+
+  Schema schema;
+  ASSERT_OK(schema.Reset({ ColumnSchema("ts", UNIXTIME_MICROS, false, nullptr, nullptr,
+                                        twc_attrs),
+                           ColumnSchema("val", INT64) },
+                         1));
+  ASSERT_TRUE(schema.time_windowed_compaction());
+
+  // Only the first key column may be marked.
+  Status s = schema.Reset({ ColumnSchema("ts", UNIXTIME_MICROS),
+                            ColumnSchema("val", INT64, false, nullptr, nullptr, twc_attrs) },
+                          1);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  // The policy can be chosen through an alter.
+  ASSERT_OK(schema.Reset({ ColumnSchema("ts", UNIXTIME_MICROS),
+                           ColumnSchema("val", INT64) },
+                         1));
+  ASSERT_FALSE(schema.time_windowed_compaction());
+  SchemaBuilder builder(schema);
+  ColumnSchemaDelta val_delta("val");
+  val_delta.time_windowed_compaction = true;
+  s = builder.ApplyColumnSchemaDelta(val_delta);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ColumnSchemaDelta ts_delta("ts");
+  ts_delta.time_windowed_compaction = true;
+  ASSERT_OK(builder.ApplyColumnSchemaDelta(ts_delta));
+  ASSERT_TRUE(builder.Build().time_windowed_compaction());
+}
+
 // Test for KUDU-943, a bug where we suspected that Variant didn't behave
 // correctly with empty strings.
 TEST_F(TestSchema, TestEmptyVariant) {
@@ -63,6 +63,10 @@ Status ColumnSchema::ApplyDelta(const ColumnSchemaDelta& col_delta) {
     }
   }
 
+  if (col_delta.ttl_seconds) {
+    RETURN_NOT_OK(ValidateTtl(*col_delta.ttl_seconds));
+  }
+
   if (col_delta.new_name) {
     name_ = *col_delta.new_name;
   }
@@ -87,6 +91,23 @@ Status ColumnSchema::ApplyDelta(const ColumnSchemaDelta& col_delta) {
   if (col_delta.cfile_block_size) {
     attributes_.cfile_block_size = *col_delta.cfile_block_size;
   }
+  if (col_delta.ttl_seconds) {
+    attributes_.ttl_seconds = *col_delta.ttl_seconds;
+  }
+  if (col_delta.time_windowed_compaction) {
+    attributes_.time_windowed_compaction = *col_delta.time_windowed_compaction;
+  }
+  return Status::OK();
+}
+
+Status ColumnSchema::ValidateTtl(int64_t ttl_seconds) const {
+  if (ttl_seconds < 0) {
+    return Status::InvalidArgument("TTL must not be negative", name_);
+  }
+  if (ttl_seconds > 0 && (type_info()->type() != UNIXTIME_MICROS || is_nullable_)) {
+    return Status::InvalidArgument(
+        "A TTL may only be set on a non-nullable UNIXTIME_MICROS column", name_);
+  }
   return Status::OK();
 }
 
@@ -147,6 +168,7 @@ void Schema::CopyFrom(const Schema& other) {
   }
 
   has_nullables_ = other.has_nullables_;
+  ttl_column_idx_ = other.ttl_column_idx_;
 }
 
 void Schema::swap(Schema& other) {
@@ -157,6 +179,7 @@ void Schema::swap(Schema& other) {
   name_to_index_.swap(other.name_to_index_);
   id_to_index_.swap(other.id_to_index_);
   std::swap(has_nullables_, other.has_nullables_);
+  std::swap(ttl_column_idx_, other.ttl_column_idx_);
 }
 
 Status Schema::Reset(const vector<ColumnSchema>& cols,
@@ -228,6 +251,29 @@ Status Schema::Reset(const vector<ColumnSchema>& cols,
     }
   }
 
+  // Find the TTL column, if any.
+  ttl_column_idx_ = kColumnNotFound;
+  for (int i = 0; i < cols_.size(); ++i) {
+    if (cols_[i].attributes().ttl_seconds <= 0) continue;
+    RETURN_NOT_OK(cols_[i].ValidateTtl(cols_[i].attributes().ttl_seconds));
+    if (PREDICT_FALSE(ttl_column_idx_ != kColumnNotFound)) {
+      return Status::InvalidArgument(
+        "Bad schema", strings::Substitute("Only one column may have a TTL: $0 and $1",
+                                          cols_[ttl_column_idx_].name(), cols_[i].name()));
+    }
+    ttl_column_idx_ = i;
+  }
+
+  // Only the first key column may order the keys by time.
+  for (int i = 0; i < cols_.size(); ++i) {
+    if (PREDICT_FALSE(cols_[i].attributes().time_windowed_compaction &&
+                      (i != 0 || key_columns == 0))) {
+      return Status::InvalidArgument(
+        "Bad schema", strings::Substitute("Time-windowed compaction may only be set on "
+                                          "the first key column: $0", cols_[i].name()));
+    }
+  }
+
   return Status::OK();
 }
 
@@ -533,6 +579,22 @@ Status SchemaBuilder::ApplyColumnSchemaDelta(const ColumnSchemaDelta& col_delta)
     return Status::NotFound("The specified column does not exist", col_delta.name);
   }
 
+  // Only one column may define the TTL of the table's rows.
+  if (col_delta.ttl_seconds && *col_delta.ttl_seconds > 0) {
+    for (const ColumnSchema& col_schema : cols_) {
+      if (col_schema.name() != col_delta.name && col_schema.attributes().ttl_seconds > 0) {
+        return Status::InvalidArgument("Only one column may have a TTL",
+                                       col_schema.name());
+      }
+    }
+  }
+
+  if (col_delta.time_windowed_compaction && *col_delta.time_windowed_compaction &&
+      (num_key_columns_ == 0 || cols_[0].name() != col_delta.name)) {
+    return Status::InvalidArgument(
+        "Time-windowed compaction may only be set on the first key column", col_delta.name);
+  }
+
   for (ColumnSchema& col_schema : cols_) {
     if (col_delta.name == col_schema.name()) {
       RETURN_NOT_OK(col_schema.ApplyDelta(col_delta));
@@ -96,13 +96,17 @@ struct ColumnStorageAttributes {
   ColumnStorageAttributes()
     : encoding(AUTO_ENCODING),
       compression(DEFAULT_COMPRESSION),
-      cfile_block_size(0) {
+      cfile_block_size(0),
+      ttl_seconds(0),
+      time_windowed_compaction(false) {
   }
 
   ColumnStorageAttributes(EncodingType enc, CompressionType cmp)
     : encoding(enc),
       compression(cmp),
-      cfile_block_size(0) {
+      cfile_block_size(0),
+      ttl_seconds(0),
+      time_windowed_compaction(false) {
   }
 
   std::string ToString() const;
@@ -113,6 +117,15 @@ struct ColumnStorageAttributes {
   // The preferred block size for cfile blocks. If 0, uses the
   // server-wide default.
   int32_t cfile_block_size;
+
+  // If positive, this is the table's TTL column: rows whose value in it is
+  // more than 'ttl_seconds' in the past are expired. See ColumnSchemaPB.
+  int64_t ttl_seconds;
+
+  // Whether the table's keys are ordered by time, by way of this column, so
+  // that its tablets use the time-windowed compaction policy. Only valid on
+  // the first key column. See ColumnSchemaPB.
+  bool time_windowed_compaction;
 };
 
 // A struct representing changes to a ColumnSchema.
@@ -144,6 +157,8 @@ public:
   boost::optional<EncodingType> encoding;
   boost::optional<CompressionType> compression;
   boost::optional<int32_t> cfile_block_size;
+  boost::optional<int64_t> ttl_seconds;
+  boost::optional<bool> time_windowed_compaction;
 };
 
 // The schema for a given column.
@@ -293,6 +308,9 @@ class ColumnSchema {
   // The original column schema is changed only if the method returns OK.
   Status ApplyDelta(const ColumnSchemaDelta& col_delta);
 
+  // Returns an error if this column can't hold a TTL of 'ttl_seconds'.
+  Status ValidateTtl(int64_t ttl_seconds) const;
+
   // Returns extended attributes (such as encoding, compression, etc...)
   // associated with the column schema. The reason they are kept in a separate
   // struct is so that in the future, they may be moved out to a more
@@ -375,7 +393,8 @@ class Schema {
                      NameToIndexMap::hasher(),
                      NameToIndexMap::key_equal(),
                      NameToIndexMapAllocator(&name_to_index_bytes_)),
-      has_nullables_(false) {
+      has_nullables_(false),
+      ttl_column_idx_(kColumnNotFound) {
   }
 
   Schema(const Schema& other);
@@ -512,6 +531,19 @@ class Schema {
     return has_nullables_;
   }
 
+  // Return the index of the column whose value determines when a row
+  // expires (see ColumnStorageAttributes::ttl_seconds), or kColumnNotFound
+  // if rows of this schema never expire.
+  int ttl_column_idx() const {
+    return ttl_column_idx_;
+  }
+
+  // Returns true if the tablets of this schema use the time-windowed
+  // compaction policy (see ColumnStorageAttributes::time_windowed_compaction).
+  bool time_windowed_compaction() const {
+    return num_key_columns_ > 0 && cols_[0].attributes().time_windowed_compaction;
+  }
+
   // Returns true if the specified column (by name) is a key
   bool is_key_column(const StringPiece col_name) const {
     return is_key_column(find_column(col_name));
@@ -855,6 +887,9 @@ class Schema {
   // Cached indicator whether any columns are nullable.
   bool has_nullables_;
 
+  // Cached index of the TTL column, or kColumnNotFound.
+  int ttl_column_idx_;
+
   // NOTE: if you add more members, make sure to add the appropriate
   // code to swap() and CopyFrom() as well to prevent subtle bugs.
 };
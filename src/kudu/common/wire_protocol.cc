@@ -216,6 +216,15 @@ void ColumnSchemaToPB(const ColumnSchema& col_schema, ColumnSchemaPB *pb, int fl
     pb->set_compression(col_schema.attributes().compression);
     pb->set_cfile_block_size(col_schema.attributes().cfile_block_size);
   }
+  // The TTL changes which rows are visible, so unlike the storage attributes
+  // above it is always sent. So is the compaction policy, which is chosen by
+  // tablets rather than by a column's readers and writers.
+  if (col_schema.attributes().ttl_seconds > 0) {
+    pb->set_ttl_seconds(col_schema.attributes().ttl_seconds);
+  }
+  if (col_schema.attributes().time_windowed_compaction) {
+    pb->set_time_windowed_compaction(true);
+  }
   if (col_schema.has_read_default()) {
     if (col_schema.type_info()->physical_type() == BINARY) {
       const Slice *read_slice = static_cast<const Slice *>(col_schema.read_default_value());
@@ -269,6 +278,12 @@ ColumnSchema ColumnSchemaFromPB(const ColumnSchemaPB& pb) {
   if (pb.has_cfile_block_size()) {
     attributes.cfile_block_size = pb.cfile_block_size();
   }
+  if (pb.has_ttl_seconds()) {
+    attributes.ttl_seconds = pb.ttl_seconds();
+  }
+  if (pb.has_time_windowed_compaction()) {
+    attributes.time_windowed_compaction = pb.time_windowed_compaction();
+  }
   return ColumnSchema(pb.name(), pb.type(), pb.is_nullable(),
                       read_default_ptr, write_default_ptr,
                       attributes);
@@ -296,6 +311,12 @@ void ColumnSchemaDeltaToPB(const ColumnSchemaDelta& col_delta, ColumnSchemaDelta
   if (col_delta.cfile_block_size) {
     pb->set_block_size(*col_delta.cfile_block_size);
   }
+  if (col_delta.ttl_seconds) {
+    pb->set_ttl_seconds(*col_delta.ttl_seconds);
+  }
+  if (col_delta.time_windowed_compaction) {
+    pb->set_time_windowed_compaction(*col_delta.time_windowed_compaction);
+  }
 }
 
 ColumnSchemaDelta ColumnSchemaDeltaFromPB(const ColumnSchemaDeltaPB& pb) {
@@ -318,6 +339,13 @@ ColumnSchemaDelta ColumnSchemaDeltaFromPB(const ColumnSchemaDeltaPB& pb) {
   if (pb.has_block_size()) {
     col_delta.cfile_block_size = boost::optional<int32_t>(pb.block_size());
   }
+  if (pb.has_ttl_seconds()) {
+    col_delta.ttl_seconds = boost::optional<int64_t>(pb.ttl_seconds());
+  }
+  if (pb.has_time_windowed_compaction()) {
+    col_delta.time_windowed_compaction =
+        boost::optional<bool>(pb.time_windowed_compaction());
+  }
   return col_delta;
 }
 
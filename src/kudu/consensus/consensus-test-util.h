@@ -352,6 +352,80 @@ class NoOpTestPeerProxy : public TestPeerProxy {
   OpId last_received_;            // Protected by lock_.
 };
 
+// Holds on to each UpdateConsensus call until the test responds to it, so
+// that several pipelined calls can be in flight and be answered in any order.
+class PipelinedTestPeerProxy : public PeerProxy {
+ public:
+  explicit PipelinedTestPeerProxy(ThreadPool* pool) : pool_(pool) {}
+
+  void UpdateAsync(const ConsensusRequestPB* request,
+                   ConsensusResponsePB* response,
+                   rpc::RpcController* /*controller*/,
+                   const rpc::ResponseCallback& callback) override {
+    std::lock_guard<simple_spinlock> lock(lock_);
+    calls_.push_back({ *request, response, callback });
+  }
+
+  void RequestConsensusVoteAsync(const VoteRequestPB* /*request*/,
+                                 VoteResponsePB* /*response*/,
+                                 rpc::RpcController* /*controller*/,
+                                 const rpc::ResponseCallback& /*callback*/) override {
+    LOG(FATAL) << "Not implemented";
+  }
+
+  // Returns the number of UpdateConsensus calls made so far.
+  int num_calls() const {
+    std::lock_guard<simple_spinlock> lock(lock_);
+    return calls_.size();
+  }
+
+  // Returns a copy of the request of the 'idx'th call.
+  ConsensusRequestPB request(int idx) const {
+    std::lock_guard<simple_spinlock> lock(lock_);
+    return calls_.at(idx).request;
+  }
+
+  // Answers the 'idx'th call with 'response'. Each call may be answered once.
+  void Respond(int idx, const ConsensusResponsePB& response) {
+    rpc::ResponseCallback callback;
+    {
+      std::lock_guard<simple_spinlock> lock(lock_);
+      Call* call = &calls_.at(idx);
+      CHECK(call->callback) << "Call " << idx << " was already answered";
+      *call->response = response;
+      callback.swap(call->callback);
+    }
+    CHECK_OK(pool_->SubmitFunc(callback));
+  }
+
+  // Answers the 'idx'th call the way a follower that accepts it would: it has
+  // received everything up to the last op of the request, and learned of the
+  // request's commit index.
+  void Ack(int idx, const std::string& responder_uuid) {
+    ConsensusRequestPB req = request(idx);
+    ConsensusResponsePB response;
+    response.set_responder_uuid(responder_uuid);
+    response.set_responder_term(req.caller_term());
+    const OpId& last = req.ops_size() > 0 ? req.ops(req.ops_size() - 1).id() :
+                                            req.preceding_id();
+    response.mutable_status()->mutable_last_received()->CopyFrom(last);
+    response.mutable_status()->mutable_last_received_current_leader()->CopyFrom(last);
+    response.mutable_status()->set_last_committed_idx(req.committed_index());
+    Respond(idx, response);
+  }
+
+ private:
+  struct Call {
+    ConsensusRequestPB request;
+    ConsensusResponsePB* response;
+    rpc::ResponseCallback callback;
+  };
+
+  ThreadPool* pool_;
+  mutable simple_spinlock lock_;
+  std::vector<Call> calls_; // Protected by lock_.
+};
+
 class NoOpTestPeerProxyFactory : public PeerProxyFactory {
  public:
   NoOpTestPeerProxyFactory() {
@@ -20,7 +20,9 @@
 #include <memory>
 #include <string>
 #include <type_traits>
+#include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -39,6 +41,8 @@
 #include "kudu/consensus/metadata.pb.h"
 #include "kudu/consensus/opid.pb.h"
 #include "kudu/consensus/opid_util.h"
+#include "kudu/consensus/ops_sidecar.h"
+#include "kudu/consensus/ref_counted_replicate.h"
 #include "kudu/consensus/time_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -47,13 +51,20 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/rpc/messenger.h"
 #include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 #include "kudu/util/threadpool.h"
 
+DECLARE_int32(consensus_max_batch_size_bytes);
+DECLARE_int32(consensus_max_in_flight_requests_per_peer);
+DECLARE_int32(raft_heartbeat_interval_ms);
+
 METRIC_DECLARE_entity(tablet);
 
 namespace kudu {
@@ -61,15 +72,18 @@ namespace consensus {
 
 using log::Log;
 using log::LogOptions;
+using pb_util::SecureDebugString;
 using rpc::Messenger;
 using rpc::MessengerBuilder;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
+using std::vector;
 
 const char* kTabletId = "test-peers-tablet";
 const char* kLeaderUuid = "peer-0";
 const char* kFollowerUuid = "peer-1";
+const int kPipelinedPayloadSize = 1024;
 
 class ConsensusPeersTest : public KuduTest {
  public:
@@ -142,6 +156,63 @@ class ConsensusPeersTest : public KuduTest {
     ASSERT_EQ(id.index(), index);
   }
 
+  // Sets up a peer whose requests may be pipelined and each carry a single
+  // op, appends ops 1 to 3 and answers the peer's first, status-only, request.
+  // Requests carrying each of the ops are then in flight, as calls 1 to 3.
+  void StartPipelinedPeer(shared_ptr<Peer>* peer, PipelinedTestPeerProxy** proxy) {
+    FLAGS_consensus_max_in_flight_requests_per_peer = 3;
+    FLAGS_consensus_max_batch_size_bytes = kPipelinedPayloadSize / 2;
+    // Keep heartbeats out of the way of the calls the tests expect.
+    FLAGS_raft_heartbeat_interval_ms = 60 * 1000;
+    message_queue_->SetLeaderMode(kMinimumOpIdIndex,
+                                  kMinimumTerm,
+                                  BuildRaftConfigPBForTests(3));
+
+    *proxy = new PipelinedTestPeerProxy(raft_pool_.get());
+    ASSERT_OK(Peer::NewRemotePeer(FakeRaftPeerPB(kFollowerUuid),
+                                  kTabletId,
+                                  kLeaderUuid,
+                                  message_queue_.get(),
+                                  raft_pool_token_.get(),
+                                  gscoped_ptr<PeerProxy>(*proxy),
+                                  messenger_,
+                                  peer));
+
+    AppendReplicateMessagesToQueue(message_queue_.get(), clock_, 1, 3, kPipelinedPayloadSize);
+    NO_FATALS(WaitForLocalAppend(3));
+    (*peer)->SignalRequest(true);
+    ASSERT_EVENTUALLY([&]() {
+        ASSERT_EQ(1, (*proxy)->num_calls());
+      });
+    ASSERT_EQ(0, (*proxy)->request(0).ops_size());
+
+    // The peer's log is empty.
+    ConsensusResponsePB resp;
+    resp.set_responder_uuid(kFollowerUuid);
+    resp.set_responder_term(0);
+    resp.mutable_status()->mutable_last_received()->CopyFrom(MinimumOpId());
+    resp.mutable_status()->mutable_last_received_current_leader()->CopyFrom(MinimumOpId());
+    resp.mutable_status()->set_last_committed_idx(0);
+    (*proxy)->Respond(0, resp);
+
+    ASSERT_EVENTUALLY([&]() {
+        ASSERT_EQ(4, (*proxy)->num_calls());
+      });
+    for (int i = 1; i <= 3; i++) {
+      ConsensusRequestPB req = (*proxy)->request(i);
+      ASSERT_EQ(1, req.ops_size());
+      ASSERT_EQ(i, req.ops(0).id().index());
+    }
+  }
+
+  // Waits for the leader's own log to have appended the op with 'index'.
+  void WaitForLocalAppend(int64_t index) {
+    ASSERT_EVENTUALLY([&]() {
+        ASSERT_GE(message_queue_->GetTrackedPeerForTests(kLeaderUuid).last_received.index(),
+                  index);
+      });
+  }
+
   // Registers a callback triggered when the op with the provided term and index
   // is committed in the test consensus impl.
   // This must be called _before_ the operation is committed.
@@ -350,6 +421,216 @@ TEST_F(ConsensusPeersTest, TestDontSendOneRpcPerWriteWhenPeerIsDown) {
   ASSERT_LT(mock_proxy->update_count(), 5);
 }
 
+// Test that ops laid out for a sidecar by the leader are merged into the
+// follower's request as if they had been sent in the request itself.
+TEST_F(ConsensusPeersTest, TestOpsSidecarRoundTrip) {
+  ConsensusRequestPB expected;
+  expected.set_tablet_id(kTabletId);
+  expected.set_caller_uuid(kLeaderUuid);
+  expected.set_caller_term(2);
+  expected.set_committed_index(1);
+
+  vector<ReplicateRefPtr> msgs;
+  for (int i = 2; i <= 4; i++) {
+    msgs.push_back(make_scoped_refptr_replicate(
+        CreateDummyReplicate(2, i, clock_->Now(), i * 100).release()));
+    expected.add_ops()->CopyFrom(*msgs.back()->get());
+  }
+  faststring ops_data;
+  AppendOpsForSidecar(msgs, &ops_data);
+
+  ConsensusRequestPB req;
+  req.set_tablet_id(kTabletId);
+  req.set_caller_uuid(kLeaderUuid);
+  req.set_caller_term(2);
+  req.set_committed_index(1);
+  req.set_ops_sidecar_idx(0);
+  vector<Slice> serialized_ops;
+  ASSERT_OK(MergeOpsFromSidecar(Slice(ops_data), &req, &serialized_ops));
+  ASSERT_FALSE(req.has_ops_sidecar_idx());
+  ASSERT_EQ(SecureDebugString(expected), SecureDebugString(req));
+
+  // The serialized form of each op is handed back, so that the follower
+  // doesn't need to serialize it again.
+  const auto serialized = [](const ReplicateRefPtr& msg) {
+    return msg->Serialized()->ToString();
+  };
+  const int num_ops = msgs.size();
+  ASSERT_EQ(num_ops, serialized_ops.size());
+  for (int i = 0; i < num_ops; i++) {
+    ASSERT_EQ(serialized(msgs[i]), serialized_ops[i].ToString());
+    ReplicateRefPtr received = make_scoped_refptr_replicate(new ReplicateMsg(req.ops(i)),
+                                                            serialized_ops[i]);
+    // The received form is kept rather than serialized anew.
+    ASSERT_EQ(received->Serialized(), received->Serialized());
+    ASSERT_EQ(serialized_ops[i].ToString(), serialized(received));
+  }
+
+  // Ops which the request already had have no serialized form to hand back.
+  req.set_ops_sidecar_idx(0);
+  ASSERT_OK(MergeOpsFromSidecar(Slice(ops_data), &req, &serialized_ops));
+  ASSERT_EQ(2 * num_ops, req.ops_size());
+  ASSERT_EQ(req.ops_size(), serialized_ops.size());
+  for (int i = 0; i < num_ops; i++) {
+    ASSERT_TRUE(serialized_ops[i].empty());
+    ASSERT_EQ(serialized(msgs[i]), serialized_ops[num_ops + i].ToString());
+  }
+
+  // An empty sidecar carries no ops.
+  ops_data.clear();
+  AppendOpsForSidecar({}, &ops_data);
+  ASSERT_EQ(0, ops_data.size());
+  req.mutable_ops()->Clear();
+  req.set_ops_sidecar_idx(0);
+  ASSERT_OK(MergeOpsFromSidecar(Slice(ops_data), &req));
+  ASSERT_EQ(0, req.ops_size());
+}
+
+// Test that a sidecar which doesn't hold valid ops is rejected.
+TEST_F(ConsensusPeersTest, TestCorruptOpsSidecar) {
+  ConsensusRequestPB req;
+  req.set_tablet_id(kTabletId);
+  req.set_caller_uuid(kLeaderUuid);
+  req.set_caller_term(2);
+
+  faststring ops_data;
+  AppendOpsForSidecar({ make_scoped_refptr_replicate(
+      CreateDummyReplicate(2, 2, clock_->Now(), 100).release()) }, &ops_data);
+
+  // Truncated in the middle of an op.
+  ConsensusRequestPB truncated_req(req);
+  Status s = MergeOpsFromSidecar(Slice(ops_data.data(), ops_data.size() - 10),
+                                 &truncated_req);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+
+  // Not protobuf at all.
+  ConsensusRequestPB garbage_req(req);
+  s = MergeOpsFromSidecar(Slice("\xff\xff\xff"), &garbage_req);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+
+  // Well-formed, but the op lacks its required fields.
+  ConsensusRequestPB partial;
+  partial.add_ops();
+  string partial_data = partial.SerializePartialAsString();
+  ConsensusRequestPB partial_req(req);
+  s = MergeOpsFromSidecar(Slice(partial_data), &partial_req);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+}
+
+// Test that responses to pipelined requests which are processed out of order
+// don't set back what the leader knows the peer to have received or committed.
+TEST_F(ConsensusPeersTest, TestPipelinedResponsesOutOfOrder) {
+  shared_ptr<Peer> peer;
+  PipelinedTestPeerProxy* proxy;
+  NO_FATALS(StartPipelinedPeer(&peer, &proxy));
+
+  // The last request is answered first, which commits all of the ops.
+  proxy->Ack(3, kFollowerUuid);
+  WaitForCommitIndex(3);
+
+  // The next op is pipelined behind the requests still in flight, and tells
+  // the peer of the new commit index.
+  AppendReplicateMessagesToQueue(message_queue_.get(), clock_, 4, 1, kPipelinedPayloadSize);
+  NO_FATALS(WaitForLocalAppend(4));
+  peer->SignalRequest(false);
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(5, proxy->num_calls());
+    });
+  ConsensusRequestPB req = proxy->request(4);
+  ASSERT_EQ(1, req.ops_size());
+  ASSERT_EQ(4, req.ops(0).id().index());
+  ASSERT_EQ(3, req.committed_index());
+  proxy->Ack(4, kFollowerUuid);
+  WaitForCommitIndex(4);
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(3, message_queue_->GetTrackedPeerForTests(
+          kFollowerUuid).last_known_committed_index);
+    });
+
+  // Only now do the responses to the first requests arrive. Once they have,
+  // nothing is in flight and the peer is sent the latest commit index.
+  proxy->Ack(1, kFollowerUuid);
+  proxy->Ack(2, kFollowerUuid);
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(6, proxy->num_calls());
+    });
+  req = proxy->request(5);
+  ASSERT_EQ(0, req.ops_size());
+  ASSERT_EQ(4, req.committed_index());
+
+  // The stale responses were ignored.
+  PeerMessageQueue::TrackedPeer tracked = message_queue_->GetTrackedPeerForTests(kFollowerUuid);
+  ASSERT_EQ(4, tracked.last_received.index());
+  ASSERT_EQ(5, tracked.next_index);
+  ASSERT_EQ(3, tracked.last_known_committed_index);
+
+  proxy->Ack(5, kFollowerUuid);
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(4, message_queue_->GetTrackedPeerForTests(
+          kFollowerUuid).last_known_committed_index);
+    });
+  ASSERT_EQ(6, proxy->num_calls());
+}
+
+// Test that once the peer rejects pipelined requests because its log doesn't
+// match, the leader stops pipelining, lets the requests in flight finish, and
+// then resends ops from where the peer's log ends.
+TEST_F(ConsensusPeersTest, TestPipelinedRequestsRewindAfterLogMismatch) {
+  shared_ptr<Peer> peer;
+  PipelinedTestPeerProxy* proxy;
+  NO_FATALS(StartPipelinedPeer(&peer, &proxy));
+
+  ConsensusResponsePB mismatch;
+  mismatch.set_responder_uuid(kFollowerUuid);
+  mismatch.set_responder_term(0);
+  ConsensusStatusPB* status = mismatch.mutable_status();
+  status->mutable_last_received()->CopyFrom(MinimumOpId());
+  status->mutable_last_received_current_leader()->CopyFrom(MinimumOpId());
+  status->set_last_committed_idx(0);
+  status->mutable_error()->set_code(ConsensusErrorPB::PRECEDING_ENTRY_DIDNT_MATCH);
+  StatusToPB(Status::IllegalState("log matching property violated"),
+             status->mutable_error()->mutable_status());
+  for (int i = 1; i <= 3; i++) {
+    proxy->Respond(i, mismatch);
+  }
+
+  // The first op is sent again, on its own, only once all of the rejected
+  // requests have been answered.
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(5, proxy->num_calls());
+    });
+  ConsensusRequestPB req = proxy->request(4);
+  ASSERT_OPID_EQ(MinimumOpId(), req.preceding_id());
+  ASSERT_EQ(1, req.ops_size());
+  ASSERT_EQ(1, req.ops(0).id().index());
+  SleepFor(MonoDelta::FromMilliseconds(100));
+  ASSERT_EQ(5, proxy->num_calls());
+
+  // Once the peer accepts it, pipelining resumes from there.
+  proxy->Ack(4, kFollowerUuid);
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(7, proxy->num_calls());
+    });
+  ASSERT_EQ(2, proxy->request(5).ops(0).id().index());
+  ASSERT_EQ(3, proxy->request(6).ops(0).id().index());
+
+  // Once those are accepted too, the peer is told that all of the ops are
+  // committed.
+  proxy->Ack(5, kFollowerUuid);
+  proxy->Ack(6, kFollowerUuid);
+  WaitForCommitIndex(3);
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(8, proxy->num_calls());
+    });
+  req = proxy->request(7);
+  ASSERT_EQ(0, req.ops_size());
+  ASSERT_EQ(3, req.committed_index());
+  proxy->Ack(7, kFollowerUuid);
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(3, message_queue_->GetTrackedPeerForTests(
+          kFollowerUuid).last_known_committed_index);
+    });
+}
+
 }  // namespace consensus
 }  // namespace kudu
-
@@ -18,7 +18,11 @@
 #include "kudu/consensus/consensus.proxy.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <type_traits>
@@ -37,8 +41,12 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/move.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/messenger.h"
 #include "kudu/rpc/periodic.h"
+#include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
@@ -52,6 +60,39 @@ DEFINE_int32(consensus_rpc_timeout_ms, 1000,
              "Timeout used for all consensus internal RPC communications.");
 TAG_FLAG(consensus_rpc_timeout_ms, advanced);
 
+DEFINE_int32(consensus_max_in_flight_requests_per_peer, 1,
+             "Maximum number of UpdateConsensus requests that a leader may have "
+             "in flight to each follower. With more than one, requests carrying "
+             "new operations are pipelined rather than each waiting for the "
+             "previous one's response, so that replication throughput to distant "
+             "followers is not bounded by one round trip per batch.");
+TAG_FLAG(consensus_max_in_flight_requests_per_peer, advanced);
+TAG_FLAG(consensus_max_in_flight_requests_per_peer, experimental);
+
+DEFINE_validator(consensus_max_in_flight_requests_per_peer,
+                 [](const char* /*n*/, int32_t v) { return v >= 1; });
+
+DEFINE_bool(consensus_send_ops_in_sidecar, true,
+            "Whether a leader sends the operations of its requests to peers in an "
+            "RPC sidecar, which is shared by the requests to all peers that are sent "
+            "the same operations, rather than serializing them anew for every peer. "
+            "Peers that don't support this are detected, and sent the operations in "
+            "requests instead.");
+TAG_FLAG(consensus_send_ops_in_sidecar, advanced);
+TAG_FLAG(consensus_send_ops_in_sidecar, runtime);
+
+DEFINE_int32(raft_heartbeat_batch_window_ms, 0,
+             "If positive, the heartbeats (UpdateConsensus requests without "
+             "operations) that tablet leaders send to the same server are "
+             "coalesced into one RPC, sent this many milliseconds after the first "
+             "of them. Heartbeats are delayed by up to this much, so it should be "
+             "well below --raft_heartbeat_interval_ms. The receiving server applies "
+             "a batch's heartbeats one after another on a single thread, handing "
+             "back those for replicas busy with other requests to be sent by "
+             "themselves. 0 disables batching.");
+TAG_FLAG(raft_heartbeat_batch_window_ms, advanced);
+TAG_FLAG(raft_heartbeat_batch_window_ms, experimental);
+
 DEFINE_int32(raft_get_node_instance_timeout_ms, 30000,
              "Timeout for retrieving node instance data over RPC.");
 TAG_FLAG(raft_get_node_instance_timeout_ms, hidden);
@@ -126,6 +167,7 @@ Peer::Peer(RaftPeerPB peer_pb,
       proxy_(std::move(proxy)),
       queue_(queue),
       failed_attempts_(0),
+      last_committed_index_sent_(kMinimumOpIdIndex),
       messenger_(std::move(messenger)),
       raft_pool_token_(raft_pool_token) {
 }
@@ -175,8 +217,18 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
     return;
   }
 
-  // Only allow one request at a time.
-  if (request_pending_) {
+  // Don't send anything while a tablet copy is being started.
+  if (tablet_copy_pending_) {
+    return;
+  }
+
+  // If requests are already in flight, only send another one if it can carry
+  // new operations: status-only requests aren't pipelined, and neither is
+  // anything while the peer is failing or has yet to be caught up with.
+  const bool pipelined = num_calls_in_flight_ > 0;
+  if (pipelined &&
+      (num_calls_in_flight_ >= FLAGS_consensus_max_in_flight_requests_per_peer ||
+       failed_attempts_ > 0)) {
     return;
   }
 
@@ -202,31 +254,38 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
     return;
   }
 
-  // The peer has no pending request nor is sending: send the request.
+  // Assemble the request.
+  UpdateCall* call = NewCallUnlocked();
+  ConsensusRequestPB* request = &call->request;
   bool needs_tablet_copy = false;
-  int64_t commit_index_before = request_.has_committed_index() ?
-      request_.committed_index() : kMinimumOpIdIndex;
-  Status s = queue_->RequestForPeer(peer_pb_.permanent_uuid(), &request_,
-                                    &replicate_msg_refs_, &needs_tablet_copy);
-  int64_t commit_index_after = request_.has_committed_index() ?
-      request_.committed_index() : kMinimumOpIdIndex;
+  int64_t commit_index_before = last_committed_index_sent_;
+  Status s = queue_->RequestForPeer(peer_pb_.permanent_uuid(), pipelined, request,
+                                    &call->replicate_msg_refs, &needs_tablet_copy);
+  int64_t commit_index_after = request->has_committed_index() ?
+      request->committed_index() : kMinimumOpIdIndex;
 
   if (PREDICT_FALSE(!s.ok())) {
     LOG_WITH_PREFIX_UNLOCKED(INFO) << "Could not obtain request from queue for peer: "
         << peer_pb_.permanent_uuid() << ". Status: " << s.ToString();
+    ReleaseCallUnlocked(call);
     return;
   }
 
   if (PREDICT_FALSE(needs_tablet_copy)) {
+    ReleaseCallUnlocked(call);
+    // Let the requests in flight finish before starting the tablet copy.
+    if (pipelined) {
+      return;
+    }
     Status s = PrepareTabletCopyRequest();
     if (s.ok()) {
-      controller_.Reset();
-      request_pending_ = true;
+      tc_controller_.Reset();
+      tablet_copy_pending_ = true;
       l.unlock();
       // Capture a shared_ptr reference into the RPC callback so that we're guaranteed
       // that this object outlives the RPC.
       shared_ptr<Peer> s_this = shared_from_this();
-      proxy_->StartTabletCopy(&tc_request_, &tc_response_, &controller_,
+      proxy_->StartTabletCopy(&tc_request_, &tc_response_, &tc_controller_,
                               [s_this]() {
                                 s_this->ProcessTabletCopyResponse();
                               });
@@ -237,16 +296,21 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
     return;
   }
 
-  request_.set_tablet_id(tablet_id_);
-  request_.set_caller_uuid(leader_uuid_);
-  request_.set_dest_uuid(peer_pb_.permanent_uuid());
+  request->set_tablet_id(tablet_id_);
+  request->set_caller_uuid(leader_uuid_);
+  request->set_dest_uuid(peer_pb_.permanent_uuid());
 
-  bool req_has_ops = request_.ops_size() > 0 || (commit_index_after > commit_index_before);
+  bool req_has_ops = request->ops_size() > 0 || (commit_index_after > commit_index_before);
   // If the queue is empty, check if we were told to send a status-only
   // message, if not just return.
-  if (PREDICT_FALSE(!req_has_ops && !even_if_queue_empty)) {
+  if (PREDICT_FALSE((!req_has_ops && !even_if_queue_empty) ||
+                    (pipelined && request->ops_size() == 0))) {
+    ReleaseCallUnlocked(call);
     return;
   }
+  // Only now is the request certain to be sent, so only now may later
+  // requests assume the peer has learned of this commit index.
+  last_committed_index_sent_ = commit_index_after;
 
   if (req_has_ops) {
     // If we're actually sending ops there's no need to heartbeat for a while.
@@ -257,32 +321,56 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
 
 
   VLOG_WITH_PREFIX_UNLOCKED(2) << "Sending to peer " << peer_pb().permanent_uuid() << ": "
-      << SecureShortDebugString(request_);
-  controller_.Reset();
+      << SecureShortDebugString(*request);
+  call->controller.Reset();
+  call->send_time = MonoTime::Now();
+
+  const bool has_ops = request->ops_size() > 0;
+  if (has_ops && FLAGS_consensus_send_ops_in_sidecar && !ops_sidecar_unsupported_ &&
+      proxy_->SupportsOpsSidecar()) {
+    WARN_NOT_OK(MoveOpsToSidecarUnlocked(call),
+                LogPrefixUnlocked() + "Unable to send operations in a sidecar");
+  }
 
-  request_pending_ = true;
+  num_calls_in_flight_++;
+  // If the window allows it, follow up right away with any further operations
+  // that didn't fit in this request.
+  bool send_more = has_ops &&
+      num_calls_in_flight_ < FLAGS_consensus_max_in_flight_requests_per_peer;
   l.unlock();
   // Capture a shared_ptr reference into the RPC callback so that we're guaranteed
   // that this object outlives the RPC.
   shared_ptr<Peer> s_this = shared_from_this();
-  proxy_->UpdateAsync(&request_, &response_, &controller_,
-                      [s_this]() {
-                        s_this->ProcessResponse();
+  proxy_->UpdateAsync(request, &call->response, &call->controller,
+                      [s_this, call]() {
+                        s_this->ProcessResponse(call);
                       });
+  if (send_more) {
+    WARN_NOT_OK(SignalRequest(false), "Unable to pipeline request to peer");
+  }
 }
 
-void Peer::ProcessResponse() {
+void Peer::ProcessResponse(UpdateCall* call) {
   // Note: This method runs on the reactor thread.
   std::unique_lock<simple_spinlock> lock(peer_lock_);
   if (closed_) {
+    ReleaseCallUnlocked(call);
     return;
   }
-  CHECK(request_pending_);
+  CHECK_GT(num_calls_in_flight_, 0);
 
   MAYBE_FAULT(FLAGS_fault_crash_after_leader_request_fraction);
 
-  if (!controller_.status().ok()) {
-    if (controller_.status().IsRemoteError()) {
+  const ConsensusResponsePB& response = call->response;
+  if (!call->controller.status().ok()) {
+    if (call->controller.status().IsRemoteError()) {
+      const rpc::ErrorStatusPB* err = call->controller.error_response();
+      if (call->request.has_ops_sidecar_idx() && err &&
+          err->unsupported_feature_flags_size() > 0) {
+        LOG_WITH_PREFIX_UNLOCKED(INFO) << "Peer doesn't accept operations in a sidecar, "
+                                       << "sending them in requests from now on";
+        ops_sidecar_unsupported_ = true;
+      }
       // Most controller errors are caused by network issues or corner cases
       // like shutdown and failure to serialize a protobuf. Therefore, we
       // generally consider these errors to indicate an unreachable peer.
@@ -291,29 +379,29 @@ void Peer::ProcessResponse() {
       // the queue know that the remote is responsive.
       queue_->NotifyPeerIsResponsive(peer_pb_.permanent_uuid());
     }
-    ProcessResponseError(controller_.status());
+    ProcessResponseError(call, call->controller.status());
     return;
   }
 
   // Notify consensus that the peer has failed.
-  if (response_.has_error() && response_.error().code() == TabletServerErrorPB::TABLET_FAILED) {
-    Status response_status = StatusFromPB(response_.error().status());
+  if (response.has_error() && response.error().code() == TabletServerErrorPB::TABLET_FAILED) {
+    Status response_status = StatusFromPB(response.error().status());
     queue_->NotifyPeerHasFailed(peer_pb_.permanent_uuid(),
                                 response_status.ToString());
-    ProcessResponseError(response_status);
+    ProcessResponseError(call, response_status);
     return;
   }
 
   // Pass through errors we can respond to, like not found, since in that case
   // we will need to start a Tablet Copy. TODO: Handle DELETED response once implemented.
-  if ((response_.has_error() &&
-      response_.error().code() != TabletServerErrorPB::TABLET_NOT_FOUND) ||
-      (response_.status().has_error() &&
-          response_.status().error().code() == consensus::ConsensusErrorPB::CANNOT_PREPARE)) {
+  if ((response.has_error() &&
+      response.error().code() != TabletServerErrorPB::TABLET_NOT_FOUND) ||
+      (response.status().has_error() &&
+          response.status().error().code() == consensus::ConsensusErrorPB::CANNOT_PREPARE)) {
     // Again, let the queue know that the remote is still responsive, since we
     // will not be sending this error response through to the queue.
     queue_->NotifyPeerIsResponsive(peer_pb_.permanent_uuid());
-    ProcessResponseError(StatusFromPB(response_.error().status()));
+    ProcessResponseError(call, StatusFromPB(response.error().status()));
     return;
   }
 
@@ -325,32 +413,44 @@ void Peer::ProcessResponse() {
   // Capture a weak_ptr reference into the submitted functor so that we can
   // safely handle the functor outliving its peer.
   weak_ptr<Peer> w_this = shared_from_this();
-  Status s = raft_pool_token_->SubmitFunc([w_this]() {
+  Status s = raft_pool_token_->SubmitFunc([w_this, call]() {
     if (auto p = w_this.lock()) {
-      p->DoProcessResponse();
-
+      p->DoProcessResponse(call);
+    } else {
+      delete call;
     }
   });
   if (PREDICT_FALSE(!s.ok())) {
     LOG_WITH_PREFIX_UNLOCKED(WARNING) << "Unable to process peer response: " << s.ToString()
-        << ": " << SecureShortDebugString(response_);
-    request_pending_ = false;
+        << ": " << SecureShortDebugString(response);
+    num_calls_in_flight_--;
+    ReleaseCallUnlocked(call);
   }
 }
 
-void Peer::DoProcessResponse() {
+void Peer::DoProcessResponse(UpdateCall* call) {
 
   VLOG_WITH_PREFIX_UNLOCKED(2) << "Response from peer " << peer_pb().permanent_uuid() << ": "
-      << SecureShortDebugString(response_);
+      << SecureShortDebugString(call->response);
 
   bool more_pending;
-  queue_->ResponseFromPeer(peer_pb_.permanent_uuid(), response_, &more_pending);
+  queue_->ResponseFromPeer(peer_pb_.permanent_uuid(), call->response, &more_pending);
+  if (!call->response.has_error() && !call->response.status().has_error()) {
+    // The peer withholds its vote from other candidates for a while after
+    // accepting a request, which extends our lease.
+    queue_->NotifyPeerAcceptedRequest(peer_pb_.permanent_uuid(),
+                                      call->request.caller_term(),
+                                      call->send_time);
+  }
 
   {
     std::unique_lock<simple_spinlock> lock(peer_lock_);
-    CHECK(request_pending_);
-    failed_attempts_ = 0;
-    request_pending_ = false;
+    if (!closed_) {
+      CHECK_GT(num_calls_in_flight_, 0);
+      failed_attempts_ = 0;
+      num_calls_in_flight_--;
+    }
+    ReleaseCallUnlocked(call);
   }
   // We're OK to read the state_ without a lock here -- if we get a race,
   // the worst thing that could happen is that we'll make one more request before
@@ -360,6 +460,43 @@ void Peer::DoProcessResponse() {
   }
 }
 
+Peer::UpdateCall* Peer::NewCallUnlocked() {
+  DCHECK(peer_lock_.is_locked());
+  if (free_calls_.empty()) {
+    return new UpdateCall();
+  }
+  UpdateCall* call = free_calls_.back().release();
+  free_calls_.pop_back();
+  return call;
+}
+
+Status Peer::MoveOpsToSidecarUnlocked(UpdateCall* call) {
+  DCHECK(peer_lock_.is_locked());
+  ConsensusRequestPB* request = &call->request;
+  DCHECK_EQ(request->ops_size(), call->replicate_msg_refs.size());
+
+  int idx;
+  RETURN_NOT_OK(call->controller.AddOutboundSidecar(
+      rpc::RpcSidecar::FromSharedFaststring(
+          queue_->GetOpsSidecarData(call->replicate_msg_refs)),
+      &idx));
+  request->set_ops_sidecar_idx(idx);
+  request->mutable_ops()->ExtractSubrange(0, request->ops_size(), nullptr);
+  call->controller.RequireServerFeature(OPS_SIDECAR);
+  return Status::OK();
+}
+
+void Peer::ReleaseCallUnlocked(UpdateCall* call) {
+  DCHECK(peer_lock_.is_locked());
+  // Drop the references to the ops now rather than when the call is reused,
+  // so as not to hold up their eviction from the log cache. We don't own the
+  // ops in the request (the queue does).
+  call->request.mutable_ops()->ExtractSubrange(0, call->request.ops_size(), nullptr);
+  call->request.clear_ops_sidecar_idx();
+  call->replicate_msg_refs.clear();
+  free_calls_.emplace_back(call);
+}
+
 Status Peer::PrepareTabletCopyRequest() {
   if (!FLAGS_enable_tablet_copy) {
     failed_attempts_++;
@@ -377,12 +514,12 @@ void Peer::ProcessTabletCopyResponse() {
   if (closed_) {
     return;
   }
-  CHECK(request_pending_);
-  request_pending_ = false;
+  CHECK(tablet_copy_pending_);
+  tablet_copy_pending_ = false;
 
   // If the response is OK, or ALREADY_INPROGRESS, then consider the RPC successful.
   bool success =
-    controller_.status().ok() &&
+    tc_controller_.status().ok() &&
     (!tc_response_.has_error() ||
      tc_response_.error().code() == TabletServerErrorPB::TabletServerErrorPB::ALREADY_INPROGRESS);
 
@@ -394,19 +531,19 @@ void Peer::ProcessTabletCopyResponse() {
     // THROTTLED is a common response after a tserver with many replicas fails;
     // logging it would generate a great deal of log spam.
     LOG_WITH_PREFIX_UNLOCKED(WARNING) << "Unable to begin Tablet Copy on peer: "
-                                      << (controller_.status().ok() ?
+                                      << (tc_controller_.status().ok() ?
                                           SecureShortDebugString(tc_response_) :
-                                          controller_.status().ToString());
+                                          tc_controller_.status().ToString());
   }
 }
 
-void Peer::ProcessResponseError(const Status& status) {
+void Peer::ProcessResponseError(UpdateCall* call, const Status& status) {
   failed_attempts_++;
   string resp_err_info;
-  if (response_.has_error()) {
+  if (call->response.has_error()) {
     resp_err_info = Substitute(" Error code: $0 ($1).",
-                               TabletServerErrorPB::Code_Name(response_.error().code()),
-                               response_.error().code());
+                               TabletServerErrorPB::Code_Name(call->response.error().code()),
+                               call->response.error().code());
   }
   LOG_WITH_PREFIX_UNLOCKED(WARNING) << "Couldn't send request to peer " << peer_pb_.permanent_uuid()
       << " for tablet " << tablet_id_ << "."
@@ -414,7 +551,8 @@ void Peer::ProcessResponseError(const Status& status) {
       << " Status: " << status.ToString() << "."
       << " Retrying in the next heartbeat period."
       << " Already tried " << failed_attempts_ << " times.";
-  request_pending_ = false;
+  num_calls_in_flight_--;
+  ReleaseCallUnlocked(call);
 }
 
 string Peer::LogPrefixUnlocked() const {
@@ -440,23 +578,250 @@ Peer::~Peer() {
   if (heartbeater_) {
     heartbeater_->Stop();
   }
+}
 
+Peer::UpdateCall::~UpdateCall() {
   // We don't own the ops (the queue does).
-  request_.mutable_ops()->ExtractSubrange(0, request_.ops_size(), nullptr);
+  request.mutable_ops()->ExtractSubrange(0, request.ops_size(), nullptr);
+}
+
+namespace {
+
+Status CreateConsensusServiceProxyForHost(const shared_ptr<Messenger>& messenger,
+                                          const HostPort& hostport,
+                                          gscoped_ptr<ConsensusServiceProxy>* new_proxy) {
+  vector<Sockaddr> addrs;
+  RETURN_NOT_OK(hostport.ResolveAddresses(&addrs));
+  if (addrs.size() > 1) {
+    LOG(WARNING)<< "Peer address '" << hostport.ToString() << "' "
+    << "resolves to " << addrs.size() << " different addresses. Using "
+    << addrs[0].ToString();
+  }
+  new_proxy->reset(new ConsensusServiceProxy(messenger, addrs[0], hostport.host()));
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+// Coalesces the operation-free UpdateConsensus requests, i.e. heartbeats, that
+// the tablet leaders of this server send to one remote server into
+// MultiRaftUpdateConsensus RPCs. A batch is sent
+// --raft_heartbeat_batch_window_ms after its first request was added to it.
+//
+// If a batch fails as a whole, each of its requests is sent by itself instead,
+// so that errors are reported per tablet as without batching. So is each
+// request that the remote server deferred because its replica was busy. If
+// the remote server doesn't support batches, all subsequent requests are sent
+// by themselves.
+class MultiRaftHeartbeatBatcher : public std::enable_shared_from_this<MultiRaftHeartbeatBatcher> {
+ public:
+  // Returns the batcher for requests to the server 'dest_uuid' at 'hostport',
+  // sent through 'messenger', creating it if there is none yet.
+  static Status GetOrCreate(const shared_ptr<Messenger>& messenger,
+                            const string& dest_uuid,
+                            const HostPort& hostport,
+                            shared_ptr<MultiRaftHeartbeatBatcher>* batcher);
+
+  MultiRaftHeartbeatBatcher(shared_ptr<Messenger> messenger,
+                            string dest_uuid,
+                            gscoped_ptr<ConsensusServiceProxy> proxy)
+      : messenger_(std::move(messenger)),
+        dest_uuid_(std::move(dest_uuid)),
+        proxy_(std::move(proxy)),
+        supported_(true) {
+  }
+
+  // Adds 'request' to the next batch. Once the response to it has been
+  // written to 'response', runs 'callback'. If the request ends up having to
+  // be sent by itself, calls 'send_alone' instead.
+  void Add(const ConsensusRequestPB& request,
+           ConsensusResponsePB* response,
+           const rpc::ResponseCallback& callback,
+           const std::function<void()>& send_alone);
+
+ private:
+  struct Batch {
+    struct Entry {
+      ConsensusResponsePB* response;
+      rpc::ResponseCallback callback;
+      std::function<void()> send_alone;
+    };
+    MultiRaftUpdateConsensusRequestPB request;
+    MultiRaftUpdateConsensusResponsePB response;
+    rpc::RpcController controller;
+    vector<Entry> entries;
+  };
+
+  // Sends the batch being filled.
+  void SendBatch();
+
+  // Hands the responses in 'batch' to the requests it carried.
+  void BatchDone(const shared_ptr<Batch>& batch);
+
+  const shared_ptr<Messenger> messenger_;
+  const string dest_uuid_;
+  const gscoped_ptr<ConsensusServiceProxy> proxy_;
+
+  // Protects the fields below.
+  simple_spinlock lock_;
+
+  // The batch being filled, if any.
+  shared_ptr<Batch> pending_;
+
+  // False once the remote server turned out not to support batches.
+  bool supported_;
+};
+
+Status MultiRaftHeartbeatBatcher::GetOrCreate(const shared_ptr<Messenger>& messenger,
+                                              const string& dest_uuid,
+                                              const HostPort& hostport,
+                                              shared_ptr<MultiRaftHeartbeatBatcher>* batcher) {
+  // Batchers are kept alive by the proxies of the peers that use them. They
+  // are distinguished by messenger since a process may host several servers,
+  // as in tests.
+  static simple_spinlock registry_lock;
+  static auto* registry = new std::map<string, weak_ptr<MultiRaftHeartbeatBatcher>>();
+
+  string key = Substitute("$0 $1 $2", reinterpret_cast<uintptr_t>(messenger.get()),
+                          dest_uuid, hostport.ToString());
+  std::lock_guard<simple_spinlock> l(registry_lock);
+  auto it = registry->find(key);
+  if (it != registry->end()) {
+    shared_ptr<MultiRaftHeartbeatBatcher> existing = it->second.lock();
+    if (existing) {
+      *batcher = std::move(existing);
+      return Status::OK();
+    }
+  }
+
+  // Batchers for peers that have since gone away (e.g. after config changes
+  // or with short-lived messengers) would otherwise accumulate, so sweep them
+  // whenever a new batcher is needed.
+  for (auto e = registry->begin(); e != registry->end();) {
+    if (e->second.expired()) {
+      e = registry->erase(e);
+    } else {
+      ++e;
+    }
+  }
+
+  gscoped_ptr<ConsensusServiceProxy> proxy;
+  RETURN_NOT_OK(CreateConsensusServiceProxyForHost(messenger, hostport, &proxy));
+  auto created = std::make_shared<MultiRaftHeartbeatBatcher>(messenger, dest_uuid,
+                                                             std::move(proxy));
+  (*registry)[key] = created;
+  *batcher = std::move(created);
+  return Status::OK();
+}
+
+void MultiRaftHeartbeatBatcher::Add(const ConsensusRequestPB& request,
+                                    ConsensusResponsePB* response,
+                                    const rpc::ResponseCallback& callback,
+                                    const std::function<void()>& send_alone) {
+  DCHECK_EQ(0, request.ops_size());
+  std::unique_lock<simple_spinlock> l(lock_);
+  if (PREDICT_FALSE(!supported_)) {
+    l.unlock();
+    send_alone();
+    return;
+  }
+  bool schedule = false;
+  if (!pending_) {
+    pending_ = std::make_shared<Batch>();
+    pending_->request.set_dest_uuid(dest_uuid_);
+    schedule = true;
+  }
+  pending_->request.add_requests()->CopyFrom(request);
+  pending_->entries.push_back({ response, callback, send_alone });
+  l.unlock();
+
+  if (schedule) {
+    // The batcher is kept alive by the peers waiting on the batch.
+    shared_ptr<MultiRaftHeartbeatBatcher> s_this = shared_from_this();
+    messenger_->ScheduleOnReactor(
+        [s_this](const Status& /* s */) { s_this->SendBatch(); },
+        MonoDelta::FromMilliseconds(FLAGS_raft_heartbeat_batch_window_ms));
+  }
+}
+
+void MultiRaftHeartbeatBatcher::SendBatch() {
+  shared_ptr<Batch> batch;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    batch.swap(pending_);
+  }
+  if (!batch) return;
+  batch->controller.set_timeout(MonoDelta::FromMilliseconds(FLAGS_consensus_rpc_timeout_ms));
+  shared_ptr<MultiRaftHeartbeatBatcher> s_this = shared_from_this();
+  proxy_->MultiRaftUpdateConsensusAsync(batch->request, &batch->response, &batch->controller,
+                                        [s_this, batch]() { s_this->BatchDone(batch); });
+}
+
+void MultiRaftHeartbeatBatcher::BatchDone(const shared_ptr<Batch>& batch) {
+  // Note: This method runs on the reactor thread.
+  const Status& s = batch->controller.status();
+  if (PREDICT_TRUE(s.ok() && !batch->response.has_error() &&
+                   batch->response.responses_size() == batch->entries.size())) {
+    vector<bool> deferred(batch->entries.size(), false);
+    for (int idx : batch->response.deferred_idx()) {
+      if (idx >= 0 && idx < deferred.size()) {
+        deferred[idx] = true;
+      }
+    }
+    for (int i = 0; i < batch->entries.size(); i++) {
+      Batch::Entry& entry = batch->entries[i];
+      if (PREDICT_FALSE(deferred[i])) {
+        entry.send_alone();
+        continue;
+      }
+      entry.response->Swap(batch->response.mutable_responses(i));
+      entry.callback();
+    }
+    return;
+  }
+
+  const rpc::ErrorStatusPB* err = batch->controller.error_response();
+  if (s.IsRemoteError() && err && err->has_code() &&
+      (err->code() == rpc::ErrorStatusPB::ERROR_NO_SUCH_METHOD ||
+       err->code() == rpc::ErrorStatusPB::ERROR_INVALID_REQUEST)) {
+    LOG(INFO) << "Server " << dest_uuid_ << " doesn't support batched heartbeats, "
+              << "sending them individually: " << s.ToString();
+    std::lock_guard<simple_spinlock> l(lock_);
+    supported_ = false;
+  } else {
+    KLOG_EVERY_N_SECS(WARNING, 10) << "Unable to send batch of " << batch->entries.size()
+                                   << " heartbeats to server " << dest_uuid_ << ", sending "
+                                   << "them individually: "
+                                   << (s.ok() ? SecureShortDebugString(batch->response) :
+                                       s.ToString());
+  }
+  for (Batch::Entry& entry : batch->entries) {
+    entry.send_alone();
+  }
 }
 
 RpcPeerProxy::RpcPeerProxy(gscoped_ptr<HostPort> hostport,
-                           gscoped_ptr<ConsensusServiceProxy> consensus_proxy)
+                           gscoped_ptr<ConsensusServiceProxy> consensus_proxy,
+                           shared_ptr<MultiRaftHeartbeatBatcher> heartbeat_batcher)
     : hostport_(std::move(hostport)),
-      consensus_proxy_(std::move(consensus_proxy)) {
+      consensus_proxy_(std::move(consensus_proxy)),
+      heartbeat_batcher_(std::move(heartbeat_batcher)) {
 }
 
 void RpcPeerProxy::UpdateAsync(const ConsensusRequestPB* request,
                                ConsensusResponsePB* response,
                                rpc::RpcController* controller,
                                const rpc::ResponseCallback& callback) {
-  controller->set_timeout(MonoDelta::FromMilliseconds(FLAGS_consensus_rpc_timeout_ms));
-  consensus_proxy_->UpdateConsensusAsync(*request, response, controller, callback);
+  auto send_alone = [this, request, response, controller, callback]() {
+    controller->set_timeout(MonoDelta::FromMilliseconds(FLAGS_consensus_rpc_timeout_ms));
+    consensus_proxy_->UpdateConsensusAsync(*request, response, controller, callback);
+  };
+  if (heartbeat_batcher_ && request->ops_size() == 0 && !request->has_ops_sidecar_idx() &&
+      FLAGS_raft_heartbeat_batch_window_ms > 0) {
+    heartbeat_batcher_->Add(*request, response, callback, send_alone);
+    return;
+  }
+  send_alone();
 }
 
 void RpcPeerProxy::RequestConsensusVoteAsync(const VoteRequestPB* request,
@@ -475,24 +840,6 @@ void RpcPeerProxy::StartTabletCopy(const StartTabletCopyRequestPB* request,
 
 RpcPeerProxy::~RpcPeerProxy() {}
 
-namespace {
-
-Status CreateConsensusServiceProxyForHost(const shared_ptr<Messenger>& messenger,
-                                          const HostPort& hostport,
-                                          gscoped_ptr<ConsensusServiceProxy>* new_proxy) {
-  vector<Sockaddr> addrs;
-  RETURN_NOT_OK(hostport.ResolveAddresses(&addrs));
-  if (addrs.size() > 1) {
-    LOG(WARNING)<< "Peer address '" << hostport.ToString() << "' "
-    << "resolves to " << addrs.size() << " different addresses. Using "
-    << addrs[0].ToString();
-  }
-  new_proxy->reset(new ConsensusServiceProxy(messenger, addrs[0], hostport.host()));
-  return Status::OK();
-}
-
-} // anonymous namespace
-
 RpcPeerProxyFactory::RpcPeerProxyFactory(shared_ptr<Messenger> messenger)
     : messenger_(std::move(messenger)) {}
 
@@ -502,7 +849,13 @@ Status RpcPeerProxyFactory::NewProxy(const RaftPeerPB& peer_pb,
   RETURN_NOT_OK(HostPortFromPB(peer_pb.last_known_addr(), hostport.get()));
   gscoped_ptr<ConsensusServiceProxy> new_proxy;
   RETURN_NOT_OK(CreateConsensusServiceProxyForHost(messenger_, *hostport, &new_proxy));
-  proxy->reset(new RpcPeerProxy(std::move(hostport), std::move(new_proxy)));
+  shared_ptr<MultiRaftHeartbeatBatcher> heartbeat_batcher;
+  if (FLAGS_raft_heartbeat_batch_window_ms > 0) {
+    RETURN_NOT_OK(MultiRaftHeartbeatBatcher::GetOrCreate(
+        messenger_, peer_pb.permanent_uuid(), *hostport, &heartbeat_batcher));
+  }
+  proxy->reset(new RpcPeerProxy(std::move(hostport), std::move(new_proxy),
+                                std::move(heartbeat_batcher)));
   return Status::OK();
 }
 
@@ -34,6 +34,7 @@
 #include "kudu/rpc/response_callback.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -47,6 +48,7 @@ class PeriodicTimer;
 
 namespace consensus {
 class ConsensusServiceProxy;
+class MultiRaftHeartbeatBatcher;
 class PeerProxy;
 class PeerMessageQueue;
 
@@ -118,17 +120,38 @@ class Peer : public std::enable_shared_from_this<Peer> {
        gscoped_ptr<PeerProxy> proxy,
        std::shared_ptr<rpc::Messenger> messenger);
 
+  // The state of an UpdateConsensus RPC to the peer. Several of them may be
+  // in flight at once if requests to the peer are pipelined.
+  struct UpdateCall {
+    ~UpdateCall();
+
+    ConsensusRequestPB request;
+    ConsensusResponsePB response;
+
+    // Reference-counted pointers to any ReplicateMsgs which are in-flight to
+    // the peer. We may have loaded these messages from the LogCache, in which
+    // case we are potentially sharing the same object as other peers. Since
+    // the PB request itself can't hold reference counts, this holds them.
+    std::vector<ReplicateRefPtr> replicate_msg_refs;
+
+    rpc::RpcController controller;
+
+    // When the request was sent. The peer received it no earlier than that,
+    // which bounds the leader lease its acceptance grants.
+    MonoTime send_time;
+  };
+
   void SendNextRequest(bool even_if_queue_empty);
 
-  // Signals that a response was received from the peer.
+  // Signals that a response was received from the peer for 'call'.
   //
   // This method is called from the reactor thread and calls
   // DoProcessResponse() on raft_pool_token_ to do any work that requires IO or
   // lock-taking.
-  void ProcessResponse();
+  void ProcessResponse(UpdateCall* call);
 
   // Run on 'raft_pool_token'. Does response handling that requires IO or may block.
-  void DoProcessResponse();
+  void DoProcessResponse(UpdateCall* call);
 
   // Fetch the desired tablet copy request from the queue and set up
   // tc_request_ appropriately.
@@ -140,8 +163,20 @@ class Peer : public std::enable_shared_from_this<Peer> {
   // Handle RPC callback from initiating tablet copy.
   void ProcessTabletCopyResponse();
 
-  // Signals there was an error sending the request to the peer.
-  void ProcessResponseError(const Status& status);
+  // Signals there was an error sending the request of 'call' to the peer.
+  void ProcessResponseError(UpdateCall* call, const Status& status);
+
+  // Moves the ops of the request of 'call' into a sidecar of its controller,
+  // shared with the requests to other peers for the same ops.
+  Status MoveOpsToSidecarUnlocked(UpdateCall* call);
+
+  // Returns a call whose buffers may be used for a new request. Must be
+  // called with 'peer_lock_' held.
+  UpdateCall* NewCallUnlocked();
+
+  // Takes back a call that is no longer in flight, keeping its buffers for
+  // reuse. Must be called with 'peer_lock_' held.
+  void ReleaseCallUnlocked(UpdateCall* call);
 
   std::string LogPrefixUnlocked() const;
 
@@ -157,21 +192,16 @@ class Peer : public std::enable_shared_from_this<Peer> {
   PeerMessageQueue* queue_;
   uint64_t failed_attempts_;
 
-  // The latest consensus update request and response.
-  ConsensusRequestPB request_;
-  ConsensusResponsePB response_;
+  // Calls that aren't in flight, kept so that their buffers can be reused.
+  std::vector<std::unique_ptr<UpdateCall>> free_calls_;
+
+  // The committed index in the latest request assembled for the peer.
+  int64_t last_committed_index_sent_;
 
   // The latest tablet copy request and response.
   StartTabletCopyRequestPB tc_request_;
   StartTabletCopyResponsePB tc_response_;
-
-  // Reference-counted pointers to any ReplicateMsgs which are in-flight to the peer. We
-  // may have loaded these messages from the LogCache, in which case we are potentially
-  // sharing the same object as other peers. Since the PB request_ itself can't hold
-  // reference counts, this holds them.
-  std::vector<ReplicateRefPtr> replicate_msg_refs_;
-
-  rpc::RpcController controller_;
+  rpc::RpcController tc_controller_;
 
   std::shared_ptr<rpc::Messenger> messenger_;
 
@@ -185,9 +215,14 @@ class Peer : public std::enable_shared_from_this<Peer> {
 
   // lock that protects Peer state changes, initialization, etc.
   mutable simple_spinlock peer_lock_;
-  bool request_pending_ = false;
+  // The number of UpdateConsensus RPCs in flight to the peer. At most
+  // --consensus_max_in_flight_requests_per_peer.
+  int num_calls_in_flight_ = 0;
+  bool tablet_copy_pending_ = false;
   bool closed_ = false;
   bool has_sent_first_request_ = false;
+  // Set once the peer has turned out not to accept ops in a sidecar.
+  bool ops_sidecar_unsupported_ = false;
 
 };
 
@@ -202,6 +237,11 @@ class PeerProxy {
                            rpc::RpcController* controller,
                            const rpc::ResponseCallback& callback) = 0;
 
+  // Whether UpdateAsync() sends the RPC sidecars of 'controller' along with
+  // the request, i.e. whether the ops of a request may be passed in a
+  // sidecar (see ConsensusRequestPB::ops_sidecar_idx).
+  virtual bool SupportsOpsSidecar() const { return false; }
+
   // Sends a RequestConsensusVote to a remote peer.
   virtual void RequestConsensusVoteAsync(const VoteRequestPB* request,
                                          VoteResponsePB* response,
@@ -235,14 +275,19 @@ class PeerProxyFactory {
 // PeerProxy implementation that does RPC calls
 class RpcPeerProxy : public PeerProxy {
  public:
+  // If 'heartbeat_batcher' is set, requests that carry no operations are sent
+  // through it, coalesced with those of other tablets to the same server.
   RpcPeerProxy(gscoped_ptr<HostPort> hostport,
-               gscoped_ptr<ConsensusServiceProxy> consensus_proxy);
+               gscoped_ptr<ConsensusServiceProxy> consensus_proxy,
+               std::shared_ptr<MultiRaftHeartbeatBatcher> heartbeat_batcher);
 
   virtual void UpdateAsync(const ConsensusRequestPB* request,
                            ConsensusResponsePB* response,
                            rpc::RpcController* controller,
                            const rpc::ResponseCallback& callback) OVERRIDE;
 
+  bool SupportsOpsSidecar() const override { return true; }
+
   virtual void RequestConsensusVoteAsync(const VoteRequestPB* request,
                                          VoteResponsePB* response,
                                          rpc::RpcController* controller,
@@ -258,6 +303,7 @@ class RpcPeerProxy : public PeerProxy {
  private:
   gscoped_ptr<HostPort> hostport_;
   gscoped_ptr<ConsensusServiceProxy> consensus_proxy_;
+  std::shared_ptr<MultiRaftHeartbeatBatcher> heartbeat_batcher_;
 };
 
 // PeerProxyFactory implementation that generates RPCPeerProxies
@@ -17,6 +17,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -43,6 +44,7 @@
 #include "kudu/consensus/metadata.pb.h"
 #include "kudu/consensus/opid.pb.h"
 #include "kudu/consensus/opid_util.h"
+#include "kudu/consensus/ops_sidecar.h"
 #include "kudu/consensus/ref_counted_replicate.h"
 #include "kudu/consensus/time_manager.h"
 #include "kudu/fs/fs_manager.h"
@@ -51,6 +53,7 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/async_util.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/pb_util.h"
@@ -63,6 +66,7 @@ DECLARE_int32(consensus_max_batch_size_bytes);
 
 METRIC_DECLARE_entity(tablet);
 
+using std::shared_ptr;
 using std::vector;
 
 namespace kudu {
@@ -650,6 +654,93 @@ TEST_F(ConsensusQueueTest, TestQueueHandlesOperationOverwriting) {
   request.mutable_ops()->ExtractSubrange(0, request.ops().size(), nullptr);
 }
 
+// Tests that requests to a peer can be pipelined, each picking up after the
+// last operation sent rather than the last one acknowledged, and that
+// responses processed out of order don't move the peer's watermarks backward.
+TEST_F(ConsensusQueueTest, TestPipelinedRequestsAndOutOfOrderResponses) {
+  queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(2));
+
+  // Size the batches to hold 10 ops each, as in TestGetPagedMessages.
+  const int kOpsPerRequest = 10;
+  ConsensusRequestPB page_size_estimator;
+  page_size_estimator.set_caller_term(14);
+  page_size_estimator.set_committed_index(0);
+  page_size_estimator.set_all_replicated_index(0);
+  page_size_estimator.set_last_idx_appended_to_leader(0);
+  page_size_estimator.mutable_preceding_id()->CopyFrom(MinimumOpId());
+  for (int i = 0; i < kOpsPerRequest; i++) {
+    page_size_estimator.mutable_ops()->AddAllocated(
+        CreateDummyReplicate(0, 0, clock_->Now(), 0).release());
+  }
+  google::FlagSaver saver;
+  FLAGS_consensus_max_batch_size_bytes = page_size_estimator.ByteSize();
+
+  ConsensusRequestPB requests[4];
+  vector<ReplicateRefPtr> refs[4];
+  ConsensusResponsePB response;
+  response.set_responder_uuid(kPeerUuid);
+  bool more_pending = false;
+  bool needs_tablet_copy;
+  UpdatePeerWatermarkToOp(&requests[0], &response, MinimumOpId(), MinimumOpId(), &more_pending);
+  AppendReplicateMessagesToQueue(queue_.get(), clock_, 1, 100);
+
+  // The last exchange failed, so nothing may be pipelined.
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, true, &requests[0], &refs[0],
+                                   &needs_tablet_copy));
+  ASSERT_EQ(0, requests[0].ops_size());
+
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, false, &requests[0], &refs[0],
+                                   &needs_tablet_copy));
+  ASSERT_EQ(kOpsPerRequest, requests[0].ops_size());
+  SetLastReceivedAndLastCommitted(&response, requests[0].ops(kOpsPerRequest - 1).id());
+  queue_->ResponseFromPeer(kPeerUuid, response, &more_pending);
+  ASSERT_TRUE(more_pending);
+
+  // Now that the peer is caught up with, send three requests back to back.
+  for (int i = 1; i < 4; i++) {
+    ASSERT_OK(queue_->RequestForPeer(kPeerUuid, i > 1, &requests[i], &refs[i],
+                                     &needs_tablet_copy));
+    ASSERT_EQ(kOpsPerRequest, requests[i].ops_size());
+    ASSERT_EQ(i * kOpsPerRequest + 1, requests[i].ops(0).id().index());
+  }
+
+  // The response to the last one arrives first.
+  SetLastReceivedAndLastCommitted(&response, requests[3].ops(kOpsPerRequest - 1).id());
+  queue_->ResponseFromPeer(kPeerUuid, response, &more_pending);
+  ASSERT_EQ(40, queue_->GetTrackedPeerForTests(kPeerUuid).last_received.index());
+
+  // The earlier responses don't move the peer backward.
+  for (int i = 1; i < 3; i++) {
+    SetLastReceivedAndLastCommitted(&response, requests[i].ops(kOpsPerRequest - 1).id());
+    queue_->ResponseFromPeer(kPeerUuid, response, &more_pending);
+    PeerMessageQueue::TrackedPeer peer = queue_->GetTrackedPeerForTests(kPeerUuid);
+    ASSERT_EQ(40, peer.last_received.index());
+    ASSERT_EQ(41, peer.next_index);
+  }
+
+  // And the next pipelined request resumes after what was acknowledged.
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, true, &requests[0], &refs[0],
+                                   &needs_tablet_copy));
+  ASSERT_EQ(41, requests[0].ops(0).id().index());
+
+  // An LMP mismatch, e.g. from a pipelined request that overtook the one
+  // preceding it, stops pipelining until a request succeeds again. Since it
+  // was sent before the peer acknowledged op 40, the op it reports is stale.
+  RefuseWithLogPropertyMismatch(&response, MakeOpId(3, 25), MakeOpId(3, 25));
+  queue_->ResponseFromPeer(kPeerUuid, response, &more_pending);
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, true, &requests[1], &refs[1],
+                                   &needs_tablet_copy));
+  ASSERT_EQ(0, requests[1].ops_size());
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, false, &requests[1], &refs[1],
+                                   &needs_tablet_copy));
+  ASSERT_EQ(41, requests[1].ops(0).id().index());
+
+  // Extract the ops from the requests to avoid double frees.
+  for (auto& request : requests) {
+    request.mutable_ops()->ExtractSubrange(0, request.ops_size(), nullptr);
+  }
+}
+
 // Test for a bug where we wouldn't move any watermark back, when overwriting
 // operations, which would cause a check failure on the write immediately
 // following the overwriting write.
@@ -813,6 +904,44 @@ TEST_F(ConsensusQueueTest, TestOnlyAdvancesWatermarkWhenPeerHasAPrefixOfOurLog)
   request.mutable_ops()->ExtractSubrange(0, request.ops().size(), nullptr);
 }
 
+// Test that the leader lease starts when the latest request accepted by a
+// majority of the voters was sent, and only counts requests of the current term.
+TEST_F(ConsensusQueueTest, TestLeaderLeaseStartTime) {
+  queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(3));
+  queue_->TrackPeer("peer-1");
+  queue_->TrackPeer("peer-2");
+
+  // Only the local peer counts towards the lease so far.
+  ASSERT_FALSE(queue_->GetLeaderLeaseStartTime().Initialized());
+
+  // Requests of other terms don't count.
+  const MonoTime first_send_time = MonoTime::Now();
+  queue_->NotifyPeerAcceptedRequest("peer-1", kMinimumTerm + 1, first_send_time);
+  ASSERT_FALSE(queue_->GetLeaderLeaseStartTime().Initialized());
+
+  // Together with the local peer, peer-1 makes a majority.
+  queue_->NotifyPeerAcceptedRequest("peer-1", kMinimumTerm, first_send_time);
+  ASSERT_EQ(first_send_time.ToString(), queue_->GetLeaderLeaseStartTime().ToString());
+
+  // A later request accepted by peer-2 extends the lease, and an earlier one
+  // answered out of order doesn't shorten it.
+  const MonoTime second_send_time = first_send_time + MonoDelta::FromMilliseconds(10);
+  queue_->NotifyPeerAcceptedRequest("peer-2", kMinimumTerm, second_send_time);
+  ASSERT_EQ(second_send_time.ToString(), queue_->GetLeaderLeaseStartTime().ToString());
+  queue_->NotifyPeerAcceptedRequest("peer-2", kMinimumTerm, first_send_time);
+  ASSERT_EQ(second_send_time.ToString(), queue_->GetLeaderLeaseStartTime().ToString());
+
+  // A new term starts without a lease.
+  queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm + 1, BuildRaftConfigPBForTests(3));
+  ASSERT_FALSE(queue_->GetLeaderLeaseStartTime().Initialized());
+  queue_->NotifyPeerAcceptedRequest("peer-2", kMinimumTerm + 1, second_send_time);
+  ASSERT_TRUE(queue_->GetLeaderLeaseStartTime().Initialized());
+
+  // Neither does a non-leader hold one.
+  queue_->SetNonLeaderMode();
+  ASSERT_FALSE(queue_->GetLeaderLeaseStartTime().Initialized());
+}
+
 // Test that Tablet Copy is triggered when a "tablet not found" error occurs.
 TEST_F(ConsensusQueueTest, TestTriggerTabletCopyIfTabletNotFound) {
   queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(3));
@@ -880,5 +1009,29 @@ TEST_F(ConsensusQueueTest, TestFollowerCommittedIndexAndMetrics) {
   ASSERT_EQ(5, queue_->metrics_.num_ops_behind_leader->value());
 }
 
+// Test that requests for the same range of ops share their sidecar content.
+TEST_F(ConsensusQueueTest, TestOpsSidecarDataIsShared) {
+  vector<ReplicateRefPtr> msgs;
+  for (int i = 1; i <= 3; i++) {
+    msgs.push_back(make_scoped_refptr_replicate(
+        CreateDummyReplicate(1, i, clock_->Now(), 100).release()));
+  }
+  shared_ptr<const faststring> data = queue_->GetOpsSidecarData(msgs);
+  faststring expected;
+  AppendOpsForSidecar(msgs, &expected);
+  ASSERT_EQ(expected.ToString(), data->ToString());
+  ASSERT_EQ(data, queue_->GetOpsSidecarData(msgs));
+
+  // A different range has its own content.
+  vector<ReplicateRefPtr> tail(msgs.begin() + 1, msgs.end());
+  shared_ptr<const faststring> tail_data = queue_->GetOpsSidecarData(tail);
+  ASSERT_NE(data, tail_data);
+  ASSERT_EQ(tail_data, queue_->GetOpsSidecarData(tail));
+
+  // Content that no request refers to anymore is built anew.
+  tail_data.reset();
+  ASSERT_EQ(expected.ToString(), queue_->GetOpsSidecarData(msgs)->ToString());
+}
+
 }  // namespace consensus
 }  // namespace kudu
@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_set>
@@ -33,6 +34,7 @@
 #include "kudu/common/timestamp.h"
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/consensus/opid_util.h"
+#include "kudu/consensus/ops_sidecar.h"
 #include "kudu/consensus/quorum_util.h"
 #include "kudu/consensus/time_manager.h"
 #include "kudu/gutil/bind.h"
@@ -45,6 +47,7 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/fault_injection.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
@@ -74,6 +77,7 @@ DECLARE_bool(safe_time_advancement_without_writes);
 using kudu::log::Log;
 using kudu::pb_util::SecureDebugString;
 using kudu::pb_util::SecureShortDebugString;
+using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::vector;
@@ -96,10 +100,10 @@ METRIC_DEFINE_gauge_int64(tablet, ops_behind_leader, "Operations Behind Leader",
 
 std::string PeerMessageQueue::TrackedPeer::ToString() const {
   return Substitute("Peer: $0, Is new: $1, Last received: $2, Next index: $3, "
-                    "Last known committed idx: $4, Last exchange result: $5, "
-                    "Needs tablet copy: $6",
+                    "Pipelined next index: $4, Last known committed idx: $5, "
+                    "Last exchange result: $6, Needs tablet copy: $7",
                     uuid, is_new, OpIdToString(last_received), next_index,
-                    last_known_committed_index,
+                    pipelined_next_index, last_known_committed_index,
                     is_last_exchange_successful ? "SUCCESS" : "ERROR",
                     needs_tablet_copy);
 }
@@ -155,6 +159,10 @@ void PeerMessageQueue::SetLeaderMode(int64_t committed_index,
     CHECK_GT(current_term, queue_state_.current_term) << "Terms should only increase";
     queue_state_.first_index_in_current_term = boost::none;
     queue_state_.current_term = current_term;
+    // Requests accepted in previous terms don't count towards the lease.
+    for (const PeersMap::value_type& entry : peers_map_) {
+      entry.second->last_accepted_request_send_time = MonoTime();
+    }
   }
 
   queue_state_.committed_index = committed_index;
@@ -212,6 +220,7 @@ void PeerMessageQueue::TrackPeerUnlocked(const string& uuid) {
   // does not have a log that matches ours, the normal queue negotiation
   // process will eventually find the right point to resume from.
   tracked_peer->next_index = queue_state_.last_appended.index() + 1;
+  tracked_peer->pipelined_next_index = tracked_peer->next_index;
   InsertOrDie(&peers_map_, uuid, tracked_peer);
 
   CheckPeersInActiveConfigIfLeaderUnlocked();
@@ -359,6 +368,14 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
                                         ConsensusRequestPB* request,
                                         vector<ReplicateRefPtr>* msg_refs,
                                         bool* needs_tablet_copy) {
+  return RequestForPeer(uuid, false, request, msg_refs, needs_tablet_copy);
+}
+
+Status PeerMessageQueue::RequestForPeer(const string& uuid,
+                                        bool pipelined,
+                                        ConsensusRequestPB* request,
+                                        vector<ReplicateRefPtr>* msg_refs,
+                                        bool* needs_tablet_copy) {
   // Maintain a thread-safe copy of necessary members.
   OpId preceding_id;
   int num_voters;
@@ -410,17 +427,26 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
   }
   *needs_tablet_copy = false;
 
+  // A pipelined request follows on from the last one sent to the peer, which
+  // only makes sense if the peer has been accepting what we've sent it.
+  int64_t next_index = peer.next_index;
+  bool send_ops = !peer.is_new;
+  if (pipelined) {
+    next_index = peer.pipelined_next_index;
+    send_ops &= peer.is_last_exchange_successful;
+  }
+
   // If we've never communicated with the peer, we don't know what messages to
   // send, so we'll send a status-only request. Otherwise, we grab requests
   // from the log starting at the last_received point.
-  if (!peer.is_new) {
+  if (send_ops) {
 
     // The batch of messages to send to the peer.
     vector<ReplicateRefPtr> messages;
     int max_batch_size = FLAGS_consensus_max_batch_size_bytes - request->ByteSize();
 
     // We try to get the follower's next_index from our log.
-    Status s = log_cache_.ReadOps(peer.next_index - 1,
+    Status s = log_cache_.ReadOps(next_index - 1,
                                   max_batch_size,
                                   &messages,
                                   &preceding_id);
@@ -461,6 +487,16 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
   DCHECK(preceding_id.IsInitialized());
   request->mutable_preceding_id()->CopyFrom(preceding_id);
 
+  // Record how far we've sent, so that a subsequent pipelined request picks up
+  // where this one leaves off.
+  if (request->ops_size() > 0) {
+    std::lock_guard<simple_spinlock> lock(queue_lock_);
+    TrackedPeer* peer_ptr = FindPtrOrNull(peers_map_, uuid);
+    if (peer_ptr != nullptr) {
+      peer_ptr->pipelined_next_index = request->ops(request->ops_size() - 1).id().index() + 1;
+    }
+  }
+
   // If we are sending ops to the follower, but the batch doesn't reach the current
   // committed index, we can consider the follower lagging, and it's worth
   // logging this fact periodically.
@@ -498,6 +534,31 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
   return Status::OK();
 }
 
+shared_ptr<const faststring> PeerMessageQueue::GetOpsSidecarData(
+    const vector<ReplicateRefPtr>& msgs) {
+  DCHECK(!msgs.empty());
+  const OpId& first = msgs.front()->get()->id();
+  const OpId& last = msgs.back()->get()->id();
+  {
+    std::lock_guard<simple_spinlock> l(ops_sidecar_lock_);
+    shared_ptr<const faststring> data = ops_sidecar_data_.lock();
+    if (data && OpIdEquals(ops_sidecar_first_, first) &&
+        OpIdEquals(ops_sidecar_last_, last)) {
+      return data;
+    }
+  }
+
+  // Build the content outside the lock. Should several peers race to build
+  // the same range, only the last one built is kept for reuse.
+  shared_ptr<faststring> data = std::make_shared<faststring>();
+  AppendOpsForSidecar(msgs, data.get());
+  std::lock_guard<simple_spinlock> l(ops_sidecar_lock_);
+  ops_sidecar_data_ = data;
+  ops_sidecar_first_ = first;
+  ops_sidecar_last_ = last;
+  return data;
+}
+
 Status PeerMessageQueue::GetTabletCopyRequestForPeer(const string& uuid,
                                                      StartTabletCopyRequestPB* req) {
   TrackedPeer* peer = nullptr;
@@ -623,6 +684,20 @@ void PeerMessageQueue::NotifyPeerIsResponsive(const string& peer_uuid) {
   peer->last_successful_communication_time = MonoTime::Now();
 }
 
+void PeerMessageQueue::NotifyPeerAcceptedRequest(const string& peer_uuid,
+                                                 int64_t term,
+                                                 MonoTime send_time) {
+  std::lock_guard<simple_spinlock> l(queue_lock_);
+  if (queue_state_.mode != LEADER || term != queue_state_.current_term) return;
+  TrackedPeer* peer = FindPtrOrNull(peers_map_, peer_uuid);
+  if (!peer) return;
+  // Pipelined requests may be answered out of order.
+  if (!peer->last_accepted_request_send_time.Initialized() ||
+      peer->last_accepted_request_send_time < send_time) {
+    peer->last_accepted_request_send_time = send_time;
+  }
+}
+
 void PeerMessageQueue::NotifyPeerHasFailed(const string& peer_uuid, const string& reason) {
   std::unique_lock<simple_spinlock> l(queue_lock_);
   TrackedPeer* peer = FindPtrOrNull(peers_map_, peer_uuid);
@@ -693,7 +768,10 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
 
     // Update the peer status based on the response.
     peer->is_new = false;
-    peer->last_known_committed_index = status.last_committed_idx();
+    // A peer's committed index never goes backwards, but with pipelined
+    // requests a stale response may be processed after a more recent one.
+    peer->last_known_committed_index = std::max(peer->last_known_committed_index,
+                                                status.last_committed_idx());
     peer->last_successful_communication_time = MonoTime::Now();
 
     // If the reported last-received op for the replica is in our local log,
@@ -703,7 +781,17 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
     // is guaranteed by the Raft protocol to be a valid op.
 
     bool peer_has_prefix_of_log = IsOpInLog(status.last_received());
-    if (peer_has_prefix_of_log) {
+    if (peer_has_prefix_of_log &&
+        !previous.is_new &&
+        previous.is_last_exchange_successful &&
+        status.last_received().index() < previous.last_received.index()) {
+      // With pipelined requests, a response may be processed after that of a
+      // later request. It carries nothing we don't already know, and the peer's
+      // log can't have shrunk since then.
+      VLOG_WITH_PREFIX_UNLOCKED(2) << "Ignoring stale progress in response from peer "
+                                   << peer_uuid << ": " << SecureShortDebugString(response);
+
+    } else if (peer_has_prefix_of_log) {
       // If the latest thing in their log is in our log, we are in sync.
       peer->last_received = status.last_received();
       peer->next_index = peer->last_received.index() + 1;
@@ -731,6 +819,14 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
           << "Falling back to committed index " << peer->last_known_committed_index;
     }
 
+    // Requests sent while this one was in flight still count towards where a
+    // pipelined request should resume, unless the peer needs to be rewound.
+    if (PREDICT_FALSE(status.has_error()) || peer->next_index < previous.next_index) {
+      peer->pipelined_next_index = peer->next_index;
+    } else {
+      peer->pipelined_next_index = std::max(peer->pipelined_next_index, peer->next_index);
+    }
+
     if (PREDICT_FALSE(status.has_error())) {
       peer->is_last_exchange_successful = false;
       switch (status.error().code()) {
@@ -874,6 +970,30 @@ bool PeerMessageQueue::IsCommittedIndexInCurrentTerm() const {
       queue_state_.committed_index >= *queue_state_.first_index_in_current_term;
 }
 
+MonoTime PeerMessageQueue::GetLeaderLeaseStartTime() const {
+  std::lock_guard<simple_spinlock> lock(queue_lock_);
+  if (queue_state_.mode != LEADER) return MonoTime();
+
+  // The local peer never votes for another candidate while it's the leader.
+  vector<MonoTime> send_times;
+  for (const RaftPeerPB& peer_pb : queue_state_.active_config->peers()) {
+    if (peer_pb.member_type() != RaftPeerPB::VOTER) continue;
+    if (peer_pb.permanent_uuid() == local_peer_pb_.permanent_uuid()) {
+      send_times.push_back(MonoTime::Now());
+      continue;
+    }
+    const TrackedPeer* peer = FindPtrOrNull(peers_map_, peer_pb.permanent_uuid());
+    if (peer && peer->last_accepted_request_send_time.Initialized()) {
+      send_times.push_back(peer->last_accepted_request_send_time);
+    }
+  }
+  if (static_cast<int>(send_times.size()) < queue_state_.majority_size_) return MonoTime();
+
+  // The majority_size_-th latest send time.
+  std::sort(send_times.begin(), send_times.end());
+  return send_times[send_times.size() - queue_state_.majority_size_];
+}
+
 int64_t PeerMessageQueue::GetMajorityReplicatedIndexForTests() const {
   std::lock_guard<simple_spinlock> lock(queue_lock_);
   return queue_state_.majority_replicated_index;
@@ -47,6 +47,7 @@
 
 namespace kudu {
 class ThreadPoolToken;
+class faststring;
 
 namespace log {
 class Log;
@@ -69,9 +70,11 @@ extern const char kConsensusQueueParentTrackerId[];
 // This also takes care of pushing requests to peers as new operations are
 // added, and notifying RaftConsensus when the commit index advances.
 //
-// TODO(todd): Right now this class is able to track one outstanding operation
-// per peer. If we want to have more than one outstanding RPC we need to
-// modify it.
+// Requests to a peer may be pipelined: while earlier requests are in flight,
+// further requests carry the operations that follow the last one sent rather
+// than those following the last one acknowledged. Responses may be processed
+// out of order, so a response never moves a peer's acknowledged position
+// backwards.
 class PeerMessageQueue {
  public:
   struct TrackedPeer {
@@ -79,6 +82,7 @@ class PeerMessageQueue {
         : uuid(std::move(uuid)),
           is_new(true),
           next_index(kInvalidOpIdIndex),
+          pipelined_next_index(kInvalidOpIdIndex),
           last_received(MinimumOpId()),
           last_known_committed_index(MinimumOpId().index()),
           is_last_exchange_successful(false),
@@ -110,6 +114,11 @@ class PeerMessageQueue {
     // This corresponds to "nextIndex" as specified in Raft.
     int64_t next_index;
 
+    // Next index to send to the peer in a pipelined request, i.e. one sent
+    // while others are still in flight. This is one past the last operation
+    // sent so far, and is never behind 'next_index'.
+    int64_t pipelined_next_index;
+
     // The last operation that we've sent to this peer and that
     // it acked. Used for watermark movement.
     OpId last_received;
@@ -128,6 +137,11 @@ class PeerMessageQueue {
     // Whether the follower was detected to need tablet copy.
     bool needs_tablet_copy;
 
+    // The time at which the latest request of the current term that the peer
+    // accepted was sent, if any. Having accepted it, the peer won't vote for
+    // another candidate for at least the minimum election timeout.
+    MonoTime last_accepted_request_send_time;
+
     // Throttler for how often we will log status messages pertaining to this
     // peer (eg when it is lagging, etc).
     logging::LogThrottler status_log_throttler;
@@ -226,6 +240,25 @@ class PeerMessageQueue {
                         std::vector<ReplicateRefPtr>* msg_refs,
                         bool* needs_tablet_copy);
 
+  // Returns the content of the ops sidecar of a request for 'msgs' (see
+  // AppendOpsForSidecar()). Peers that are sent the same range of ops, as
+  // caught-up peers usually are, share the same buffer rather than each
+  // copying the ops into their own.
+  //
+  // This method is thread-safe.
+  std::shared_ptr<const faststring> GetOpsSidecarData(
+      const std::vector<ReplicateRefPtr>& msgs);
+
+  // Like the above, but if 'pipelined' is true, assembles a request to be sent
+  // while other requests to the peer are still in flight. Such a request
+  // carries the operations following the last one sent to the peer, and no
+  // operations at all unless the last exchange with the peer was successful.
+  Status RequestForPeer(const std::string& uuid,
+                        bool pipelined,
+                        ConsensusRequestPB* request,
+                        std::vector<ReplicateRefPtr>* msg_refs,
+                        bool* needs_tablet_copy);
+
   // Fill in a StartTabletCopyRequest for the specified peer.
   // If that peer should not initiate Tablet Copy, returns a non-OK status.
   // On success, also internally resets peer->needs_tablet_copy to false.
@@ -239,6 +272,12 @@ class PeerMessageQueue {
   // it is alive and making progress.
   void NotifyPeerIsResponsive(const std::string& peer_uuid);
 
+  // Records that the given peer accepted a request of 'term' which was sent
+  // at 'send_time'. Used to track the leader's lease.
+  void NotifyPeerAcceptedRequest(const std::string& peer_uuid,
+                                 int64_t term,
+                                 MonoTime send_time);
+
   // Notify consensus that the given peer has failed.
   void NotifyPeerHasFailed(const std::string& peer_uuid,
                            const std::string& reason);
@@ -276,6 +315,13 @@ class PeerMessageQueue {
   // Return true if the committed index falls within the current term.
   bool IsCommittedIndexInCurrentTerm() const;
 
+  // Returns the latest time such that a majority of the voters, counting the
+  // local peer, accepted requests of the current term sent at or after it.
+  // None of those voters will vote for another candidate until the minimum
+  // election timeout has elapsed since then. Returns an uninitialized
+  // MonoTime if not in leader mode or if no such time is known yet.
+  MonoTime GetLeaderLeaseStartTime() const;
+
   // Returns the current majority replicated index, for tests.
   int64_t GetMajorityReplicatedIndexForTests() const;
 
@@ -458,6 +504,15 @@ class PeerMessageQueue {
   // doesn't change.
   DFAKE_MUTEX(append_fake_lock_);
 
+  // The ops sidecar content last built by GetOpsSidecarData(), for as long as
+  // a request still refers to it, and the range of ops it holds. As ops of a
+  // given term and index are the same on all peers, the range identifies the
+  // content.
+  simple_spinlock ops_sidecar_lock_;
+  std::weak_ptr<const faststring> ops_sidecar_data_; // Protected by ops_sidecar_lock_.
+  OpId ops_sidecar_first_; // Protected by ops_sidecar_lock_.
+  OpId ops_sidecar_last_; // Protected by ops_sidecar_lock_.
+
   LogCache log_cache_;
 
   Metrics metrics_;
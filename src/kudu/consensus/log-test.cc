@@ -23,6 +23,7 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <vector>
 
@@ -44,13 +45,16 @@
 #include "kudu/consensus/log_util.h"
 #include "kudu/consensus/opid.pb.h"
 #include "kudu/consensus/opid_util.h"
+#include "kudu/consensus/shared_log_syncer.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/bind.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/move.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/async_util.h"
+#include "kudu/util/countdown_latch.h"
 #include "kudu/util/compression/compression.pb.h"
 #include "kudu/util/env.h"
 #include "kudu/util/metrics.h"
@@ -63,6 +67,9 @@
 DEFINE_int32(num_batches, 10000,
              "Number of batches to write to/read from the Log in TestWriteManyBatches");
 
+DECLARE_bool(log_pipelined_sync);
+DECLARE_bool(log_shared_sync);
+DECLARE_int32(log_compression_dictionary_bytes);
 DECLARE_int32(log_min_segments_to_retain);
 DECLARE_int32(log_max_segments_to_retain);
 DECLARE_double(log_inject_io_error_on_preallocate_fraction);
@@ -1052,6 +1059,45 @@ TEST_P(LogTestOptionalCompression, TestReadReplicatesHighIndex) {
   ASSERT_GT(op_id.index(), std::numeric_limits<int32_t>::max());
 }
 
+// Test that a compression dictionary is built from the first entries of the
+// log, used for subsequent segments, and kept across restarts.
+TEST_F(LogTest, TestCompressionDictionary) {
+  FLAGS_log_compression_codec = "LZ4";
+  FLAGS_log_compression_dictionary_bytes = 256;
+  ASSERT_OK(BuildLog());
+
+  const int kNumSegments = 2;
+  const int kNumOpsPerSegment = 20;
+  OpId op_id = MakeOpId(1, 1);
+  for (int i = 0; i < kNumSegments; i++) {
+    for (int j = 0; j < kNumOpsPerSegment; j++) {
+      ASSERT_OK(AppendNoOp(&op_id));
+    }
+    ASSERT_OK(log_->AllocateSegmentAndRollOver());
+  }
+
+  SegmentSequence segments;
+  ASSERT_OK(log_->reader()->GetSegmentsSnapshot(&segments));
+  ASSERT_EQ(kNumSegments + 1, segments.size());
+  ASSERT_FALSE(segments[0]->header().has_compression_dictionary());
+  const string dictionary = segments[1]->header().compression_dictionary();
+  ASSERT_FALSE(dictionary.empty());
+  ASSERT_LE(dictionary.size(), FLAGS_log_compression_dictionary_bytes);
+  ASSERT_EQ(dictionary, segments[2]->header().compression_dictionary());
+  for (int i = 0; i < kNumSegments; i++) {
+    vector<LogEntryPB*> entries;
+    ElementDeleter deleter(&entries);
+    ASSERT_OK(segments[i]->ReadEntries(&entries));
+    ASSERT_EQ(kNumOpsPerSegment, entries.size());
+  }
+  ASSERT_OK(log_->Close());
+
+  ASSERT_OK(BuildLog());
+  ASSERT_OK(log_->reader()->GetSegmentsSnapshot(&segments));
+  ASSERT_EQ(dictionary, segments.back()->header().compression_dictionary());
+  ASSERT_OK(log_->Close());
+}
+
 // Test various situations where we expect different segments depending on what the
 // min log index is.
 TEST_F(LogTest, TestGetGCableDataSize) {
@@ -1129,6 +1175,194 @@ TEST_F(LogTest, TestDiskSpaceCheck) {
   // detect that we are past the preallocation limit.
 }
 
+static void RecordAppendCallback(vector<int>* order, int idx, CountDownLatch* latch,
+                                 const Status& s) {
+  CHECK_OK(s);
+  order->push_back(idx);
+  latch->CountDown();
+}
+
+// Test that many concurrently outstanding appends are synced and have their
+// callbacks run in order, whether or not syncs are pipelined with appends,
+// including across segment roll-overs.
+TEST_F(LogTest, TestPipelinedSync) {
+  options_.segment_size_mb = 1;
+  options_.force_fsync_all = true;
+  const int kNumBatches = 500;
+  OpId op_id = MakeOpId(1, 1);
+  int total_batches = 0;
+  for (bool pipelined : { false, true }) {
+    SCOPED_TRACE(pipelined);
+    FLAGS_log_pipelined_sync = pipelined;
+    ASSERT_OK(BuildLog());
+
+    vector<int> order;
+    CountDownLatch latch(kNumBatches);
+    for (int i = 0; i < kNumBatches; i++) {
+      consensus::ReplicateRefPtr replicate =
+          make_scoped_refptr_replicate(new ReplicateMsg());
+      replicate->get()->mutable_id()->CopyFrom(op_id);
+      replicate->get()->set_op_type(NO_OP);
+      replicate->get()->set_timestamp(clock_->Now().ToUint64());
+      replicate->get()->mutable_noop_request()->set_payload_for_tests(string(4096, 'x'));
+      op_id.set_index(op_id.index() + 1);
+      ASSERT_OK(log_->AsyncAppendReplicates(
+          { replicate }, Bind(&RecordAppendCallback, &order, i, &latch)));
+    }
+    latch.Wait();
+    ASSERT_EQ(kNumBatches, order.size());
+    for (int i = 0; i < kNumBatches; i++) {
+      ASSERT_EQ(i, order[i]);
+    }
+    ASSERT_OK(log_->Close());
+    total_batches += kNumBatches;
+
+    // Everything that was acknowledged must be readable once the log is
+    // reopened, and the appends must have spanned several segments.
+    ASSERT_OK(BuildLog());
+    SegmentSequence segments;
+    ASSERT_OK(log_->reader()->GetSegmentsSnapshot(&segments));
+    ASSERT_GT(segments.size(), 2);
+    int num_entries = 0;
+    for (const scoped_refptr<ReadableLogSegment>& segment : segments) {
+      vector<LogEntryPB*> entries;
+      ElementDeleter deleter(&entries);
+      ASSERT_OK(segment->ReadEntries(&entries));
+      num_entries += entries.size();
+    }
+    ASSERT_EQ(total_batches, num_entries);
+    ASSERT_OK(log_->Close());
+  }
+}
+
+// Test that the logs of different tablets share syncs of the WAL file system
+// when --log_shared_sync is set.
+TEST_F(LogTest, TestSharedSync) {
+  FLAGS_log_shared_sync = true;
+  options_.force_fsync_all = true;
+  ASSERT_OK(BuildLog());
+  scoped_refptr<Log> other_log;
+  ASSERT_OK(Log::Open(options_, fs_manager_.get(), "other-tablet",
+                      SchemaBuilder(schema_).Build(), 0, nullptr, &other_log));
+  std::shared_ptr<SharedLogSyncer> syncer = log_->shared_syncer_for_tests();
+  ASSERT_TRUE(syncer);
+  ASSERT_EQ(syncer.get(), other_log->shared_syncer_for_tests().get());
+
+  // Append to both logs concurrently.
+  const int kNumThreads = 2;
+  const int kNumOpsPerThread = 100;
+  vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    Log* log = t == 0 ? log_.get() : other_log.get();
+    threads.emplace_back([&, log]() {
+      OpId op_id = MakeOpId(1, 1);
+      for (int i = 0; i < kNumOpsPerThread; i++) {
+        CHECK_OK(AppendNoOpToLogSync(clock_, log, &op_id));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  // Syncs may be coalesced, but there can never be more of them than appends.
+  ASSERT_GT(syncer->num_syncs(), 0);
+  ASSERT_LE(syncer->num_syncs(), kNumThreads * kNumOpsPerThread);
+  // Unless syncfs() can't be trusted to report errors, the segments
+  // themselves are never fsynced.
+  if (SharedLogSyncer::SyncfsReportsWritebackErrors(env_->GetKernelRelease())) {
+    ASSERT_EQ(0, syncer->num_file_syncs());
+  }
+  ASSERT_OK(other_log->Close());
+  ASSERT_OK(log_->Close());
+
+  // Without forced fsyncs there is nothing to share.
+  options_.force_fsync_all = false;
+  ASSERT_OK(BuildLog());
+  ASSERT_FALSE(log_->shared_syncer_for_tests());
+  ASSERT_OK(log_->Close());
+}
+
+// Test that a shared sync also syncs the caller's own file on kernels whose
+// syncfs() doesn't report writeback errors, and only on those.
+TEST_F(LogTest, TestSharedSyncSyncsOwnFile) {
+  SharedLogSyncer syncer(env_, test_dir_);
+  ASSERT_OK(syncer.Init());
+  syncer.set_sync_file_after_syncfs_for_tests(true);
+  int num_file_syncs = 0;
+  ASSERT_OK(syncer.Sync([&]() {
+    num_file_syncs++;
+    return Status::OK();
+  }));
+  ASSERT_EQ(1, num_file_syncs);
+  ASSERT_EQ(1, syncer.num_file_syncs());
+
+  Status s = syncer.Sync([]() { return Status::IOError("injected writeback failure"); });
+  ASSERT_TRUE(s.IsIOError()) << s.ToString();
+
+  // A failure doesn't affect later syncs.
+  ASSERT_OK(syncer.Sync([]() { return Status::OK(); }));
+
+  syncer.set_sync_file_after_syncfs_for_tests(false);
+  ASSERT_OK(syncer.Sync([&]() {
+    num_file_syncs++;
+    return Status::OK();
+  }));
+  ASSERT_EQ(1, num_file_syncs);
+  ASSERT_EQ(4, syncer.num_syncs());
+  ASSERT_EQ(3, syncer.num_file_syncs());
+}
+
+TEST_F(LogTest, TestSyncfsReportsWritebackErrors) {
+  ASSERT_FALSE(SharedLogSyncer::SyncfsReportsWritebackErrors("2.6.32-754.el6.x86_64"));
+  ASSERT_FALSE(SharedLogSyncer::SyncfsReportsWritebackErrors("4.18.0-348.el8.x86_64"));
+  ASSERT_FALSE(SharedLogSyncer::SyncfsReportsWritebackErrors("5.4.0-150-generic"));
+  ASSERT_TRUE(SharedLogSyncer::SyncfsReportsWritebackErrors("5.8.0"));
+  ASSERT_TRUE(SharedLogSyncer::SyncfsReportsWritebackErrors("5.10.0-21-amd64"));
+  ASSERT_TRUE(SharedLogSyncer::SyncfsReportsWritebackErrors("6.1.0"));
+}
+
+// Test that replicates are written to the log from their kept serialized form,
+// when they have one, and read back unchanged.
+TEST_F(LogTest, TestAppendSerializedReplicates) {
+  ASSERT_OK(BuildLog());
+  vector<consensus::ReplicateRefPtr> replicates;
+  for (int i = 1; i <= 3; i++) {
+    consensus::ReplicateRefPtr replicate = make_scoped_refptr_replicate(new ReplicateMsg());
+    replicate->get()->mutable_id()->CopyFrom(MakeOpId(1, i));
+    replicate->get()->set_op_type(NO_OP);
+    replicate->get()->set_timestamp(clock_->Now().ToUint64());
+    replicate->get()->mutable_noop_request()->set_payload_for_tests(string(i * 100, 'x'));
+    replicates.push_back(replicate);
+  }
+  // Have one of them keep its serialized form, as the ops in the log cache
+  // do, and another carry the form it was received in, as a follower's ops
+  // received in a sidecar do.
+  ASSERT_EQ(replicates[0]->get()->SerializeAsString(),
+            replicates[0]->KeepSerialized()->ToString());
+  string serialized = replicates[1]->get()->SerializeAsString();
+  replicates[1] = make_scoped_refptr_replicate(new ReplicateMsg(*replicates[1]->get()),
+                                               Slice(serialized));
+  ASSERT_EQ(serialized, replicates[1]->Serialized()->ToString());
+
+  Synchronizer s;
+  ASSERT_OK(log_->AsyncAppendReplicates(replicates, s.AsStatusCallback()));
+  ASSERT_OK(s.Wait());
+  ASSERT_OK(log_->Close());
+
+  SegmentSequence segments;
+  ASSERT_OK(log_->reader()->GetSegmentsSnapshot(&segments));
+  ASSERT_EQ(1, segments.size());
+  vector<LogEntryPB*> entries;
+  ElementDeleter deleter(&entries);
+  ASSERT_OK(segments[0]->ReadEntries(&entries));
+  ASSERT_EQ(replicates.size(), entries.size());
+  for (int i = 0; i < entries.size(); i++) {
+    ASSERT_EQ(REPLICATE, entries[i]->type());
+    ASSERT_EQ(replicates[i]->get()->SerializeAsString(),
+              entries[i]->replicate().SerializeAsString());
+  }
+}
+
 // Test that the append thread shuts itself down after it's idle.
 TEST_F(LogTest, TestAutoStopIdleAppendThread) {
   ASSERT_OK(BuildLog());
@@ -26,12 +26,15 @@
 
 #include <boost/range/adaptor/reversed.hpp>
 #include <gflags/gflags.h>
+#include <google/protobuf/wire_format_lite.h>
+#include <google/protobuf/wire_format_lite_inl.h>
 
 #include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/log_index.h"
 #include "kudu/consensus/log_metrics.h"
 #include "kudu/consensus/log_reader.h"
 #include "kudu/consensus/log_util.h"
+#include "kudu/consensus/shared_log_syncer.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/bind.h"
@@ -42,8 +45,10 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/walltime.h"
 #include "kudu/util/async_util.h"
+#include "kudu/util/coding.h"
 #include "kudu/util/compression/compression.pb.h"
 #include "kudu/util/compression/compression_codec.h"
+#include "kudu/util/condition_variable.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
@@ -53,6 +58,7 @@
 #include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/random.h"
@@ -84,6 +90,24 @@ DEFINE_int32(group_commit_queue_size_bytes, 4 * 1024 * 1024,
              "Maximum size of the group commit queue in bytes");
 TAG_FLAG(group_commit_queue_size_bytes, advanced);
 
+DEFINE_bool(log_pipelined_sync, true,
+            "Whether to sync the log on a separate thread from the one appending "
+            "to it, so that a group of entries can be written while the previous "
+            "group is being synced. Syncs that are pending when the sync thread "
+            "becomes free are coalesced into one.");
+TAG_FLAG(log_pipelined_sync, advanced);
+TAG_FLAG(log_pipelined_sync, experimental);
+
+DEFINE_bool(log_shared_sync, false,
+            "Whether the WALs of all tablets should be made durable by shared "
+            "syncs of the file system holding the WAL directory instead of an "
+            "fsync of each tablet's active segment. Reduces the number of syncs "
+            "on servers hosting many tablets. Best suited to a WAL directory on "
+            "a dedicated disk, since the syncs also flush any other data written "
+            "to its file system. Only relevant if --log_force_fsync_all is set.");
+TAG_FLAG(log_shared_sync, advanced);
+TAG_FLAG(log_shared_sync, experimental);
+
 
 DEFINE_int32(log_thread_idle_threshold_ms, 1000,
              "Number of milliseconds after which the log append thread decides that a "
@@ -97,6 +121,20 @@ DEFINE_string(log_compression_codec, "LZ4",
               "Codec to use for compressing WAL segments.");
 TAG_FLAG(log_compression_codec, experimental);
 
+DEFINE_int32(log_compression_dictionary_bytes, 0,
+             "Size of the dictionary built from samples of the first entries "
+             "appended to a tablet's WAL, and used to compress the entries of its "
+             "subsequent segments. Improves the compression of small entry batches, "
+             "which share content such as the schema but have little redundancy "
+             "within themselves. Only used if the codec configured by "
+             "--log_compression_codec supports dictionaries. If 0, no dictionary "
+             "is used. Segments compressed with a dictionary can't be read by "
+             "versions of Kudu that predate this flag, e.g. when downgrading or "
+             "copying tablets to such servers during a rolling upgrade.");
+DEFINE_validator(log_compression_dictionary_bytes,
+                 [](const char* /*n*/, int32_t v) { return v >= 0 && v <= 64 * 1024; });
+TAG_FLAG(log_compression_dictionary_bytes, experimental);
+
 // Fault/latency injection flags.
 // -----------------------------
 DEFINE_bool(log_inject_latency, false,
@@ -172,6 +210,7 @@ using consensus::CommitMsg;
 using consensus::OpId;
 using consensus::ReplicateRefPtr;
 using env_util::OpenFileForRandom;
+using google::protobuf::internal::WireFormatLite;
 using std::shared_ptr;
 using std::string;
 using std::vector;
@@ -200,6 +239,12 @@ using strings::Substitute;
 //    ensure that it doesn't miss a concurrent wake-up. This is done in GoIdle().
 //
 // See the implementation comments in Wake() and GoIdle() for details.
+//
+// Unless --log_pipelined_sync is disabled, syncing the log and running the
+// callbacks of appended batches is handed off to a second single-threaded
+// pool, so that the next group can be appended while the previous one is
+// being synced. Groups that pile up while a sync is in progress are synced
+// together once it completes.
 class Log::AppendThread {
  public:
   explicit AppendThread(Log* log);
@@ -222,6 +267,10 @@ class Log::AppendThread {
     return base::subtle::NoBarrier_Load(&worker_state_) == WORKER_ACTIVE;
   }
 
+  // Waits until all groups handed off to the sync thread have been synced
+  // and their callbacks run.
+  void WaitForPendingSyncs();
+
  private:
   // The task submitted to the threadpool which collects batches from the queue
   // and appends them, until it determines that the queue is idle.
@@ -237,6 +286,16 @@ class Log::AppendThread {
   // LogEntryBatch* pointers.
   void HandleGroup(vector<LogEntryBatch*> entry_batches);
 
+  // Syncs the log if 'needs_sync' is true, then runs the callbacks of
+  // 'entry_batches' and deletes them. 'start' is when the oldest of the
+  // batches began to be appended.
+  void SyncAndRunCallbacks(vector<LogEntryBatch*> entry_batches, bool needs_sync,
+                           MonoTime start);
+
+  // The task submitted to sync_pool_, which syncs groups of appended batches
+  // until there are none left.
+  void DoSyncWork();
+
   string LogPrefix() const;
 
   Log* const log_;
@@ -254,11 +313,33 @@ class Log::AppendThread {
   // Pool with a single thread, which handles shutting down the thread
   // when idle.
   gscoped_ptr<ThreadPool> append_pool_;
+
+  // Pool with a single thread on which pipelined syncs are performed.
+  gscoped_ptr<ThreadPool> sync_pool_;
+
+  // Protects the fields below.
+  Mutex sync_lock_;
+
+  // Signaled when the sync task finishes.
+  ConditionVariable sync_done_cond_;
+
+  // Batches that were appended but whose sync has yet to start, whether any of
+  // them requires a sync (i.e. is not a COMMIT), and when the oldest of them
+  // began to be appended.
+  vector<LogEntryBatch*> unsynced_batches_;
+  bool unsynced_needs_sync_;
+  MonoTime unsynced_start_;
+
+  // Whether a DoSyncWork() task is queued or running.
+  bool sync_task_active_;
 };
 
 
 Log::AppendThread::AppendThread(Log *log)
-  : log_(log) {
+  : log_(log),
+    sync_done_cond_(&sync_lock_),
+    unsynced_needs_sync_(false),
+    sync_task_active_(false) {
 }
 
 Status Log::AppendThread::Init() {
@@ -273,6 +354,14 @@ Status Log::AppendThread::Init() {
                 // handles waiting for work while idle.
                 .set_idle_timeout(MonoDelta::FromSeconds(0))
                 .Build(&append_pool_));
+  RETURN_NOT_OK(ThreadPoolBuilder("wal-sync")
+                .set_min_threads(0)
+                .set_max_threads(1)
+                // Keep the thread around while the log is busy, since a sync
+                // task is submitted each time the sync thread catches up.
+                .set_idle_timeout(MonoDelta::FromMilliseconds(
+                    FLAGS_log_thread_idle_threshold_ms))
+                .Build(&sync_pool_));
   return Status::OK();
 }
 
@@ -345,14 +434,14 @@ void Log::AppendThread::DoWork() {
 }
 
 void Log::AppendThread::HandleGroup(vector<LogEntryBatch*> entry_batches) {
+  const MonoTime start = MonoTime::Now();
   if (log_->metrics_) {
     log_->metrics_->entry_batches_per_group->Increment(entry_batches.size());
   }
   TRACE_EVENT1("log", "batch", "batch_size", entry_batches.size());
 
-  SCOPED_LATENCY_METRIC(log_->metrics_, group_commit_latency);
-
   bool is_all_commits = true;
+  int64_t group_bytes = 0;
   for (LogEntryBatch* entry_batch : entry_batches) {
     TRACE_EVENT_FLOW_END0("log", "Batch", entry_batch);
     Status s = log_->DoAppend(entry_batch);
@@ -370,10 +459,63 @@ void Log::AppendThread::HandleGroup(vector<LogEntryBatch*> entry_batches) {
     if (is_all_commits && entry_batch->type_ != COMMIT) {
       is_all_commits = false;
     }
+    group_bytes += entry_batch->total_size_bytes();
+  }
+  if (log_->metrics_) {
+    log_->metrics_->bytes_per_group->Increment(group_bytes);
+  }
+
+  if (!FLAGS_log_pipelined_sync) {
+    SyncAndRunCallbacks(std::move(entry_batches), !is_all_commits, start);
+    return;
+  }
+
+  // Hand the group off to the sync thread, starting a sync task if there
+  // isn't one already.
+  MutexLock l(sync_lock_);
+  if (unsynced_batches_.empty()) {
+    unsynced_start_ = start;
+  }
+  unsynced_batches_.insert(unsynced_batches_.end(), entry_batches.begin(), entry_batches.end());
+  unsynced_needs_sync_ |= !is_all_commits;
+  if (!sync_task_active_) {
+    sync_task_active_ = true;
+    CHECK_OK(sync_pool_->SubmitClosure(Bind(&Log::AppendThread::DoSyncWork, Unretained(this))));
+  }
+}
+
+void Log::AppendThread::DoSyncWork() {
+  while (true) {
+    vector<LogEntryBatch*> entry_batches;
+    bool needs_sync;
+    MonoTime start;
+    {
+      MutexLock l(sync_lock_);
+      if (unsynced_batches_.empty()) {
+        sync_task_active_ = false;
+        sync_done_cond_.Broadcast();
+        return;
+      }
+      entry_batches.swap(unsynced_batches_);
+      needs_sync = unsynced_needs_sync_;
+      unsynced_needs_sync_ = false;
+      start = unsynced_start_;
+    }
+    SyncAndRunCallbacks(std::move(entry_batches), needs_sync, start);
   }
+}
 
+void Log::AppendThread::WaitForPendingSyncs() {
+  MutexLock l(sync_lock_);
+  while (sync_task_active_) {
+    sync_done_cond_.Wait();
+  }
+}
+
+void Log::AppendThread::SyncAndRunCallbacks(vector<LogEntryBatch*> entry_batches,
+                                            bool needs_sync, MonoTime start) {
   Status s;
-  if (!is_all_commits) {
+  if (needs_sync) {
     s = log_->Sync();
   }
   if (PREDICT_FALSE(!s.ok())) {
@@ -398,6 +540,10 @@ void Log::AppendThread::HandleGroup(vector<LogEntryBatch*> entry_batches) {
       delete entry_batch;
     }
   }
+  if (log_->metrics_) {
+    log_->metrics_->group_commit_latency->Increment(
+        (MonoTime::Now() - start).ToMicroseconds());
+  }
 }
 
 void Log::AppendThread::Shutdown() {
@@ -406,6 +552,10 @@ void Log::AppendThread::Shutdown() {
     append_pool_->Wait();
     append_pool_->Shutdown();
   }
+  if (sync_pool_) {
+    sync_pool_->Wait();
+    sync_pool_->Shutdown();
+  }
 }
 
 string Log::AppendThread::LogPrefix() const {
@@ -470,6 +620,7 @@ Log::Log(LogOptions options, FsManager* fs_manager, string log_path,
       sync_disabled_(false),
       allocation_state_(kAllocationNotStarted),
       codec_(nullptr),
+      compression_dictionary_sample_bytes_(0),
       metric_entity_(metric_entity) {
   CHECK_OK(ThreadPoolBuilder("log-alloc").set_max_threads(1).Build(&allocation_pool_));
   if (metric_entity_) {
@@ -490,6 +641,12 @@ Status Log::Init() {
     }
   }
 
+  if (FLAGS_log_shared_sync && force_sync_all_) {
+    RETURN_NOT_OK(SharedLogSyncer::GetOrCreate(fs_manager_->env(),
+                                               fs_manager_->GetWalsRootDir(),
+                                               &shared_syncer_));
+  }
+
   // Init the index
   log_index_.reset(new LogIndex(log_dir_));
 
@@ -509,7 +666,13 @@ Status Log::Init() {
 
     vector<scoped_refptr<ReadableLogSegment> > segments;
     RETURN_NOT_OK(reader_->GetSegmentsSnapshot(&segments));
-    active_segment_sequence_number_ = segments.back()->header().sequence_number();
+    const LogSegmentHeaderPB& last_header = segments.back()->header();
+    active_segment_sequence_number_ = last_header.sequence_number();
+
+    // Keep compressing with the tablet's existing dictionary, if any.
+    if (UseCompressionDictionary() && last_header.compression_codec() == codec_->type()) {
+      compression_dictionary_ = last_header.compression_dictionary();
+    }
   }
 
   if (force_sync_all_) {
@@ -561,6 +724,8 @@ Status Log::RollOver() {
 
   DCHECK_EQ(allocation_state(), kAllocationFinished);
 
+  // The sync thread must not be using the current segment while it's closed.
+  append_thread_->WaitForPendingSyncs();
   RETURN_NOT_OK(Sync());
   RETURN_NOT_OK(CloseCurrentSegment());
 
@@ -601,9 +766,13 @@ Status Log::AsyncAppendReplicates(const vector<ReplicateRefPtr>& replicates,
                                   const StatusCallback& callback) {
   unique_ptr<LogEntryBatchPB> batch_pb = CreateBatchFromAllocatedOperations(replicates);
 
-  unique_ptr<LogEntryBatch> batch;
-  RETURN_NOT_OK(CreateBatchFromPB(REPLICATE, std::move(batch_pb), &batch));
+  // The replicates are set before serializing the batch so that their
+  // serialized form is reused.
+  unique_ptr<LogEntryBatch> batch(new LogEntryBatch(
+      REPLICATE, std::move(batch_pb), replicates.size()));
   batch->SetReplicates(replicates);
+  batch->Serialize();
+  TRACE("Serialized $0 byte log entry", batch->total_size_bytes());
   return AsyncAppend(std::move(batch), callback);
 }
 
@@ -663,6 +832,10 @@ Status Log::DoAppend(LogEntryBatch* entry_batch) {
 
     RETURN_NOT_OK(active_segment_->WriteEntryBatch(entry_batch_data, codec_));
 
+    if (PREDICT_FALSE(compression_dictionary_.empty()) && UseCompressionDictionary()) {
+      SampleForCompressionDictionary(entry_batch_data);
+    }
+
     // Update the reader on how far it can read the active segment.
     reader_->UpdateLastSegmentOffset(active_segment_->written_offset());
 
@@ -681,6 +854,35 @@ Status Log::DoAppend(LogEntryBatch* entry_batch) {
   return Status::OK();
 }
 
+bool Log::UseCompressionDictionary() const {
+  return codec_ && codec_->SupportsDictionary() && FLAGS_log_compression_dictionary_bytes > 0;
+}
+
+void Log::SampleForCompressionDictionary(const Slice& entry_batch_data) {
+  // Entry batches of a tablet tend to share their leading bytes (e.g. the
+  // schema and the headers of the first entry), so a prefix of each sample is
+  // all that is needed.
+  const size_t dictionary_bytes = FLAGS_log_compression_dictionary_bytes;
+  Slice sample(entry_batch_data.data(), std::min(entry_batch_data.size(), dictionary_bytes));
+  compression_dictionary_samples_.emplace_back(sample.ToString());
+  compression_dictionary_sample_bytes_ += sample.size();
+
+  // Build the dictionary once enough distinct batches have been sampled to
+  // fill it. It is used starting with the next segment.
+  const int kMinSamples = 8;
+  if (compression_dictionary_samples_.size() < kMinSamples ||
+      compression_dictionary_sample_bytes_ < dictionary_bytes) {
+    return;
+  }
+  vector<Slice> samples(compression_dictionary_samples_.begin(),
+                        compression_dictionary_samples_.end());
+  compression_dictionary_ = BuildCompressionDictionary(samples, dictionary_bytes);
+  compression_dictionary_samples_.clear();
+  compression_dictionary_sample_bytes_ = 0;
+  VLOG_WITH_PREFIX(1) << Substitute("Built $0-byte WAL compression dictionary from $1 samples",
+                                    compression_dictionary_.size(), samples.size());
+}
+
 Status Log::UpdateIndexForBatch(const LogEntryBatch& batch,
                                 int64_t start_offset) {
   if (batch.type_ != REPLICATE) {
@@ -739,7 +941,11 @@ Status Log::Sync() {
 
   if (force_sync_all_ && !sync_disabled_) {
     LOG_SLOW_EXECUTION(WARNING, 50, Substitute("$0Fsync log took a long time", LogPrefix())) {
-      RETURN_NOT_OK(active_segment_->Sync());
+      if (shared_syncer_) {
+        RETURN_NOT_OK(shared_syncer_->Sync([this]() { return active_segment_->Sync(); }));
+      } else {
+        RETURN_NOT_OK(active_segment_->Sync());
+      }
 
       if (log_hooks_) {
         RETURN_NOT_OK_PREPEND(log_hooks_->PostSyncIfFsyncEnabled(),
@@ -1020,6 +1226,10 @@ Status Log::SwitchToAllocatedSegment() {
 
   if (codec_) {
     header.set_compression_codec(codec_->type());
+    if (!compression_dictionary_.empty()) {
+      header.set_compression_dictionary(compression_dictionary_);
+      header.add_incompatible_features(LogSegmentHeaderPB::COMPRESSION_DICTIONARY);
+    }
   }
 
   // Set up the new footer. This will be maintained as the segment is written.
@@ -1112,9 +1322,7 @@ LogEntryBatch::LogEntryBatch(LogEntryTypePB type,
                              size_t count)
     : type_(type),
       entry_batch_pb_(std::move(entry_batch_pb)),
-      total_size_bytes_(
-          PREDICT_FALSE(count == 1 && entry_batch_pb_->entry(0).type() == FLUSH_MARKER) ?
-          0 : entry_batch_pb_->ByteSize()),
+      total_size_bytes_(0),
       count_(count) {
 }
 
@@ -1134,8 +1342,44 @@ void LogEntryBatch::Serialize() {
   if (PREDICT_FALSE(count() == 1 && entry_batch_pb_->entry(0).type() == FLUSH_MARKER)) {
     return;
   }
-  buffer_.reserve(total_size_bytes_);
-  pb_util::AppendToString(*entry_batch_pb_, &buffer_);
+  if (type_ == REPLICATE && !replicates_.empty()) {
+    SerializeReplicates();
+  } else {
+    pb_util::AppendToString(*entry_batch_pb_, &buffer_);
+  }
+  total_size_bytes_ = buffer_.size();
+}
+
+void LogEntryBatch::SerializeReplicates() {
+  DCHECK_EQ(replicates_.size(), entry_batch_pb_->entry_size());
+  // Lay out each replicate's serialized form as protobuf would lay out the
+  // LogEntryPB holding it: 'type' followed by 'replicate'. Parsing the
+  // resulting buffer yields the same LogEntryBatchPB as 'entry_batch_pb_'.
+  const uint32_t entry_tag = WireFormatLite::MakeTag(
+      LogEntryBatchPB::kEntryFieldNumber, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  const uint32_t type_tag = WireFormatLite::MakeTag(
+      LogEntryPB::kTypeFieldNumber, WireFormatLite::WIRETYPE_VARINT);
+  const uint32_t replicate_tag = WireFormatLite::MakeTag(
+      LogEntryPB::kReplicateFieldNumber, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  const int type_size = WireFormatLite::TagSize(LogEntryPB::kTypeFieldNumber,
+                                                WireFormatLite::TYPE_ENUM) +
+                        WireFormatLite::EnumSize(REPLICATE);
+  const int replicate_tag_size = WireFormatLite::TagSize(LogEntryPB::kReplicateFieldNumber,
+                                                         WireFormatLite::TYPE_MESSAGE);
+  for (const consensus::ReplicateRefPtr& replicate : replicates_) {
+    // The log cache keeps the serialized form of the ops it holds, so these
+    // are usually copied rather than serialized here.
+    shared_ptr<const faststring> msg = replicate->Serialized();
+    uint32_t entry_size = type_size + replicate_tag_size +
+                          WireFormatLite::LengthDelimitedSize(msg->size());
+    PutVarint32(&buffer_, entry_tag);
+    PutVarint32(&buffer_, entry_size);
+    PutVarint32(&buffer_, type_tag);
+    PutVarint32(&buffer_, REPLICATE);
+    PutVarint32(&buffer_, replicate_tag);
+    PutVarint32(&buffer_, msg->size());
+    buffer_.append(msg->data(), msg->size());
+  }
 }
 
 
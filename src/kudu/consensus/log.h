@@ -64,6 +64,7 @@ struct RetentionIndexes;
 class LogEntryBatch;
 class LogIndex;
 class LogReader;
+class SharedLogSyncer;
 
 typedef BlockingQueue<LogEntryBatch*, LogEntryBatchLogicalSize> LogEntryBatchQueue;
 
@@ -214,6 +215,12 @@ class Log : public RefCountedThreadSafe<Log> {
   // Return true if the append thread is currently active.
   bool append_thread_active_for_tests() const;
 
+  // Returns the syncer shared with the other tablets' logs, or null if syncs
+  // aren't shared.
+  const std::shared_ptr<SharedLogSyncer>& shared_syncer_for_tests() const {
+    return shared_syncer_;
+  }
+
   // Forces the Log to allocate a new segment and roll over.
   // This can be used to make sure all entries appended up to this point are
   // available in closed, readable segments.
@@ -294,6 +301,13 @@ class Log : public RefCountedThreadSafe<Log> {
   // AppenderThread.
   Status DoAppend(LogEntryBatch* entry_batch);
 
+  // Returns whether entries should be compressed with a dictionary.
+  bool UseCompressionDictionary() const;
+
+  // Records a sample of a serialized entry batch, building
+  // 'compression_dictionary_' once enough samples have been collected.
+  void SampleForCompressionDictionary(const Slice& entry_batch_data);
+
   // Update footer_builder_ to reflect the log indexes seen in 'batch'.
   void UpdateFooterForBatch(LogEntryBatch* batch);
 
@@ -388,6 +402,10 @@ class Log : public RefCountedThreadSafe<Log> {
   // This is used to disable fsync during bootstrap.
   bool sync_disabled_;
 
+  // If set, syncs are coalesced with those of other tablets' logs on the same
+  // WAL file system. See --log_shared_sync.
+  std::shared_ptr<SharedLogSyncer> shared_syncer_;
+
   // The status of the most recent log-allocation action.
   Promise<Status> allocation_status_;
 
@@ -398,6 +416,18 @@ class Log : public RefCountedThreadSafe<Log> {
   // The codec used to compress entries, or nullptr if not configured.
   const CompressionCodec* codec_;
 
+  // The dictionary with which entries of new segments are compressed, or
+  // empty if there is none (yet).
+  //
+  // This and the samples below are only accessed during Init() and by the
+  // append thread.
+  std::string compression_dictionary_;
+
+  // Samples of appended entry batches from which to build
+  // 'compression_dictionary_', and their total size.
+  std::vector<std::string> compression_dictionary_samples_;
+  size_t compression_dictionary_sample_bytes_;
+
   scoped_refptr<MetricEntity> metric_entity_;
   gscoped_ptr<LogMetrics> metrics_;
 
@@ -455,6 +485,9 @@ class LogEntryBatch {
   // Serializes contents of the entry to an internal buffer.
   void Serialize();
 
+  // Serializes a REPLICATE batch from the serialized form of its replicates.
+  void SerializeReplicates();
+
   // Sets the callback that will be invoked after the entry is
   // appended and synced to disk
   void set_callback(const StatusCallback& cb) {
@@ -500,8 +533,8 @@ class LogEntryBatch {
   // Contents of the log entries that will be written to disk.
   std::unique_ptr<LogEntryBatchPB> entry_batch_pb_;
 
-   // Total size in bytes of all entries
-  const uint32_t total_size_bytes_;
+  // Total size in bytes of all entries, once serialized.
+  uint32_t total_size_bytes_;
 
   // Number of entries in 'entry_batch_pb_'
   const size_t count_;
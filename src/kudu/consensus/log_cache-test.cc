@@ -244,14 +244,16 @@ TEST_F(LogCacheTest, TestMemoryLimit) {
   FLAGS_log_cache_size_limit_mb = 1;
   CloseAndReopenCache(MinimumOpId());
 
-  const int kPayloadSize = 400 * 1024;
+  // Each op is charged twice its payload, as the cache keeps it both parsed
+  // and serialized.
+  const int kPayloadSize = 200 * 1024;
   // Limit should not be violated.
   ASSERT_OK(AppendReplicateMessagesToCache(1, 1, kPayloadSize));
   log_->WaitUntilAllFlushed();
   ASSERT_EQ(1, cache_->num_cached_ops());
 
-  // Verify the size is right. It's not exactly kPayloadSize because of in-memory
-  // overhead, etc.
+  // Verify the size is right. It's not exactly 2 * kPayloadSize because of
+  // in-memory overhead, etc.
   int size_with_one_msg = cache_->BytesUsed();
   ASSERT_GT(size_with_one_msg, 300 * 1024);
   ASSERT_LT(size_with_one_msg, 500 * 1024);
@@ -298,7 +300,8 @@ TEST_F(LogCacheTest, TestGlobalMemoryLimit) {
   // Exceed the global hard limit.
   ScopedTrackedConsumption consumption(cache_->parent_tracker_, 3*1024*1024);
 
-  const int kPayloadSize = 768 * 1024;
+  // Each op is charged twice its payload (see TestMemoryLimit).
+  const int kPayloadSize = 384 * 1024;
 
   // Should succeed, but only end up caching one of the two ops because of the global limit.
   ASSERT_OK(AppendReplicateMessagesToCache(1, 2, kPayloadSize));
@@ -18,6 +18,7 @@
 #include "kudu/consensus/log_cache.h"
 
 #include <map>
+#include <memory>
 #include <mutex>
 #include <vector>
 #include <ostream>
@@ -40,6 +41,7 @@
 #include "kudu/gutil/mathlimits.h"
 #include "kudu/gutil/strings/human_readable.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
@@ -78,6 +80,15 @@ static const char kParentMemTrackerId[] = "log_cache";
 
 typedef vector<const ReplicateMsg*>::const_iterator MsgIter;
 
+namespace {
+// Returns the memory charged for a cached message. The cache keeps the
+// serialized form of each message along with it (see AppendOperations()),
+// so both forms are charged.
+int64_t CachedMessageSize(const ReplicateRefPtr& msg) {
+  return msg->get()->SpaceUsed() + msg->KeepSerialized()->size();
+}
+} // anonymous namespace
+
 LogCache::LogCache(const scoped_refptr<MetricEntity>& metric_entity,
                    const scoped_refptr<log::Log>& log,
                    const string& local_uuid,
@@ -147,6 +158,14 @@ void LogCache::TruncateOpsAfterUnlocked(int64_t index) {
 
 Status LogCache::AppendOperations(const vector<ReplicateRefPtr>& msgs,
                                   const StatusCallback& callback) {
+  // Serialize the messages before taking the lock. Each message keeps its
+  // serialized form while it's cached, so that the WAL and the requests to
+  // all peers reuse it rather than serializing the message again.
+  int64_t mem_required = 0;
+  for (const auto& msg : msgs) {
+    mem_required += CachedMessageSize(msg);
+  }
+
   std::unique_lock<simple_spinlock> l(lock_);
 
   int size = msgs.size();
@@ -162,11 +181,6 @@ Status LogCache::AppendOperations(const vector<ReplicateRefPtr>& msgs,
   }
 
 
-  int64_t mem_required = 0;
-  for (const auto& msg : msgs) {
-    mem_required += msg->get()->SpaceUsed();
-  }
-
   // Try to consume the memory. If it can't be consumed, we may need to evict.
   bool borrowed_memory = false;
   if (!tracker_->TryConsume(mem_required)) {
@@ -278,9 +292,9 @@ namespace {
 // Calculate the total byte size that will be used on the wire to replicate
 // this message as part of a consensus update request. This accounts for the
 // length delimiting and tagging of the message.
-int64_t TotalByteSizeForMessage(const ReplicateMsg& msg) {
+int64_t TotalByteSizeForMessage(int64_t serialized_size) {
   int msg_size = google::protobuf::internal::WireFormatLite::LengthDelimitedSize(
-    msg.ByteSize());
+    serialized_size);
   msg_size += 1; // for the type tag
   return msg_size;
 }
@@ -329,7 +343,7 @@ Status LogCache::ReadOps(int64_t after_op_index,
       for (ReplicateMsg* msg : raw_replicate_ptrs) {
         CHECK_EQ(next_index, msg->id().index());
 
-        remaining_space -= TotalByteSizeForMessage(*msg);
+        remaining_space -= TotalByteSizeForMessage(msg->ByteSize());
         if (remaining_space > 0 || messages->empty()) {
           messages->push_back(make_scoped_refptr_replicate(msg));
           next_index++;
@@ -347,7 +361,7 @@ Status LogCache::ReadOps(int64_t after_op_index,
           continue;
         }
 
-        remaining_space -= TotalByteSizeForMessage(*msg->get());
+        remaining_space -= TotalByteSizeForMessage(msg->Serialized()->size());
         if (remaining_space < 0 && !messages->empty()) {
           break;
         }
@@ -397,8 +411,7 @@ void LogCache::EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evic
     }
 
     VLOG_WITH_PREFIX_UNLOCKED(2) << "Evicting cache. Removing: " << msg->get()->id();
-    AccountForMessageRemovalUnlocked(msg);
-    bytes_evicted += msg->get()->SpaceUsed();
+    bytes_evicted += AccountForMessageRemovalUnlocked(msg);
     cache_.erase(iter++);
 
     if (bytes_evicted >= bytes_to_evict) {
@@ -408,10 +421,12 @@ void LogCache::EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evic
   VLOG_WITH_PREFIX_UNLOCKED(1) << "Evicting log cache: after state: " << ToStringUnlocked();
 }
 
-void LogCache::AccountForMessageRemovalUnlocked(const ReplicateRefPtr& msg) {
-  tracker_->Release(msg->get()->SpaceUsed());
-  metrics_.log_cache_size->DecrementBy(msg->get()->SpaceUsed());
+int64_t LogCache::AccountForMessageRemovalUnlocked(const ReplicateRefPtr& msg) {
+  int64_t size = CachedMessageSize(msg);
+  tracker_->Release(size);
+  metrics_.log_cache_size->DecrementBy(size);
   metrics_.log_cache_num_ops->Decrement();
+  return size;
 }
 
 int64_t LogCache::BytesUsed() const {
@@ -155,8 +155,8 @@ class LogCache {
   void EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evict);
 
   // Update metrics and MemTracker to account for the removal of the
-  // given message.
-  void AccountForMessageRemovalUnlocked(const ReplicateRefPtr& msg);
+  // given message. Returns the number of bytes released.
+  int64_t AccountForMessageRemovalUnlocked(const ReplicateRefPtr& msg);
 
   void TruncateOpsAfterUnlocked(int64_t index);
 
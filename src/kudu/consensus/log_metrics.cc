@@ -48,6 +48,11 @@ METRIC_DEFINE_histogram(tablet, log_entry_batches_per_group, "Log Group Commit B
                         "Number of log entry batches in a group commit group",
                         1024, 2);
 
+METRIC_DEFINE_histogram(tablet, log_bytes_per_group, "Log Group Commit Size",
+                        kudu::MetricUnit::kBytes,
+                        "Number of bytes appended to the log in a group commit group",
+                        64LU * 1024 * 1024, 2);
+
 namespace kudu {
 namespace log {
 
@@ -58,7 +63,8 @@ LogMetrics::LogMetrics(const scoped_refptr<MetricEntity>& metric_entity)
       MINIT(append_latency),
       MINIT(group_commit_latency),
       MINIT(roll_latency),
-      MINIT(entry_batches_per_group) {
+      MINIT(entry_batches_per_group),
+      MINIT(bytes_per_group) {
 }
 #undef MINIT
 
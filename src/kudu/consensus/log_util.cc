@@ -348,6 +348,11 @@ Status ReadableLogSegment::InitCompressionCodec() {
   if (header_.has_compression_codec() && header_.compression_codec() != NO_COMPRESSION) {
     RETURN_NOT_OK_PREPEND(GetCompressionCodec(header_.compression_codec(), &codec_),
                           "could not init compression codec");
+    if (header_.has_compression_dictionary() && !codec_->SupportsDictionary()) {
+      return Status::Corruption(Substitute(
+          "log segment $0 has a compression dictionary but its codec ($1) doesn't support one",
+          path_, CompressionType_Name(header_.compression_codec())));
+    }
   }
   return Status::OK();
 }
@@ -433,9 +438,12 @@ Status ReadableLogSegment::ReadHeader() {
                                                 header_size),
                         "Unable to parse protobuf");
 
-  if (header.incompatible_features_size() > 0) {
-    return Status::NotSupported("log segment uses a feature not supported by this version "
-                                "of Kudu");
+  for (int32_t feature : header.incompatible_features()) {
+    if (!LogSegmentHeaderPB::FeatureFlag_IsValid(feature) ||
+        feature == LogSegmentHeaderPB::UNKNOWN) {
+      return Status::NotSupported("log segment uses a feature not supported by this version "
+                                  "of Kudu");
+    }
   }
 
   header_.Swap(&header);
@@ -754,8 +762,16 @@ Status ReadableLogSegment::ReadEntryBatch(int64_t *offset,
   if (codec_) {
     // We pre-reserved space for the decompression up above.
     uint8_t* uncompress_buf = &(*tmp_buf)[header.msg_length_compressed];
-    RETURN_NOT_OK_PREPEND(codec_->Uncompress(entry_batch_slice, uncompress_buf, header.msg_length),
-                          "failed to uncompress entry");
+    if (header_.has_compression_dictionary()) {
+      RETURN_NOT_OK_PREPEND(codec_->UncompressWithDictionary(
+                                entry_batch_slice, header_.compression_dictionary(),
+                                uncompress_buf, header.msg_length),
+                            "failed to uncompress entry");
+    } else {
+      RETURN_NOT_OK_PREPEND(codec_->Uncompress(entry_batch_slice, uncompress_buf,
+                                               header.msg_length),
+                            "failed to uncompress entry");
+    }
     entry_batch_slice = Slice(uncompress_buf, header.msg_length);
   }
 
@@ -781,6 +797,8 @@ WritableLogSegment::WritableLogSegment(string path,
       is_footer_written_(false),
       written_offset_(0) {}
 
+WritableLogSegment::~WritableLogSegment() {}
+
 Status WritableLogSegment::WriteHeaderAndOpen(const LogSegmentHeaderPB& new_header) {
   MAYBE_FAULT(FLAGS_fault_crash_before_write_log_segment_header);
 
@@ -843,7 +861,16 @@ Status WritableLogSegment::WriteEntryBatch(const Slice& data,
     DCHECK_NE(header_.compression_codec(), NO_COMPRESSION);
     compress_buf_.resize(codec->MaxCompressedLength(uncompressed_len));
     size_t compressed_len;
-    RETURN_NOT_OK(codec->Compress(data, &compress_buf_[0], &compressed_len));
+    if (header_.has_compression_dictionary()) {
+      if (!compression_dictionary_) {
+        RETURN_NOT_OK(codec->PrepareDictionary(header_.compression_dictionary(),
+                                               &compression_dictionary_));
+      }
+      RETURN_NOT_OK(codec->CompressWithPreparedDictionary(data, *compression_dictionary_,
+                                                          &compress_buf_[0], &compressed_len));
+    } else {
+      RETURN_NOT_OK(codec->Compress(data, &compress_buf_[0], &compressed_len));
+    }
     compress_buf_.resize(compressed_len);
     data_to_write = Slice(compress_buf_.data(), compress_buf_.size());
   } else {
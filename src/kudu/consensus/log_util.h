@@ -47,6 +47,7 @@ DECLARE_bool(log_force_fsync_all);
 namespace kudu {
 
 class CompressionCodec;
+class PreparedCompressionDictionary;
 
 namespace log {
 
@@ -406,6 +407,7 @@ class WritableLogSegment {
  public:
   WritableLogSegment(std::string path,
                      std::shared_ptr<WritableFile> writable_file);
+  ~WritableLogSegment();
 
   // Opens the segment by writing the header.
   Status WriteHeaderAndOpen(const LogSegmentHeaderPB& new_header);
@@ -494,6 +496,10 @@ class WritableLogSegment {
   // Buffer used for output when compressing.
   faststring compress_buf_;
 
+  // The header's compression dictionary, prepared on the first compressed
+  // write so that it isn't reloaded for every batch.
+  std::unique_ptr<PreparedCompressionDictionary> compression_dictionary_;
+
   DISALLOW_COPY_AND_ASSIGN(WritableLogSegment);
 };
 
@@ -0,0 +1,94 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/consensus/ops_sidecar.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+#include <google/protobuf/wire_format_lite_inl.h>
+
+#include "kudu/consensus/consensus.pb.h"
+#include "kudu/gutil/port.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+
+using google::protobuf::internal::WireFormatLite;
+using google::protobuf::io::CodedInputStream;
+using std::shared_ptr;
+using std::vector;
+
+namespace kudu {
+namespace consensus {
+
+void AppendOpsForSidecar(const vector<ReplicateRefPtr>& msgs, faststring* dst) {
+  const uint32_t ops_tag = WireFormatLite::MakeTag(
+      ConsensusRequestPB::kOpsFieldNumber, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  // Take each op's serialized form once, so that its size and content agree.
+  vector<shared_ptr<const faststring>> serialized_ops;
+  serialized_ops.reserve(msgs.size());
+  size_t ops_size = 0;
+  for (const ReplicateRefPtr& msg : msgs) {
+    serialized_ops.emplace_back(msg->Serialized());
+    ops_size += WireFormatLite::TagSize(ConsensusRequestPB::kOpsFieldNumber,
+                                        WireFormatLite::TYPE_MESSAGE) +
+                WireFormatLite::LengthDelimitedSize(serialized_ops.back()->size());
+  }
+  dst->reserve(dst->size() + ops_size);
+  for (const auto& serialized : serialized_ops) {
+    PutVarint32(dst, ops_tag);
+    PutVarint32(dst, serialized->size());
+    dst->append(serialized->data(), serialized->size());
+  }
+}
+
+Status MergeOpsFromSidecar(const Slice& ops_data,
+                           ConsensusRequestPB* req,
+                           vector<Slice>* serialized_ops) {
+  // The sidecar holds nothing but the serialized 'ops' field. Each op is
+  // parsed on its own so that its serialized form can be handed back along
+  // with it.
+  const uint32_t ops_tag = WireFormatLite::MakeTag(
+      ConsensusRequestPB::kOpsFieldNumber, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  if (serialized_ops) {
+    serialized_ops->resize(req->ops_size());
+  }
+  CodedInputStream in(ops_data.data(), ops_data.size());
+  while (in.CurrentPosition() < static_cast<int>(ops_data.size())) {
+    uint32_t op_size;
+    if (PREDICT_FALSE(in.ReadTag() != ops_tag || !in.ReadVarint32(&op_size) ||
+                      op_size > ops_data.size() - in.CurrentPosition())) {
+      return Status::Corruption("invalid operations sidecar in consensus request");
+    }
+    Slice op_data(ops_data.data() + in.CurrentPosition(), op_size);
+    if (PREDICT_FALSE(!req->add_ops()->ParseFromArray(op_data.data(), op_data.size()))) {
+      return Status::Corruption("invalid operation in consensus request sidecar");
+    }
+    if (serialized_ops) {
+      serialized_ops->push_back(op_data);
+    }
+    in.Skip(op_size);
+  }
+  req->clear_ops_sidecar_idx();
+  return Status::OK();
+}
+
+}  // namespace consensus
+}  // namespace kudu
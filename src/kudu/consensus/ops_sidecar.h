@@ -0,0 +1,51 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_CONSENSUS_OPS_SIDECAR_H_
+#define KUDU_CONSENSUS_OPS_SIDECAR_H_
+
+#include <vector>
+
+#include "kudu/consensus/ref_counted_replicate.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+class Slice;
+class faststring;
+
+namespace consensus {
+class ConsensusRequestPB;
+
+// Appends the serialized form of 'msgs' to 'dst', laid out as the 'ops' field
+// of a ConsensusRequestPB would be. This is the content of the sidecar that
+// ConsensusRequestPB::ops_sidecar_idx refers to.
+void AppendOpsForSidecar(const std::vector<ReplicateRefPtr>& msgs, faststring* dst);
+
+// Merges the ops laid out by AppendOpsForSidecar() in 'ops_data' into 'req',
+// after any ops it already has, and clears its 'ops_sidecar_idx'. Returns
+// Corruption if 'ops_data' isn't a valid list of ops.
+//
+// If 'serialized_ops' isn't null, it's set to the serialized form of each of
+// the ops of 'req', pointing into 'ops_data', with an empty slice for each op
+// that 'req' already had.
+Status MergeOpsFromSidecar(const Slice& ops_data,
+                           ConsensusRequestPB* req,
+                           std::vector<Slice>* serialized_ops = nullptr);
+
+}  // namespace consensus
+}  // namespace kudu
+
+#endif /* KUDU_CONSENSUS_OPS_SIDECAR_H_ */
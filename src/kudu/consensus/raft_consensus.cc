@@ -26,6 +26,7 @@
 #include <ostream>
 #include <unordered_set>
 #include <type_traits>
+#include <vector>
 
 #include <boost/optional/optional.hpp>
 #include <gflags/gflags.h>
@@ -63,6 +64,7 @@
 #include "kudu/util/process_memory.h"
 #include "kudu/util/random.h"
 #include "kudu/util/random_util.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/thread_restrictions.h"
 #include "kudu/util/threadpool.h"
@@ -88,6 +90,20 @@ DEFINE_int32(leader_failure_exp_backoff_max_delta_ms, 20 * 1000,
              "increases exponentially, up to this value.");
 TAG_FLAG(leader_failure_exp_backoff_max_delta_ms, experimental);
 
+DEFINE_bool(raft_enable_leader_leases, false,
+            "Whether leaders track a lease during which a majority of the voters won't vote "
+            "for another candidate. A leader holding a lease serves snapshot scans without a "
+            "snapshot timestamp just after its latest committed operation, so they only wait "
+            "for the in-flight operations which precede it. Replicas also withhold their "
+            "votes for the minimum election timeout after starting up. Elections forced via "
+            "the RunLeaderElection RPC don't honor leases.");
+TAG_FLAG(raft_enable_leader_leases, experimental);
+
+DEFINE_double(raft_leader_lease_max_clock_drift, 0.1,
+              "The fraction of the minimum election timeout by which leader leases are "
+              "shortened, to allow for the clocks of the servers running at different rates.");
+TAG_FLAG(raft_leader_lease_max_clock_drift, experimental);
+
 DEFINE_bool(enable_leader_failure_detection, true,
             "Whether to enable failure detection of tablet leaders. If enabled, attempts will be "
             "made to elect a follower as a new leader when the leader is detected to have failed.");
@@ -143,6 +159,7 @@ using kudu::tserver::TabletServerErrorPB;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
+using std::vector;
 using std::weak_ptr;
 using strings::Substitute;
 
@@ -321,6 +338,15 @@ Status RaftConsensus::Start(const ConsensusBootstrapInfo& info,
     // Now assume "follower" duties.
     RETURN_NOT_OK(BecomeReplicaUnlocked());
 
+    // We may have accepted requests from a leader right before restarting,
+    // extending its lease. Neither vote for others nor run for leader until
+    // that lease has run out.
+    if (FLAGS_raft_enable_leader_leases && CurrentTermUnlocked() > 0) {
+      withhold_votes_until_ = MonoTime::Now() + MinimumElectionTimeout();
+      SnoozeFailureDetector(string("withholding votes after restart"),
+                            LeaderElectionExpBackoffDeltaUnlocked());
+    }
+
     SetStateUnlocked(kRunning);
   }
 
@@ -409,6 +435,15 @@ Status RaftConsensus::StartElection(ElectionMode mode, ElectionReason reason) {
                                   "a non-participant in the raft config",
                                   SecureShortDebugString(cmeta_->ActiveConfig()));
     }
+    // A leader may still hold a lease we granted it. Explicitly requested
+    // elections don't honor leases.
+    if (FLAGS_raft_enable_leader_leases && reason == ELECTION_TIMEOUT_EXPIRED) {
+      MonoTime now = MonoTime::Now();
+      if (now < withhold_votes_until_) {
+        SnoozeFailureDetector(string("withholding votes"), withhold_votes_until_ - now);
+        return Status::OK();
+      }
+    }
     LOG_WITH_PREFIX_UNLOCKED(INFO)
         << "Starting " << mode_str
         << " (" << ReasonString(reason, GetLeaderUuidUnlocked()) << ")";
@@ -556,6 +591,7 @@ Status RaftConsensus::BecomeLeaderUnlocked() {
   replicate->set_op_type(NO_OP);
   replicate->mutable_noop_request(); // Define the no-op request field.
   CHECK_OK(time_manager_->AssignTimestamp(replicate));
+  leader_term_start_timestamp_ = Timestamp(replicate->timestamp());
 
   scoped_refptr<ConsensusRound> round(
       new ConsensusRound(this, make_scoped_refptr(new RefCountedReplicate(replicate))));
@@ -779,6 +815,34 @@ void RaftConsensus::TryRemoveFollowerTask(const string& uuid,
 
 Status RaftConsensus::Update(const ConsensusRequestPB* request,
                              ConsensusResponsePB* response) {
+  // see var declaration
+  std::lock_guard<simple_spinlock> lock(update_lock_);
+  return UpdateWithLockHeld(request, nullptr, response);
+}
+
+Status RaftConsensus::Update(const ConsensusRequestPB* request,
+                             const vector<Slice>& serialized_ops,
+                             ConsensusResponsePB* response) {
+  DCHECK_EQ(request->ops_size(), static_cast<int>(serialized_ops.size()));
+  std::lock_guard<simple_spinlock> lock(update_lock_);
+  return UpdateWithLockHeld(request, &serialized_ops, response);
+}
+
+Status RaftConsensus::TryUpdate(const ConsensusRequestPB* request,
+                                ConsensusResponsePB* response,
+                                bool* busy) {
+  std::unique_lock<simple_spinlock> lock(update_lock_, std::try_to_lock);
+  *busy = !lock.owns_lock();
+  if (*busy) {
+    return Status::OK();
+  }
+  return UpdateWithLockHeld(request, nullptr, response);
+}
+
+Status RaftConsensus::UpdateWithLockHeld(const ConsensusRequestPB* request,
+                                         const vector<Slice>* serialized_ops,
+                                         ConsensusResponsePB* response) {
+  DCHECK(update_lock_.is_locked());
   update_calls_for_tests_.Increment();
 
   if (PREDICT_FALSE(FLAGS_follower_reject_update_consensus_requests)) {
@@ -790,9 +854,7 @@ Status RaftConsensus::Update(const ConsensusRequestPB* request,
 
   VLOG_WITH_PREFIX(2) << "Replica received request: " << SecureShortDebugString(*request);
 
-  // see var declaration
-  std::lock_guard<simple_spinlock> lock(update_lock_);
-  Status s = UpdateReplica(request, response);
+  Status s = UpdateReplica(request, serialized_ops, response);
   if (PREDICT_FALSE(VLOG_IS_ON(1))) {
     if (request->ops_size() == 0) {
       VLOG_WITH_PREFIX(1) << "Replica replied to status only request. Replica: "
@@ -851,6 +913,7 @@ std::string RaftConsensus::LeaderRequest::OpsRangeString() const {
 }
 
 void RaftConsensus::DeduplicateLeaderRequestUnlocked(ConsensusRequestPB* rpc_req,
+                                                     const vector<Slice>* serialized_ops,
                                                      LeaderRequest* deduplicated_req) {
   DCHECK(lock_.is_locked());
 
@@ -902,7 +965,12 @@ void RaftConsensus::DeduplicateLeaderRequestUnlocked(ConsensusRequestPB* rpc_req
     if (deduplicated_req->first_message_idx == - 1) {
       deduplicated_req->first_message_idx = i;
     }
-    deduplicated_req->messages.push_back(make_scoped_refptr_replicate(leader_msg));
+    if (serialized_ops && !(*serialized_ops)[i].empty()) {
+      deduplicated_req->messages.push_back(
+          make_scoped_refptr_replicate(leader_msg, (*serialized_ops)[i]));
+    } else {
+      deduplicated_req->messages.push_back(make_scoped_refptr_replicate(leader_msg));
+    }
   }
 
   if (deduplicated_req->messages.size() != rpc_req->ops_size()) {
@@ -988,6 +1056,7 @@ void RaftConsensus::TruncateAndAbortOpsAfterUnlocked(int64_t truncate_after_inde
 }
 
 Status RaftConsensus::CheckLeaderRequestUnlocked(const ConsensusRequestPB* request,
+                                                 const vector<Slice>* serialized_ops,
                                                  ConsensusResponsePB* response,
                                                  LeaderRequest* deduped_req) {
   DCHECK(lock_.is_locked());
@@ -1000,7 +1069,7 @@ Status RaftConsensus::CheckLeaderRequestUnlocked(const ConsensusRequestPB* reque
   }
 
   ConsensusRequestPB* mutable_req = const_cast<ConsensusRequestPB*>(request);
-  DeduplicateLeaderRequestUnlocked(mutable_req, deduped_req);
+  DeduplicateLeaderRequestUnlocked(mutable_req, serialized_ops, deduped_req);
 
   // This is an additional check for KUDU-639 that makes sure the message's index
   // and term are in the right sequence in the request, after we've deduplicated
@@ -1078,6 +1147,7 @@ Status RaftConsensus::CheckLeaderRequestUnlocked(const ConsensusRequestPB* reque
 }
 
 Status RaftConsensus::UpdateReplica(const ConsensusRequestPB* request,
+                                    const vector<Slice>* serialized_ops,
                                     ConsensusResponsePB* response) {
   TRACE_EVENT2("consensus", "RaftConsensus::UpdateReplica",
                "peer", peer_uuid(),
@@ -1186,7 +1256,7 @@ Status RaftConsensus::UpdateReplica(const ConsensusRequestPB* request,
 
     deduped_req.leader_uuid = request->caller_uuid();
 
-    RETURN_NOT_OK(CheckLeaderRequestUnlocked(request, response, &deduped_req));
+    RETURN_NOT_OK(CheckLeaderRequestUnlocked(request, serialized_ops, response, &deduped_req));
 
     if (response->status().has_error()) {
       // We had an error, like an invalid term, we still fill the response.
@@ -2020,6 +2090,28 @@ RaftPeerPB::Role RaftConsensus::role() const {
   return cmeta_->active_role();
 }
 
+bool RaftConsensus::HasLeaderLease(Timestamp* term_start_timestamp) const {
+  if (!FLAGS_raft_enable_leader_leases) {
+    return false;
+  }
+  ThreadRestrictions::AssertWaitAllowed();
+  LockGuard l(lock_);
+  if (state_ != kRunning || cmeta_->active_role() != RaftPeerPB::LEADER) {
+    return false;
+  }
+  // Until an operation of our term is committed, operations of previous terms
+  // which an earlier leader acknowledged may not be known to be committed.
+  if (!queue_->IsCommittedIndexInCurrentTerm()) {
+    return false;
+  }
+  MonoTime lease_start = queue_->GetLeaderLeaseStartTime();
+  if (!lease_start.Initialized() || MonoTime::Now() >= lease_start + LeaderLeaseDuration()) {
+    return false;
+  }
+  *term_start_timestamp = leader_term_start_timestamp_;
+  return true;
+}
+
 int64_t RaftConsensus::CurrentTerm() const {
   LockGuard l(lock_);
   return CurrentTermUnlocked();
@@ -2472,6 +2564,12 @@ MonoDelta RaftConsensus::MinimumElectionTimeout() const {
   return MonoDelta::FromMilliseconds(failure_timeout);
 }
 
+MonoDelta RaftConsensus::LeaderLeaseDuration() const {
+  double lease_ms = MinimumElectionTimeout().ToMilliseconds() *
+      (1 - FLAGS_raft_leader_lease_max_clock_drift);
+  return MonoDelta::FromMilliseconds(static_cast<int64_t>(lease_ms));
+}
+
 MonoDelta RaftConsensus::LeaderElectionExpBackoffDeltaUnlocked() {
   DCHECK(lock_.is_locked());
   // Compute a backoff factor based on how many leader elections have
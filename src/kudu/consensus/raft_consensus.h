@@ -29,6 +29,7 @@
 #include <glog/logging.h>
 #include <gtest/gtest_prod.h>
 
+#include "kudu/common/timestamp.h"
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/consensus/consensus_meta.h"  // IWYU pragma: keep
 #include "kudu/consensus/consensus_queue.h"
@@ -56,6 +57,7 @@ namespace kudu {
 typedef std::lock_guard<simple_spinlock> Lock;
 typedef gscoped_ptr<Lock> ScopedLock;
 
+class Slice;
 class ThreadPool;
 class ThreadPoolToken;
 class Status;
@@ -237,6 +239,21 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   Status Update(const ConsensusRequestPB* request,
                 ConsensusResponsePB* response);
 
+  // Like Update(), for a request whose ops arrived in serialized form, e.g. in
+  // a sidecar. 'serialized_ops' holds the serialized form of each of the
+  // request's ops, or an empty slice where it isn't known, and spares
+  // serializing the ops again to log and cache them.
+  Status Update(const ConsensusRequestPB* request,
+                const std::vector<Slice>& serialized_ops,
+                ConsensusResponsePB* response);
+
+  // Like Update(), but if another update is being applied to the replica,
+  // sets 'busy' to true and returns right away without doing anything,
+  // rather than waiting for it.
+  Status TryUpdate(const ConsensusRequestPB* request,
+                   ConsensusResponsePB* response,
+                   bool* busy);
+
   // Messages sent from CANDIDATEs to voting peers to request their vote
   // in leader election.
   //
@@ -264,6 +281,17 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   // Returns the current Raft role of this instance.
   RaftPeerPB::Role role() const;
 
+  // Returns true if this instance is the leader and holds a leader lease,
+  // i.e. a majority of the voters have accepted requests of its term recently
+  // enough that no other leader can have been elected, and an operation of
+  // its term has been committed. Always returns false unless
+  // --raft_enable_leader_leases is set.
+  //
+  // If it does, sets 'term_start_timestamp' to the timestamp of the first
+  // operation of the leader's term, which is greater than those of all
+  // operations of previous terms.
+  bool HasLeaderLease(Timestamp* term_start_timestamp) const;
+
   // Returns the current term.
   int64_t CurrentTerm() const;
 
@@ -436,18 +464,27 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   // 'lock_' must be held for configuration change before calling.
   Status BecomeReplicaUnlocked();
 
+  // Implements Update() and TryUpdate() once 'update_lock_' is held.
+  // 'serialized_ops' may be null.
+  Status UpdateWithLockHeld(const ConsensusRequestPB* request,
+                            const std::vector<Slice>* serialized_ops,
+                            ConsensusResponsePB* response);
+
   // Updates the state in a replica by storing the received operations in the log
   // and triggering the required transactions. This method won't return until all
   // operations have been stored in the log and all Prepares() have been completed,
   // and a replica cannot accept any more Update() requests until this is done.
   Status UpdateReplica(const ConsensusRequestPB* request,
+                       const std::vector<Slice>* serialized_ops,
                        ConsensusResponsePB* response);
 
   // Deduplicates an RPC request making sure that we get only messages that we
   // haven't appended to our log yet.
   // On return 'deduplicated_req' is instantiated with only the new messages
-  // and the correct preceding id.
+  // and the correct preceding id. The new messages are seeded with their
+  // serialized form from 'serialized_ops', if it's not null.
   void DeduplicateLeaderRequestUnlocked(ConsensusRequestPB* rpc_req,
+                                        const std::vector<Slice>* serialized_ops,
                                         LeaderRequest* deduplicated_req);
 
   // Handles a request from a leader, refusing the request if the term is lower than
@@ -473,6 +510,7 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   // If this returns ok and the response has no errors, 'deduped_req' is set with only
   // the messages to add to our state machine.
   Status CheckLeaderRequestUnlocked(const ConsensusRequestPB* request,
+                                    const std::vector<Slice>* serialized_ops,
                                     ConsensusResponsePB* response,
                                     LeaderRequest* deduped_req) WARN_UNUSED_RESULT;
 
@@ -576,6 +614,11 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   // jitter, election timeouts may be longer than this.
   MonoDelta MinimumElectionTimeout() const;
 
+  // Return how long a leader lease lasts after the requests granting it
+  // were sent: the minimum election timeout, shortened to allow for clock
+  // drift.
+  MonoDelta LeaderLeaseDuration() const;
+
   // Calculates a snooze delta for leader election.
   //
   // The delta increases exponentially with the difference between the current
@@ -777,6 +820,10 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   // nodes from disturbing the healthy leader.
   MonoTime withhold_votes_until_;
 
+  // The timestamp of the NO_OP which started the current term, if this
+  // instance is the leader.
+  Timestamp leader_term_start_timestamp_;
+
   // The last OpId received from the current leader. This is updated whenever the follower
   // accepts operations from a leader, and passed back so that the leader knows from what
   // point to continue sending operations.
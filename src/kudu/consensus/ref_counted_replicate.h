@@ -18,24 +18,81 @@
 #ifndef KUDU_CONSENSUS_REF_COUNTED_REPLICATE_H_
 #define KUDU_CONSENSUS_REF_COUNTED_REPLICATE_H_
 
+#include <memory>
+#include <mutex>
+#include <utility>
+
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/slice.h"
 
 namespace kudu {
 namespace consensus {
 
 // A simple ref-counted wrapper around ReplicateMsg.
+//
+// The serialized form of the message may be kept along with it, so that the
+// WAL and the requests to peers needn't serialize it again. The log cache
+// keeps it for the messages it holds, and a message received in serialized
+// form keeps that form.
 class RefCountedReplicate : public RefCountedThreadSafe<RefCountedReplicate> {
  public:
   explicit RefCountedReplicate(ReplicateMsg* msg) : msg_(msg) {}
 
+  // Wraps 'msg', whose serialized form 'serialized' is already at hand, e.g.
+  // because it was received that way. 'serialized' is copied and kept.
+  RefCountedReplicate(ReplicateMsg* msg, const Slice& serialized)
+      : msg_(msg) {
+    std::shared_ptr<faststring> kept = std::make_shared<faststring>();
+    kept->append(serialized.data(), serialized.size());
+    serialized_ = std::move(kept);
+  }
+
   ReplicateMsg* get() {
     return msg_.get();
   }
 
+  // Returns the serialized message: the kept serialized form, if any, and
+  // otherwise a newly serialized one, which isn't kept. The returned buffer
+  // is never modified, so its size and content may be used separately. The
+  // message must not be modified after this, or KeepSerialized(), is first
+  // called.
+  //
+  // This method is thread-safe.
+  std::shared_ptr<const faststring> Serialized() {
+    {
+      std::lock_guard<simple_spinlock> l(lock_);
+      if (serialized_) {
+        return serialized_;
+      }
+    }
+    std::shared_ptr<faststring> serialized = std::make_shared<faststring>();
+    pb_util::AppendToString(*msg_, serialized.get());
+    return serialized;
+  }
+
+  // Like Serialized(), but keeps a newly serialized form, so that later calls
+  // return the same buffer.
+  //
+  // This method is thread-safe.
+  std::shared_ptr<const faststring> KeepSerialized() {
+    std::shared_ptr<const faststring> serialized = Serialized();
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (!serialized_) {
+      serialized_ = std::move(serialized);
+    }
+    return serialized_;
+  }
+
  private:
   gscoped_ptr<ReplicateMsg> msg_;
+
+  simple_spinlock lock_;
+  std::shared_ptr<const faststring> serialized_; // Protected by lock_.
 };
 
 typedef scoped_refptr<RefCountedReplicate> ReplicateRefPtr;
@@ -44,6 +101,11 @@ inline ReplicateRefPtr make_scoped_refptr_replicate(ReplicateMsg* replicate) {
   return ReplicateRefPtr(new RefCountedReplicate(replicate));
 }
 
+inline ReplicateRefPtr make_scoped_refptr_replicate(ReplicateMsg* replicate,
+                                                    const Slice& serialized) {
+  return ReplicateRefPtr(new RefCountedReplicate(replicate, serialized));
+}
+
 } // namespace consensus
 } // namespace kudu
 
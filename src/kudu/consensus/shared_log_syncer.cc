@@ -0,0 +1,151 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/consensus/shared_log_syncer.h"
+
+#include <map>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/util/debug/trace_event.h"
+#include "kudu/util/env.h"
+
+using std::shared_ptr;
+using std::string;
+using std::weak_ptr;
+
+namespace kudu {
+namespace log {
+
+Status SharedLogSyncer::GetOrCreate(Env* env, const string& wal_root,
+                                    shared_ptr<SharedLogSyncer>* syncer) {
+  // Syncers are kept alive by the Logs that use them, so that one is
+  // destroyed once the last Log under its WAL root is. A Mutex rather than a
+  // spinlock, since initializing a syncer does IO.
+  static auto* registry_lock = new Mutex();
+  static auto* registry = new std::map<string, weak_ptr<SharedLogSyncer>>();
+
+  MutexLock l(*registry_lock);
+  weak_ptr<SharedLogSyncer>& entry = (*registry)[wal_root];
+  shared_ptr<SharedLogSyncer> result = entry.lock();
+  if (!result) {
+    result = std::make_shared<SharedLogSyncer>(env, wal_root);
+    RETURN_NOT_OK(result->Init());
+    entry = result;
+  }
+  *syncer = std::move(result);
+  return Status::OK();
+}
+
+SharedLogSyncer::SharedLogSyncer(Env* env, string wal_root)
+    : env_(env),
+      wal_root_(std::move(wal_root)),
+      sync_file_after_syncfs_(!SyncfsReportsWritebackErrors(env->GetKernelRelease())),
+      sync_done_(&lock_),
+      sync_in_progress_(false),
+      sync_file_system_supported_(true),
+      num_syncs_(0),
+      num_file_syncs_(0) {
+}
+
+SharedLogSyncer::~SharedLogSyncer() {
+}
+
+Status SharedLogSyncer::Init() {
+  Status s = env_->NewSyncableFileSystem(wal_root_, &fs_);
+  if (s.IsNotSupported()) {
+    LOG(WARNING) << "Unable to sync the file system containing " << wal_root_
+                 << ", WALs will be synced individually: " << s.ToString();
+    sync_file_system_supported_ = false;
+    return Status::OK();
+  }
+  RETURN_NOT_OK_PREPEND(s, "unable to open WAL file system");
+  return Status::OK();
+}
+
+Status SharedLogSyncer::Sync(const std::function<Status()>& sync_file) {
+  TRACE_EVENT0("log", "SharedLogSyncer::Sync");
+  MutexLock l(lock_);
+  // Everything the caller has written precedes this request, so any sync
+  // that starts after it covers the caller.
+  if (!next_round_) {
+    next_round_ = std::make_shared<SyncRound>();
+  }
+  shared_ptr<SyncRound> round = next_round_;
+  while (!round->done) {
+    if (!sync_file_system_supported_) {
+      l.Unlock();
+      return SyncFile(sync_file);
+    }
+    if (sync_in_progress_) {
+      sync_done_.Wait();
+      continue;
+    }
+
+    // Sync on behalf of every caller in this round.
+    sync_in_progress_ = true;
+    next_round_.reset();
+    l.Unlock();
+    Status s = fs_->Sync();
+    l.Lock();
+    sync_in_progress_ = false;
+    num_syncs_++;
+    if (PREDICT_FALSE(!s.ok())) {
+      round->status = s.CloneAndPrepend("unable to sync WAL file system");
+    }
+    round->done = true;
+    sync_done_.Broadcast();
+  }
+  Status s = round->status;
+  l.Unlock();
+  RETURN_NOT_OK(s);
+  if (sync_file_after_syncfs_) {
+    // syncfs() didn't report failures to write back dirty pages, but syncing
+    // the caller's file does, and is cheap now that its pages are clean.
+    return SyncFile(sync_file);
+  }
+  return Status::OK();
+}
+
+Status SharedLogSyncer::SyncFile(const std::function<Status()>& sync_file) {
+  {
+    MutexLock l(lock_);
+    num_file_syncs_++;
+  }
+  return sync_file();
+}
+
+int64_t SharedLogSyncer::num_syncs() const {
+  MutexLock l(lock_);
+  return num_syncs_;
+}
+
+int64_t SharedLogSyncer::num_file_syncs() const {
+  MutexLock l(lock_);
+  return num_file_syncs_;
+}
+
+bool SharedLogSyncer::SyncfsReportsWritebackErrors(const string& kernel_release) {
+  autodigit_less lt;
+  return !lt(kernel_release, "5.8");
+}
+
+}  // namespace log
+}  // namespace kudu
@@ -0,0 +1,137 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_CONSENSUS_SHARED_LOG_SYNCER_H
+#define KUDU_CONSENSUS_SHARED_LOG_SYNCER_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Env;
+class SyncableFileSystem;
+
+namespace log {
+
+// Coalesces the syncs of the WALs of all tablets which share a WAL root
+// directory into syncs of the whole file system holding it.
+//
+// With many small tablets, each tablet's Log would otherwise fsync its own
+// active segment for every group it appends, which amounts to thousands of
+// tiny fsyncs per second. Instead, a Log that wants to sync registers with the
+// SharedLogSyncer; the first waiter syncs the file system on behalf of every
+// Log that registered before the sync began, and those that register while it
+// is in progress are covered by the next one.
+//
+// This is most effective when the WAL has a dedicated disk, since syncing the
+// file system also flushes any other data written to it.
+//
+// This class is thread-safe.
+class SharedLogSyncer {
+ public:
+  // Returns the syncer shared by all Logs under 'wal_root' in 'syncer',
+  // creating and initializing it if there is none yet.
+  static Status GetOrCreate(Env* env, const std::string& wal_root,
+                            std::shared_ptr<SharedLogSyncer>* syncer);
+
+  SharedLogSyncer(Env* env, std::string wal_root);
+  ~SharedLogSyncer();
+
+  // Opens the file system holding the WAL root. This must happen before the
+  // writes which the syncer is meant to make durable: syncfs() only reports
+  // writeback errors recorded after the file system was opened.
+  Status Init();
+
+  // Makes everything written to the file system before this call durable.
+  // Returns the error of the file system sync which covered this call, if
+  // it failed.
+  //
+  // 'sync_file' is called to sync the caller's own file instead if the file
+  // system can't be synced as a whole. On kernels whose syncfs() doesn't
+  // report writeback errors, it's also called once the file system has been
+  // synced, to learn of any error writing the file back.
+  Status Sync(const std::function<Status()>& sync_file);
+
+  // Returns the number of file system syncs performed so far.
+  int64_t num_syncs() const;
+
+  // Returns the number of times that callers' 'sync_file' was called so far.
+  int64_t num_file_syncs() const;
+
+  // Returns whether syncfs() reports errors writing back dirty pages on the
+  // given kernel release, which is the case as of Linux 5.8.
+  static bool SyncfsReportsWritebackErrors(const std::string& kernel_release);
+
+  void set_sync_file_after_syncfs_for_tests(bool sync_file_after_syncfs) {
+    sync_file_after_syncfs_ = sync_file_after_syncfs;
+  }
+
+ private:
+  // The callers covered by a single file system sync.
+  struct SyncRound {
+    bool done = false;
+    Status status;
+  };
+
+  // Calls 'sync_file', counting it in 'num_file_syncs_'.
+  Status SyncFile(const std::function<Status()>& sync_file);
+
+  Env* const env_;
+  const std::string wal_root_;
+
+  // The file system holding 'wal_root_', kept open for the lifetime of the
+  // syncer so that every sync reports the writeback errors since Init().
+  // Null if the file system can't be synced as a whole.
+  std::unique_ptr<SyncableFileSystem> fs_;
+
+  // Whether callers' files must be synced after the file system, to learn of
+  // writeback errors which syncfs() doesn't report.
+  bool sync_file_after_syncfs_;
+
+  mutable Mutex lock_;
+
+  // Signaled whenever a sync completes.
+  ConditionVariable sync_done_;
+
+  // The round which the next file system sync will cover, if any caller is
+  // waiting for it yet. Callers which arrive while a sync is in progress
+  // join this round, since the ongoing sync may have missed their writes.
+  std::shared_ptr<SyncRound> next_round_;
+
+  // Whether a sync is currently in progress.
+  bool sync_in_progress_;
+
+  // Whether the file system can be synced as a whole.
+  bool sync_file_system_supported_;
+
+  int64_t num_syncs_;
+  int64_t num_file_syncs_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedLogSyncer);
+};
+
+}  // namespace log
+}  // namespace kudu
+
+#endif // KUDU_CONSENSUS_SHARED_LOG_SYNCER_H
@@ -46,6 +46,7 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/async_util.h"
 #include "kudu/util/env.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
@@ -450,6 +451,17 @@ TYPED_TEST(BlockManagerTest, EndToEndTest) {
   ASSERT_EQ(test_data.substr(0, size1), data1);
   ASSERT_EQ(test_data.substr(size1, size2), data2);
 
+  // And asynchronously, including an out-of-bounds read.
+  uint8_t async_scratch[size1];
+  vector<Slice> async_results = { Slice(async_scratch, size1) };
+  Synchronizer s;
+  read_block->ReadVAsync(size2, &async_results, s.AsStdStatusCallback());
+  ASSERT_OK(s.Wait());
+  ASSERT_EQ(test_data.substr(size2, size1), async_results[0]);
+  Synchronizer oob;
+  read_block->ReadVAsync(size1, &async_results, oob.AsStdStatusCallback());
+  ASSERT_TRUE(oob.Wait().IsIOError());
+
   // We don't actually do anything with the result of this call; we just want
   // to make sure it doesn't trigger a crash (see KUDU-1931).
   LOG(INFO) << "Block memory footprint: " << read_block->memory_footprint();
@@ -481,6 +493,50 @@ TYPED_TEST(BlockManagerTest, CreateBlocksInDataDirs) {
   ASSERT_TRUE(MessageDifferencer::Equals(test_group_pb, this->test_group_pb_));
 }
 
+TYPED_TEST(BlockManagerTest, ReadBlocksTest) {
+  // Write a few blocks with distinct contents.
+  const int kNumBlocks = 3;
+  vector<string> contents;
+  vector<unique_ptr<ReadableBlock>> blocks;
+  for (int i = 0; i < kNumBlocks; i++) {
+    unique_ptr<WritableBlock> writer;
+    ASSERT_OK(this->bm_->CreateBlock(this->test_block_opts_, &writer));
+    contents.emplace_back(Substitute("block $0 contents", i));
+    ASSERT_OK(writer->Append(contents.back()));
+    ASSERT_OK(writer->Close());
+    unique_ptr<ReadableBlock> reader;
+    ASSERT_OK(this->bm_->OpenBlock(writer->id(), &reader));
+    blocks.emplace_back(std::move(reader));
+  }
+
+  // Read adjacent, overlapping, and out-of-order ranges of all the blocks.
+  struct Range {
+    int block;
+    uint64_t offset;
+    size_t length;
+  };
+  const vector<Range> ranges = {
+    { 2, 0, 5 }, { 0, 5, 3 }, { 0, 0, 5 }, { 1, 0, 16 }, { 0, 2, 10 }, { 2, 5, 11 },
+  };
+  vector<unique_ptr<uint8_t[]>> scratches;
+  vector<BlockReadRequest> requests;
+  for (const auto& r : ranges) {
+    scratches.emplace_back(new uint8_t[r.length]);
+    requests.push_back({ blocks[r.block].get(), r.offset,
+                         Slice(scratches.back().get(), r.length) });
+  }
+  ASSERT_OK(this->bm_->ReadBlocks(&requests));
+  for (int i = 0; i < ranges.size(); i++) {
+    ASSERT_EQ(contents[ranges[i].block].substr(ranges[i].offset, ranges[i].length),
+              requests[i].result.ToString());
+  }
+
+  // An out-of-bounds read fails the batch.
+  uint8_t scratch[10];
+  requests.push_back({ blocks[0].get(), contents[0].size() - 5, Slice(scratch, 10) });
+  ASSERT_TRUE(this->bm_->ReadBlocks(&requests).IsIOError());
+}
+
 // Test that we can still read from an opened block after deleting it
 // (even if we can't open it again).
 TYPED_TEST(BlockManagerTest, ReadAfterDeleteTest) {
@@ -28,6 +28,8 @@
 #include "kudu/util/env.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/throttler.h"
 
 // The default value is optimized for throughput in the case that
 // there are multiple drives backing the tablet. By asynchronously
@@ -63,6 +65,16 @@ DEFINE_int64(block_manager_max_open_files, -1,
 TAG_FLAG(block_manager_max_open_files, advanced);
 TAG_FLAG(block_manager_max_open_files, evolving);
 
+DEFINE_bool(block_manager_direct_reads, false,
+            "Whether to read data blocks with direct I/O, bypassing the "
+            "operating system's page cache. This avoids caching block data "
+            "both in the page cache and in the block cache, making the block "
+            "cache the only cache of block data; it should be sized "
+            "accordingly. Has no effect on filesystems that don't support "
+            "direct I/O.");
+TAG_FLAG(block_manager_direct_reads, advanced);
+TAG_FLAG(block_manager_direct_reads, experimental);
+
 static bool ValidateMaxOpenFiles(const char* /*flagname*/, int64_t value) {
   if (value == 0) {
     LOG(ERROR) << "Invalid max open files: cannot be 0";
@@ -72,6 +84,14 @@ static bool ValidateMaxOpenFiles(const char* /*flagname*/, int64_t value) {
 }
 DEFINE_validator(block_manager_max_open_files, &ValidateMaxOpenFiles);
 
+DEFINE_int32(maintenance_io_throttle_mb_per_sec, 0,
+             "Maximum rate, in MB/s, at which background maintenance operations "
+             "(e.g. compactions) may read and write blocks, summed across all "
+             "disks. Flushes and foreground reads and writes are not counted "
+             "against this budget. 0 disables throttling.");
+TAG_FLAG(maintenance_io_throttle_mb_per_sec, experimental);
+TAG_FLAG(maintenance_io_throttle_mb_per_sec, runtime);
+
 using strings::Substitute;
 
 namespace kudu {
@@ -104,5 +124,60 @@ int64_t GetFileCacheCapacityForBlockManager(Env* env) {
   return FLAGS_block_manager_max_open_files;
 }
 
+namespace {
+
+IOThrottler* BackgroundIOThrottler() {
+  static IOThrottler* throttler = new IOThrottler();
+  return throttler;
+}
+
+int64_t BackgroundIOBytesPerSec() {
+  return static_cast<int64_t>(FLAGS_maintenance_io_throttle_mb_per_sec) * 1024 * 1024;
+}
+
+} // anonymous namespace
+
+void ThrottleBackgroundIO(int64_t bytes) {
+  if (!ScopedBackgroundIO::IsActive()) {
+    return;
+  }
+  int64_t bytes_per_sec = BackgroundIOBytesPerSec();
+  if (bytes_per_sec <= 0) {
+    return;
+  }
+  MonoDelta delay = BackgroundIOThrottler()->Take(MonoTime::Now(), bytes, bytes_per_sec);
+  if (ScopedDeferBackgroundIOThrottle::IsActive()) {
+    // Paid for when the outermost scope ends.
+    return;
+  }
+  if (delay.ToMicroseconds() > 0) {
+    SleepFor(delay);
+  }
+}
+
+__thread int ScopedDeferBackgroundIOThrottle::depth_ = 0;
+
+ScopedDeferBackgroundIOThrottle::ScopedDeferBackgroundIOThrottle(bool enable, bool pay)
+    : enabled_(enable),
+      pay_(pay) {
+  if (enabled_) {
+    depth_++;
+  }
+}
+
+ScopedDeferBackgroundIOThrottle::~ScopedDeferBackgroundIOThrottle() {
+  if (!enabled_) {
+    return;
+  }
+  if (--depth_ > 0 || !pay_ || !ScopedBackgroundIO::IsActive() ||
+      BackgroundIOBytesPerSec() <= 0) {
+    return;
+  }
+  MonoDelta delay = BackgroundIOThrottler()->Backlog(MonoTime::Now());
+  if (delay.ToMicroseconds() > 0) {
+    SleepFor(delay);
+  }
+}
+
 } // namespace fs
 } // namespace kudu
@@ -24,8 +24,11 @@
 #include <string>
 #include <vector>
 
+#include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
+#include "kudu/util/status_callback.h"
 
 namespace kudu {
 
@@ -33,7 +36,6 @@ class BlockId;
 class Env;
 class MemTracker;
 class MetricEntity;
-class Slice;
 
 namespace fs {
 
@@ -158,10 +160,33 @@ class ReadableBlock : public Block {
   // If an error was encountered, returns a non-OK status.
   virtual Status ReadV(uint64_t offset, std::vector<Slice>* results) const = 0;
 
+  // Like ReadV(), but returns immediately and invokes 'cb' with the outcome
+  // once the read has completed. Until then, 'results', the memory it points
+  // to, and this block must remain valid. 'cb' may be invoked on an internal
+  // I/O thread and must not block.
+  //
+  // Issuing several reads before waiting for any of them keeps that many
+  // I/Os outstanding without dedicating a thread to each.
+  virtual void ReadVAsync(uint64_t offset, std::vector<Slice>* results,
+                          const StdStatusCallback& cb) const = 0;
+
   // Returns the memory usage of this object including the object itself.
   virtual size_t memory_footprint() const = 0;
 };
 
+// One read in a batch issued via BlockManager::ReadBlocks().
+struct BlockReadRequest {
+  // The block to read from. Must have been opened by the block manager
+  // performing the read, and must remain open for its duration.
+  const ReadableBlock* block;
+
+  // Offset within the block to read from.
+  uint64_t offset;
+
+  // Exactly 'result.size()' bytes are read into 'result.data()'.
+  Slice result;
+};
+
 // Provides options and hints for block placement. This is used for identifying
 // the correct DataDirGroups to place blocks. In the future this may also be
 // used to specify directories based on block type (e.g. to prefer bloom block
@@ -230,6 +255,13 @@ class BlockManager {
   virtual Status OpenBlock(const BlockId& block_id,
                            std::unique_ptr<ReadableBlock>* block) = 0;
 
+  // Performs a batch of reads from opened blocks, as if by calling Read() on
+  // each, but possibly merging reads of nearby data into fewer I/Os and
+  // keeping several of those I/Os outstanding at once. Returns the first
+  // error encountered, in which case the contents of any of the results are
+  // undefined.
+  virtual Status ReadBlocks(std::vector<BlockReadRequest>* requests) = 0;
+
   // Deletes an existing block, allowing its space to be reclaimed by the
   // filesystem. The change is immediately made durable.
   //
@@ -295,5 +327,39 @@ class BlockTransaction {
 // using resource limits obtained from the system.
 int64_t GetFileCacheCapacityForBlockManager(Env* env);
 
+// Charges 'bytes' of block I/O about to be issued by the calling thread to the
+// process-wide budget set by --maintenance_io_throttle_mb_per_sec, if the
+// thread is doing background I/O (see ScopedBackgroundIO). The thread then
+// sleeps until the budget allows for the I/O, unless throttling is deferred
+// (see ScopedDeferBackgroundIOThrottle).
+void ThrottleBackgroundIO(int64_t bytes);
+
+// While in scope, the background block I/O issued by the calling thread is
+// charged to the budget of ThrottleBackgroundIO(), but the thread doesn't
+// sleep for it. When the outermost scope ends, the thread sleeps until all of
+// the I/O charged so far has been paid for.
+//
+// This is meant for code holding locks which flushes or foreground operations
+// may wait on. It should be declared before such a lock is taken, so that the
+// lock is released before sleeping.
+class ScopedDeferBackgroundIOThrottle {
+ public:
+  // Passing 'enable' as false leaves the current state unchanged, which is
+  // convenient when propagating the state to helper threads. Passing 'pay' as
+  // false skips the sleep at the end of the scope, e.g. for a helper thread
+  // whose I/O the thread it works for pays for.
+  explicit ScopedDeferBackgroundIOThrottle(bool enable = true, bool pay = true);
+  ~ScopedDeferBackgroundIOThrottle();
+
+  static bool IsActive() { return depth_ > 0; }
+
+ private:
+  static __thread int depth_;
+  const bool enabled_;
+  const bool pay_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedDeferBackgroundIOThrottle);
+};
+
 } // namespace fs
 } // namespace kudu
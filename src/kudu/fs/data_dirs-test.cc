@@ -18,6 +18,7 @@
 #include <cmath>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <set>
 #include <string>
@@ -38,7 +39,9 @@
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/env.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
@@ -51,6 +54,7 @@ using std::unique_ptr;
 using strings::Substitute;
 
 DECLARE_bool(crash_on_eio);
+DECLARE_bool(fs_data_dirs_load_aware_placement);
 DECLARE_double(env_inject_eio);
 DECLARE_int32(fs_data_dirs_full_disk_cache_seconds);
 DECLARE_int32(fs_target_data_dirs_per_tablet);
@@ -362,6 +366,74 @@ TEST_F(DataDirsTest, TestLoadBalancingBias) {
   ASSERT_TRUE(some_added_to_skewed_dirs);
 }
 
+TEST_F(DataDirsTest, TestLoadAwarePlacement) {
+  FLAGS_fs_data_dirs_load_aware_placement = true;
+
+  // Tracked I/Os should feed the load estimate of their directory.
+  DataDir* busy_dir = dd_manager_->data_dirs()[0].get();
+  ASSERT_EQ(0, busy_dir->ExpectedIOWaitMicros());
+  {
+    DataDir::ScopedIOTracker io_tracker(busy_dir);
+    SleepFor(MonoDelta::FromMilliseconds(10));
+  }
+  ASSERT_GT(busy_dir->ExpectedIOWaitMicros(), 0);
+  ASSERT_EQ(0, busy_dir->ios_in_flight_.Load());
+
+  // Make one directory look heavily loaded: it should never be chosen over
+  // any of the idle directories, neither for blocks nor for tablets.
+  {
+    std::lock_guard<simple_spinlock> l(busy_dir->latency_lock_);
+    busy_dir->io_latency_.avg_us = 100000;
+    busy_dir->io_latency_.last_update = MonoTime::Now();
+  }
+  busy_dir->ios_in_flight_.Store(4);
+
+  ASSERT_OK(dd_manager_->CreateDataDirGroup(test_tablet_name_));
+  for (int i = 0; i < 1000; i++) {
+    DataDir* dd;
+    ASSERT_OK(dd_manager_->GetNextDataDir(test_block_opts_, &dd));
+    ASSERT_NE(busy_dir, dd);
+  }
+
+  FLAGS_fs_target_data_dirs_per_tablet = 1;
+  for (int i = 0; i < 50; i++) {
+    ASSERT_OK(dd_manager_->CreateDataDirGroup(Substitute("$0-$1", test_tablet_name_, i)));
+  }
+  uint16_t busy_uuid_idx;
+  ASSERT_TRUE(dd_manager_->FindUuidIndexByDataDir(busy_dir, &busy_uuid_idx));
+  // The only tablet in the busy dir is the one spread across all dirs.
+  ASSERT_EQ(1, FindOrDie(dd_manager_->tablets_by_uuid_idx_map_, busy_uuid_idx).size());
+
+  // Without load-aware placement, the busy dir is eventually chosen.
+  FLAGS_fs_data_dirs_load_aware_placement = false;
+  bool chose_busy_dir = false;
+  for (int i = 0; i < 1000 && !chose_busy_dir; i++) {
+    DataDir* dd;
+    ASSERT_OK(dd_manager_->GetNextDataDir(test_block_opts_, &dd));
+    chose_busy_dir = dd == busy_dir;
+  }
+  ASSERT_TRUE(chose_busy_dir);
+  busy_dir->ios_in_flight_.Store(0);
+}
+
+TEST_F(DataDirsTest, TestIOLatencyDecays) {
+  DataDir* dir = dd_manager_->data_dirs()[0].get();
+  MonoTime start = MonoTime::Now();
+  dir->RecordIOLatency(DataDir::DATA_IO, MonoDelta::FromMilliseconds(80), start);
+  ASSERT_EQ(10000, dir->ExpectedIOWaitMicros(start));
+
+  // Without further I/O, the average halves every second.
+  ASSERT_EQ(5000, dir->ExpectedIOWaitMicros(start + MonoDelta::FromSeconds(1)));
+  ASSERT_EQ(0, dir->ExpectedIOWaitMicros(start + MonoDelta::FromSeconds(60)));
+
+  // Syncs are averaged separately, and only count while one is in flight.
+  dir->RecordIOLatency(DataDir::SYNC_IO, MonoDelta::FromMilliseconds(800), start);
+  ASSERT_EQ(10000, dir->ExpectedIOWaitMicros(start));
+  dir->syncs_in_flight_.Store(1);
+  ASSERT_EQ(110000, dir->ExpectedIOWaitMicros(start));
+  dir->syncs_in_flight_.Store(0);
+}
+
 class DataDirManagerTest : public DataDirsTest {
  public:
   DataDirManagerTest() :
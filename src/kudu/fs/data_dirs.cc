@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <cerrno>
+#include <cmath>
 #include <cstdint>
 #include <deque>
 #include <iterator>
@@ -89,6 +90,32 @@ DEFINE_int32(fs_data_dirs_full_disk_cache_seconds, 30,
 TAG_FLAG(fs_data_dirs_full_disk_cache_seconds, advanced);
 TAG_FLAG(fs_data_dirs_full_disk_cache_seconds, evolving);
 
+DEFINE_bool(fs_data_dirs_load_aware_placement, false,
+            "Whether to consider the I/O load and free space of data directories "
+            "when placing new blocks and new tablets. If false, blocks are placed "
+            "randomly within a tablet's directory group, and tablets are placed "
+            "based solely on the number of tablets in each directory.");
+TAG_FLAG(fs_data_dirs_load_aware_placement, advanced);
+TAG_FLAG(fs_data_dirs_load_aware_placement, runtime);
+TAG_FLAG(fs_data_dirs_load_aware_placement, experimental);
+
+DEFINE_double(fs_data_dirs_load_imbalance_ratio, 1.5,
+              "When choosing between two data directories, the less loaded one is "
+              "preferred only if the other's load exceeds it by at least this ratio. "
+              "Smaller differences are treated as noise.");
+DEFINE_validator(fs_data_dirs_load_imbalance_ratio,
+                 [](const char* /*n*/, double v) { return v >= 1.0; });
+TAG_FLAG(fs_data_dirs_load_imbalance_ratio, advanced);
+TAG_FLAG(fs_data_dirs_load_imbalance_ratio, runtime);
+TAG_FLAG(fs_data_dirs_load_imbalance_ratio, experimental);
+
+DEFINE_int32(fs_data_dirs_idle_io_wait_us, 1000,
+             "Expected I/O wait times, in microseconds, below which a data directory "
+             "is considered idle for the purposes of load-aware placement.");
+TAG_FLAG(fs_data_dirs_idle_io_wait_us, advanced);
+TAG_FLAG(fs_data_dirs_idle_io_wait_us, runtime);
+TAG_FLAG(fs_data_dirs_idle_io_wait_us, experimental);
+
 DEFINE_bool(fs_lock_data_dirs, true,
             "Lock the data directories to prevent concurrent usage. "
             "Note that read-only concurrent usage is still allowed.");
@@ -203,7 +230,10 @@ DataDir::DataDir(Env* env,
       metadata_file_(std::move(metadata_file)),
       pool_(std::move(pool)),
       is_shutdown_(false),
-      is_full_(false) {
+      ios_in_flight_(0),
+      syncs_in_flight_(0),
+      is_full_(false),
+      available_space_fraction_(1.0) {
 }
 
 DataDir::~DataDir() {
@@ -240,7 +270,10 @@ Status DataDir::RefreshIsFull(RefreshMode mode) {
       DCHECK(last_check_is_full_.Initialized());
       MonoTime expiry = last_check_is_full_ + MonoDelta::FromSeconds(
           FLAGS_fs_data_dirs_full_disk_cache_seconds);
-      if (!is_full_ || MonoTime::Now() < expiry) {
+      // Load-aware placement also takes free space into account, so non-full
+      // roots are periodically rechecked too.
+      if ((!is_full_ && !FLAGS_fs_data_dirs_load_aware_placement) ||
+          MonoTime::Now() < expiry) {
         break;
       }
       FALLTHROUGH_INTENDED; // Root was previously full, check again.
@@ -260,13 +293,44 @@ Status DataDir::RefreshIsFull(RefreshMode mode) {
         is_full_new = false;
       }
       RETURN_NOT_OK_PREPEND(s, "Could not refresh fullness"); // Catch other types of IOErrors, etc.
+
+      // The free space fraction only guides load-aware placement, so it is
+      // refreshed at most once per cache period even though the block managers
+      // refresh fullness on every append or preallocation.
+      MonoTime now = MonoTime::Now();
+      bool refresh_space;
+      {
+        std::lock_guard<simple_spinlock> l(lock_);
+        refresh_space = FLAGS_fs_data_dirs_load_aware_placement && !is_full_new &&
+            (!last_check_space_.Initialized() ||
+             now >= last_check_space_ + MonoDelta::FromSeconds(
+                 FLAGS_fs_data_dirs_full_disk_cache_seconds));
+      }
+      double available_space_fraction = 0;
+      if (refresh_space) {
+        SpaceInfo space_info;
+        RETURN_NOT_OK_PREPEND(env_->GetSpaceInfo(dir_, &space_info),
+                              "Could not refresh fullness");
+        if (space_info.capacity_bytes > 0) {
+          available_space_fraction = std::min(
+              1.0, static_cast<double>(space_info.free_bytes) / space_info.capacity_bytes);
+        }
+      }
       {
         std::lock_guard<simple_spinlock> l(lock_);
         if (metrics_ && is_full_ != is_full_new) {
           metrics_->data_dirs_full->IncrementBy(is_full_new ? 1 : -1);
         }
         is_full_ = is_full_new;
-        last_check_is_full_ = MonoTime::Now();
+        if (is_full_new) {
+          // Force a refresh as soon as the dir has room again.
+          available_space_fraction_ = 0;
+          last_check_space_ = MonoTime();
+        } else if (refresh_space) {
+          available_space_fraction_ = available_space_fraction;
+          last_check_space_ = now;
+        }
+        last_check_is_full_ = now;
       }
       break;
     }
@@ -276,6 +340,48 @@ Status DataDir::RefreshIsFull(RefreshMode mode) {
   return Status::OK();
 }
 
+DataDir::ScopedIOTracker::ScopedIOTracker(DataDir* dir, IOType type)
+    : dir_(dir),
+      type_(type),
+      start_(MonoTime::Now()) {
+  (type_ == SYNC_IO ? dir_->syncs_in_flight_ : dir_->ios_in_flight_).Increment();
+}
+
+DataDir::ScopedIOTracker::~ScopedIOTracker() {
+  MonoTime now = MonoTime::Now();
+  dir_->RecordIOLatency(type_, now - start_, now);
+  (type_ == SYNC_IO ? dir_->syncs_in_flight_ : dir_->ios_in_flight_).IncrementBy(-1);
+}
+
+double DataDir::LatencyAverage::ValueAt(MonoTime now) const {
+  if (!last_update.Initialized() || now <= last_update) {
+    return avg_us;
+  }
+  // Halve the average for every second without a completed I/O.
+  return avg_us * std::exp2(-(now - last_update).ToSeconds());
+}
+
+void DataDir::LatencyAverage::Add(MonoDelta latency, MonoTime now) {
+  // Weigh each new sample by 1/8 so that the average tracks changes in load
+  // within a few dozen I/Os while smoothing out individual outliers.
+  double old_avg_us = ValueAt(now);
+  avg_us = old_avg_us + (latency.ToMicroseconds() - old_avg_us) / 8;
+  last_update = now;
+}
+
+void DataDir::RecordIOLatency(IOType type, MonoDelta latency, MonoTime now) {
+  std::lock_guard<simple_spinlock> l(latency_lock_);
+  (type == SYNC_IO ? sync_latency_ : io_latency_).Add(latency, now);
+}
+
+int64_t DataDir::ExpectedIOWaitMicros(MonoTime now) const {
+  // A new I/O waits for those already in flight, and for any sync in
+  // progress.
+  std::lock_guard<simple_spinlock> l(latency_lock_);
+  return static_cast<int64_t>((ios_in_flight_.Load() + 1) * io_latency_.ValueAt(now) +
+                              syncs_in_flight_.Load() * sync_latency_.ValueAt(now));
+}
+
 const char* DataDirManager::kDataDirName = "data";
 
 DataDirManagerOptions::DataDirManagerOptions()
@@ -680,6 +786,25 @@ Status DataDirManager::CreateDataDirGroup(const string& tablet_id,
   return Status::OK();
 }
 
+namespace {
+
+// Returns a score reflecting how costly it would be to place new data in
+// 'dir': lower is better. Directories that are expected to serve I/O quickly
+// are favored, with dirs that are running low on space penalized by up to 2x.
+double LoadScore(const DataDir* dir) {
+  int64_t wait_us = std::max<int64_t>(dir->ExpectedIOWaitMicros(),
+                                      FLAGS_fs_data_dirs_idle_io_wait_us);
+  return wait_us * (2.0 - dir->available_space_fraction());
+}
+
+// Returns whether 'a' is significantly less loaded than 'b'.
+bool IsLessLoaded(const DataDir* a, const DataDir* b) {
+  return FLAGS_fs_data_dirs_load_aware_placement &&
+      LoadScore(a) * FLAGS_fs_data_dirs_load_imbalance_ratio < LoadScore(b);
+}
+
+} // anonymous namespace
+
 Status DataDirManager::GetNextDataDir(const CreateBlockOptions& opts, DataDir** dir) {
   shared_lock<rw_spinlock> lock(dir_group_lock_.get_lock());
   const vector<uint16_t>* group_uuid_indices;
@@ -712,15 +837,31 @@ Status DataDirManager::GetNextDataDir(const CreateBlockOptions& opts, DataDir**
   iota(random_indices.begin(), random_indices.end(), 0);
   shuffle(random_indices.begin(), random_indices.end(), default_random_engine(rng_.Next()));
 
-  // Randomly select a member of the group that is not full.
+  // Randomly select two members of the group that are not full, and choose
+  // the less loaded of the two. When the two are similarly loaded, as is the
+  // case for idle dirs, the first is chosen, keeping placement random.
+  DataDir* first = nullptr;
   for (int i : random_indices) {
     uint16_t uuid_idx = (*group_uuid_indices)[i];
     DataDir* candidate = FindOrDie(data_dir_by_uuid_idx_, uuid_idx);
     RETURN_NOT_OK(candidate->RefreshIsFull(DataDir::RefreshMode::EXPIRED_ONLY));
-    if (!candidate->is_full()) {
+    if (candidate->is_full()) {
+      continue;
+    }
+    if (!FLAGS_fs_data_dirs_load_aware_placement) {
       *dir = candidate;
       return Status::OK();
     }
+    if (first == nullptr) {
+      first = candidate;
+      continue;
+    }
+    *dir = IsLessLoaded(candidate, first) ? candidate : first;
+    return Status::OK();
+  }
+  if (first != nullptr) {
+    *dir = first;
+    return Status::OK();
   }
   string tablet_id_str = "";
   if (PREDICT_TRUE(!opts.tablet_id.empty())) {
@@ -777,9 +918,24 @@ Status DataDirManager::GetDirsForGroupUnlocked(int target_size,
   }
   while (group_indices->size() < target_size && !candidate_indices.empty()) {
     shuffle(candidate_indices.begin(), candidate_indices.end(), default_random_engine(rng_.Next()));
-    if (candidate_indices.size() == 1 ||
-        FindOrDie(tablets_by_uuid_idx_map_, candidate_indices[0]).size() <
-            FindOrDie(tablets_by_uuid_idx_map_, candidate_indices[1]).size()) {
+    // Prefer the dir that is significantly less loaded; otherwise prefer the
+    // dir with fewer tablets.
+    bool choose_first;
+    if (candidate_indices.size() == 1) {
+      choose_first = true;
+    } else {
+      const DataDir* first = FindOrDie(data_dir_by_uuid_idx_, candidate_indices[0]);
+      const DataDir* second = FindOrDie(data_dir_by_uuid_idx_, candidate_indices[1]);
+      if (IsLessLoaded(first, second)) {
+        choose_first = true;
+      } else if (IsLessLoaded(second, first)) {
+        choose_first = false;
+      } else {
+        choose_first = FindOrDie(tablets_by_uuid_idx_map_, candidate_indices[0]).size() <
+            FindOrDie(tablets_by_uuid_idx_map_, candidate_indices[1]).size();
+      }
+    }
+    if (choose_first) {
       group_indices->push_back(candidate_indices[0]);
       candidate_indices.erase(candidate_indices.begin());
     } else {
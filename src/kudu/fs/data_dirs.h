@@ -34,6 +34,7 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/map-util.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
@@ -178,7 +179,66 @@ class DataDir {
     return is_full_;
   }
 
+  // The kinds of I/O tracked by ScopedIOTracker. Syncs are tracked apart
+  // from reads and writes, which they typically outlast by far.
+  enum IOType {
+    DATA_IO,
+    SYNC_IO,
+  };
+
+  // Tracks a single I/O against this directory for the lifetime of the
+  // object. Used to estimate how loaded the directory is.
+  class ScopedIOTracker {
+   public:
+    explicit ScopedIOTracker(DataDir* dir, IOType type = DATA_IO);
+    ~ScopedIOTracker();
+
+   private:
+    DataDir* dir_;
+    const IOType type_;
+    const MonoTime start_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedIOTracker);
+  };
+
+  // Returns an estimate of how long, in microseconds, a new I/O issued
+  // against this directory would take to complete, based on the number of
+  // I/Os and syncs currently in flight and their recent average latencies.
+  int64_t ExpectedIOWaitMicros() const {
+    return ExpectedIOWaitMicros(MonoTime::Now());
+  }
+
+  // Returns the fraction of the underlying filesystem's capacity that was
+  // free as of the last fullness check, between 0 and 1.
+  double available_space_fraction() const {
+    std::lock_guard<simple_spinlock> l(lock_);
+    return available_space_fraction_;
+  }
+
  private:
+  FRIEND_TEST(DataDirsTest, TestIOLatencyDecays);
+  FRIEND_TEST(DataDirsTest, TestLoadAwarePlacement);
+
+  // An exponentially-weighted moving average of I/O latencies which decays
+  // towards zero while no I/O completes, so that a directory that was slow
+  // in the past isn't shunned forever.
+  struct LatencyAverage {
+    double avg_us = 0;
+    MonoTime last_update;
+
+    // Returns the average as of 'now'.
+    double ValueAt(MonoTime now) const;
+
+    // Folds the latency of an I/O which completed at 'now' into the average.
+    void Add(MonoDelta latency, MonoTime now);
+  };
+
+  int64_t ExpectedIOWaitMicros(MonoTime now) const;
+
+  // Folds the latency of an I/O of type 'type', completed at 'now', into the
+  // corresponding average.
+  void RecordIOLatency(IOType type, MonoDelta latency, MonoTime now);
+
   Env* env_;
   DataDirMetrics* metrics_;
   const DataDirFsType fs_type_;
@@ -188,10 +248,23 @@ class DataDir {
 
   bool is_shutdown_;
 
-  // Protects 'last_check_is_full_' and 'is_full_'.
+  // Number of I/Os and syncs tracked by ScopedIOTracker that have yet to
+  // complete.
+  AtomicInt<int32_t> ios_in_flight_;
+  AtomicInt<int32_t> syncs_in_flight_;
+
+  // Protects 'io_latency_' and 'sync_latency_'.
+  mutable simple_spinlock latency_lock_;
+  LatencyAverage io_latency_;
+  LatencyAverage sync_latency_;
+
+  // Protects 'last_check_is_full_', 'is_full_', 'last_check_space_', and
+  // 'available_space_fraction_'.
   mutable simple_spinlock lock_;
   MonoTime last_check_is_full_;
   bool is_full_;
+  MonoTime last_check_space_;
+  double available_space_fraction_;
 
   DISALLOW_COPY_AND_ASSIGN(DataDir);
 };
@@ -374,6 +447,7 @@ class DataDirManager {
   FRIEND_TEST(DataDirsTest, TestLoadBalancingBias);
   FRIEND_TEST(DataDirsTest, TestLoadBalancingDistribution);
   FRIEND_TEST(DataDirsTest, TestFailedDirNotAddedToGroup);
+  FRIEND_TEST(DataDirsTest, TestLoadAwarePlacement);
 
   // The base name of a data directory.
   static const char* kDataDirName;
@@ -63,6 +63,7 @@ using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
+DECLARE_bool(block_manager_direct_reads);
 DECLARE_bool(block_manager_lock_dirs);
 DECLARE_bool(enable_data_block_fsync);
 DECLARE_string(block_manager_preflush_control);
@@ -335,16 +336,20 @@ Status FileWritableBlock::Append(const Slice& data) {
 
 Status FileWritableBlock::AppendV(const vector<Slice>& data) {
   DCHECK(state_ == CLEAN || state_ == DIRTY) << "Invalid state: " << state_;
-  RETURN_NOT_OK_HANDLE_ERROR(writer_->AppendV(data));
-  RETURN_NOT_OK_HANDLE_ERROR(location_.data_dir()->RefreshIsFull(
-      DataDir::RefreshMode::ALWAYS));
-  state_ = DIRTY;
 
-  // Calculate the amount of data written
+  // Calculate the amount of data to write
   size_t bytes_written = accumulate(data.begin(), data.end(), static_cast<size_t>(0),
                                     [&](int sum, const Slice& curr) {
                                       return sum + curr.size();
                                     });
+  ThrottleBackgroundIO(bytes_written);
+  {
+    DataDir::ScopedIOTracker io_tracker(location_.data_dir());
+    RETURN_NOT_OK_HANDLE_ERROR(writer_->AppendV(data));
+  }
+  RETURN_NOT_OK_HANDLE_ERROR(location_.data_dir()->RefreshIsFull(
+      DataDir::RefreshMode::ALWAYS));
+  state_ = DIRTY;
   bytes_appended_ += bytes_written;
   return Status::OK();
 }
@@ -391,6 +396,7 @@ Status FileWritableBlock::Close(SyncMode mode) {
     VLOG(3) << "Syncing block " << id();
     if (FLAGS_enable_data_block_fsync) {
       if (block_manager_->metrics_) block_manager_->metrics_->total_disk_sync->Increment();
+      DataDir::ScopedIOTracker io_tracker(location_.data_dir(), DataDir::SYNC_IO);
       sync = writer_->Sync();
     }
     if (sync.ok()) {
@@ -442,6 +448,9 @@ class FileReadableBlock : public ReadableBlock {
 
   virtual Status ReadV(uint64_t offset, vector<Slice>* results) const OVERRIDE;
 
+  virtual void ReadVAsync(uint64_t offset, vector<Slice>* results,
+                          const StdStatusCallback& cb) const OVERRIDE;
+
   virtual size_t memory_footprint() const OVERRIDE;
 
   void HandleError(const Status& s) const;
@@ -517,20 +526,48 @@ Status FileReadableBlock::Read(uint64_t offset, Slice* result) const {
 Status FileReadableBlock::ReadV(uint64_t offset, vector<Slice>* results) const {
   DCHECK(!closed_.Load());
 
-  RETURN_NOT_OK_HANDLE_ERROR(reader_->ReadV(offset, results));
+  // Calculate the read amount of data
+  size_t bytes_read = accumulate(results->begin(), results->end(), static_cast<size_t>(0),
+                                 [&](int sum, const Slice& curr) {
+                                   return sum + curr.size();
+                                 });
+  ThrottleBackgroundIO(bytes_read);
+  {
+    DataDir::ScopedIOTracker io_tracker(block_manager_->dd_manager_->FindDataDirByUuidIndex(
+        internal::FileBlockLocation::GetDataDirIdx(block_id_)));
+    RETURN_NOT_OK_HANDLE_ERROR(reader_->ReadV(offset, results));
+  }
 
   if (block_manager_->metrics_) {
-    // Calculate the read amount of data
-    size_t bytes_read = accumulate(results->begin(), results->end(), static_cast<size_t>(0),
-                                   [&](int sum, const Slice& curr) {
-                                     return sum + curr.size();
-                                   });
     block_manager_->metrics_->total_bytes_read->IncrementBy(bytes_read);
   }
-
   return Status::OK();
 }
 
+void FileReadableBlock::ReadVAsync(uint64_t offset, vector<Slice>* results,
+                                   const StdStatusCallback& cb) const {
+  DCHECK(!closed_.Load());
+
+  size_t bytes_read = accumulate(results->begin(), results->end(), static_cast<size_t>(0),
+                                 [&](int sum, const Slice& curr) {
+                                   return sum + curr.size();
+                                 });
+  ThrottleBackgroundIO(bytes_read);
+  // The read is tracked until it completes, possibly on another thread.
+  auto io_tracker = std::make_shared<DataDir::ScopedIOTracker>(
+      block_manager_->dd_manager_->FindDataDirByUuidIndex(
+          internal::FileBlockLocation::GetDataDirIdx(block_id_)));
+  reader_->ReadVAsync(offset, results,
+                      [this, bytes_read, cb, io_tracker](const Status& s) mutable {
+    io_tracker.reset();
+    HandleError(s);
+    if (s.ok() && block_manager_->metrics_) {
+      block_manager_->metrics_->total_bytes_read->IncrementBy(bytes_read);
+    }
+    cb(s);
+  });
+}
+
 size_t FileReadableBlock::memory_footprint() const {
   DCHECK(reader_);
   return kudu_malloc_usable_size(this) + reader_->memory_footprint();
@@ -594,6 +631,7 @@ FileBlockManager::FileBlockManager(Env* env,
     mem_tracker_(MemTracker::CreateTracker(-1,
                                            "file_block_manager",
                                            opts.parent_mem_tracker)) {
+  file_cache_.set_direct_reads(FLAGS_block_manager_direct_reads);
   if (opts.metric_entity) {
     metrics_.reset(new internal::BlockManagerMetrics(opts.metric_entity));
   }
@@ -718,6 +756,14 @@ Status FileBlockManager::OpenBlock(const BlockId& block_id,
   return Status::OK();
 }
 
+Status FileBlockManager::ReadBlocks(vector<BlockReadRequest>* requests) {
+  // Every block is a separate file; there's nothing to merge.
+  for (auto& req : *requests) {
+    RETURN_NOT_OK(req.block->Read(req.offset, &req.result));
+  }
+  return Status::OK();
+}
+
 Status FileBlockManager::DeleteBlock(const BlockId& block_id) {
   CHECK(!read_only_);
 
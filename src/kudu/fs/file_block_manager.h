@@ -86,6 +86,8 @@ class FileBlockManager : public BlockManager {
   Status OpenBlock(const BlockId& block_id,
                    std::unique_ptr<ReadableBlock>* block) override;
 
+  Status ReadBlocks(std::vector<BlockReadRequest>* requests) override;
+
   Status DeleteBlock(const BlockId& block_id) override;
 
   Status CloseBlocks(const std::vector<std::unique_ptr<WritableBlock>>& blocks) override;
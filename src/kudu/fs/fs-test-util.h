@@ -79,6 +79,18 @@ class CountingReadableBlock : public ReadableBlock {
     return Status::OK();
   }
 
+  virtual void ReadVAsync(uint64_t offset, std::vector<Slice>* results,
+                          const StdStatusCallback& cb) const OVERRIDE {
+    block_->ReadVAsync(offset, results, [this, results, cb](const Status& s) {
+      if (s.ok()) {
+        for (const auto& result : *results) {
+          *bytes_read_ += result.size();
+        }
+      }
+      cb(s);
+    });
+  }
+
   virtual size_t memory_footprint() const OVERRIDE {
     return block_->memory_footprint();
   }
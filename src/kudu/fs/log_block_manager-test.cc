@@ -24,6 +24,7 @@
 #include <ostream>
 #include <set>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -65,6 +66,7 @@
 using kudu::pb_util::ReadablePBContainerFile;
 using std::set;
 using std::string;
+using std::thread;
 using std::unique_ptr;
 using std::unordered_map;
 using std::unordered_set;
@@ -73,10 +75,14 @@ using strings::Substitute;
 
 DECLARE_bool(cache_force_single_shard);
 DECLARE_bool(crash_on_eio);
+DECLARE_bool(enable_data_block_fsync);
 DECLARE_double(env_inject_eio);
 DECLARE_double(log_container_excess_space_before_cleanup_fraction);
 DECLARE_double(log_container_live_metadata_before_compact_ratio);
+DECLARE_int32(log_container_group_sync_window_us);
 DECLARE_int64(block_manager_max_open_files);
+DECLARE_int64(log_block_manager_read_merge_max_gap_bytes);
+DECLARE_int64(log_container_checkpoint_interval_records);
 DECLARE_int64(log_container_max_blocks);
 DECLARE_string(env_inject_eio_globs);
 DECLARE_uint64(log_container_preallocate_bytes);
@@ -87,6 +93,9 @@ METRIC_DECLARE_gauge_uint64(log_block_manager_bytes_under_management);
 METRIC_DECLARE_gauge_uint64(log_block_manager_blocks_under_management);
 METRIC_DECLARE_gauge_uint64(log_block_manager_containers);
 METRIC_DECLARE_gauge_uint64(log_block_manager_full_containers);
+METRIC_DECLARE_histogram(log_block_manager_group_sync_batch_size);
+METRIC_DECLARE_counter(log_block_manager_group_syncs_coalesced);
+METRIC_DECLARE_counter(log_block_manager_merged_reads);
 
 namespace kudu {
 namespace fs {
@@ -1430,5 +1439,189 @@ TEST_F(LogBlockManagerTest, TestAbortBlock) {
   ASSERT_EQ(1, bm_->available_containers_by_data_dir_.begin()->second.size());
 }
 
+// Test that concurrent closes of blocks in the same container share fsyncs.
+TEST_F(LogBlockManagerTest, TestGroupSync) {
+  FLAGS_enable_data_block_fsync = true;
+  // Use a generous window so that every closing thread joins the first sync.
+  FLAGS_log_container_group_sync_window_us = 500 * 1000;
+
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity = METRIC_ENTITY_server.Instantiate(&registry, "test");
+  ASSERT_OK(ReopenBlockManager(entity));
+
+  // Finalized blocks return their container to the pool, so all of these
+  // blocks land in the same container.
+  const int kNumBlocks = 4;
+  vector<unique_ptr<WritableBlock>> blocks;
+  for (int i = 0; i < kNumBlocks; i++) {
+    unique_ptr<WritableBlock> writer;
+    ASSERT_OK(bm_->CreateBlock(test_block_opts_, &writer));
+    ASSERT_OK(writer->Append("test data"));
+    ASSERT_OK(writer->Finalize());
+    blocks.emplace_back(std::move(writer));
+  }
+  ASSERT_EQ(1, bm_->all_containers_by_name_.size());
+
+  vector<thread> threads;
+  vector<Status> statuses(kNumBlocks);
+  for (int i = 0; i < kNumBlocks; i++) {
+    threads.emplace_back([&, i]() { statuses[i] = blocks[i]->Close(); });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (const auto& s : statuses) {
+    ASSERT_OK(s);
+  }
+  for (const auto& block : blocks) {
+    unique_ptr<ReadableBlock> reader;
+    ASSERT_OK(bm_->OpenBlock(block->id(), &reader));
+  }
+
+  // At least the data file syncs of all but one thread were coalesced.
+  scoped_refptr<Histogram> batch_size = down_cast<Histogram*>(
+      entity->FindOrNull(METRIC_log_block_manager_group_sync_batch_size).get());
+  ASSERT_EQ(kNumBlocks, batch_size->MaxValueForTests());
+  ASSERT_GE(down_cast<Counter*>(
+      entity->FindOrNull(METRIC_log_block_manager_group_syncs_coalesced).get())->value(),
+            kNumBlocks - 1);
+}
+
+TEST_F(LogBlockManagerTest, TestContainerMetadataCheckpoint) {
+  FLAGS_log_container_checkpoint_interval_records = 5;
+
+  // Create a handful of blocks in a single container and delete some of them.
+  const int kNumBlocks = 20;
+  vector<BlockId> live_ids;
+  vector<BlockId> dead_ids;
+  for (int i = 0; i < kNumBlocks; i++) {
+    unique_ptr<WritableBlock> writer;
+    ASSERT_OK(bm_->CreateBlock(test_block_opts_, &writer));
+    ASSERT_OK(writer->Append("test data"));
+    ASSERT_OK(writer->Close());
+    if (i % 3 == 0) {
+      ASSERT_OK(bm_->DeleteBlock(writer->id()));
+      dead_ids.push_back(writer->id());
+    } else {
+      live_ids.push_back(writer->id());
+    }
+  }
+
+  auto verify_blocks = [&]() {
+    for (const auto& id : live_ids) {
+      unique_ptr<ReadableBlock> reader;
+      ASSERT_OK(bm_->OpenBlock(id, &reader));
+      uint64_t size;
+      ASSERT_OK(reader->Size(&size));
+      ASSERT_EQ(strlen("test data"), size);
+    }
+    for (const auto& id : dead_ids) {
+      unique_ptr<ReadableBlock> reader;
+      ASSERT_TRUE(bm_->OpenBlock(id, &reader).IsNotFound());
+    }
+  };
+
+  // The first reopen replays the whole metadata file (unless a background
+  // checkpoint got there first) and leaves a checkpoint behind.
+  ASSERT_OK(ReopenBlockManager());
+  NO_FATALS(verify_blocks());
+  string container;
+  NO_FATALS(GetOnlyContainer(&container));
+  string checkpoint_path = container + LogBlockManager::kContainerCheckpointFileSuffix;
+  ASSERT_TRUE(env_->FileExists(checkpoint_path));
+
+  // Subsequent reopens start from the checkpoint and must see the same blocks.
+  ASSERT_OK(ReopenBlockManager());
+  NO_FATALS(verify_blocks());
+
+  // New blocks must not reuse the IDs covered by the checkpoint.
+  unique_ptr<WritableBlock> writer;
+  ASSERT_OK(bm_->CreateBlock(test_block_opts_, &writer));
+  ASSERT_OK(writer->Close());
+  for (const auto& id : live_ids) {
+    ASSERT_NE(id, writer->id());
+  }
+  for (const auto& id : dead_ids) {
+    ASSERT_NE(id, writer->id());
+  }
+  live_ids.push_back(writer->id());
+
+  // A corrupt checkpoint is ignored in favor of a full replay.
+  ASSERT_OK(WriteStringToFile(env_, "garbage", checkpoint_path));
+  ASSERT_OK(ReopenBlockManager());
+  NO_FATALS(verify_blocks());
+
+  // So is a checkpoint whose offset is past the end of the metadata file or
+  // in the middle of a record. Either way, it's replaced by a checkpoint of
+  // the whole metadata file.
+  string metadata_path = container + LogBlockManager::kContainerMetadataFileSuffix;
+  uint64_t metadata_size;
+  ASSERT_OK(env_->GetFileSize(metadata_path, &metadata_size));
+  auto corrupt_checkpoint_offset = [&](uint64_t offset) {
+    BlockRecordCheckpointPB checkpoint;
+    ASSERT_OK(pb_util::ReadPBContainerFromPath(env_, checkpoint_path, &checkpoint));
+    ASSERT_EQ(metadata_size, checkpoint.metadata_offset());
+    checkpoint.set_metadata_offset(offset);
+    ASSERT_OK(pb_util::WritePBContainerToPath(env_, checkpoint_path, checkpoint,
+                                              pb_util::OVERWRITE, pb_util::NO_SYNC));
+  };
+  for (uint64_t bad_offset : { metadata_size + 100, metadata_size - 3 }) {
+    SCOPED_TRACE(bad_offset);
+    NO_FATALS(corrupt_checkpoint_offset(bad_offset));
+    ASSERT_OK(ReopenBlockManager());
+    NO_FATALS(verify_blocks());
+    uint64_t size_after_reopen;
+    ASSERT_OK(env_->GetFileSize(metadata_path, &size_after_reopen));
+    ASSERT_EQ(metadata_size, size_after_reopen);
+    BlockRecordCheckpointPB checkpoint;
+    ASSERT_OK(pb_util::ReadPBContainerFromPath(env_, checkpoint_path, &checkpoint));
+    ASSERT_EQ(metadata_size, checkpoint.metadata_offset());
+  }
+}
+
+TEST_F(LogBlockManagerTest, TestReadBlocksMergesNearbyReads) {
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity = METRIC_ENTITY_server.Instantiate(&registry, "test");
+  ASSERT_OK(ReopenBlockManager(entity));
+
+  // Blocks written one after the other land next to each other in the same
+  // container, separated only by alignment padding.
+  const int kNumBlocks = 5;
+  vector<unique_ptr<ReadableBlock>> blocks;
+  for (int i = 0; i < kNumBlocks; i++) {
+    unique_ptr<WritableBlock> writer;
+    ASSERT_OK(bm_->CreateBlock(test_block_opts_, &writer));
+    ASSERT_OK(writer->Append(Substitute("block $0", i)));
+    ASSERT_OK(writer->Close());
+    unique_ptr<ReadableBlock> reader;
+    ASSERT_OK(bm_->OpenBlock(writer->id(), &reader));
+    blocks.emplace_back(std::move(reader));
+  }
+  ASSERT_EQ(1, bm_->all_containers_by_name_.size());
+
+  uint8_t scratch[kNumBlocks][7];
+  vector<BlockReadRequest> requests;
+  for (int i = kNumBlocks - 1; i >= 0; i--) {
+    requests.push_back({ blocks[i].get(), 0, Slice(scratch[i], 7) });
+  }
+  ASSERT_OK(bm_->ReadBlocks(&requests));
+  for (int i = 0; i < kNumBlocks; i++) {
+    ASSERT_EQ(Substitute("block $0", kNumBlocks - 1 - i), requests[i].result.ToString());
+  }
+  Counter* merged = down_cast<Counter*>(
+      entity->FindOrNull(METRIC_log_block_manager_merged_reads).get());
+  ASSERT_EQ(kNumBlocks - 1, merged->value());
+
+  // Nothing is merged if gaps aren't allowed, and the separate reads are
+  // issued together.
+  FLAGS_log_block_manager_read_merge_max_gap_bytes = 0;
+  memset(scratch, 0, sizeof(scratch));
+  ASSERT_OK(bm_->ReadBlocks(&requests));
+  ASSERT_EQ(kNumBlocks - 1, merged->value());
+  for (int i = 0; i < kNumBlocks; i++) {
+    ASSERT_EQ(Substitute("block $0", kNumBlocks - 1 - i), requests[i].result.ToString());
+  }
+}
+
 } // namespace fs
 } // namespace kudu
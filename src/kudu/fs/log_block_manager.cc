@@ -21,6 +21,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <errno.h>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -47,6 +48,7 @@
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/callback.h"
 #include "kudu/gutil/casts.h"
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/stl_util.h"
@@ -58,6 +60,8 @@
 #include "kudu/gutil/walltime.h"
 #include "kudu/util/alignment.h"
 #include "kudu/util/atomic.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/countdown_latch.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
 #include "kudu/util/file_cache.h"
@@ -66,6 +70,7 @@
 #include "kudu/util/malloc.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/random.h"
@@ -73,8 +78,10 @@
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/test_util_prod.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 
+DECLARE_bool(block_manager_direct_reads);
 DECLARE_bool(block_manager_lock_dirs);
 DECLARE_bool(enable_data_block_fsync);
 DECLARE_string(block_manager_preflush_control);
@@ -113,6 +120,38 @@ DEFINE_bool(log_block_manager_test_hole_punching, true,
 TAG_FLAG(log_block_manager_test_hole_punching, advanced);
 TAG_FLAG(log_block_manager_test_hole_punching, unsafe);
 
+DEFINE_int32(log_container_group_sync_window_us, 0,
+             "How long, in microseconds, a thread about to fsync a log block "
+             "container's data or metadata file waits for other threads writing "
+             "to the same container to join it, so that all of them share a "
+             "single fsync. Concurrent syncs of the same file are coalesced "
+             "even when set to 0; a positive value trades some latency for "
+             "larger groups when many tablets flush at once.");
+TAG_FLAG(log_container_group_sync_window_us, advanced);
+TAG_FLAG(log_container_group_sync_window_us, experimental);
+
+DEFINE_int64(log_container_checkpoint_interval_records, 1000,
+             "Number of records appended to a log block container's metadata "
+             "file after which a checkpoint of the container's live blocks is "
+             "written. At startup, only the records appended since the last "
+             "checkpoint need to be replayed. Set to 0 to disable checkpoints.");
+TAG_FLAG(log_container_checkpoint_interval_records, advanced);
+TAG_FLAG(log_container_checkpoint_interval_records, experimental);
+
+DEFINE_int32(log_block_manager_open_threads_per_data_dir, 4,
+             "Number of threads per data directory used to read log block "
+             "container metadata while opening the block manager.");
+TAG_FLAG(log_block_manager_open_threads_per_data_dir, advanced);
+
+DEFINE_int64(log_block_manager_read_merge_max_gap_bytes, 4096,
+             "When reading a batch of blocks, reads from the same container "
+             "separated by at most this many bytes are merged into a single "
+             "vectored read. The default covers the padding between blocks "
+             "that were written consecutively. If 0, only exactly adjacent "
+             "reads are merged.");
+TAG_FLAG(log_block_manager_read_merge_max_gap_bytes, advanced);
+TAG_FLAG(log_block_manager_read_merge_max_gap_bytes, experimental);
+
 METRIC_DEFINE_gauge_uint64(server, log_block_manager_bytes_under_management,
                            "Bytes Under Management",
                            kudu::MetricUnit::kBytes,
@@ -133,6 +172,26 @@ METRIC_DEFINE_gauge_uint64(server, log_block_manager_full_containers,
                            kudu::MetricUnit::kLogBlockContainers,
                            "Number of full log block containers");
 
+METRIC_DEFINE_histogram(server, log_block_manager_group_sync_batch_size,
+                        "Group Sync Batch Size",
+                        kudu::MetricUnit::kRequests,
+                        "Number of concurrent requests to sync a log block container "
+                        "file that were satisfied by a single fsync",
+                        10000, 2);
+
+METRIC_DEFINE_counter(server, log_block_manager_group_syncs_coalesced,
+                      "Coalesced Group Syncs",
+                      kudu::MetricUnit::kRequests,
+                      "Number of requests to sync a log block container file that "
+                      "were satisfied by another thread's fsync instead of issuing "
+                      "their own");
+
+METRIC_DEFINE_counter(server, log_block_manager_merged_reads,
+                      "Merged Block Reads",
+                      kudu::MetricUnit::kRequests,
+                      "Number of block reads in batched requests that were merged "
+                      "into a vectored read issued for another block read");
+
 namespace kudu {
 
 namespace fs {
@@ -173,17 +232,136 @@ struct LogBlockManagerMetrics {
 
   scoped_refptr<AtomicGauge<uint64_t>> containers;
   scoped_refptr<AtomicGauge<uint64_t>> full_containers;
+
+  scoped_refptr<Histogram> group_sync_batch_size;
+  scoped_refptr<Counter> group_syncs_coalesced;
+
+  scoped_refptr<Counter> merged_reads;
 };
 
 #define GINIT(x) x(METRIC_log_block_manager_##x.Instantiate(metric_entity, 0))
+#define MINIT(x) x(METRIC_log_block_manager_##x.Instantiate(metric_entity))
 LogBlockManagerMetrics::LogBlockManagerMetrics(const scoped_refptr<MetricEntity>& metric_entity)
   : generic_metrics(metric_entity),
     GINIT(bytes_under_management),
     GINIT(blocks_under_management),
     GINIT(containers),
-    GINIT(full_containers) {
+    GINIT(full_containers),
+    MINIT(group_sync_batch_size),
+    MINIT(group_syncs_coalesced),
+    MINIT(merged_reads) {
 }
 #undef GINIT
+#undef MINIT
+
+////////////////////////////////////////////////////////////
+// GroupSyncer
+////////////////////////////////////////////////////////////
+
+// Coalesces concurrent requests to fsync the same file.
+//
+// Blocks of unrelated writers (e.g. flushes of different tablets) often land
+// in the same container, and each writer syncs the container when closing its
+// blocks. Rather than issuing one fsync per writer, every caller of Sync()
+// takes a ticket; if no sync is in progress, the caller becomes the leader and
+// issues a single sync on behalf of every ticket handed out before it started.
+// Callers that arrive while a sync is in progress wait for it and then elect
+// a new leader among themselves, so at most one sync of the file is in flight
+// at any time.
+//
+// Callers must have finished the writes that they want to make durable before
+// calling Sync().
+class GroupSyncer {
+ public:
+  explicit GroupSyncer(const LogBlockManagerMetrics* metrics)
+      : metrics_(metrics),
+        cond_(&lock_),
+        last_ticket_(0),
+        synced_through_(0),
+        sync_in_progress_(false) {
+  }
+
+  // Makes all writes performed before this call durable by way of 'sync_fn',
+  // possibly by sharing an invocation of 'sync_fn' with other callers.
+  //
+  // Returns the result of the invocation of 'sync_fn' that covered this call.
+  // Once an invocation fails, every later call fails with the same error: a
+  // later fsync could succeed without the writes that were lost having
+  // reached the disk.
+  Status Sync(const std::function<Status()>& sync_fn);
+
+ private:
+  const LogBlockManagerMetrics* metrics_;
+
+  // Protects all of the state below.
+  Mutex lock_;
+  ConditionVariable cond_;
+
+  // The last ticket handed out to a caller.
+  int64_t last_ticket_;
+
+  // Every caller whose ticket is up to and including this value is covered by
+  // a sync that succeeded.
+  int64_t synced_through_;
+
+  // The error of the first sync that failed, if any.
+  Status failed_status_;
+
+  bool sync_in_progress_;
+
+  DISALLOW_COPY_AND_ASSIGN(GroupSyncer);
+};
+
+Status GroupSyncer::Sync(const std::function<Status()>& sync_fn) {
+  if (!FLAGS_enable_data_block_fsync) {
+    return sync_fn();
+  }
+
+  MutexLock l(lock_);
+  const int64_t ticket = ++last_ticket_;
+  while (true) {
+    // Check for success first: this ticket may have been covered by a sync
+    // that succeeded before a later one failed.
+    if (synced_through_ >= ticket) {
+      if (metrics_) metrics_->group_syncs_coalesced->Increment();
+      return Status::OK();
+    }
+    if (PREDICT_FALSE(!failed_status_.ok())) {
+      if (metrics_) metrics_->group_syncs_coalesced->Increment();
+      return failed_status_;
+    }
+    if (!sync_in_progress_) {
+      break;
+    }
+    cond_.Wait();
+  }
+
+  // This caller is the leader for the next sync.
+  sync_in_progress_ = true;
+  if (FLAGS_log_container_group_sync_window_us > 0) {
+    l.Unlock();
+    SleepFor(MonoDelta::FromMicroseconds(FLAGS_log_container_group_sync_window_us));
+    l.Lock();
+  }
+  const int64_t covered_from = synced_through_;
+  const int64_t covered_through = last_ticket_;
+
+  l.Unlock();
+  Status s = sync_fn();
+  l.Lock();
+
+  if (s.ok()) {
+    synced_through_ = covered_through;
+  } else {
+    failed_status_ = s;
+  }
+  sync_in_progress_ = false;
+  if (metrics_) {
+    metrics_->group_sync_batch_size->Increment(covered_through - covered_from);
+  }
+  cond_.Broadcast();
+  return s;
+}
 
 ////////////////////////////////////////////////////////////
 // LogBlock (declaration)
@@ -384,6 +562,10 @@ class LogBlockContainer {
   // See RWFile::ReadV().
   Status ReadVData(int64_t offset, vector<Slice>* results) const;
 
+  // Like ReadVData(), but asynchronous; see ReadableBlock::ReadVAsync().
+  void ReadVDataAsync(int64_t offset, vector<Slice>* results,
+                      const StdStatusCallback& cb) const;
+
   // Appends 'pb' to this container's metadata file.
   //
   // The on-disk effects of this call are made durable only after SyncMetadata().
@@ -418,6 +600,23 @@ class LogBlockContainer {
   // file was changed.
   Status ReopenMetadataWriter();
 
+  // Reads this container's checkpoint file into 'checkpoint'. Returns
+  // NotFound if there is no checkpoint.
+  Status ReadCheckpoint(BlockRecordCheckpointPB* checkpoint) const;
+
+  // Replaces this container's checkpoint file with 'checkpoint', which covers
+  // 'records_covered' records that weren't covered by the previous one.
+  Status WriteCheckpoint(const BlockRecordCheckpointPB& checkpoint,
+                         int64_t records_covered);
+
+  // Deletes this container's checkpoint file, if there is one.
+  Status DeleteCheckpoint() const;
+
+  // Writes a new checkpoint on this container's data directory thread pool if
+  // enough metadata records have been appended since the last one, and no
+  // checkpoint is being written already.
+  void MaybeScheduleCheckpoint();
+
   // Truncates this container's data file to 'next_block_offset_' if it is
   // full. This effectively removes any preallocated but unused space.
   //
@@ -436,6 +635,12 @@ class LogBlockContainer {
   // 'dead_blocks'. Live records are written to 'live_block_records'. The
   // greatest block ID seen thus far in the container is written to 'max_block_id'.
   //
+  // If the container has a usable checkpoint, the checkpoint is loaded and
+  // only the records that follow it are read; otherwise every record is read.
+  // In the former case, 'dead_blocks' only includes blocks that were deleted
+  // by records following the checkpoint. The offset just past the last valid
+  // record is written to 'metadata_offset'.
+  //
   // Returns an error only if there was a problem accessing the container from
   // disk; such errors are fatal and effectively halt processing immediately.
   Status ProcessRecords(
@@ -443,7 +648,8 @@ class LogBlockContainer {
       LogBlockManager::UntrackedBlockMap* live_blocks,
       LogBlockManager::BlockRecordMap* live_block_records,
       std::vector<scoped_refptr<internal::LogBlock>>* dead_blocks,
-      uint64_t* max_block_id);
+      uint64_t* max_block_id,
+      uint64_t* metadata_offset);
 
   // Updates internal bookkeeping state to reflect the creation of a block.
   void BlockCreated(const scoped_refptr<LogBlock>& block);
@@ -491,6 +697,8 @@ class LogBlockContainer {
   DataDir* data_dir() const { return data_dir_; }
   const PathInstanceMetadataPB* instance() const { return data_dir_->instance()->metadata(); }
   bool read_only() const { return read_only_.Load(); }
+  bool loaded_from_checkpoint() const { return loaded_from_checkpoint_; }
+  int64_t records_since_checkpoint() const { return records_since_checkpoint_.Load(); }
 
  private:
   LogBlockContainer(LogBlockManager* block_manager, DataDir* data_dir,
@@ -528,6 +736,20 @@ class LogBlockContainer {
   // This function is thread unsafe.
   void UpdateNextBlockOffset(int64_t block_offset, int64_t block_length);
 
+  // Replays the first 'metadata_size' bytes of this container's metadata
+  // file, starting from its last checkpoint if possible, and builds a new
+  // checkpoint out of them without touching any in-memory state. Safe to call
+  // while records are being appended.
+  Status BuildCheckpoint(uint64_t metadata_size,
+                         BlockRecordCheckpointPB* checkpoint) const;
+
+  // Builds and writes a new checkpoint. Runs on the data directory's thread
+  // pool; see MaybeScheduleCheckpoint().
+  void DoCheckpoint();
+
+  // Returns the path of this container's checkpoint file.
+  string CheckpointPath() const;
+
   // The owning block manager. Must outlive the container itself.
   LogBlockManager* const block_manager_;
 
@@ -566,11 +788,25 @@ class LogBlockContainer {
   // as the block manager.
   const LogBlockManagerMetrics* metrics_;
 
+  // Coalesce concurrent syncs of the data and metadata files respectively.
+  GroupSyncer data_syncer_;
+  GroupSyncer metadata_syncer_;
+
   // If true, only read operations are allowed. Existing blocks may
   // not be deleted until the next restart, and new blocks may not
   // be added.
   AtomicBool read_only_;
 
+  // Whether the container's records were loaded from a checkpoint at startup.
+  bool loaded_from_checkpoint_;
+
+  // The number of records in the metadata file that aren't covered by the
+  // last checkpoint.
+  AtomicInt<int64_t> records_since_checkpoint_;
+
+  // Whether a checkpoint is being written in the background.
+  AtomicBool checkpoint_in_progress_;
+
   DISALLOW_COPY_AND_ASSIGN(LogBlockContainer);
 };
 
@@ -592,7 +828,12 @@ LogBlockContainer::LogBlockContainer(
       live_bytes_aligned_(0),
       live_blocks_(0),
       metrics_(block_manager->metrics()),
-      read_only_(false) {
+      data_syncer_(metrics_),
+      metadata_syncer_(metrics_),
+      read_only_(false),
+      loaded_from_checkpoint_(false),
+      records_since_checkpoint_(0),
+      checkpoint_in_progress_(false) {
 }
 
 void LogBlockContainer::HandleError(const Status& s) const {
@@ -747,30 +988,99 @@ Status LogBlockContainer::ProcessRecords(
     LogBlockManager::UntrackedBlockMap* live_blocks,
     LogBlockManager::BlockRecordMap* live_block_records,
     vector<scoped_refptr<internal::LogBlock>>* dead_blocks,
-    uint64_t* max_block_id) {
-  string metadata_path = metadata_file_->filename();
-  unique_ptr<RandomAccessFile> metadata_reader;
-  RETURN_NOT_OK_HANDLE_ERROR(block_manager()->env()->NewRandomAccessFile(
-      metadata_path, &metadata_reader));
-  ReadablePBContainerFile pb_reader(std::move(metadata_reader));
-  RETURN_NOT_OK_HANDLE_ERROR(pb_reader.Open());
+    uint64_t* max_block_id,
+    uint64_t* metadata_offset) {
+  unique_ptr<ReadablePBContainerFile> pb_reader;
+  auto open_reader = [&]() -> Status {
+    unique_ptr<RandomAccessFile> metadata_reader;
+    RETURN_NOT_OK_HANDLE_ERROR(block_manager()->env()->NewRandomAccessFile(
+        metadata_file_->filename(), &metadata_reader));
+    pb_reader.reset(new ReadablePBContainerFile(std::move(metadata_reader)));
+    RETURN_NOT_OK_HANDLE_ERROR(pb_reader->Open());
+    return Status::OK();
+  };
+  RETURN_NOT_OK(open_reader());
 
   uint64_t data_file_size = 0;
   Status read_status;
-  while (true) {
-    BlockRecordPB record;
-    read_status = pb_reader.ReadNextPB(&record);
-    if (!read_status.ok()) {
-      break;
+  int64_t records_read = 0;
+
+  // If there's a checkpoint, read the records that follow it before touching
+  // any state: should they turn out to be unreadable, the checkpoint is
+  // deleted and the whole metadata file is replayed instead.
+  //
+  // A partial trailing record is not accepted either: it's indistinguishable
+  // from a checkpoint whose offset points into the middle of a record, and
+  // the full replay below knows how to deal with it.
+  BlockRecordCheckpointPB checkpoint;
+  Status checkpoint_status = Status::NotFound("");
+  if (FLAGS_log_container_checkpoint_interval_records > 0) {
+    checkpoint_status = ReadCheckpoint(&checkpoint);
+  }
+  if (checkpoint_status.ok()) {
+    vector<BlockRecordPB> tail;
+    read_status = pb_reader->SkipTo(checkpoint.metadata_offset());
+    while (read_status.ok()) {
+      tail.emplace_back();
+      read_status = pb_reader->ReadNextPB(&tail.back());
+    }
+    if (read_status.IsEndOfFile()) {
+      if (!tail.empty()) {
+        // Drop the record that failed to be read.
+        tail.pop_back();
+      }
+      for (auto& record : *checkpoint.mutable_live_records()) {
+        RETURN_NOT_OK(ProcessRecord(&record, report,
+                                    live_blocks, live_block_records, dead_blocks,
+                                    &data_file_size, max_block_id));
+      }
+      // Account for the blocks that were deleted before the checkpoint.
+      next_block_offset_.StoreMax(checkpoint.next_block_offset());
+      total_bytes_.Store(checkpoint.total_bytes());
+      total_blocks_.Store(checkpoint.total_blocks());
+      *max_block_id = std::max(*max_block_id, checkpoint.max_block_id());
+      for (auto& record : tail) {
+        RETURN_NOT_OK(ProcessRecord(&record, report,
+                                    live_blocks, live_block_records, dead_blocks,
+                                    &data_file_size, max_block_id));
+      }
+      loaded_from_checkpoint_ = true;
+      records_read = tail.size();
+    } else {
+      checkpoint_status = read_status;
+      RETURN_NOT_OK(open_reader());
+    }
+  }
+  if (!checkpoint_status.ok() && !checkpoint_status.IsNotFound()) {
+    LOG(WARNING) << Substitute("Ignoring checkpoint of container $0: $1",
+                               ToString(), checkpoint_status.ToString());
+    // Don't leave the checkpoint behind: the metadata file will grow past its
+    // offset, and it'd be wrongly used by the next startup or checkpoint.
+    if (!block_manager_->read_only_) {
+      WARN_NOT_OK(DeleteCheckpoint(),
+                  Substitute("Could not delete checkpoint of container $0", ToString()));
+    }
+  }
+
+  if (!loaded_from_checkpoint_) {
+    while (true) {
+      BlockRecordPB record;
+      read_status = pb_reader->ReadNextPB(&record);
+      if (!read_status.ok()) {
+        break;
+      }
+      RETURN_NOT_OK(ProcessRecord(&record, report,
+                                  live_blocks, live_block_records, dead_blocks,
+                                  &data_file_size, max_block_id));
+      records_read++;
     }
-    RETURN_NOT_OK(ProcessRecord(&record, report,
-                                live_blocks, live_block_records, dead_blocks,
-                                &data_file_size, max_block_id));
   }
+  records_since_checkpoint_.Store(records_read);
 
   // NOTE: 'read_status' will never be OK here.
   if (PREDICT_TRUE(read_status.IsEndOfFile())) {
     // We've reached the end of the file without any problems.
+    *metadata_offset = pb_reader->offset();
     return Status::OK();
   }
   if (read_status.IsIncomplete()) {
@@ -778,7 +1088,8 @@ Status LogBlockContainer::ProcessRecords(
     // format that can reliably detect this. Consider this a failed partial
     // write and truncate the metadata file to remove this partial record.
     report->partial_record_check->entries.emplace_back(ToString(),
-                                                       pb_reader.offset());
+                                                       pb_reader->offset());
+    *metadata_offset = pb_reader->offset();
     return Status::OK();
   }
   // If we've made it here, we've found (and are returning) an unrecoverable error.
@@ -884,7 +1195,7 @@ Status LogBlockContainer::DoCloseBlocks(const vector<LogWritableBlock*>& blocks,
   auto sync_blocks = [&]() -> Status {
     if (mode == SYNC) {
       VLOG(3) << "Syncing data file " << data_file_->filename();
-      RETURN_NOT_OK(SyncData());
+      RETURN_NOT_OK(data_syncer_.Sync([this]() { return SyncData(); }));
     }
 
     // Append metadata only after data is synced so that there's
@@ -896,7 +1207,7 @@ Status LogBlockContainer::DoCloseBlocks(const vector<LogWritableBlock*>& blocks,
 
     if (mode == SYNC) {
       VLOG(3) << "Syncing metadata file " << metadata_file_->filename();
-      RETURN_NOT_OK(SyncMetadata());
+      RETURN_NOT_OK(metadata_syncer_.Sync([this]() { return SyncMetadata(); }));
     }
 
     RETURN_NOT_OK(block_manager()->SyncContainer(*this));
@@ -940,7 +1251,10 @@ Status LogBlockContainer::WriteVData(int64_t offset, const vector<Slice>& data)
   DCHECK(!read_only());
   DCHECK_GE(offset, next_block_offset());
 
-  RETURN_NOT_OK_HANDLE_ERROR(data_file_->WriteV(offset, data));
+  {
+    DataDir::ScopedIOTracker io_tracker(data_dir_);
+    RETURN_NOT_OK_HANDLE_ERROR(data_file_->WriteV(offset, data));
+  }
 
   // This append may have changed the container size if:
   // 1. It was large enough that it blew out the preallocated space.
@@ -957,20 +1271,37 @@ Status LogBlockContainer::WriteVData(int64_t offset, const vector<Slice>& data)
 
 Status LogBlockContainer::ReadData(int64_t offset, Slice* result) const {
   DCHECK_GE(offset, 0);
+  DataDir::ScopedIOTracker io_tracker(data_dir_);
   RETURN_NOT_OK_HANDLE_ERROR(data_file_->Read(offset, result));
   return Status::OK();
 }
 Status LogBlockContainer::ReadVData(int64_t offset, vector<Slice>* results) const {
   DCHECK_GE(offset, 0);
+  DataDir::ScopedIOTracker io_tracker(data_dir_);
   RETURN_NOT_OK_HANDLE_ERROR(data_file_->ReadV(offset, results));
   return Status::OK();
 }
 
+void LogBlockContainer::ReadVDataAsync(int64_t offset, vector<Slice>* results,
+                                       const StdStatusCallback& cb) const {
+  DCHECK_GE(offset, 0);
+  // The read is tracked until it completes, possibly on another thread.
+  auto io_tracker = std::make_shared<DataDir::ScopedIOTracker>(data_dir_);
+  data_file_->ReadVAsync(offset, results, [this, cb, io_tracker](const Status& s) mutable {
+    io_tracker.reset();
+    HandleError(s);
+    cb(s);
+  });
+}
+
 Status LogBlockContainer::AppendMetadata(const BlockRecordPB& pb) {
   DCHECK(!read_only());
   // Note: We don't check for sufficient disk space for metadata writes in
   // order to allow for block deletion on full disks.
   RETURN_NOT_OK_HANDLE_ERROR(metadata_file_->Append(pb));
+  if (records_since_checkpoint_.Increment() >= FLAGS_log_container_checkpoint_interval_records) {
+    MaybeScheduleCheckpoint();
+  }
   return Status::OK();
 }
 
@@ -992,6 +1323,7 @@ Status LogBlockContainer::SyncData() {
   DCHECK(!read_only());
   if (FLAGS_enable_data_block_fsync) {
     if (metrics_) metrics_->generic_metrics.total_disk_sync->Increment();
+    DataDir::ScopedIOTracker io_tracker(data_dir_, DataDir::SYNC_IO);
     RETURN_NOT_OK_HANDLE_ERROR(data_file_->Sync());
   }
   return Status::OK();
@@ -1001,6 +1333,7 @@ Status LogBlockContainer::SyncMetadata() {
   DCHECK(!read_only());
   if (FLAGS_enable_data_block_fsync) {
     if (metrics_) metrics_->generic_metrics.total_disk_sync->Increment();
+    DataDir::ScopedIOTracker io_tracker(data_dir_, DataDir::SYNC_IO);
     RETURN_NOT_OK_HANDLE_ERROR(metadata_file_->Sync());
   }
   return Status::OK();
@@ -1019,6 +1352,159 @@ Status LogBlockContainer::ReopenMetadataWriter() {
   return Status::OK();
 }
 
+string LogBlockContainer::CheckpointPath() const {
+  return StrCat(ToString(), LogBlockManager::kContainerCheckpointFileSuffix);
+}
+
+Status LogBlockContainer::ReadCheckpoint(BlockRecordCheckpointPB* checkpoint) const {
+  Status s = pb_util::ReadPBContainerFromPath(block_manager_->env(), CheckpointPath(),
+                                              checkpoint);
+  if (!s.ok() && !s.IsNotFound()) {
+    HandleError(s);
+  }
+  return s;
+}
+
+Status LogBlockContainer::WriteCheckpoint(const BlockRecordCheckpointPB& checkpoint,
+                                          int64_t records_covered) {
+  RETURN_NOT_OK_HANDLE_ERROR(pb_util::WritePBContainerToPath(
+      block_manager_->env(), CheckpointPath(), checkpoint, pb_util::OVERWRITE,
+      FLAGS_enable_data_block_fsync ? pb_util::SYNC : pb_util::NO_SYNC));
+  records_since_checkpoint_.IncrementBy(-records_covered);
+  VLOG(1) << Substitute("Wrote checkpoint of container $0 with $1 live blocks",
+                        ToString(), checkpoint.live_records_size());
+  return Status::OK();
+}
+
+Status LogBlockContainer::BuildCheckpoint(uint64_t metadata_size,
+                                          BlockRecordCheckpointPB* checkpoint) const {
+  const int64_t fs_block_size = instance()->filesystem_block_size_bytes();
+  LogBlockManager::BlockRecordMap live_records;
+  int64_t next_block_offset = 0;
+  int64_t total_bytes = 0;
+  int64_t total_blocks = 0;
+  uint64_t max_block_id = 0;
+
+  unique_ptr<RandomAccessFile> metadata_reader;
+  RETURN_NOT_OK(block_manager_->env()->NewRandomAccessFile(
+      metadata_file_->filename(), &metadata_reader));
+  ReadablePBContainerFile pb_reader(std::move(metadata_reader));
+  RETURN_NOT_OK(pb_reader.Open());
+
+  // Start from the previous checkpoint if it's usable.
+  BlockRecordCheckpointPB prev;
+  if (ReadCheckpoint(&prev).ok() &&
+      prev.metadata_offset() <= metadata_size &&
+      pb_reader.SkipTo(prev.metadata_offset()).ok()) {
+    for (auto& record : *prev.mutable_live_records()) {
+      live_records[BlockId::FromPB(record.block_id())].Swap(&record);
+    }
+    next_block_offset = prev.next_block_offset();
+    total_bytes = prev.total_bytes();
+    total_blocks = prev.total_blocks();
+    max_block_id = prev.max_block_id();
+  }
+
+  // Replay the remaining records the same way that ProcessRecord() does,
+  // skipping the malformed ones. Records past 'metadata_size' may not be
+  // durable yet, and are left for the next checkpoint.
+  Status read_status;
+  uint64_t end_offset = pb_reader.offset();
+  while (end_offset < metadata_size) {
+    BlockRecordPB record;
+    read_status = pb_reader.ReadNextPB(&record);
+    if (!read_status.ok() || pb_reader.offset() > metadata_size) {
+      break;
+    }
+    end_offset = pb_reader.offset();
+    const BlockId block_id(BlockId::FromPB(record.block_id()));
+    switch (record.op_type()) {
+      case CREATE:
+        if (!record.has_offset() || !record.has_length() ||
+            record.offset() < 0 || record.length() < 0 ||
+            ContainsKey(live_records, block_id)) {
+          break;
+        }
+        next_block_offset = std::max<int64_t>(
+            next_block_offset,
+            KUDU_ALIGN_UP(record.offset() + record.length(), fs_block_size));
+        // See LogBlock::fs_aligned_length().
+        total_bytes += record.offset() % fs_block_size == 0 ?
+            KUDU_ALIGN_UP(record.length(), fs_block_size) : record.length();
+        total_blocks++;
+        max_block_id = std::max(max_block_id, block_id.id());
+        live_records[block_id].Swap(&record);
+        break;
+      case DELETE:
+        live_records.erase(block_id);
+        break;
+      default:
+        break;
+    }
+  }
+  // Every record before 'metadata_size' was fully appended, so anything
+  // other than running into the end of the file is an error.
+  if (!read_status.ok() && !read_status.IsEndOfFile()) {
+    return read_status;
+  }
+
+  checkpoint->Clear();
+  checkpoint->set_metadata_offset(end_offset);
+  for (auto& e : live_records) {
+    checkpoint->add_live_records()->Swap(&e.second);
+  }
+  checkpoint->set_next_block_offset(next_block_offset);
+  checkpoint->set_total_bytes(total_bytes);
+  checkpoint->set_total_blocks(total_blocks);
+  checkpoint->set_max_block_id(max_block_id);
+  return Status::OK();
+}
+
+Status LogBlockContainer::DeleteCheckpoint() const {
+  Status s = block_manager_->env()->DeleteFile(CheckpointPath());
+  if (s.IsNotFound()) {
+    return Status::OK();
+  }
+  RETURN_NOT_OK_HANDLE_ERROR(s);
+  return Status::OK();
+}
+
+void LogBlockContainer::MaybeScheduleCheckpoint() {
+  if (FLAGS_log_container_checkpoint_interval_records <= 0 ||
+      block_manager_->read_only_ || read_only() ||
+      !checkpoint_in_progress_.CompareAndSet(false, true)) {
+    return;
+  }
+  ExecClosure(Bind(&LogBlockContainer::DoCheckpoint, Unretained(this)));
+}
+
+void LogBlockContainer::DoCheckpoint() {
+  // Records appended after this point may or may not make it into the new
+  // checkpoint; erring on the side of not counting them is harmless.
+  int64_t records_covered = records_since_checkpoint_.Load();
+
+  // The metadata file remains the source of truth, so make sure that it's at
+  // least as durable as the checkpoint that's about to reflect it. Records
+  // appended during the sync aren't covered by it, so they're left out.
+  uint64_t metadata_size = metadata_file_->offset();
+  Status s;
+  if (FLAGS_enable_data_block_fsync) {
+    s = metadata_file_->Sync();
+  }
+  BlockRecordCheckpointPB checkpoint;
+  if (s.ok()) {
+    s = BuildCheckpoint(metadata_size, &checkpoint);
+  }
+  if (s.ok()) {
+    s = WriteCheckpoint(checkpoint, records_covered);
+  }
+  if (!s.ok()) {
+    HandleError(s);
+    WARN_NOT_OK(s, Substitute("Could not write checkpoint of container $0", ToString()));
+  }
+  checkpoint_in_progress_.Store(false);
+}
+
 Status LogBlockContainer::EnsurePreallocated(int64_t block_start_offset,
                                              size_t next_append_length) {
   DCHECK(!read_only());
@@ -1292,6 +1778,8 @@ Status LogWritableBlock::AppendV(const vector<Slice>& data) {
                                   return sum + curr.size();
                                 });
 
+  ThrottleBackgroundIO(data_size);
+
   // The metadata change is deferred to Close(). We can't do
   // it now because the block's length is still in flux.
   int64_t cur_block_offset = block_offset_ + block_length_;
@@ -1405,8 +1893,18 @@ class LogReadableBlock : public ReadableBlock {
 
   virtual Status ReadV(uint64_t offset, vector<Slice>* results) const OVERRIDE;
 
+  virtual void ReadVAsync(uint64_t offset, vector<Slice>* results,
+                          const StdStatusCallback& cb) const OVERRIDE;
+
   virtual size_t memory_footprint() const OVERRIDE;
 
+  // Validates a read of 'results' at 'offset' within the block, returning
+  // the read's offset within the container and its length.
+  Status PrepareRead(uint64_t offset, const vector<Slice>& results,
+                     uint64_t* read_offset, size_t* read_length) const;
+
+  LogBlockContainer* container() const { return container_; }
+
  private:
   // The owning container. Must outlive this block.
   LogBlockContainer* container_;
@@ -1464,23 +1962,33 @@ Status LogReadableBlock::Read(uint64_t offset, Slice* result) const {
   return ReadV(offset, &results);
 }
 
-Status LogReadableBlock::ReadV(uint64_t offset, vector<Slice>* results) const {
+Status LogReadableBlock::PrepareRead(uint64_t offset, const vector<Slice>& results,
+                                     uint64_t* read_offset, size_t* read_length) const {
   DCHECK(!closed_.Load());
 
-  size_t read_length = accumulate(results->begin(), results->end(), static_cast<size_t>(0),
-                                  [&](int sum, const Slice& curr) {
-                                    return sum + curr.size();
-                                  });
+  *read_length = accumulate(results.begin(), results.end(), static_cast<size_t>(0),
+                            [&](int sum, const Slice& curr) {
+                              return sum + curr.size();
+                            });
 
-  uint64_t read_offset = log_block_->offset() + offset;
-  if (log_block_->length() < offset + read_length) {
+  *read_offset = log_block_->offset() + offset;
+  if (log_block_->length() < offset + *read_length) {
     return Status::IOError("Out-of-bounds read",
                            Substitute("read of [$0-$1) in block [$2-$3)",
-                                      read_offset,
-                                      read_offset + read_length,
+                                      *read_offset,
+                                      *read_offset + *read_length,
                                       log_block_->offset(),
                                       log_block_->offset() + log_block_->length()));
   }
+  return Status::OK();
+}
+
+Status LogReadableBlock::ReadV(uint64_t offset, vector<Slice>* results) const {
+  uint64_t read_offset;
+  size_t read_length;
+  RETURN_NOT_OK(PrepareRead(offset, *results, &read_offset, &read_length));
+
+  ThrottleBackgroundIO(read_length);
 
   MicrosecondsInt64 start_time = GetMonoTimeMicros();
   RETURN_NOT_OK(container_->ReadVData(read_offset, results));
@@ -1498,6 +2006,28 @@ Status LogReadableBlock::ReadV(uint64_t offset, vector<Slice>* results) const {
   return Status::OK();
 }
 
+void LogReadableBlock::ReadVAsync(uint64_t offset, vector<Slice>* results,
+                                  const StdStatusCallback& cb) const {
+  uint64_t read_offset;
+  size_t read_length;
+  Status s = PrepareRead(offset, *results, &read_offset, &read_length);
+  if (!s.ok()) {
+    cb(s);
+    return;
+  }
+
+  ThrottleBackgroundIO(read_length);
+
+  const LogBlockManagerMetrics* metrics = container_->metrics();
+  container_->ReadVDataAsync(read_offset, results,
+                             [metrics, read_length, cb](const Status& read_status) {
+    if (read_status.ok() && metrics) {
+      metrics->generic_metrics.total_bytes_read->IncrementBy(read_length);
+    }
+    cb(read_status);
+  });
+}
+
 size_t LogReadableBlock::memory_footprint() const {
   return kudu_malloc_usable_size(this);
 }
@@ -1510,6 +2040,7 @@ size_t LogReadableBlock::memory_footprint() const {
 
 const char* LogBlockManager::kContainerMetadataFileSuffix = ".metadata";
 const char* LogBlockManager::kContainerDataFileSuffix = ".data";
+const char* LogBlockManager::kContainerCheckpointFileSuffix = ".checkpoint";
 
 // These values were arrived at via experimentation. See commit 4923a74 for
 // more details.
@@ -1527,7 +2058,11 @@ LogBlockManager::LogBlockManager(Env* env,
                                            opts.parent_mem_tracker)),
     dd_manager_(DCHECK_NOTNULL(dd_manager)),
     error_manager_(DCHECK_NOTNULL(error_manager)),
-    file_cache_("lbm", env, GetFileCacheCapacityForBlockManager(env),
+    // With direct reads, each cached container file may hold a second
+    // descriptor for reading.
+    file_cache_("lbm", env,
+                GetFileCacheCapacityForBlockManager(env) /
+                (FLAGS_block_manager_direct_reads ? 2 : 1),
                 opts.metric_entity),
     blocks_by_block_id_(10,
                         BlockMap::hasher(),
@@ -1538,6 +2073,7 @@ LogBlockManager::LogBlockManager(Env* env,
     buggy_el6_kernel_(IsBuggyEl6Kernel(env->GetKernelRelease())),
     next_block_id_(1) {
   blocks_by_block_id_.set_deleted_key(BlockId());
+  file_cache_.set_direct_reads(FLAGS_block_manager_direct_reads);
 
   // HACK: when running in a test environment, we often instantiate many
   // LogBlockManagers in the same process, eg corresponding to different
@@ -1720,6 +2256,116 @@ Status LogBlockManager::OpenBlock(const BlockId& block_id,
   return Status::OK();
 }
 
+Status LogBlockManager::ReadBlocks(vector<BlockReadRequest>* requests) {
+  // Translate each request into a read of its container's data file.
+  struct ContainerRead {
+    LogBlockContainer* container;
+    uint64_t file_offset;
+    Slice* result;
+  };
+  vector<ContainerRead> reads;
+  reads.reserve(requests->size());
+  for (auto& req : *requests) {
+    const auto* block = down_cast<const internal::LogReadableBlock*>(req.block);
+    uint64_t file_offset;
+    size_t length;
+    RETURN_NOT_OK(block->PrepareRead(req.offset, { req.result }, &file_offset, &length));
+    reads.push_back({ block->container(), file_offset, &req.result });
+  }
+  std::sort(reads.begin(), reads.end(), [](const ContainerRead& a, const ContainerRead& b) {
+    return std::make_pair(a.container, a.file_offset) <
+           std::make_pair(b.container, b.file_offset);
+  });
+
+  // Blocks are aligned to the filesystem block size, so even blocks written
+  // back-to-back are separated by a little padding. Reads separated by no
+  // more than 'max_gap' bytes are merged into one, with the gaps read into
+  // (and discarded from) scratch space.
+  struct MergedRead {
+    LogBlockContainer* container;
+    uint64_t start;
+    uint64_t end;
+    size_t bytes_requested;
+    int num_merged;
+    vector<Slice> slices;
+    Status status;
+  };
+  const int64_t max_gap = FLAGS_log_block_manager_read_merge_max_gap_bytes;
+  vector<MergedRead> merged_reads;
+  vector<size_t> gap_sizes;
+  for (size_t i = 0; i < reads.size();) {
+    MergedRead merged = { reads[i].container, reads[i].file_offset,
+                          reads[i].file_offset + reads[i].result->size(),
+                          reads[i].result->size(), 0, { *reads[i].result }, Status::OK() };
+    size_t j = i + 1;
+    for (; j < reads.size() && reads[j].container == merged.container; j++) {
+      // Overlapping reads can't share a single vectored read.
+      if (reads[j].file_offset < merged.end || reads[j].file_offset - merged.end > max_gap) {
+        break;
+      }
+      if (reads[j].file_offset > merged.end) {
+        // Filled in with scratch space once all of the gaps are known.
+        gap_sizes.push_back(reads[j].file_offset - merged.end);
+        merged.slices.emplace_back(nullptr, gap_sizes.back());
+      }
+      merged.slices.push_back(*reads[j].result);
+      merged.end = reads[j].file_offset + reads[j].result->size();
+      merged.bytes_requested += reads[j].result->size();
+    }
+    merged.num_merged = j - i - 1;
+    merged_reads.emplace_back(std::move(merged));
+    i = j;
+  }
+
+  // The merged reads may be in flight at the same time, so each gap gets
+  // scratch space of its own.
+  unique_ptr<uint8_t[]> gap_scratch(
+      new uint8_t[std::accumulate(gap_sizes.begin(), gap_sizes.end(), static_cast<size_t>(0))]);
+  uint8_t* next_gap = gap_scratch.get();
+  for (auto& merged : merged_reads) {
+    for (auto& slice : merged.slices) {
+      if (slice.data() == nullptr) {
+        slice = Slice(next_gap, slice.size());
+        next_gap += slice.size();
+      }
+    }
+  }
+
+  // The merged reads usually hit different containers, and often different
+  // disks, so they're all issued before waiting for any of them. A lone read
+  // is simply done in this thread.
+  MicrosecondsInt64 start_time = GetMonoTimeMicros();
+  if (merged_reads.size() == 1) {
+    MergedRead* merged = &merged_reads.front();
+    ThrottleBackgroundIO(merged->end - merged->start);
+    merged->status = merged->container->ReadVData(merged->start, &merged->slices);
+  } else {
+    CountDownLatch latch(merged_reads.size());
+    for (auto& merged : merged_reads) {
+      ThrottleBackgroundIO(merged.end - merged.start);
+      merged.container->ReadVDataAsync(merged.start, &merged.slices,
+                                       [&merged, &latch](const Status& s) {
+        merged.status = s;
+        latch.CountDown();
+      });
+    }
+    latch.Wait();
+  }
+  int64_t dur = GetMonoTimeMicros() - start_time;
+  TRACE_COUNTER_INCREMENT("lbm_read_time_us", dur);
+  const char* counter = BUCKETED_COUNTER_NAME("lbm_reads", dur);
+  TRACE_COUNTER_INCREMENT(counter, 1);
+
+  for (const auto& merged : merged_reads) {
+    RETURN_NOT_OK(merged.status);
+    if (metrics_) {
+      metrics_->generic_metrics.total_bytes_read->IncrementBy(merged.bytes_requested);
+      metrics_->merged_reads->IncrementBy(merged.num_merged);
+    }
+  }
+  return Status::OK();
+}
+
 Status LogBlockManager::DeleteBlock(const BlockId& block_id) {
   CHECK(!read_only_);
 
@@ -1969,6 +2615,92 @@ void LogBlockManager::RemoveLogBlockUnlocked(const BlockMap::iterator& it) {
   }
 }
 
+struct LogBlockManager::LoadedContainer {
+  // Declared first so that it outlives any LogBlocks referring to it.
+  unique_ptr<LogBlockContainer> container;
+
+  Status status;
+  FsReport report;
+  UntrackedBlockMap live_blocks;
+  BlockRecordMap live_block_records;
+  vector<scoped_refptr<internal::LogBlock>> dead_blocks;
+  uint64_t max_block_id = 0;
+};
+
+void LogBlockManager::LoadContainer(DataDir* dir,
+                                    const string& container_name,
+                                    LoadedContainer* result) {
+  result->report.incomplete_container_check.emplace();
+  result->report.malformed_record_check.emplace();
+  result->report.partial_record_check.emplace();
+
+  Status s = LogBlockContainer::Open(
+      this, dir, &result->report, container_name, &result->container);
+  if (s.IsAborted()) {
+    result->status = s;
+    return;
+  }
+  if (!s.ok()) {
+    result->status = s.CloneAndPrepend(Substitute(
+        "Could not open container $0", container_name));
+    return;
+  }
+  LogBlockContainer* container = result->container.get();
+
+  // Process the records, building a container-local map for live blocks and
+  // a list of dead blocks.
+  //
+  // It's important that we don't try to add these blocks to the global map
+  // incrementally as we see each record, since it's possible that one container
+  // has a "CREATE <b>" while another has a "CREATE <b> ; DELETE <b>" pair.
+  // If we processed those two containers in this order, then upon processing
+  // the second container, we'd think there was a duplicate block. Building
+  // the container-local map first ensures that we discount deleted blocks
+  // before checking for duplicate IDs.
+  //
+  // NOTE: Since KUDU-1538, we allocate sequential block IDs, which makes reuse
+  // exceedingly unlikely. However, we might have old data which still exhibits
+  // the above issue.
+  uint64_t metadata_offset;
+  s = container->ProcessRecords(&result->report,
+                                &result->live_blocks,
+                                &result->live_block_records,
+                                &result->dead_blocks,
+                                &result->max_block_id,
+                                &metadata_offset);
+  if (!s.ok()) {
+    result->status = s.CloneAndPrepend(Substitute(
+        "Could not process records in container $0", container->ToString()));
+    return;
+  }
+
+  // Checkpoint the container if replaying its records took long enough,
+  // unless its metadata is about to be deleted or compacted anyway, or it
+  // has inconsistencies that the repair may change.
+  bool to_delete_or_compact = container->full() &&
+      (container->live_blocks() == 0 ||
+       static_cast<double>(container->live_blocks()) / container->total_blocks() <=
+       FLAGS_log_container_live_metadata_before_compact_ratio);
+  if (!read_only_ &&
+      FLAGS_log_container_checkpoint_interval_records > 0 &&
+      container->records_since_checkpoint() >= FLAGS_log_container_checkpoint_interval_records &&
+      !to_delete_or_compact &&
+      result->report.malformed_record_check->entries.empty() &&
+      result->report.partial_record_check->entries.empty()) {
+    BlockRecordCheckpointPB checkpoint;
+    checkpoint.set_metadata_offset(metadata_offset);
+    for (const auto& e : result->live_block_records) {
+      *checkpoint.add_live_records() = e.second;
+    }
+    checkpoint.set_next_block_offset(container->next_block_offset());
+    checkpoint.set_total_bytes(container->total_bytes());
+    checkpoint.set_total_blocks(container->total_blocks());
+    checkpoint.set_max_block_id(result->max_block_id);
+    WARN_NOT_OK(container->WriteCheckpoint(checkpoint, container->records_since_checkpoint()),
+                Substitute("Could not write checkpoint of container $0", container->ToString()));
+  }
+}
+
 void LogBlockManager::OpenDataDir(DataDir* dir,
                                   FsReport* report,
                                   Status* result_status) {
@@ -1997,8 +2729,9 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
   // files will be compacted during repair.
   unordered_map<string, vector<BlockRecordPB>> low_live_block_containers;
 
-  // Find all containers and open them.
+  // Find all containers.
   unordered_set<string> containers_seen;
+  vector<string> container_names;
   vector<string> children;
   Status s = env_->GetChildren(dir->dir(), &children);
   if (!s.ok()) {
@@ -2007,7 +2740,6 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
         "Could not list children of $0", dir->dir()));
     return;
   }
-  MonoTime last_opened_container_log_time = MonoTime::Now();
   for (const string& child : children) {
     string container_name;
     if (!TryStripSuffixString(
@@ -2016,51 +2748,58 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
             child, LogBlockManager::kContainerMetadataFileSuffix, &container_name)) {
       continue;
     }
-    if (!InsertIfNotPresent(&containers_seen, container_name)) {
-      continue;
+    if (InsertIfNotPresent(&containers_seen, container_name)) {
+      container_names.emplace_back(std::move(container_name));
     }
+  }
 
-    unique_ptr<LogBlockContainer> container;
-    s = LogBlockContainer::Open(
-        this, dir, &local_report, container_name, &container);
-    if (s.IsAborted()) {
-      // Skip the container. Open() added a record of it to 'local_report' for us.
-      continue;
+  // Reading container metadata dominates the time it takes to open a data
+  // directory, so containers are read in parallel, a batch at a time. Each is
+  // then merged into the block manager one at a time, in order.
+  //
+  // If the pool can't be created, containers are read on this thread.
+  gscoped_ptr<ThreadPool> pool;
+  if (FLAGS_log_block_manager_open_threads_per_data_dir > 1) {
+    WARN_NOT_OK(ThreadPoolBuilder("lbm-open")
+                .set_max_threads(FLAGS_log_block_manager_open_threads_per_data_dir)
+                .Build(&pool),
+                "Could not create thread pool for opening containers");
+  }
+  static const int kContainerLoadBatchSize = 256;
+  vector<LoadedContainer> loaded;
+  MonoTime last_opened_container_log_time = MonoTime::Now();
+  for (int i = 0; i < container_names.size(); i++) {
+    if (i % kContainerLoadBatchSize == 0) {
+      int batch_size = std::min<int>(kContainerLoadBatchSize, container_names.size() - i);
+      loaded.clear();
+      loaded.resize(batch_size);
+      for (int j = 0; j < batch_size; j++) {
+        const string* name = &container_names[i + j];
+        LoadedContainer* lc = &loaded[j];
+        auto task = [this, dir, name, lc]() { LoadContainer(dir, *name, lc); };
+        if (!pool || !pool->SubmitFunc(task).ok()) {
+          task();
+        }
+      }
+      if (pool) {
+        pool->Wait();
+      }
     }
-    if (!s.ok()) {
-      *result_status = s.CloneAndPrepend(Substitute(
-          "Could not open container $0", container_name));
-      return;
+    LoadedContainer& lc = loaded[i % kContainerLoadBatchSize];
+    local_report.MergeFrom(lc.report);
+    if (lc.status.IsAborted()) {
+      // Skip the container. Open() added a record of it to the report for us.
+      continue;
     }
-
-    // Process the records, building a container-local map for live blocks and
-    // a list of dead blocks.
-    //
-    // It's important that we don't try to add these blocks to the global map
-    // incrementally as we see each record, since it's possible that one container
-    // has a "CREATE <b>" while another has a "CREATE <b> ; DELETE <b>" pair.
-    // If we processed those two containers in this order, then upon processing
-    // the second container, we'd think there was a duplicate block. Building
-    // the container-local map first ensures that we discount deleted blocks
-    // before checking for duplicate IDs.
-    //
-    // NOTE: Since KUDU-1538, we allocate sequential block IDs, which makes reuse
-    // exceedingly unlikely. However, we might have old data which still exhibits
-    // the above issue.
-    UntrackedBlockMap live_blocks;
-    BlockRecordMap live_block_records;
-    vector<scoped_refptr<internal::LogBlock>> dead_blocks;
-    uint64_t max_block_id = 0;
-    s = container->ProcessRecords(&local_report,
-                                  &live_blocks,
-                                  &live_block_records,
-                                  &dead_blocks,
-                                  &max_block_id);
-    if (!s.ok()) {
-      *result_status = s.CloneAndPrepend(Substitute(
-          "Could not process records in container $0", container->ToString()));
+    if (!lc.status.ok()) {
+      *result_status = lc.status;
       return;
     }
+    unique_ptr<LogBlockContainer>& container = lc.container;
+    UntrackedBlockMap& live_blocks = lc.live_blocks;
+    BlockRecordMap& live_block_records = lc.live_block_records;
+    const vector<scoped_refptr<internal::LogBlock>>& dead_blocks = lc.dead_blocks;
+    const uint64_t max_block_id = lc.max_block_id;
 
     // With deleted blocks out of the way, check for misaligned blocks.
     //
@@ -2172,6 +2911,13 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
         if (container->live_blocks()) {
           need_repunching.insert(need_repunching.end(),
                                  dead_blocks.begin(), dead_blocks.end());
+          // Blocks deleted before the container's checkpoint are unknown, so
+          // some of the excess space may not be reclaimed. Drop the checkpoint
+          // so that the next startup replays (and repunches) everything.
+          if (container->loaded_from_checkpoint()) {
+            WARN_NOT_OK(container->DeleteCheckpoint(),
+                        "Could not delete container checkpoint");
+          }
         }
       }
 
@@ -2331,6 +3077,12 @@ Status LogBlockManager::Repair(
                 "Could not delete dead container data file " + data_file_name);
     WARN_NOT_OK_LBM_DISK_FAILURE(file_cache_.DeleteFile(metadata_file_name),
                 "Could not delete dead container metadata file " + metadata_file_name);
+    string checkpoint_file_name = StrCat(d, kContainerCheckpointFileSuffix);
+    s = env_->DeleteFile(checkpoint_file_name);
+    if (!s.IsNotFound()) {
+      WARN_NOT_OK_LBM_DISK_FAILURE(s,
+          "Could not delete dead container checkpoint file " + checkpoint_file_name);
+    }
   }
   if (!dead_containers.empty()) {
     WARN_NOT_OK_LBM_DISK_FAILURE(env_->SyncDir(dir->dir()), "Could not sync data directory");
@@ -2520,6 +3272,16 @@ Status LogBlockManager::RewriteMetadataFile(const LogBlockContainer& container,
   uint64_t new_metadata_size;
   RETURN_NOT_OK_LBM_DISK_FAILURE_PREPEND(env_->GetFileSize(tmp_file_name, &new_metadata_size),
                                          "could not get file size of temporary metadata file");
+
+  // The container's checkpoint refers to offsets in the old metadata file, so
+  // it must be gone before the new file takes its place.
+  const string checkpoint_file_name = StrCat(container.ToString(), kContainerCheckpointFileSuffix);
+  if (env_->FileExists(checkpoint_file_name)) {
+    RETURN_NOT_OK_LBM_DISK_FAILURE_PREPEND(env_->DeleteFile(checkpoint_file_name),
+                                           "could not delete checkpoint file");
+    RETURN_NOT_OK_LBM_DISK_FAILURE_PREPEND(env_->SyncDir(dir),
+                                           "could not sync data directory");
+  }
   RETURN_NOT_OK_LBM_DISK_FAILURE_PREPEND(env_->RenameFile(tmp_file_name, metadata_file_name),
                                          "could not rename temporary metadata file");
   // Evict the old path from the file cache, so that when we re-open the new
@@ -104,6 +104,11 @@ struct LogBlockManagerMetrics;
 // made available in memory if _all_ on-disk operations (including any
 // necessary synchronization calls) are successful.
 //
+// Blocks written by unrelated writers (e.g. different tablets) frequently
+// share a container. Concurrent syncs of the same container file are grouped
+// so that one fsync covers every writer waiting on it, which keeps many small
+// concurrent flushes from turning into an fsync per flush.
+//
 // When a new block is created, a container is selected from the data
 // directory group appropriate for the block, as indicated by hints in
 // provided CreateBlockOptions (i.e. blocks for diskrowsets should be placed
@@ -161,6 +166,7 @@ class LogBlockManager : public BlockManager {
  public:
   static const char* kContainerMetadataFileSuffix;
   static const char* kContainerDataFileSuffix;
+  static const char* kContainerCheckpointFileSuffix;
 
   // Note: all objects passed as pointers should remain alive for the lifetime
   // of the block manager.
@@ -178,6 +184,8 @@ class LogBlockManager : public BlockManager {
   Status OpenBlock(const BlockId& block_id,
                    std::unique_ptr<ReadableBlock>* block) override;
 
+  Status ReadBlocks(std::vector<BlockReadRequest>* requests) override;
+
   Status DeleteBlock(const BlockId& block_id) override;
 
   Status CloseBlocks(const std::vector<std::unique_ptr<WritableBlock>>& blocks) override;
@@ -190,10 +198,12 @@ class LogBlockManager : public BlockManager {
   FRIEND_TEST(LogBlockManagerTest, TestAbortBlock);
   FRIEND_TEST(LogBlockManagerTest, TestCloseFinalizedBlock);
   FRIEND_TEST(LogBlockManagerTest, TestFinalizeBlock);
+  FRIEND_TEST(LogBlockManagerTest, TestGroupSync);
   FRIEND_TEST(LogBlockManagerTest, TestLIFOContainerSelection);
   FRIEND_TEST(LogBlockManagerTest, TestLookupBlockLimit);
   FRIEND_TEST(LogBlockManagerTest, TestMetadataTruncation);
   FRIEND_TEST(LogBlockManagerTest, TestParseKernelRelease);
+  FRIEND_TEST(LogBlockManagerTest, TestReadBlocksMergesNearbyReads);
   FRIEND_TEST(LogBlockManagerTest, TestReuseBlockIds);
 
   friend class internal::LogBlockContainer;
@@ -327,6 +337,17 @@ class LogBlockManager : public BlockManager {
                    FsReport* report,
                    Status* result_status);
 
+  // The result of reading a single container's metadata at startup.
+  struct LoadedContainer;
+
+  // Opens the container named 'container_name' in 'dir' and reads its
+  // metadata records into 'result', writing a new checkpoint for it if
+  // warranted. The block manager's in-memory state isn't modified, so this
+  // may run concurrently for different containers.
+  void LoadContainer(DataDir* dir,
+                     const std::string& container_name,
+                     LoadedContainer* result);
+
   // Perform basic initialization.
   Status Init();
 
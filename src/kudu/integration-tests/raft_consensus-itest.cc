@@ -96,9 +96,11 @@ DEFINE_int64(client_num_batches_per_thread, 5,
              "In how many batches to group the rows, for each client");
 DECLARE_int32(consensus_rpc_timeout_ms);
 
+METRIC_DECLARE_entity(server);
 METRIC_DECLARE_entity(tablet);
 METRIC_DECLARE_counter(transaction_memory_pressure_rejections);
 METRIC_DECLARE_gauge_int64(raft_term);
+METRIC_DECLARE_histogram(handler_latency_kudu_consensus_ConsensusService_MultiRaftUpdateConsensus);
 
 using std::string;
 using std::unordered_map;
@@ -109,9 +111,12 @@ using strings::Substitute;
 namespace kudu {
 namespace tserver {
 
+using client::KuduClient;
 using client::KuduInsert;
+using client::KuduScanner;
 using client::KuduSession;
 using client::KuduTable;
+using client::KuduTabletServer;
 using client::sp::shared_ptr;
 using consensus::ConsensusRequestPB;
 using consensus::ConsensusResponsePB;
@@ -419,6 +424,15 @@ class RaftConsensusITest : public TabletServerIntegrationTestBase {
   // Retrieve the current term of the first tablet on this tablet server.
   Status GetTermMetricValue(ExternalTabletServer* ts, int64_t* term);
 
+  // Retrieve the number of MultiRaftUpdateConsensus RPCs this tablet server
+  // has handled.
+  Status GetMultiRaftUpdateConsensusCalls(ExternalTabletServer* ts, int64_t* calls);
+
+  // Write 'num_rows' rows, with keys from 'first_key' on, through the leader,
+  // checking that the followers learn of each one being committed, and that
+  // the leader remains the same throughout.
+  void WriteRowsAndCheckLeaderStable(int first_key, int num_rows);
+
   shared_ptr<KuduTable> table_;
   std::vector<scoped_refptr<kudu::Thread> > threads_;
   CountDownLatch inserters_;
@@ -429,6 +443,52 @@ Status RaftConsensusITest::GetTermMetricValue(ExternalTabletServer* ts,
   return ts->GetInt64Metric(&METRIC_ENTITY_tablet, nullptr, &METRIC_raft_term, "value", term);
 }
 
+Status RaftConsensusITest::GetMultiRaftUpdateConsensusCalls(ExternalTabletServer* ts,
+                                                            int64_t* calls) {
+  return ts->GetInt64Metric(
+      &METRIC_ENTITY_server, "kudu.tabletserver",
+      &METRIC_handler_latency_kudu_consensus_ConsensusService_MultiRaftUpdateConsensus,
+      "total_count", calls);
+}
+
+void RaftConsensusITest::WriteRowsAndCheckLeaderStable(int first_key, int num_rows) {
+  const MonoDelta kTimeout = MonoDelta::FromSeconds(10);
+  TServerDetails* leader = nullptr;
+  ASSERT_OK(GetLeaderReplicaWithRetries(tablet_id_, &leader));
+  int64_t orig_term;
+  ASSERT_OK(GetTermMetricValue(cluster_->tablet_server_by_uuid(leader->uuid()), &orig_term));
+  vector<TServerDetails*> followers;
+  GetOnlyLiveFollowerReplicas(tablet_id_, &followers);
+  ASSERT_FALSE(followers.empty());
+
+  for (int i = 0; i < num_rows; i++) {
+    ASSERT_OK(WriteSimpleTestRow(leader, tablet_id_, RowOperationsPB::INSERT,
+                                 first_key + i, kTestRowIntVal, "foo", kTimeout));
+    // Followers learn that the write was committed from the next request,
+    // which carries no operations and so goes out in a batch if batching is
+    // enabled.
+    OpId committed;
+    ASSERT_OK(itest::GetLastOpIdForReplica(tablet_id_, leader, consensus::COMMITTED_OPID,
+                                           kTimeout, &committed));
+    for (TServerDetails* follower : followers) {
+      ASSERT_OK(itest::WaitUntilCommittedOpIdIndexIs(committed.index(), follower,
+                                                     tablet_id_, kTimeout));
+    }
+  }
+
+  // Let the tablet idle for a few heartbeat periods: heartbeats alone must
+  // keep the leader in place.
+  SleepFor(MonoDelta::FromSeconds(3));
+  TServerDetails* new_leader = nullptr;
+  ASSERT_OK(GetLeaderReplicaWithRetries(tablet_id_, &new_leader));
+  ASSERT_EQ(leader->uuid(), new_leader->uuid());
+  for (const auto& e : tablet_servers_) {
+    int64_t term;
+    ASSERT_OK(GetTermMetricValue(cluster_->tablet_server_by_uuid(e.first), &term));
+    ASSERT_EQ(orig_term, term) << "server " << e.first;
+  }
+}
+
 void RaftConsensusITest::AddFlagsForLogRolls(vector<string>* extra_tserver_flags) {
   // We configure a small log segment size so that we roll frequently,
   // configure a small cache size so that we evict data from the cache, and
@@ -488,6 +548,58 @@ TEST_F(RaftConsensusITest, TestInsertAndMutateThroughConsensus) {
   ASSERT_ALL_REPLICAS_AGREE(FLAGS_client_inserts_per_thread * num_iters);
 }
 
+// Test that a leader whose followers don't accept operations in a sidecar
+// falls back to sending them in its requests.
+TEST_F(RaftConsensusITest, TestOpsSidecarFallback) {
+  NO_FATALS(BuildAndStart({ "--consensus_support_ops_sidecar=false" }));
+
+  InsertTestRowsRemoteThread(0,
+                             FLAGS_client_inserts_per_thread,
+                             FLAGS_client_num_batches_per_thread,
+                             vector<CountDownLatch*>());
+  ASSERT_ALL_REPLICAS_AGREE(FLAGS_client_inserts_per_thread);
+}
+
+// Test that with heartbeats batched, leaders stay stable, and followers learn
+// of the commit index through the batches.
+TEST_F(RaftConsensusITest, TestBatchedHeartbeats) {
+  NO_FATALS(BuildAndStart({ "--raft_heartbeat_batch_window_ms=20" }));
+  NO_FATALS(WriteRowsAndCheckLeaderStable(0, 5));
+
+  // The followers received batches.
+  TServerDetails* leader = nullptr;
+  ASSERT_OK(GetLeaderReplicaWithRetries(tablet_id_, &leader));
+  for (const auto& e : tablet_servers_) {
+    if (e.first == leader->uuid()) continue;
+    int64_t calls;
+    ASSERT_OK(GetMultiRaftUpdateConsensusCalls(cluster_->tablet_server_by_uuid(e.first),
+                                               &calls));
+    ASSERT_GT(calls, 0) << "server " << e.first;
+  }
+}
+
+// Test that a leader whose followers don't support batched heartbeats falls
+// back to sending them individually.
+TEST_F(RaftConsensusITest, TestBatchedHeartbeatsFallback) {
+  NO_FATALS(BuildAndStart({ "--raft_heartbeat_batch_window_ms=20",
+                            "--consensus_support_multi_raft_update=false" }));
+  NO_FATALS(WriteRowsAndCheckLeaderStable(0, 5));
+
+  // Once a batch has been rejected, no more are sent.
+  unordered_map<string, int64_t> calls_before;
+  for (const auto& e : tablet_servers_) {
+    ASSERT_OK(GetMultiRaftUpdateConsensusCalls(cluster_->tablet_server_by_uuid(e.first),
+                                               &calls_before[e.first]));
+  }
+  NO_FATALS(WriteRowsAndCheckLeaderStable(5, 1));
+  for (const auto& e : tablet_servers_) {
+    int64_t calls;
+    ASSERT_OK(GetMultiRaftUpdateConsensusCalls(cluster_->tablet_server_by_uuid(e.first),
+                                               &calls));
+    ASSERT_EQ(calls_before[e.first], calls) << "server " << e.first;
+  }
+}
+
 TEST_F(RaftConsensusITest, TestFailedTransaction) {
   NO_FATALS(BuildAndStart());
 
@@ -603,6 +715,126 @@ TEST_F(RaftConsensusITest, TestInsertOnNonLeader) {
   ASSERT_ALL_REPLICAS_AGREE(0);
 }
 
+// Test that a follower serves a bounded-staleness snapshot scan by itself,
+// at its safe time, when that is within the bound.
+TEST_F(RaftConsensusITest, TestBoundedStalenessScanOnFollower) {
+  NO_FATALS(BuildAndStart());
+
+  InsertTestRowsRemoteThread(0,
+                             FLAGS_client_inserts_per_thread,
+                             FLAGS_client_num_batches_per_thread,
+                             vector<CountDownLatch*>());
+  ASSERT_ALL_REPLICAS_AGREE(FLAGS_client_inserts_per_thread);
+
+  vector<TServerDetails*> followers;
+  GetOnlyLiveFollowerReplicas(tablet_id_, &followers);
+  ASSERT_FALSE(followers.empty());
+  TServerDetails* follower = followers[0];
+
+  ScanRequestPB req;
+  ScanResponsePB resp;
+  RpcController rpc;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(tablet_id_);
+  scan->set_read_mode(READ_AT_SNAPSHOT);
+  scan->set_max_staleness_us(60 * 1000 * 1000);
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+  req.set_batch_size_bytes(0);
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(follower->tserver_proxy->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_TRUE(resp.has_snap_timestamp());
+  }
+  vector<string> results;
+  NO_FATALS(DrainScannerToStrings(resp.scanner_id(), schema_, &results,
+                                  follower->tserver_proxy.get()));
+  ASSERT_EQ(FLAGS_client_inserts_per_thread, results.size());
+}
+
+// Test that a replica too stale for a bounded-staleness scan turns it down,
+// and that the client then retries the scan at another replica.
+TEST_F(RaftConsensusITest, TestBoundedStalenessScanOnStaleReplica) {
+  const int kMaxStalenessMs = 3000;
+  const vector<string> kTsFlags = {
+    "--enable_leader_failure_detection=false"
+  };
+  const vector<string> kMasterFlags = {
+    "--catalog_manager_wait_for_new_tablets_to_elect_leader=false"
+  };
+  NO_FATALS(BuildAndStart(kTsFlags, kMasterFlags));
+
+  // Find the replica that scans with FIRST_REPLICA selection go to, and make
+  // it the stale one.
+  shared_ptr<KuduTable> table;
+  ASSERT_OK(client_->OpenTable(kTableId, &table));
+  string stale_uuid;
+  {
+    KuduScanner scanner(table.get());
+    ASSERT_OK(scanner.SetSelection(KuduClient::FIRST_REPLICA));
+    ASSERT_OK(scanner.Open());
+    KuduTabletServer* ts;
+    ASSERT_OK(scanner.GetCurrentServer(&ts));
+    std::unique_ptr<KuduTabletServer> ts_holder(ts);
+    stale_uuid = ts->uuid();
+  }
+
+  // Elect another replica and write a row through it.
+  TServerDetails* leader = nullptr;
+  for (const auto& e : tablet_servers_) {
+    if (e.first != stale_uuid) {
+      leader = e.second;
+      break;
+    }
+  }
+  ASSERT_NE(nullptr, leader);
+  ASSERT_OK(StartElection(leader, tablet_id_, MonoDelta::FromSeconds(10)));
+  ASSERT_OK(WaitUntilLeader(leader, tablet_id_, MonoDelta::FromSeconds(10)));
+  ASSERT_OK(WriteSimpleTestRow(leader, tablet_id_, RowOperationsPB::INSERT,
+                               kTestRowKey, kTestRowIntVal, "foo", MonoDelta::FromSeconds(10)));
+  ASSERT_OK(WaitForServersToAgree(MonoDelta::FromSeconds(10), tablet_servers_, tablet_id_, 2));
+
+  // Cut the replica off from the leader so that its safe time falls behind.
+  ASSERT_OK(cluster_->SetFlag(cluster_->tablet_server_by_uuid(stale_uuid),
+                              "follower_reject_update_consensus_requests", "true"));
+  SleepFor(MonoDelta::FromMilliseconds(2 * kMaxStalenessMs));
+
+  // Asked directly, the replica reports that it's too stale.
+  {
+    TServerDetails* stale = FindOrDie(tablet_servers_, stale_uuid);
+    ScanRequestPB req;
+    ScanResponsePB resp;
+    RpcController rpc;
+    NewScanRequestPB* scan = req.mutable_new_scan_request();
+    scan->set_tablet_id(tablet_id_);
+    scan->set_read_mode(READ_AT_SNAPSHOT);
+    scan->set_max_staleness_us(kMaxStalenessMs * 1000);
+    ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+    req.set_batch_size_bytes(0);
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(stale->tserver_proxy->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_EQ(TabletServerErrorPB::REPLICA_TOO_STALE, resp.error().code());
+  }
+
+  // The client is sent away by the stale replica and scans another one.
+  {
+    KuduScanner scanner(table.get());
+    ASSERT_OK(scanner.SetReadMode(KuduScanner::READ_AT_SNAPSHOT));
+    ASSERT_OK(scanner.SetSelection(KuduClient::FIRST_REPLICA));
+    ASSERT_OK(scanner.SetMaxStalenessMillis(kMaxStalenessMs));
+    vector<string> rows;
+    ASSERT_OK(ScanToStrings(&scanner, &rows));
+    ASSERT_EQ(1, rows.size());
+    KuduTabletServer* ts;
+    ASSERT_OK(scanner.GetCurrentServer(&ts));
+    std::unique_ptr<KuduTabletServer> ts_holder(ts);
+    ASSERT_NE(stale_uuid, ts->uuid());
+  }
+}
+
 TEST_F(RaftConsensusITest, TestRunLeaderElection) {
   // Reset consensus rpc timeout to the default value or the election might fail often.
   FLAGS_consensus_rpc_timeout_ms = 1000;
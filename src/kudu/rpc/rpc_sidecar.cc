@@ -27,6 +27,7 @@
 #include "kudu/util/faststring.h"
 #include "kudu/util/status.h"
 
+using std::shared_ptr;
 using std::unique_ptr;
 
 namespace kudu {
@@ -53,10 +54,26 @@ class FaststringSidecar : public RpcSidecar {
   const unique_ptr<faststring> data_;
 };
 
+// Sidecar that shares ownership of its data, e.g. with the sidecars of other calls
+// sending the same data.
+class SharedFaststringSidecar : public RpcSidecar {
+ public:
+  explicit SharedFaststringSidecar(shared_ptr<const faststring> data)
+      : data_(std::move(data)) { }
+  Slice AsSlice() const override { return *data_; }
+
+ private:
+  const shared_ptr<const faststring> data_;
+};
+
 unique_ptr<RpcSidecar> RpcSidecar::FromFaststring(unique_ptr<faststring> data) {
   return unique_ptr<RpcSidecar>(new FaststringSidecar(std::move(data)));
 }
 
+unique_ptr<RpcSidecar> RpcSidecar::FromSharedFaststring(shared_ptr<const faststring> data) {
+  return unique_ptr<RpcSidecar>(new SharedFaststringSidecar(std::move(data)));
+}
+
 unique_ptr<RpcSidecar> RpcSidecar::FromSlice(Slice slice) {
   return unique_ptr<RpcSidecar>(new SliceSidecar(slice));
 }
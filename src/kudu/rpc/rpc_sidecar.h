@@ -52,6 +52,8 @@ namespace rpc {
 class RpcSidecar {
  public:
   static std::unique_ptr<RpcSidecar> FromFaststring(std::unique_ptr<faststring> data);
+  static std::unique_ptr<RpcSidecar> FromSharedFaststring(
+      std::shared_ptr<const faststring> data);
   static std::unique_ptr<RpcSidecar> FromSlice(Slice slice);
 
   // Utility method to parse a series of sidecar slices into 'sidecars' from 'buffer' and
@@ -41,6 +41,7 @@
 #include "kudu/common/schema.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/integral_types.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/stringpiece.h"
@@ -269,6 +270,42 @@ TEST_F(TestCFileSet, TestIteratePartialSchema) {
   }
 }
 
+// Test that creating an iterator initializes the readers of the projected key
+// and predicate columns, which were lazily opened, by reading their metadata
+// in a batch, and leaves the other readers to be opened when first read.
+TEST_F(TestCFileSet, TestIteratorInitsKeyAndPredicateReaders) {
+  const int kNumRows = 100;
+  WriteTestRowSet(kNumRows);
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), &fileset));
+  auto reader_for_col = [&](int col_idx) {
+    return FindOrDie(fileset->readers_by_col_id_, schema_.column_id(col_idx)).get();
+  };
+  ASSERT_FALSE(reader_for_col(1)->initted());
+  ASSERT_FALSE(reader_for_col(2)->initted());
+
+  Schema new_schema;
+  ASSERT_OK(schema_.CreateProjectionByNames({ "c1", "c2" }, &new_schema));
+  shared_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&new_schema));
+  gscoped_ptr<RowwiseIterator> iter(new MaterializingIterator(cfile_iter));
+  ScanSpec spec;
+  int32_t lower = 0;
+  spec.AddPredicate(ColumnPredicate::Range(schema_.column(1), &lower, nullptr));
+  ASSERT_OK(iter->Init(&spec));
+  ASSERT_TRUE(reader_for_col(1)->initted());
+  ASSERT_FALSE(reader_for_col(2)->initted());
+
+  vector<string> results;
+  ASSERT_OK(IterateToStringList(iter.get(), &results));
+  ASSERT_TRUE(reader_for_col(2)->initted());
+  ASSERT_EQ(kNumRows, results.size());
+  for (int i = 0; i < kNumRows; i++) {
+    ASSERT_EQ(StringPrintf("(int32 c1=%d, int32 c2=%d)", i * 10, i * 100),
+              results[i]);
+  }
+}
+
 // Add a range predicate on the key column and ensure that only the relevant small number of rows
 // are read off disk.
 TEST_F(TestCFileSet, TestRangeScan) {
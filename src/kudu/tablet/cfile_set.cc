@@ -235,6 +235,11 @@ uint64_t CFileSet::OnDiskDataSize() const {
   return ret;
 }
 
+uint64_t CFileSet::OnDiskColumnDataSize(const ColumnId& col_id) const {
+  const auto* reader = FindOrNull(readers_by_col_id_, col_id);
+  return reader ? (*reader)->file_size() : 0;
+}
+
 Status CFileSet::FindRow(const RowSetKeyProbe &probe,
                          boost::optional<rowid_t>* idx,
                          ProbeStats* stats) const {
@@ -288,6 +293,40 @@ Status CFileSet::CheckRowPresent(const RowSetKeyProbe &probe, bool *present,
   return Status::OK();
 }
 
+Status CFileSet::ReadCell(rowid_t idx,
+                          const ColumnSchema& col_schema,
+                          ColumnId col_id,
+                          ColumnBlock* dst) const {
+  DCHECK_EQ(1, dst->nrows());
+  unique_ptr<ColumnIterator> iter;
+  if (has_data_for_column_id(col_id)) {
+    CFileIterator* cfile_iter;
+    RETURN_NOT_OK(NewColumnIterator(col_id, CFileReader::CACHE_BLOCK, &cfile_iter));
+    iter.reset(cfile_iter);
+  } else {
+    // See Iterator::CreateColumnIterators().
+    if (PREDICT_FALSE(!col_schema.is_nullable() && !col_schema.has_read_default())) {
+      return Status::Corruption(Substitute("column $0 has no data in rowset $1",
+                                           col_schema.ToString(), ToString()));
+    }
+    iter.reset(new DefaultColumnValueIterator(col_schema.type_info(),
+                                              col_schema.read_default_value()));
+  }
+
+  RETURN_NOT_OK(iter->SeekToOrdinal(idx));
+  size_t n = 1;
+  RETURN_NOT_OK(iter->PrepareBatch(&n));
+  if (PREDICT_FALSE(n != 1)) {
+    return Status::Corruption(Substitute("column $0 has no row $1 in rowset $2",
+                                         col_schema.ToString(), idx, ToString()));
+  }
+  SelectionVector sel(1);
+  sel.SetAllTrue();
+  ColumnMaterializationContext ctx(0, nullptr, dst, &sel);
+  RETURN_NOT_OK(iter->Scan(&ctx));
+  return iter->FinishBatch();
+}
+
 Status CFileSet::NewKeyIterator(CFileIterator **key_iter) const {
   return key_index_reader()->NewIterator(key_iter, CFileReader::CACHE_BLOCK);
 }
@@ -308,6 +347,34 @@ Status CFileSet::Iterator::CreateColumnIterators(const ScanSpec* spec) {
     cache_blocks = CFileReader::DONT_CACHE_BLOCK;
   }
 
+  // Initialize the readers of the projected key and predicate columns
+  // together, so that their headers and footers are read in batches rather
+  // than as each column is first read. These columns are read by nearly every
+  // scan. The others may never be materialized, e.g. if no row passes the
+  // predicates, so their readers are left to be opened lazily when first
+  // seeked (see CFileIterator::PrepareForNewSeek()).
+  const Schema& tablet_schema = base_data_->tablet_schema();
+  vector<CFileReader*> readers;
+  for (int proj_col_idx = 0;
+       proj_col_idx < projection_->num_columns();
+       proj_col_idx++) {
+    ColumnId col_id = projection_->column_id(proj_col_idx);
+    int tablet_col_idx = tablet_schema.find_column_by_id(col_id);
+    bool is_key = tablet_col_idx != Schema::kColumnNotFound &&
+        tablet_schema.is_key_column(tablet_col_idx);
+    bool has_predicate = spec &&
+        ContainsKey(spec->predicates(), projection_->column(proj_col_idx).name());
+    if (!is_key && !has_predicate) {
+      continue;
+    }
+    const unique_ptr<CFileReader>* reader = FindOrNull(base_data_->readers_by_col_id_, col_id);
+    if (reader) {
+      readers.push_back(reader->get());
+    }
+  }
+  RETURN_NOT_OK(CFileReader::InitBatch(
+      base_data_->rowset_metadata_->fs_manager()->block_manager(), readers));
+
   for (int proj_col_idx = 0;
        proj_col_idx < projection_->num_columns();
        proj_col_idx++) {
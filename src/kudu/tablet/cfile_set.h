@@ -47,6 +47,7 @@ class optional;
 
 namespace kudu {
 
+class ColumnBlock;
 class ColumnMaterializationContext;
 class MemTracker;
 class ScanSpec;
@@ -91,6 +92,10 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
   // The size on-disk of this cfile set's data, in bytes.
   uint64_t OnDiskDataSize() const;
 
+  // The size on-disk of the data for the given column, in bytes. Returns 0 if
+  // there is no data for the column.
+  uint64_t OnDiskColumnDataSize(const ColumnId& col_id) const;
+
   // Determine the index of the given row key.
   // Sets *idx to boost::none if the row is not found.
   Status FindRow(const RowSetKeyProbe& probe,
@@ -106,6 +111,13 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
   Status CheckRowPresent(const RowSetKeyProbe &probe, bool *present,
                          rowid_t *rowid, ProbeStats* stats) const;
 
+  // Read the base value of column 'col_id', described by 'col_schema', in
+  // the row at index 'idx' into the single cell of 'dst'.
+  Status ReadCell(rowid_t idx,
+                  const ColumnSchema& col_schema,
+                  ColumnId col_id,
+                  ColumnBlock* dst) const;
+
   // Return true if there exists a CFile for the given column ID.
   bool has_data_for_column_id(ColumnId col_id) const {
     return ContainsKey(readers_by_col_id_, col_id);
@@ -116,6 +128,7 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
  private:
   friend class Iterator;
   friend class CFileSetIteratorProjector;
+  FRIEND_TEST(TestCFileSet, TestIteratorInitsKeyAndPredicateReaders);
 
   DISALLOW_COPY_AND_ASSIGN(CFileSet);
 
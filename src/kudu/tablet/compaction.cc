@@ -55,6 +55,7 @@
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/maintenance_manager.h"
 #include "kudu/util/memory/arena.h"
 
 using kudu::clock::HybridClock;
@@ -1085,6 +1086,11 @@ Status FlushCompactionInput(CompactionInput* input,
   RowBlock block(out->schema(), kCompactionOutputBlockNumRows, nullptr);
 
   while (input->HasMoreBlocks()) {
+    // Compactions may be asked to yield their maintenance thread to a more
+    // urgent op. Nothing has been committed yet, so it's safe to bail out.
+    if (PREDICT_FALSE(MaintenanceOp::CurrentOpPreempted())) {
+      return Status::Aborted("compaction preempted by a more urgent maintenance op");
+    }
     RETURN_NOT_OK(input->PrepareBlock(&rows));
 
     int n = 0;
@@ -0,0 +1,276 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TABLET_COMPACTION_POLICY_SIM_H
+#define KUDU_TABLET_COMPACTION_POLICY_SIM_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/compaction_policy.h"
+#include "kudu/tablet/mock-rowsets.h"
+#include "kudu/tablet/rowset.h"
+#include "kudu/tablet/rowset_info.h"
+#include "kudu/tablet/rowset_tree.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace tablet {
+
+// A mock DiskRowSet whose keys are 8-byte big-endian encodings of integers,
+// so that the simulator can interpolate between them.
+class SimRowSet : public MockDiskRowSet {
+ public:
+  SimRowSet(uint64_t min_key, uint64_t max_key, int size)
+      : MockDiskRowSet(EncodeKey(min_key), EncodeKey(max_key), size),
+        min_key_(min_key),
+        max_key_(max_key),
+        size_(size) {
+  }
+
+  static std::string EncodeKey(uint64_t key) {
+    std::string ret(8, '\0');
+    for (int i = 7; i >= 0; i--) {
+      ret[i] = static_cast<char>(key & 0xff);
+      key >>= 8;
+    }
+    return ret;
+  }
+
+  // Maps an arbitrary encoded key into the simulator's 63-bit key space.
+  // Order-preserving, but lossy for keys longer than 8 bytes.
+  static uint64_t DecodeKey(const std::string& key) {
+    uint64_t ret = 0;
+    for (int i = 0; i < 8; i++) {
+      ret <<= 8;
+      if (i < key.size()) {
+        ret |= static_cast<uint8_t>(key[i]);
+      }
+    }
+    return ret >> 1;
+  }
+
+  // Keys must be less than this, so that max_key + 1 never overflows.
+  static const uint64_t kMaxKey = 1ULL << 63;
+
+  uint64_t min_key() const { return min_key_; }
+  uint64_t max_key() const { return max_key_; }
+  int size() const { return size_; }
+
+ private:
+  const uint64_t min_key_;
+  const uint64_t max_key_;
+  const int size_;
+};
+
+// Replays a stream of flushes against a compaction policy, without doing any
+// I/O, and tracks how well the policy keeps up.
+//
+// Each flush adds a rowset with the given bounds and size. After each flush,
+// the policy is run up to 'compactions_per_flush' times; each selection with
+// positive quality is "compacted" by replacing its inputs with rowsets of at
+// most the policy's target size. The outputs' bounds are derived by assuming
+// each input's data is spread uniformly across its key range.
+class CompactionPolicySimulator {
+ public:
+  struct Stats {
+    int64_t num_flushes = 0;
+    int64_t num_compactions = 0;
+    int64_t bytes_flushed = 0;
+    int64_t bytes_compacted = 0;
+    double sum_avg_height = 0;
+    double max_avg_height = 0;
+
+    // Bytes written by flushes and compactions per byte flushed.
+    double write_amplification() const {
+      return bytes_flushed == 0 ? 0 :
+          static_cast<double>(bytes_flushed + bytes_compacted) / bytes_flushed;
+    }
+
+    // The tablet's average rowset height, averaged over all flushes.
+    double mean_avg_height() const {
+      return num_flushes == 0 ? 0 : sum_avg_height / num_flushes;
+    }
+
+    std::string ToString() const {
+      return strings::Substitute(
+          "flushes=$0 compactions=$1 flushed_mb=$2 compacted_mb=$3 "
+          "write_amp=$4 mean_avg_height=$5 max_avg_height=$6",
+          num_flushes, num_compactions, bytes_flushed >> 20, bytes_compacted >> 20,
+          write_amplification(), mean_avg_height(), max_avg_height);
+    }
+  };
+
+  CompactionPolicySimulator(CompactionPolicy* policy, int compactions_per_flush)
+      : policy_(policy),
+        compactions_per_flush_(compactions_per_flush) {
+  }
+
+  // Adds a flushed rowset covering [min_key, max_key] and then runs
+  // compactions.
+  Status Flush(uint64_t min_key, uint64_t max_key, int size) {
+    CHECK_LE(min_key, max_key);
+    CHECK_LT(max_key, SimRowSet::kMaxKey);
+    rowsets_.emplace_back(new SimRowSet(min_key, max_key, size));
+    stats_.num_flushes++;
+    stats_.bytes_flushed += size;
+    for (int i = 0; i < compactions_per_flush_; i++) {
+      bool compacted;
+      RETURN_NOT_OK(MaybeCompact(&compacted));
+      if (!compacted) break;
+    }
+    RETURN_NOT_OK(RecordHeight());
+    return Status::OK();
+  }
+
+  // Runs the policy once and, if it selects a worthwhile compaction, applies it.
+  Status MaybeCompact(bool* compacted) {
+    *compacted = false;
+    RowSetTree tree;
+    RETURN_NOT_OK(tree.Reset(rowsets_));
+    std::unordered_set<RowSet*> picked;
+    double quality = 0;
+    RETURN_NOT_OK(policy_->PickRowSets(tree, &picked, &quality, nullptr));
+    if (picked.size() < 2 || quality <= 0) {
+      return Status::OK();
+    }
+
+    std::vector<const SimRowSet*> inputs;
+    RowSetVector remaining;
+    for (const auto& rs : rowsets_) {
+      if (picked.count(rs.get())) {
+        inputs.push_back(static_cast<const SimRowSet*>(rs.get()));
+        stats_.bytes_compacted += inputs.back()->size();
+      } else {
+        remaining.push_back(rs);
+      }
+    }
+    RowSetVector outputs;
+    SplitOutputs(inputs, &outputs);
+    remaining.insert(remaining.end(), outputs.begin(), outputs.end());
+    rowsets_.swap(remaining);
+    stats_.num_compactions++;
+    *compacted = true;
+    return Status::OK();
+  }
+
+  // The current average height of the tablet: the sum of the rowsets' widths,
+  // where width is the fraction of the tablet's data within a rowset's range.
+  Status AverageHeight(double* height) const {
+    RowSetTree tree;
+    RETURN_NOT_OK(tree.Reset(rowsets_));
+    std::vector<RowSetInfo> min_key, max_key;
+    RowSetInfo::CollectOrdered(tree, &min_key, &max_key);
+    *height = 0;
+    for (const auto& rsi : min_key) {
+      *height += rsi.width();
+    }
+    return Status::OK();
+  }
+
+  int64_t total_bytes() const {
+    int64_t ret = 0;
+    for (const auto& rs : rowsets_) {
+      ret += static_cast<const SimRowSet*>(rs.get())->size();
+    }
+    return ret;
+  }
+
+  const RowSetVector& rowsets() const { return rowsets_; }
+  const Stats& stats() const { return stats_; }
+
+ private:
+  Status RecordHeight() {
+    double height;
+    RETURN_NOT_OK(AverageHeight(&height));
+    stats_.sum_avg_height += height;
+    stats_.max_avg_height = std::max(stats_.max_avg_height, height);
+    return Status::OK();
+  }
+
+  // Divides the data of 'inputs' into rowsets of at most the policy's target
+  // size, walking the piecewise-uniform key density of the inputs.
+  void SplitOutputs(const std::vector<const SimRowSet*>& inputs, RowSetVector* outputs) const {
+    // Work with half-open ranges [min_key, max_key + 1).
+    std::vector<long double> points;
+    int64_t total = 0;
+    for (const auto* rs : inputs) {
+      points.push_back(rs->min_key());
+      points.push_back(static_cast<long double>(rs->max_key()) + 1);
+      total += rs->size();
+    }
+    std::sort(points.begin(), points.end());
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+
+    const long double target = std::max<uint64_t>(1, policy_->target_rowset_size());
+    long double out_start = points.front();
+    long double out_bytes = 0;
+    int64_t emitted = 0;
+    auto emit = [&](long double end, int64_t size) {
+      uint64_t min_key = static_cast<uint64_t>(out_start);
+      uint64_t end_key = static_cast<uint64_t>(end);
+      uint64_t max_key = end_key > min_key ? end_key - 1 : min_key;
+      outputs->emplace_back(new SimRowSet(min_key, max_key, size));
+      emitted += size;
+    };
+    for (int i = 0; i + 1 < points.size(); i++) {
+      long double lo = points[i];
+      long double hi = points[i + 1];
+      long double density = 0;
+      for (const auto* rs : inputs) {
+        long double rs_lo = rs->min_key();
+        long double rs_hi = static_cast<long double>(rs->max_key()) + 1;
+        if (rs_lo <= lo && hi <= rs_hi) {
+          density += rs->size() / (rs_hi - rs_lo);
+        }
+      }
+      if (density == 0) continue;
+      while (out_bytes + density * (hi - lo) >= target) {
+        long double cut = lo + (target - out_bytes) / density;
+        if (cut <= lo) {
+          // Too dense to split at this precision; always make progress.
+          cut = std::nextafter(lo, hi);
+        }
+        emit(cut, static_cast<int64_t>(target));
+        out_start = cut;
+        lo = cut;
+        out_bytes = 0;
+      }
+      out_bytes += density * (hi - lo);
+    }
+    if (emitted < total) {
+      emit(points.back(), total - emitted);
+    }
+  }
+
+  CompactionPolicy* const policy_;
+  const int compactions_per_flush_;
+  RowSetVector rowsets_;
+  Stats stats_;
+};
+
+} // namespace tablet
+} // namespace kudu
+
+#endif
@@ -22,6 +22,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <glog/stl_logging.h>
 #include <gtest/gtest.h>
@@ -29,6 +30,7 @@
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/compaction_policy-sim.h"
 #include "kudu/tablet/compaction_policy.h"
 #include "kudu/tablet/mock-rowsets.h"
 #include "kudu/tablet/rowset.h"
@@ -36,9 +38,23 @@
 #include "kudu/util/env.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/path_util.h"
+#include "kudu/util/random.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+DEFINE_int32(compaction_sim_num_flushes, 200,
+             "Number of flushes replayed by the compaction policy simulation tests");
+DEFINE_int32(compaction_sim_flush_size_mb, 8,
+             "Size of each flush in the synthetic compaction policy simulations");
+DEFINE_int32(compaction_sim_budget_mb, 128,
+             "Compaction budget used by the compaction policy simulations");
+DEFINE_int32(compaction_sim_compactions_per_flush, 1,
+             "Maximum number of compactions the simulations run after each flush");
+DEFINE_string(compaction_sim_input_file, "",
+              "If set, a file of recorded flushes, in the format of "
+              "ycsb-test-rowsets.tsv, to replay in TestSimulateRecordedStream");
 
 using std::shared_ptr;
 using std::unordered_set;
@@ -69,6 +85,87 @@ TEST(TestCompactionPolicy, TestBudgetedSelection) {
   ASSERT_GE(quality, 1.0);
 }
 
+// With the time-windowed policy, rowsets below the hot window should never be
+// picked, even if compacting them would be the best choice by key overlap.
+TEST(TestCompactionPolicy, TestTimeWindowedSelection) {
+  const int kRowSetSize = 1024 * 1024;
+  RowSetVector vec;
+  // Old, heavily overlapping rowsets at the bottom of the key space.
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("a", "c", kRowSetSize)));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("a", "c", kRowSetSize)));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("b", "d", kRowSetSize)));
+  // Recent rowsets at the top of the key space.
+  shared_ptr<RowSet> recent1(new MockDiskRowSet("x", "z", kRowSetSize));
+  shared_ptr<RowSet> recent2(new MockDiskRowSet("y", "z", kRowSetSize));
+  vec.push_back(recent1);
+  vec.push_back(recent2);
+
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(vec));
+
+  const int kBudgetMb = 1000; // enough to select all
+  const int kHotWindowMb = 2;
+  TimeWindowedCompactionPolicy policy(kBudgetMb, kHotWindowMb);
+
+  unordered_set<RowSet*> picked;
+  double quality = 0;
+  ASSERT_OK(policy.PickRowSets(tree, &picked, &quality, nullptr));
+  ASSERT_EQ(2, picked.size());
+  ASSERT_EQ(1, picked.count(recent1.get()));
+  ASSERT_EQ(1, picked.count(recent2.get()));
+}
+
+// If the hot window holds a single rowset, there's nothing to compact.
+TEST(TestCompactionPolicy, TestTimeWindowedSelectionAllSealed) {
+  const int kRowSetSize = 1024 * 1024;
+  RowSetVector vec;
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("a", "c", kRowSetSize)));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("b", "d", kRowSetSize)));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("x", "z", kRowSetSize)));
+
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(vec));
+
+  TimeWindowedCompactionPolicy policy(1000, 1);
+  unordered_set<RowSet*> picked;
+  double quality = 0;
+  ASSERT_OK(policy.PickRowSets(tree, &picked, &quality, nullptr));
+  ASSERT_TRUE(picked.empty());
+}
+
+// The sealed key range should be reported as it moves up, and rowsets sealed
+// before should stay sealed when the policy is recreated, e.g. when the tablet
+// is reopened, even if the hot window would now hold them.
+TEST(TestCompactionPolicy, TestTimeWindowedSealedKeyPersists) {
+  const int kRowSetSize = 1024 * 1024;
+  RowSetVector vec;
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("a", "c", kRowSetSize)));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("b", "d", kRowSetSize)));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("x", "z", kRowSetSize)));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("y", "z", kRowSetSize)));
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(vec));
+
+  string sealed_key;
+  auto seal_cb = [&](const string& key) { sealed_key = key; };
+  unordered_set<RowSet*> picked;
+  double quality = 0;
+  {
+    TimeWindowedCompactionPolicy policy(1000, 2, "", seal_cb);
+    ASSERT_OK(policy.PickRowSets(tree, &picked, &quality, nullptr));
+    ASSERT_EQ(2, picked.size());
+    ASSERT_EQ("x", sealed_key);
+  }
+
+  // With a larger hot window, and the sealed key persisted, only the recent
+  // rowsets are picked again.
+  picked.clear();
+  TimeWindowedCompactionPolicy policy(1000, 1000, sealed_key, seal_cb);
+  ASSERT_OK(policy.PickRowSets(tree, &picked, &quality, nullptr));
+  ASSERT_EQ(2, picked.size());
+  ASSERT_EQ("x", sealed_key);
+}
+
 // Return the directory of the currently-running executable.
 static string GetExecutableDir() {
   string exec;
@@ -76,9 +173,8 @@ static string GetExecutableDir() {
   return DirName(exec);
 }
 
-static RowSetVector LoadFile(const string& name) {
+static RowSetVector LoadFileAtPath(const string& path) {
   RowSetVector ret;
-  string path = JoinPathSegments(GetExecutableDir(), name);
   faststring data;
   CHECK_OK_PREPEND(ReadFileToString(Env::Default(), path, &data),
                    strings::Substitute("Unable to load test data file $0", path));
@@ -97,6 +193,10 @@ static RowSetVector LoadFile(const string& name) {
   return ret;
 }
 
+static RowSetVector LoadFile(const string& name) {
+  return LoadFileAtPath(JoinPathSegments(GetExecutableDir(), name));
+}
+
 // Realistic test using data scraped from a tablet containing 200+GB of YCSB data.
 // This test can be used as a benchmark for optimizing the compaction policy,
 // and also serves as a basic regression/stress test using real data.
@@ -127,5 +227,94 @@ TEST(TestCompactionPolicy, TestYcsbCompaction) {
       << qualities;
 }
 
+enum class SimWorkload {
+  // Each flush covers a disjoint key range above the previous one.
+  SEQUENTIAL,
+  // Each flush covers nearly the whole key space.
+  UNIFORM,
+};
+
+// Runs the simulator with a synthetic write stream and returns its stats.
+static CompactionPolicySimulator::Stats SimulateWorkload(SimWorkload workload, int budget_mb) {
+  const uint64_t kKeySpace = SimRowSet::kMaxKey;
+  const uint64_t kSequentialStep = kKeySpace / (FLAGS_compaction_sim_num_flushes + 1);
+  const int kFlushSize = FLAGS_compaction_sim_flush_size_mb * 1024 * 1024;
+
+  Random rng(SeedRandom());
+  BudgetedCompactionPolicy policy(budget_mb);
+  CompactionPolicySimulator sim(&policy, FLAGS_compaction_sim_compactions_per_flush);
+  for (int i = 0; i < FLAGS_compaction_sim_num_flushes; i++) {
+    uint64_t min_key, max_key;
+    switch (workload) {
+      case SimWorkload::SEQUENTIAL:
+        min_key = i * kSequentialStep;
+        max_key = min_key + kSequentialStep - 1;
+        break;
+      case SimWorkload::UNIFORM:
+        // The extremes of a large uniform sample lie close to the edges of
+        // the key space.
+        min_key = rng.Uniform64(kKeySpace / 1000);
+        max_key = kKeySpace - 1 - rng.Uniform64(kKeySpace / 1000);
+        break;
+    }
+    CHECK_OK(sim.Flush(min_key, max_key, kFlushSize));
+  }
+  // Compaction must neither lose nor invent data.
+  CHECK_EQ(sim.stats().bytes_flushed, sim.total_bytes());
+  return sim.stats();
+}
+
+// With sequential inserts rowsets never overlap, so there is nothing worth
+// compacting and the tablet's height stays at 1.
+TEST(TestCompactionPolicy, TestSimulateSequentialInserts) {
+  CompactionPolicySimulator::Stats stats =
+      SimulateWorkload(SimWorkload::SEQUENTIAL, FLAGS_compaction_sim_budget_mb);
+  LOG(INFO) << "Sequential inserts: " << stats.ToString();
+  ASSERT_EQ(0, stats.num_compactions);
+  ASSERT_DOUBLE_EQ(1.0, stats.write_amplification());
+  ASSERT_LE(stats.max_avg_height, 1.01);
+}
+
+// With uniform inserts every flush overlaps the whole tablet. Reports the
+// trade-off between write amplification and height for a range of budgets.
+// Run with --compaction_sim_* flags (and --compaction_approximation_ratio) to
+// explore other configurations.
+TEST(TestCompactionPolicy, TestSimulateUniformInserts) {
+  for (int budget_mb : { FLAGS_compaction_sim_budget_mb / 2,
+                         FLAGS_compaction_sim_budget_mb,
+                         FLAGS_compaction_sim_budget_mb * 2 }) {
+    CompactionPolicySimulator::Stats stats = SimulateWorkload(SimWorkload::UNIFORM, budget_mb);
+    LOG(INFO) << strings::Substitute("Uniform inserts, $0MB budget: ", budget_mb)
+              << stats.ToString();
+    ASSERT_GT(stats.num_compactions, 0);
+    ASSERT_GT(stats.write_amplification(), 1.0);
+    // Without compaction the mean height would be about half the number of flushes.
+    ASSERT_LT(stats.mean_avg_height(), FLAGS_compaction_sim_num_flushes / 2.0);
+  }
+}
+
+// Replays a recorded stream of flushes, one per line in the format of
+// ycsb-test-rowsets.tsv, in file order. By default the first
+// --compaction_sim_num_flushes rowsets of the YCSB snapshot are used.
+TEST(TestCompactionPolicy, TestSimulateRecordedStream) {
+  RowSetVector flushes = FLAGS_compaction_sim_input_file.empty() ?
+      LoadFile("ycsb-test-rowsets.tsv") : LoadFileAtPath(FLAGS_compaction_sim_input_file);
+  if (flushes.size() > FLAGS_compaction_sim_num_flushes) {
+    flushes.resize(FLAGS_compaction_sim_num_flushes);
+  }
+
+  BudgetedCompactionPolicy policy(FLAGS_compaction_sim_budget_mb);
+  CompactionPolicySimulator sim(&policy, FLAGS_compaction_sim_compactions_per_flush);
+  for (const auto& rs : flushes) {
+    string min_key, max_key;
+    ASSERT_OK(rs->GetBounds(&min_key, &max_key));
+    ASSERT_OK(sim.Flush(SimRowSet::DecodeKey(min_key),
+                        SimRowSet::DecodeKey(max_key),
+                        rs->OnDiskSize()));
+  }
+  LOG(INFO) << "Recorded stream: " << sim.stats().ToString();
+  ASSERT_EQ(sim.stats().bytes_flushed, sim.total_bytes());
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -18,6 +18,7 @@
 #include "kudu/tablet/compaction_policy.h"
 
 #include <algorithm>
+#include <memory>
 #include <ostream>
 #include <queue>
 #include <string>
@@ -31,11 +32,14 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/mathlimits.h"
 #include "kudu/tablet/rowset_info.h"
+#include "kudu/tablet/rowset_tree.h"
 #include "kudu/tablet/svg_dump.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/knapsack_solver.h"
 #include "kudu/util/status.h"
 
+using std::shared_ptr;
+using std::string;
 using std::vector;
 
 DEFINE_int32(budgeted_compaction_target_rowset_size, 32*1024*1024,
@@ -448,5 +452,101 @@ Status BudgetedCompactionPolicy::PickRowSets(const RowSetTree &tree,
   return Status::OK();
 }
 
+////////////////////////////////////////////////////////////
+// TimeWindowedCompactionPolicy
+////////////////////////////////////////////////////////////
+
+TimeWindowedCompactionPolicy::TimeWindowedCompactionPolicy(int size_budget_mb,
+                                                           int hot_window_mb,
+                                                           string sealed_key,
+                                                           SealCallback seal_cb)
+  : hot_window_mb_(hot_window_mb),
+    sealed_key_(std::move(sealed_key)),
+    seal_cb_(std::move(seal_cb)),
+    hot_window_policy_(size_budget_mb) {
+  CHECK_GT(hot_window_mb, 0);
+}
+
+uint64_t TimeWindowedCompactionPolicy::target_rowset_size() const {
+  return hot_window_policy_.target_rowset_size();
+}
+
+int TimeWindowedCompactionPolicy::CollectHotWindow(const RowSetTree& tree,
+                                                   RowSetVector* hot) {
+  struct Bounded {
+    shared_ptr<RowSet> rs;
+    string min_key;
+    string max_key;
+  };
+  vector<Bounded> bounded;
+  bounded.reserve(tree.all_rowsets().size());
+  for (const shared_ptr<RowSet>& rs : tree.all_rowsets()) {
+    Bounded b;
+    // Rowsets without bounds (e.g. MemRowSets) can't be compacted anyway.
+    if (!rs->GetBounds(&b.min_key, &b.max_key).ok()) continue;
+    b.rs = rs;
+    bounded.emplace_back(std::move(b));
+  }
+
+  // Walk down from the highest keys, accumulating rowsets until the window
+  // holds 'hot_window_mb_' of data. The lowest key covered by those rowsets
+  // is the boundary between the hot window and the sealed key range.
+  std::sort(bounded.begin(), bounded.end(), [](const Bounded& a, const Bounded& b) {
+    return a.max_key > b.max_key;
+  });
+  uint64_t window_bytes = 0;
+  const uint64_t hot_window_bytes = static_cast<uint64_t>(hot_window_mb_) * 1024 * 1024;
+  const string* boundary = nullptr;
+  for (const Bounded& b : bounded) {
+    if (boundary == nullptr || b.min_key < *boundary) {
+      boundary = &b.min_key;
+    }
+    window_bytes += b.rs->OnDiskDataSizeNoUndos();
+    if (window_bytes >= hot_window_bytes) break;
+  }
+
+  // Rowsets that were sealed before stay sealed.
+  if (boundary != nullptr && *boundary > sealed_key_) {
+    sealed_key_ = *boundary;
+    if (seal_cb_) {
+      seal_cb_(sealed_key_);
+    }
+  }
+
+  // Every rowset which overlaps the hot key range belongs to the hot window,
+  // even if it was not needed to fill it up.
+  int num_sealed = 0;
+  for (const Bounded& b : bounded) {
+    if (b.max_key >= sealed_key_) {
+      hot->push_back(b.rs);
+    } else {
+      num_sealed++;
+    }
+  }
+  return num_sealed;
+}
+
+Status TimeWindowedCompactionPolicy::PickRowSets(const RowSetTree &tree,
+                                                 std::unordered_set<RowSet*>* picked,
+                                                 double* quality,
+                                                 std::vector<std::string>* log) {
+  RowSetVector hot;
+  int num_sealed = CollectHotWindow(tree, &hot);
+  if (log) {
+    LOG_STRING(INFO, log) << "Time-windowed compaction: " << hot.size()
+                          << " rowset(s) in hot window, " << num_sealed << " sealed";
+  }
+  if (hot.size() < 2) {
+    if (log) {
+      LOG_STRING(INFO, log) << "No rowsets to compact";
+    }
+    return Status::OK();
+  }
+
+  RowSetTree hot_tree;
+  RETURN_NOT_OK(hot_tree.Reset(hot));
+  return hot_window_policy_.PickRowSets(hot_tree, picked, quality, log);
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -19,18 +19,19 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <unordered_set>
 #include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
+#include "kudu/tablet/rowset.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
 namespace tablet {
 
-class RowSet;
 class RowSetInfo;
 class RowSetTree;
 
@@ -127,6 +128,58 @@ class BudgetedCompactionPolicy : public CompactionPolicy {
   size_t size_budget_mb_;
 };
 
+// Compaction policy for tables whose keys are ordered by time and whose older
+// data is not updated, e.g. time series tables.
+//
+// The key space of the tablet is split into a "hot" window, made up of the
+// rowsets holding the most recent ~'hot_window_mb' of data (i.e. the rowsets
+// with the highest keys), and the "sealed" key range below it. Sealed rowsets
+// are never selected for compaction: their data is not expected to change, so
+// rewriting them would only add write amplification. Within the hot window,
+// rowsets are selected using the budgeted policy above.
+//
+// As new data is inserted at the top of the key space, the hot window moves
+// up and the rowsets it leaves behind are sealed. The boundary of the sealed
+// key range only ever moves up, even if the hot window shrinks, e.g. because
+// compactions dropped deleted rows from it.
+class TimeWindowedCompactionPolicy : public CompactionPolicy {
+ public:
+  // Called with the new boundary of the sealed key range whenever it moves,
+  // so that it may be persisted.
+  typedef std::function<void(const std::string& sealed_key)> SealCallback;
+
+  // 'sealed_key' is the boundary of the sealed key range as last reported to
+  // 'seal_cb', or an empty string if no rowsets were sealed yet.
+  TimeWindowedCompactionPolicy(int size_budget_mb, int hot_window_mb,
+                               std::string sealed_key = "",
+                               SealCallback seal_cb = SealCallback());
+
+  virtual Status PickRowSets(const RowSetTree &tree,
+                             std::unordered_set<RowSet*>* picked,
+                             double* quality,
+                             std::vector<std::string>* log) OVERRIDE;
+
+  virtual uint64_t target_rowset_size() const OVERRIDE;
+
+ private:
+  // Collects into 'hot' the rowsets of 'tree' which overlap the hot window,
+  // moving the boundary of the sealed key range up if need be. Returns the
+  // number of rowsets which were sealed.
+  int CollectHotWindow(const RowSetTree& tree, RowSetVector* hot);
+
+  const int hot_window_mb_;
+
+  // The boundary of the sealed key range: rowsets whose keys are all below it
+  // are sealed. Since PickRowSets() isn't called concurrently, this needs no
+  // lock of its own.
+  std::string sealed_key_;
+
+  const SealCallback seal_cb_;
+
+  // Policy used to pick rowsets from the hot window.
+  BudgetedCompactionPolicy hot_window_policy_;
+};
+
 } // namespace tablet
 } // namespace kudu
 #endif
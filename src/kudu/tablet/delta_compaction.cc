@@ -36,6 +36,7 @@
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/map-util.h"
+#include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/cfile_set.h"
 #include "kudu/tablet/compaction.h"
@@ -47,6 +48,7 @@
 #include "kudu/tablet/mutation.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/rowset_metadata.h"
+#include "kudu/util/maintenance_manager.h"
 #include "kudu/util/memory/arena.h"
 
 using std::shared_ptr;
@@ -132,6 +134,11 @@ Status MajorDeltaCompaction::FlushRowSetAndDeltas() {
   // We know that we're reading everything from disk so we're including all transactions.
   MvccSnapshot snap = MvccSnapshot::CreateSnapshotIncludingAllTransactions();
   while (old_base_data_rwise->HasNext()) {
+    // The compaction may be asked to yield its maintenance thread to a more
+    // urgent op. Nothing has been committed yet, so it's safe to bail out.
+    if (PREDICT_FALSE(MaintenanceOp::CurrentOpPreempted())) {
+      return Status::Aborted("major delta compaction preempted by a more urgent maintenance op");
+    }
 
     // 1) Get the next batch of base data for the columns we're compacting.
     arena.Reset();
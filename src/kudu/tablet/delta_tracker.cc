@@ -353,6 +353,10 @@ Status DeltaTracker::CompactStores(int start_idx, int end_idx) {
   // Prevent concurrent compactions or a compaction concurrent with a flush
   //
   // TODO(perf): this could be more fine grained
+  //
+  // The I/O throttle is only paid once the lock is released (the guard is
+  // declared first), so that a throttled compaction doesn't stall DMS flushes.
+  fs::ScopedDeferBackgroundIOThrottle defer_io_throttle;
   std::lock_guard<Mutex> l(compact_flush_lock_);
 
   // At the time of writing, minor delta compaction only compacts REDO delta
@@ -449,6 +453,33 @@ Status DeltaTracker::InitUndoDeltas(Timestamp ancient_history_mark,
   return Status::OK();
 }
 
+Status DeltaTracker::InitRedoDeltas(MonoTime deadline, int64_t* delta_blocks_initialized) {
+  SharedDeltaStoreVector redos;
+  {
+    shared_lock<rw_spinlock> lock(component_lock_);
+    redos = redo_delta_stores_;
+  }
+  int64_t tmp_blocks_initialized = 0;
+  for (auto& redo : redos) {
+    if (deadline.Initialized() && MonoTime::Now() >= deadline) break;
+    if (!redo->Initted()) {
+      RETURN_NOT_OK(redo->Init());
+      tmp_blocks_initialized++;
+    }
+  }
+
+  if (delta_blocks_initialized) *delta_blocks_initialized = tmp_blocks_initialized;
+  return Status::OK();
+}
+
+bool DeltaTracker::HasUninitializedRedoStores() const {
+  shared_lock<rw_spinlock> lock(component_lock_);
+  for (const auto& redo : redo_delta_stores_) {
+    if (!redo->Initted()) return true;
+  }
+  return false;
+}
+
 Status DeltaTracker::DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
                                              int64_t* blocks_deleted, int64_t* bytes_deleted) {
   DCHECK_NE(Timestamp::kInvalidTimestamp, ancient_history_mark);
@@ -503,6 +534,38 @@ Status DeltaTracker::DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
   return Status::OK();
 }
 
+bool DeltaTracker::CountDeletedRows(int64_t* deleted_rows, Timestamp* max_timestamp) const {
+  shared_lock<rw_spinlock> lock(component_lock_);
+  if (!dms_->Empty()) return false;
+
+  int64_t tmp_deleted_rows = 0;
+  Timestamp tmp_max_timestamp = Timestamp::kMin;
+  for (const auto& redo : redo_delta_stores_) {
+    // Never initialize the deltas in this code path (it's slow).
+    if (!redo->Initted()) return false;
+    const DeltaStats& stats = redo->delta_stats();
+    tmp_deleted_rows += stats.delete_count() - stats.reinsert_count();
+    if (tmp_max_timestamp < stats.max_timestamp()) {
+      tmp_max_timestamp = stats.max_timestamp();
+    }
+  }
+
+  *deleted_rows = tmp_deleted_rows;
+  *max_timestamp = tmp_max_timestamp;
+  return true;
+}
+
+bool DeltaTracker::ColumnKnownUnmodified(ColumnId col_id) const {
+  shared_lock<rw_spinlock> lock(component_lock_);
+  if (!dms_->Empty()) return false;
+  for (const auto& redo : redo_delta_stores_) {
+    if (!redo->Initted() || redo->delta_stats().update_count_for_col_id(col_id) > 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
 Status DeltaTracker::DoCompactStores(size_t start_idx, size_t end_idx,
          unique_ptr<WritableBlock> block,
          vector<shared_ptr<DeltaStore> > *compacted_stores,
@@ -667,6 +730,13 @@ Status DeltaTracker::FlushDMS(DeltaMemStore* dms,
                                             dfr));
   LOG_WITH_PREFIX(INFO) << "Reopened delta block for read: " << block_id.ToString();
 
+  // If the flushed deltas contain deletes, initialize the reader now while the
+  // footer is still likely to be cached, so that the delete counts are
+  // available to CountDeletedRows() without further IO.
+  if (stats->delete_count() > 0) {
+    RETURN_NOT_OK((*dfr)->Init());
+  }
+
   RETURN_NOT_OK(rowset_metadata_->CommitRedoDeltaDataBlock(dms->id(), block_id));
   if (flush_type == FLUSH_METADATA) {
     RETURN_NOT_OK_PREPEND(rowset_metadata_->Flush(),
@@ -677,6 +747,7 @@ Status DeltaTracker::FlushDMS(DeltaMemStore* dms,
 }
 
 Status DeltaTracker::Flush(MetadataFlushType flush_type) {
+  fs::ScopedDeferBackgroundIOThrottle defer_io_throttle;
   std::lock_guard<Mutex> l(compact_flush_lock_);
 
   // First, swap out the old DeltaMemStore a new one,
@@ -188,10 +188,30 @@ class DeltaTracker {
                         int64_t* delta_blocks_initialized,
                         int64_t* bytes_in_ancient_undos);
 
+  // See RowSet::InitRedoDeltas().
+  Status InitRedoDeltas(MonoTime deadline, int64_t* delta_blocks_initialized);
+
+  // See RowSet::HasUninitializedRedoDeltas().
+  bool HasUninitializedRedoStores() const;
+
   // See RowSet::DeleteAncientUndoDeltas().
   Status DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
                                  int64_t* blocks_deleted, int64_t* bytes_deleted);
 
+  // Compute, from the stats of the REDO delta stores, the net number of rows
+  // deleted (deletes less reinserts) in '*deleted_rows' and the latest REDO
+  // timestamp in '*max_timestamp'.
+  //
+  // Returns false without setting the out-params if the answer can't be
+  // determined without IO: if the DeltaMemStore is not empty, or if any REDO
+  // delta store has not been initialized.
+  bool CountDeletedRows(int64_t* deleted_rows, Timestamp* max_timestamp) const;
+
+  // Returns true if it is known, without IO, that no delta in this tracker
+  // updates the column 'col_id'. As with CountDeletedRows(), this requires an
+  // empty DeltaMemStore and initialized REDO delta stores.
+  bool ColumnKnownUnmodified(ColumnId col_id) const;
+
   // Validate that 'first' may precede 'second' in an ordered list of deltas,
   // given a delta type of 'type'. This should only be run in DEBUG mode.
   void ValidateDeltaOrder(const std::shared_ptr<DeltaStore>& first,
@@ -65,6 +65,7 @@
 DEFINE_double(update_fraction, 0.1f, "fraction of rows to update");
 DECLARE_bool(cfile_lazy_open);
 DECLARE_int32(cfile_default_block_size);
+DECLARE_int32(flush_column_writer_threads);
 DECLARE_double(tablet_delta_store_major_compact_min_ratio);
 DECLARE_int32(tablet_delta_store_minor_compact_max);
 
@@ -440,6 +441,18 @@ TEST_F(TestRowSet, TestDeltaApplicationPerformance) {
   }
 }
 
+// Test writing a rowset with the columns written in parallel, and then
+// reading all of it back.
+TEST_F(TestRowSet, TestRowSetRoundTripWithParallelColumnWriters) {
+  google::FlagSaver saver;
+  FLAGS_flush_column_writer_threads = 4;
+  WriteTestRowSet();
+
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+  IterateProjection(*rs, schema_, n_rows_);
+}
+
 TEST_F(TestRowSet, TestRollingDiskRowSetWriter) {
   // Set small block size so that we can roll frequently. Otherwise
   // we couldn't output such small files.
@@ -460,6 +473,26 @@ TEST_F(TestRowSet, TestRollingDiskRowSetWriter) {
   }
 }
 
+// Test that the rolling writer still rolls when the columns are written in
+// parallel, and their sizes are only known once queued chunks are written.
+TEST_F(TestRowSet, TestRollingDiskRowSetWriterWithParallelColumnWriters) {
+  google::FlagSaver saver;
+  FLAGS_cfile_default_block_size = 4096;
+  FLAGS_flush_column_writer_threads = 4;
+
+  RollingDiskRowSetWriter writer(tablet()->metadata(), schema_,
+                                 BloomFilterSizing::BySizeAndFPRate(32*1024, 0.01f),
+                                 64 * 1024); // roll every 64KB
+  DoWriteTestRowSet(10000, &writer);
+
+  vector<shared_ptr<RowSetMetadata> > metas;
+  writer.GetWrittenRowSetMetadata(&metas);
+  EXPECT_GT(metas.size(), 1);
+  for (const shared_ptr<RowSetMetadata>& meta : metas) {
+    ASSERT_TRUE(meta->HasDataForColumnIdForTests(schema_.column_id(0)));
+  }
+}
+
 TEST_F(TestRowSet, TestMakeDeltaIteratorMergerUnlocked) {
   WriteTestRowSet();
 
@@ -18,6 +18,7 @@
 #include "kudu/tablet/diskrowset.h"
 
 #include <algorithm>
+#include <limits>
 #include <map>
 #include <ostream>
 #include <vector>
@@ -36,6 +37,7 @@
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/common/types.h"
+#include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/tablet/cfile_set.h"
@@ -52,6 +54,7 @@
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/maintenance_manager.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
@@ -66,6 +69,16 @@ DEFINE_double(tablet_delta_store_major_compact_min_ratio, 0.1f,
              "can run (Advanced option)");
 TAG_FLAG(tablet_delta_store_major_compact_min_ratio, experimental);
 
+DEFINE_int64(tablet_delta_store_major_compact_max_bytes_per_pass, 0,
+             "Maximum amount of base column data, in bytes, that a single pass of a "
+             "major delta compaction rewrites. A rowset whose updated columns exceed "
+             "this is compacted in several passes, each covering a subset of the "
+             "columns and committed on its own, so an interrupted compaction keeps "
+             "the passes it completed. At least one column is rewritten per pass. "
+             "0 means all updated columns are compacted in a single pass.");
+TAG_FLAG(tablet_delta_store_major_compact_max_bytes_per_pass, experimental);
+TAG_FLAG(tablet_delta_store_major_compact_max_bytes_per_pass, runtime);
+
 DEFINE_int32(default_composite_key_index_block_size_bytes, 4096,
              "Block size used for composite key indexes.");
 TAG_FLAG(default_composite_key_index_block_size_bytes, experimental);
@@ -100,7 +113,8 @@ DiskRowSetWriter::DiskRowSetWriter(RowSetMetadata* rowset_metadata,
       schema_(schema),
       bloom_sizing_(bloom_sizing),
       finished_(false),
-      written_count_(0) {
+      written_count_(0),
+      max_ttl_value_(std::numeric_limits<int64_t>::min()) {
   CHECK(schema->has_column_ids());
 }
 
@@ -191,6 +205,17 @@ Status DiskRowSetWriter::AppendBlock(const RowBlock &block) {
   // Write the batch to each of the columns
   RETURN_NOT_OK(col_writer_->AppendBlock(block));
 
+  // Track the newest value of the TTL column, so that the rowset can later be
+  // recognized as expired without reading it.
+  int ttl_col_idx = schema_->ttl_column_idx();
+  if (ttl_col_idx != Schema::kColumnNotFound) {
+    const ColumnBlock ttl_col = block.column_block(ttl_col_idx);
+    for (size_t i = 0; i < block.nrows(); i++) {
+      max_ttl_value_ = std::max(max_ttl_value_,
+                                *reinterpret_cast<const int64_t*>(ttl_col.cell_ptr(i)));
+    }
+  }
+
 #ifndef NDEBUG
     faststring prev_key;
 #endif
@@ -260,6 +285,11 @@ Status DiskRowSetWriter::FinishAndReleaseBlocks(BlockTransaction* transaction) {
   col_writer_->GetFlushedBlocksByColumnId(&flushed_blocks);
   rowset_metadata_->SetColumnDataBlocks(flushed_blocks);
 
+  int ttl_col_idx = schema_->ttl_column_idx();
+  if (ttl_col_idx != Schema::kColumnNotFound) {
+    rowset_metadata_->SetMaxTtlValue(schema_->column_id(ttl_col_idx), max_ttl_value_);
+  }
+
   if (ad_hoc_index_writer_ != nullptr) {
     Status s = ad_hoc_index_writer_->FinishAndReleaseBlock(transaction);
     if (!s.ok()) {
@@ -510,7 +540,8 @@ DiskRowSet::DiskRowSet(shared_ptr<RowSetMetadata> rowset_metadata,
     : rowset_metadata_(std::move(rowset_metadata)),
       open_(false),
       log_anchor_registry_(log_anchor_registry),
-      mem_trackers_(std::move(mem_trackers)) {}
+      mem_trackers_(std::move(mem_trackers)),
+      sealed_expired_(false) {}
 
 Status DiskRowSet::Open() {
   TRACE_EVENT0("tablet", "DiskRowSet::Open");
@@ -549,13 +580,50 @@ Status DiskRowSet::MajorCompactDeltaStores(HistoryGcOpts history_gc_opts) {
     return Status::OK();
   }
 
-  return MajorCompactDeltaStoresWithColumnIds(col_ids, std::move(history_gc_opts));
+  vector<vector<ColumnId>> passes;
+  SplitColumnsIntoPasses(col_ids, &passes);
+  for (int i = 0; i < passes.size(); i++) {
+    // Each pass is committed before the next starts, so stopping here loses
+    // no work; the remaining columns still have REDO deltas and will be
+    // picked up by a later major delta compaction.
+    if (i > 0 && MaintenanceOp::CurrentOpPreempted()) {
+      LOG_WITH_PREFIX(INFO) << "Major delta compaction preempted after " << i << " of "
+                            << passes.size() << " passes";
+      return Status::OK();
+    }
+    RETURN_NOT_OK(MajorCompactDeltaStoresWithColumnIds(passes[i], history_gc_opts));
+  }
+  return Status::OK();
+}
+
+void DiskRowSet::SplitColumnsIntoPasses(const vector<ColumnId>& col_ids,
+                                        vector<vector<ColumnId>>* passes) const {
+  passes->clear();
+  int64_t max_bytes = FLAGS_tablet_delta_store_major_compact_max_bytes_per_pass;
+  if (max_bytes <= 0) {
+    passes->push_back(col_ids);
+    return;
+  }
+
+  shared_lock<rw_spinlock> l(component_lock_);
+  int64_t pass_bytes = 0;
+  for (ColumnId col_id : col_ids) {
+    int64_t col_bytes = base_data_->OnDiskColumnDataSize(col_id);
+    if (passes->empty() || (!passes->back().empty() && pass_bytes + col_bytes > max_bytes)) {
+      passes->emplace_back();
+      pass_bytes = 0;
+    }
+    passes->back().push_back(col_id);
+    pass_bytes += col_bytes;
+  }
 }
 
 Status DiskRowSet::MajorCompactDeltaStoresWithColumnIds(const vector<ColumnId>& col_ids,
                                                         HistoryGcOpts history_gc_opts) {
   LOG_WITH_PREFIX(INFO) << "Major compacting REDO delta stores (cols: " << col_ids << ")";
   TRACE_EVENT0("tablet", "DiskRowSet::MajorCompactDeltaStoresWithColumnIds");
+  // Pay for any throttled I/O only after releasing the compaction lock.
+  fs::ScopedDeferBackgroundIOThrottle defer_io_throttle;
   std::lock_guard<Mutex> l(*delta_tracker()->compact_flush_lock());
 
   // TODO(todd): do we need to lock schema or anything here?
@@ -647,6 +715,9 @@ Status DiskRowSet::MutateRow(Timestamp timestamp,
                              OperationResultPB* result) {
   DCHECK(open_);
   shared_lock<rw_spinlock> l(component_lock_);
+  if (PREDICT_FALSE(sealed_expired_)) {
+    return Status::ServiceUnavailable("rowset of expired rows is being dropped");
+  }
 
   boost::optional<rowid_t> row_idx;
   RETURN_NOT_OK(base_data_->FindRow(probe, &row_idx, stats));
@@ -687,6 +758,48 @@ Status DiskRowSet::CheckRowPresent(const RowSetKeyProbe &probe,
   return Status::OK();
 }
 
+Status DiskRowSet::ReadTtlValue(const RowSetKeyProbe& probe,
+                                const MvccSnapshot& snap,
+                                ProbeStats* stats,
+                                bool* present,
+                                int64_t* ttl_micros) const {
+  DCHECK(open_);
+  shared_lock<rw_spinlock> l(component_lock_);
+  *present = false;
+
+  bool in_base_data;
+  rowid_t row_idx;
+  RETURN_NOT_OK(base_data_->CheckRowPresent(probe, &in_base_data, &row_idx, stats));
+  if (!in_base_data) {
+    return Status::OK();
+  }
+
+  // Read the base value of the row's TTL cell, then apply the deltas which
+  // are visible to 'snap' to it, as a scan of that single cell would.
+  const Schema& schema = rowset_metadata_->tablet_schema();
+  int ttl_col_idx = schema.ttl_column_idx();
+  DCHECK_NE(Schema::kColumnNotFound, ttl_col_idx);
+  Schema projection({ schema.column(ttl_col_idx) }, { schema.column_id(ttl_col_idx) }, 0);
+  ColumnBlock dst(projection.column(0).type_info(), nullptr, ttl_micros, 1, nullptr);
+  RETURN_NOT_OK(base_data_->ReadCell(row_idx, projection.column(0), projection.column_id(0),
+                                     &dst));
+
+  unique_ptr<DeltaIterator> delta_iter;
+  RETURN_NOT_OK(delta_tracker_->NewDeltaIterator(&projection, snap, &delta_iter));
+  RETURN_NOT_OK(delta_iter->Init(nullptr));
+  RETURN_NOT_OK(delta_iter->SeekToOrdinal(row_idx));
+  RETURN_NOT_OK(delta_iter->PrepareBatch(1, DeltaIterator::PREPARE_FOR_APPLY));
+  SelectionVector sel(1);
+  sel.SetAllTrue();
+  RETURN_NOT_OK(delta_iter->ApplyDeletes(&sel));
+  if (!sel.IsRowSelected(0)) {
+    return Status::OK();
+  }
+  RETURN_NOT_OK(delta_iter->ApplyUpdates(0, &dst));
+  *present = true;
+  return Status::OK();
+}
+
 Status DiskRowSet::CountRows(rowid_t *count) const {
   DCHECK(open_);
   shared_lock<rw_spinlock> l(component_lock_);
@@ -814,6 +927,69 @@ Status DiskRowSet::DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
                                                  blocks_deleted, bytes_deleted);
 }
 
+Status DiskRowSet::IsDeletedAndAncient(Timestamp ancient_history_mark, bool* deleted) {
+  DCHECK_NE(Timestamp::kInvalidTimestamp, ancient_history_mark);
+  *deleted = false;
+
+  int64_t deleted_rows;
+  Timestamp max_redo_timestamp;
+  if (!delta_tracker_->CountDeletedRows(&deleted_rows, &max_redo_timestamp)) {
+    return Status::OK();
+  }
+  // The delete that removed the last live row must itself be ancient, otherwise
+  // a scan between it and the ancient history mark could still see the row.
+  if (deleted_rows == 0 || ancient_history_mark <= max_redo_timestamp) {
+    return Status::OK();
+  }
+
+  rowid_t num_rows;
+  RETURN_NOT_OK(CountRows(&num_rows));
+  DCHECK_LE(deleted_rows, num_rows);
+  *deleted = deleted_rows == num_rows;
+  return Status::OK();
+}
+
+bool DiskRowSet::HasUninitializedRedoDeltas() const {
+  return delta_tracker_->HasUninitializedRedoStores();
+}
+
+Status DiskRowSet::InitRedoDeltas(MonoTime deadline, int64_t* delta_blocks_initialized) {
+  TRACE_EVENT0("tablet", "DiskRowSet::InitRedoDeltas");
+  return delta_tracker_->InitRedoDeltas(deadline, delta_blocks_initialized);
+}
+
+Status DiskRowSet::IsExpired(int64_t ttl_cutoff_micros, bool* expired) const {
+  shared_lock<rw_spinlock> l(component_lock_);
+  *expired = IsExpiredUnlocked(ttl_cutoff_micros);
+  return Status::OK();
+}
+
+bool DiskRowSet::SealIfExpired(int64_t ttl_cutoff_micros) {
+  // Mutations hold 'component_lock_' while applying to the DMS, so holding it
+  // exclusively ensures none can slip in between the check and the seal.
+  std::lock_guard<rw_spinlock> l(component_lock_);
+  if (!sealed_expired_ && IsExpiredUnlocked(ttl_cutoff_micros)) {
+    sealed_expired_ = true;
+  }
+  return sealed_expired_;
+}
+
+bool DiskRowSet::IsExpiredUnlocked(int64_t ttl_cutoff_micros) const {
+  if (sealed_expired_) return true;
+  const Schema& schema = rowset_metadata_->tablet_schema();
+  int ttl_col_idx = schema.ttl_column_idx();
+  if (ttl_col_idx == Schema::kColumnNotFound) return false;
+  ColumnId ttl_col_id = schema.column_id(ttl_col_idx);
+
+  int64_t max_ttl_value;
+  if (!rowset_metadata_->GetMaxTtlValue(ttl_col_id, &max_ttl_value) ||
+      max_ttl_value >= ttl_cutoff_micros) {
+    return false;
+  }
+  // An update could have moved a row's TTL value past what was recorded.
+  return delta_tracker_->ColumnKnownUnmodified(ttl_col_id);
+}
+
 Status DiskRowSet::DebugDump(vector<string> *lines) {
   // Using CompactionInput to dump our data is an easy way of seeing all the
   // rows and deltas.
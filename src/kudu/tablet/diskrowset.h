@@ -151,6 +151,9 @@ class DiskRowSetWriter {
 
   // The last encoded key written.
   faststring last_encoded_key_;
+
+  // The largest value written to the schema's TTL column, if it has one.
+  int64_t max_ttl_value_;
 };
 
 
@@ -380,7 +383,26 @@ class DiskRowSet : public RowSet {
   Status DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
                                  int64_t* blocks_deleted, int64_t* bytes_deleted) OVERRIDE;
 
+  Status IsDeletedAndAncient(Timestamp ancient_history_mark, bool* deleted) OVERRIDE;
+
+  bool HasUninitializedRedoDeltas() const OVERRIDE;
+
+  Status InitRedoDeltas(MonoTime deadline, int64_t* delta_blocks_initialized) OVERRIDE;
+
+  Status IsExpired(int64_t ttl_cutoff_micros, bool* expired) const OVERRIDE;
+
+  bool SealIfExpired(int64_t ttl_cutoff_micros) OVERRIDE;
+
+  Status ReadTtlValue(const RowSetKeyProbe& probe,
+                      const MvccSnapshot& snap,
+                      ProbeStats* stats,
+                      bool* present,
+                      int64_t* ttl_micros) const OVERRIDE;
+
   // Major compacts all the delta files for all the columns.
+  //
+  // If --tablet_delta_store_major_compact_max_bytes_per_pass is set, the
+  // columns are compacted in several passes, each committed independently.
   Status MajorCompactDeltaStores(HistoryGcOpts history_gc_opts);
 
   std::mutex *compact_flush_lock() OVERRIDE {
@@ -428,10 +450,19 @@ class DiskRowSet : public RowSet {
                                  HistoryGcOpts history_gc_opts,
                                  gscoped_ptr<MajorDeltaCompaction>* out) const;
 
+  // Splits 'col_ids' into groups whose base data is at most
+  // --tablet_delta_store_major_compact_max_bytes_per_pass in size, with at
+  // least one column per group.
+  void SplitColumnsIntoPasses(const std::vector<ColumnId>& col_ids,
+                              std::vector<std::vector<ColumnId>>* passes) const;
+
   // Major compacts all the delta files for the specified columns.
   Status MajorCompactDeltaStoresWithColumnIds(const std::vector<ColumnId>& col_ids,
                                               HistoryGcOpts history_gc_opts);
 
+  // See IsExpired(). Requires that 'component_lock_' is held.
+  bool IsExpiredUnlocked(int64_t ttl_cutoff_micros) const;
+
   std::shared_ptr<RowSetMetadata> rowset_metadata_;
 
   bool open_;
@@ -445,6 +476,10 @@ class DiskRowSet : public RowSet {
   std::shared_ptr<CFileSet> base_data_;
   gscoped_ptr<DeltaTracker> delta_tracker_;
 
+  // Set by SealIfExpired(). Once set, MutateRow() fails. Protected by
+  // 'component_lock_'.
+  bool sealed_expired_;
+
   // Lock governing this rowset's inclusion in a compact/flush. If locked,
   // no other compactor will attempt to include this rowset.
   std::mutex compact_flush_lock_;
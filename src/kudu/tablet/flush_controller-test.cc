@@ -0,0 +1,157 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/flush_controller.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags_declare.h>
+#include <gtest/gtest.h>
+
+#include "kudu/util/monotime.h"
+#include "kudu/util/test_util.h"
+
+DECLARE_int32(adaptive_flush_headroom_secs);
+DECLARE_int32(adaptive_flush_min_threshold_mb);
+DECLARE_int32(flush_threshold_mb);
+
+namespace kudu {
+namespace tablet {
+
+static const int64_t kMB = 1024 * 1024;
+
+class FlushControllerTest : public KuduTest {
+ public:
+  void SetUp() override {
+    KuduTest::SetUp();
+    FLAGS_flush_threshold_mb = 1024;
+    FLAGS_adaptive_flush_min_threshold_mb = 16;
+    // Disabled except in the test that exercises it.
+    FLAGS_adaptive_flush_headroom_secs = 0;
+    now_ = MonoTime::Now();
+  }
+
+ protected:
+  // Advances time by 'secs', with each tablet's MemRowSet having grown by
+  // 'secs' times its rate in MB/sec.
+  void Ingest(int secs, const std::vector<std::pair<std::string, int64_t>>& rates_mb) {
+    for (int i = 0; i < secs; i++) {
+      now_ += MonoDelta::FromSeconds(1);
+      for (const auto& tablet_and_rate : rates_mb) {
+        int64_t* size = &sizes_[tablet_and_rate.first];
+        *size += tablet_and_rate.second * kMB;
+        fc_.UpdateTablet(tablet_and_rate.first, *size, now_);
+      }
+    }
+  }
+
+  FlushController fc_;
+  MonoTime now_;
+  std::unordered_map<std::string, int64_t> sizes_;
+};
+
+// An unknown or idle tablet uses the static threshold.
+TEST_F(FlushControllerTest, TestDefaultThreshold) {
+  ASSERT_EQ(1024 * kMB, fc_.FlushThresholdBytes("unknown", 1024 * kMB));
+  fc_.UpdateTablet("a", 0, now_);
+  ASSERT_EQ(1024 * kMB, fc_.FlushThresholdBytes("a", 1024 * kMB));
+}
+
+// The budget is split in proportion to the square root of the ingest rates.
+TEST_F(FlushControllerTest, TestThresholdsFollowIngestRate) {
+  Ingest(600, { { "fast", 4 }, { "slow", 1 } });
+  ASSERT_NEAR(4 * kMB, fc_.IngestRate("fast"), 0.1 * kMB);
+  ASSERT_NEAR(1 * kMB, fc_.IngestRate("slow"), 0.1 * kMB);
+
+  // sqrt(4) : sqrt(1) = 2 : 1, so with a budget of 300MB the thresholds are
+  // 2 * 300MB * 2/3 and 2 * 300MB * 1/3.
+  const int64_t kBudget = 300 * kMB;
+  ASSERT_NEAR(400 * kMB, fc_.FlushThresholdBytes("fast", kBudget), 10 * kMB);
+  ASSERT_NEAR(200 * kMB, fc_.FlushThresholdBytes("slow", kBudget), 10 * kMB);
+
+  // Thresholds are clamped to the configured bounds.
+  ASSERT_EQ(1024 * kMB, fc_.FlushThresholdBytes("fast", 100 * 1024 * kMB));
+  ASSERT_EQ(16 * kMB, fc_.FlushThresholdBytes("slow", 1 * kMB));
+
+  // Once a tablet goes away, its share is given to the others.
+  fc_.RemoveTablet("slow");
+  ASSERT_NEAR(600 * kMB, fc_.FlushThresholdBytes("fast", kBudget), 10 * kMB);
+}
+
+// Thresholds shrink as the projected time until the budget runs out falls
+// below the headroom.
+TEST_F(FlushControllerTest, TestHeadroom) {
+  Ingest(600, { { "a", 1 } });
+  // 600MB held by the MemRowSet; 1GB of budget leaves ~424 seconds at 1MB/s.
+  const int64_t kBudget = 1024 * kMB;
+  ASSERT_EQ(1024 * kMB, fc_.FlushThresholdBytes("a", kBudget));
+
+  // Unclamped, the threshold would be twice the budget; with four times the
+  // remaining time as headroom it is a quarter of that.
+  FLAGS_adaptive_flush_headroom_secs = 4 * 424;
+  ASSERT_NEAR(512 * kMB, fc_.FlushThresholdBytes("a", kBudget), 10 * kMB);
+
+  // Past the budget, flush as soon as possible.
+  ASSERT_EQ(16 * kMB, fc_.FlushThresholdBytes("a", 512 * kMB));
+}
+
+// A tablet whose MemRowSet stops growing becomes idle, and a flush resets the
+// MemRowSet without resetting the ingest rate.
+TEST_F(FlushControllerTest, TestIdleAndFlush) {
+  const MonoDelta kIdlePeriod = MonoDelta::FromSeconds(60);
+  Ingest(120, { { "a", 1 } });
+  ASSERT_FALSE(fc_.IsIdle("a", now_, kIdlePeriod));
+
+  // Simulate a flush followed by continued ingest.
+  sizes_["a"] = 0;
+  Ingest(10, { { "a", 1 } });
+  ASSERT_FALSE(fc_.IsIdle("a", now_, kIdlePeriod));
+  ASSERT_GT(fc_.IngestRate("a"), 0.5 * kMB);
+
+  // No more growth.
+  Ingest(61, { { "a", 0 } });
+  ASSERT_TRUE(fc_.IsIdle("a", now_, kIdlePeriod));
+  ASSERT_TRUE(fc_.IsIdle("unknown", now_, kIdlePeriod));
+}
+
+// Toggling the controller drops everything it learned, so that stale rates
+// don't carry over to when it is next enabled.
+TEST_F(FlushControllerTest, TestToggleResetsState) {
+  fc_.SetEnabled(true);
+  Ingest(600, { { "a", 4 } });
+  ASSERT_GT(fc_.IngestRate("a"), 3.0 * kMB);
+
+  // Re-asserting the same state keeps what was learned.
+  fc_.SetEnabled(true);
+  ASSERT_GT(fc_.IngestRate("a"), 3.0 * kMB);
+
+  fc_.SetEnabled(false);
+  ASSERT_EQ(0, fc_.IngestRate("a"));
+  ASSERT_EQ(1024 * kMB, fc_.FlushThresholdBytes("a", 1024 * kMB));
+
+  // Once re-enabled, the rate is learned afresh.
+  fc_.SetEnabled(true);
+  Ingest(1, { { "a", 4 } });
+  ASSERT_LT(fc_.IngestRate("a"), 1.0 * kMB);
+}
+
+} // namespace tablet
+} // namespace kudu
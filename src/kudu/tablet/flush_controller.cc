@@ -0,0 +1,209 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/flush_controller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <utility>
+
+#include <gflags/gflags.h>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/process_memory.h"
+
+DEFINE_bool(enable_adaptive_flush_thresholds, false,
+            "Whether MemRowSet flush thresholds are chosen by a server-wide controller "
+            "based on each tablet's ingest rate and the memory available, rather than "
+            "being fixed at --flush_threshold_mb. When enabled, a MemRowSet is only "
+            "flushed for age (see --flush_threshold_secs) once it has stopped growing.");
+TAG_FLAG(enable_adaptive_flush_thresholds, experimental);
+TAG_FLAG(enable_adaptive_flush_thresholds, runtime);
+
+DEFINE_int32(adaptive_flush_min_threshold_mb, 64,
+             "The smallest MemRowSet flush threshold the adaptive flush controller will "
+             "choose, unless --flush_threshold_mb is smaller.");
+TAG_FLAG(adaptive_flush_min_threshold_mb, experimental);
+TAG_FLAG(adaptive_flush_min_threshold_mb, runtime);
+
+DEFINE_int32(adaptive_flush_headroom_secs, 60,
+             "The adaptive flush controller lowers flush thresholds once the projected "
+             "time until MemRowSets exhaust the memory available to them, at the current "
+             "ingest rate, falls below this many seconds.");
+TAG_FLAG(adaptive_flush_headroom_secs, experimental);
+TAG_FLAG(adaptive_flush_headroom_secs, runtime);
+
+DECLARE_int32(flush_threshold_mb);
+DECLARE_int32(memory_pressure_percentage);
+
+namespace kudu {
+namespace tablet {
+
+namespace {
+
+// Ingest rates are sampled at most this often...
+const double kMinSampleSecs = 1.0;
+// ...and smoothed with this time constant.
+const double kRateTimeConstantSecs = 60.0;
+
+} // anonymous namespace
+
+FlushController::FlushController()
+    : enabled_(false),
+      total_mrs_bytes_(0),
+      total_rate_(0),
+      total_sqrt_rate_(0) {
+}
+
+FlushController* FlushController::GetInstance() {
+  static FlushController* instance = new FlushController();
+  return instance;
+}
+
+void FlushController::SetEnabled(bool enabled) {
+  if (enabled_.load(std::memory_order_relaxed) == enabled) {
+    return;
+  }
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (enabled_.load(std::memory_order_relaxed) == enabled) {
+    return;
+  }
+  enabled_.store(enabled, std::memory_order_relaxed);
+  tablets_.clear();
+  total_mrs_bytes_ = 0;
+  total_rate_ = 0;
+  total_sqrt_rate_ = 0;
+}
+
+void FlushController::SubtractFromTotals(const TabletState& state) {
+  total_mrs_bytes_ -= state.mrs_bytes;
+  total_rate_ = std::max(0.0, total_rate_ - state.rate);
+  total_sqrt_rate_ = std::max(0.0, total_sqrt_rate_ - std::sqrt(state.rate));
+}
+
+void FlushController::AddToTotals(const TabletState& state) {
+  total_mrs_bytes_ += state.mrs_bytes;
+  total_rate_ += state.rate;
+  total_sqrt_rate_ += std::sqrt(state.rate);
+}
+
+void FlushController::UpdateTablet(const std::string& tablet_id, int64_t mrs_bytes,
+                                   MonoTime now) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  auto it = tablets_.find(tablet_id);
+  if (it == tablets_.end()) {
+    TabletState state;
+    state.mrs_bytes = mrs_bytes;
+    state.sample_start = now;
+    state.sample_start_bytes = mrs_bytes;
+    state.last_growth = now;
+    AddToTotals(state);
+    tablets_.emplace(tablet_id, state);
+    return;
+  }
+
+  TabletState* state = &it->second;
+  SubtractFromTotals(*state);
+  if (mrs_bytes > state->mrs_bytes) {
+    state->last_growth = now;
+  }
+  state->mrs_bytes = mrs_bytes;
+
+  double elapsed = (now - state->sample_start).ToSeconds();
+  if (elapsed >= kMinSampleSecs) {
+    // If the MemRowSet shrank, it was flushed during the sample; count what
+    // the new one has accumulated since.
+    int64_t grown = mrs_bytes >= state->sample_start_bytes ?
+        mrs_bytes - state->sample_start_bytes : mrs_bytes;
+    double alpha = 1 - std::exp(-elapsed / kRateTimeConstantSecs);
+    state->rate += alpha * (grown / elapsed - state->rate);
+    state->sample_start = now;
+    state->sample_start_bytes = mrs_bytes;
+  }
+  AddToTotals(*state);
+}
+
+void FlushController::RemoveTablet(const std::string& tablet_id) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  auto it = tablets_.find(tablet_id);
+  if (it == tablets_.end()) {
+    return;
+  }
+  SubtractFromTotals(it->second);
+  tablets_.erase(it);
+}
+
+int64_t FlushController::FlushThresholdBytes(const std::string& tablet_id,
+                                             int64_t budget_bytes) const {
+  const int64_t max_bytes = static_cast<int64_t>(FLAGS_flush_threshold_mb) * 1024 * 1024;
+  const int64_t min_bytes = std::min<int64_t>(
+      max_bytes, static_cast<int64_t>(FLAGS_adaptive_flush_min_threshold_mb) * 1024 * 1024);
+
+  std::lock_guard<simple_spinlock> l(lock_);
+  const TabletState* state = FindOrNull(tablets_, tablet_id);
+  if (!state) {
+    return max_bytes;
+  }
+
+  // Split the budget in proportion to the square root of the ingest rates.
+  // Without any ingest there's nothing to trade off.
+  double threshold = max_bytes;
+  if (state->rate > 0 && total_sqrt_rate_ > 0) {
+    threshold = 2.0 * budget_bytes * std::sqrt(state->rate) / total_sqrt_rate_;
+  }
+
+  // Flush earlier if the budget is about to run out.
+  const double headroom_secs = FLAGS_adaptive_flush_headroom_secs;
+  if (total_rate_ > 0 && headroom_secs > 0) {
+    double secs_to_limit = (budget_bytes - total_mrs_bytes_) / total_rate_;
+    if (secs_to_limit < headroom_secs) {
+      threshold *= std::max(0.0, secs_to_limit) / headroom_secs;
+    }
+  }
+
+  return std::max(min_bytes, std::min(max_bytes, static_cast<int64_t>(threshold)));
+}
+
+bool FlushController::IsIdle(const std::string& tablet_id, MonoTime now,
+                             MonoDelta period) const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  const TabletState* state = FindOrNull(tablets_, tablet_id);
+  return !state || now - state->last_growth >= period;
+}
+
+int64_t FlushController::MemoryBudgetBytes() const {
+  int64_t pressure_threshold =
+      process_memory::HardLimit() * FLAGS_memory_pressure_percentage / 100;
+  int64_t mrs_bytes;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    mrs_bytes = total_mrs_bytes_;
+  }
+  int64_t other_bytes = std::max<int64_t>(0, process_memory::CurrentConsumption() - mrs_bytes);
+  return std::max<int64_t>(0, pressure_threshold - other_bytes);
+}
+
+double FlushController::IngestRate(const std::string& tablet_id) const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  const TabletState* state = FindOrNull(tablets_, tablet_id);
+  return state ? state->rate : 0;
+}
+
+} // namespace tablet
+} // namespace kudu
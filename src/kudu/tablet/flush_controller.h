@@ -0,0 +1,124 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TABLET_FLUSH_CONTROLLER_H
+#define KUDU_TABLET_FLUSH_CONTROLLER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+
+namespace kudu {
+namespace tablet {
+
+// Process-wide controller that sizes MemRowSet flushes across all tablets.
+//
+// With a fixed per-tablet flush threshold, a server hosting many tablets
+// either flushes lots of small MemRowSets (via the time-based trigger) or runs
+// into the memory limit when they all grow at once. Instead, each tablet's
+// FlushMRSOp reports its MemRowSet size whenever it is polled, and the
+// controller tracks each tablet's ingest rate and the total memory held by
+// MemRowSets. From these it hands out per-tablet thresholds that:
+//
+// - divide the memory available to MemRowSets so as to minimize the total
+//   number of flushes. A tablet's MemRowSet holds on average half its
+//   threshold, and flushes (rate / threshold) times per second; minimizing
+//   the flush count under a memory budget gives thresholds proportional to
+//   the square root of each tablet's ingest rate.
+// - shrink when, at the current total ingest rate, the memory budget would be
+//   exhausted within --adaptive_flush_headroom_secs, so that flushes start
+//   before the server comes under memory pressure.
+//
+// Thresholds are clamped between --adaptive_flush_min_threshold_mb and
+// --flush_threshold_mb.
+//
+// This class is thread-safe.
+class FlushController {
+ public:
+  FlushController();
+
+  // Returns the process-wide instance.
+  static FlushController* GetInstance();
+
+  // Notes whether adaptive flush thresholds are in use, i.e. the current value
+  // of --enable_adaptive_flush_thresholds. Whenever this changes, all tracked
+  // state is dropped: while disabled, tablets stop reporting, so their rates
+  // and sizes would be stale by the time the controller is enabled again.
+  void SetEnabled(bool enabled);
+
+  // Records that the given tablet's MemRowSet held 'mrs_bytes' as of 'now'.
+  void UpdateTablet(const std::string& tablet_id, int64_t mrs_bytes, MonoTime now);
+
+  // Stops tracking the given tablet.
+  void RemoveTablet(const std::string& tablet_id);
+
+  // Returns the MemRowSet size, in bytes, at which the given tablet should
+  // flush, if MemRowSets may use at most 'budget_bytes' in total.
+  int64_t FlushThresholdBytes(const std::string& tablet_id, int64_t budget_bytes) const;
+
+  // Returns true if the given tablet's MemRowSet has not grown within
+  // 'period' as of 'now'. Flushing such a MemRowSet early costs nothing,
+  // since it would not get any bigger.
+  bool IsIdle(const std::string& tablet_id, MonoTime now, MonoDelta period) const;
+
+  // Returns the memory that may be used by MemRowSets before the process
+  // comes under memory pressure, given its current consumption.
+  int64_t MemoryBudgetBytes() const;
+
+  // Returns the estimated ingest rate of the given tablet, in bytes/sec.
+  double IngestRate(const std::string& tablet_id) const;
+
+ private:
+  struct TabletState {
+    int64_t mrs_bytes = 0;
+    // Smoothed ingest rate, in bytes/sec.
+    double rate = 0;
+    // Start of the current rate sample.
+    MonoTime sample_start;
+    int64_t sample_start_bytes = 0;
+    // Last time the MemRowSet was seen to grow.
+    MonoTime last_growth;
+  };
+
+  // Removes the tablet's contribution to the aggregates below.
+  void SubtractFromTotals(const TabletState& state);
+  void AddToTotals(const TabletState& state);
+
+  // The last value passed to SetEnabled(). Read without 'lock_' on the fast
+  // path, and only changed while holding it.
+  std::atomic<bool> enabled_;
+
+  mutable simple_spinlock lock_;
+  std::unordered_map<std::string, TabletState> tablets_;
+
+  // Aggregates over 'tablets_', maintained incrementally so that computing a
+  // threshold doesn't require a pass over every tablet.
+  int64_t total_mrs_bytes_;
+  double total_rate_;
+  double total_sqrt_rate_;
+
+  DISALLOW_COPY_AND_ASSIGN(FlushController);
+};
+
+} // namespace tablet
+} // namespace kudu
+
+#endif
@@ -23,6 +23,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -30,10 +31,14 @@
 #include "kudu/common/iterator.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/schema.h"
+#include "kudu/gutil/casts.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/compaction.h"
+#include "kudu/tablet/delta_tracker.h"
+#include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/local_tablet_writer.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/rowset.h"
@@ -42,6 +47,9 @@
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 
+DECLARE_bool(cfile_lazy_open);
+DECLARE_int64(tablet_delta_store_major_compact_max_bytes_per_pass);
+
 using std::shared_ptr;
 using std::string;
 using std::unordered_set;
@@ -221,6 +229,46 @@ TEST_F(TestMajorDeltaCompaction, TestCompact) {
   }
 }
 
+// Verify that a major delta compaction split into several passes produces the
+// same data as a single pass, committing each pass separately.
+TEST_F(TestMajorDeltaCompaction, TestCompactInPasses) {
+  // Compact one column per pass.
+  FLAGS_tablet_delta_store_major_compact_max_bytes_per_pass = 1;
+  // Open delta files eagerly so that their stats are visible to
+  // GetColumnIdsWithUpdates().
+  FLAGS_cfile_lazy_open = false;
+
+  const int kNumRows = 100;
+  ASSERT_NO_FATAL_FAILURE(WriteTestTablet(kNumRows));
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_NO_FATAL_FAILURE(UpdateRows(kNumRows, false));
+  ASSERT_OK(tablet()->FlushBiggestDMS());
+  ASSERT_NO_FATAL_FAILURE(UpdateRows(kNumRows, true));
+  ASSERT_OK(tablet()->FlushBiggestDMS());
+  ASSERT_NO_FATAL_FAILURE(VerifyData());
+
+  vector<shared_ptr<RowSet> > all_rowsets;
+  tablet()->GetRowSetsForTests(&all_rowsets);
+  ASSERT_EQ(1, all_rowsets.size());
+  DiskRowSet* drs = down_cast<DiskRowSet*>(all_rowsets.front().get());
+  DeltaTracker* dt = drs->delta_tracker();
+
+  vector<ColumnId> col_ids;
+  dt->GetColumnIdsWithUpdates(&col_ids);
+  ASSERT_EQ(3, col_ids.size());
+  size_t undos_before = dt->CountUndoDeltaStores();
+
+  ASSERT_OK(drs->MajorCompactDeltaStores(HistoryGcOpts::Disabled()));
+  ASSERT_NO_FATAL_FAILURE(VerifyData());
+
+  // All of the REDOs were compacted away, and each of the three passes wrote
+  // its own UNDO file.
+  dt->GetColumnIdsWithUpdates(&col_ids);
+  ASSERT_TRUE(col_ids.empty());
+  ASSERT_EQ(0, dt->CountRedoDeltaStores());
+  ASSERT_EQ(undos_before + 3, dt->CountUndoDeltaStores());
+}
+
 // Verify that we do issue UNDO files and that we can read them.
 TEST_F(TestMajorDeltaCompaction, TestUndos) {
   const int kNumRows = 100;
@@ -286,6 +286,53 @@ Status MemRowSet::CheckRowPresent(const RowSetKeyProbe &probe, bool *present,
   return Status::OK();
 }
 
+Status MemRowSet::ReadTtlValue(const RowSetKeyProbe& probe,
+                               const MvccSnapshot& snap,
+                               ProbeStats* stats,
+                               bool* present,
+                               int64_t* ttl_micros) const {
+  stats->mrs_consulted++;
+  *present = false;
+
+  // See CheckRowPresent() about using a PreparedMutation here.
+  btree::PreparedMutation<MSBTreeTraits> mutation(probe.encoded_key_slice());
+  mutation.Prepare(const_cast<MSBTree *>(&tree_));
+  if (!mutation.exists()) {
+    return Status::OK();
+  }
+  MRSRow row(this, mutation.current_mutable_value());
+  if (!snap.IsCommitted(row.insertion_timestamp())) {
+    return Status::OK();
+  }
+
+  // Start with the inserted value, and roll it forward through the mutations
+  // which are visible to 'snap', as an iterator would.
+  int ttl_col_idx = schema_.ttl_column_idx();
+  DCHECK_NE(Schema::kColumnNotFound, ttl_col_idx);
+  ColumnBlock dst(schema_.column(ttl_col_idx).type_info(), nullptr, ttl_micros, 1, nullptr);
+  dst.SetCellValue(0, row.cell_ptr(ttl_col_idx));
+  bool is_deleted = false;
+  for (const Mutation* mut = row.acquire_redo_head();
+       mut != nullptr;
+       mut = mut->acquire_next()) {
+    if (!snap.IsCommitted(mut->timestamp())) {
+      continue;
+    }
+    RowChangeListDecoder decoder(mut->changelist());
+    RETURN_NOT_OK(decoder.Init());
+    if (decoder.is_delete()) {
+      decoder.TwiddleDeleteStatus(&is_deleted);
+      continue;
+    }
+    if (decoder.is_reinsert()) {
+      decoder.TwiddleDeleteStatus(&is_deleted);
+    }
+    RETURN_NOT_OK(decoder.ApplyToOneColumn(0, &dst, schema_, ttl_col_idx, nullptr));
+  }
+  *present = !is_deleted;
+  return Status::OK();
+}
+
 MemRowSet::Iterator *MemRowSet::NewIterator(const Schema *projection,
                                             const MvccSnapshot &snap) const {
   return new MemRowSet::Iterator(shared_from_this(), tree_.NewIterator(),
@@ -388,6 +388,33 @@ class MemRowSet : public RowSet,
     return Status::OK();
   }
 
+  Status IsDeletedAndAncient(Timestamp /*ancient_history_mark*/, bool* deleted) OVERRIDE {
+    *deleted = false;
+    return Status::OK();
+  }
+
+  bool HasUninitializedRedoDeltas() const OVERRIDE { return false; }
+
+  Status InitRedoDeltas(MonoTime /*deadline*/, int64_t* delta_blocks_initialized) OVERRIDE {
+    if (delta_blocks_initialized) *delta_blocks_initialized = 0;
+    return Status::OK();
+  }
+
+  Status IsExpired(int64_t /*ttl_cutoff_micros*/, bool* expired) const OVERRIDE {
+    *expired = false;
+    return Status::OK();
+  }
+
+  bool SealIfExpired(int64_t /*ttl_cutoff_micros*/) OVERRIDE {
+    return false;
+  }
+
+  Status ReadTtlValue(const RowSetKeyProbe& probe,
+                      const MvccSnapshot& snap,
+                      ProbeStats* stats,
+                      bool* present,
+                      int64_t* ttl_micros) const OVERRIDE;
+
   Status FlushDeltas() OVERRIDE { return Status::OK(); }
 
   Status MinorCompactDeltaStores() OVERRIDE { return Status::OK(); }
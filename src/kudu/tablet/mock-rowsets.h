@@ -144,6 +144,43 @@ class MockRowSet : public RowSet {
     return Status::OK();
   }
 
+  virtual Status IsDeletedAndAncient(Timestamp /*ancient_history_mark*/,
+                                     bool* /*deleted*/) OVERRIDE {
+    LOG(FATAL) << "Unimplemented";
+    return Status::OK();
+  }
+
+  virtual bool HasUninitializedRedoDeltas() const OVERRIDE {
+    LOG(FATAL) << "Unimplemented";
+    return false;
+  }
+
+  virtual Status InitRedoDeltas(MonoTime /*deadline*/,
+                                int64_t* /*delta_blocks_initialized*/) OVERRIDE {
+    LOG(FATAL) << "Unimplemented";
+    return Status::OK();
+  }
+
+  virtual Status IsExpired(int64_t /*ttl_cutoff_micros*/,
+                           bool* /*expired*/) const OVERRIDE {
+    LOG(FATAL) << "Unimplemented";
+    return Status::OK();
+  }
+
+  virtual bool SealIfExpired(int64_t /*ttl_cutoff_micros*/) OVERRIDE {
+    LOG(FATAL) << "Unimplemented";
+    return false;
+  }
+
+  virtual Status ReadTtlValue(const RowSetKeyProbe& /*probe*/,
+                              const MvccSnapshot& /*snap*/,
+                              ProbeStats* /*stats*/,
+                              bool* /*present*/,
+                              int64_t* /*ttl_micros*/) const OVERRIDE {
+    LOG(FATAL) << "Unimplemented";
+    return Status::OK();
+  }
+
   virtual bool IsAvailableForCompaction() OVERRIDE {
     return true;
   }
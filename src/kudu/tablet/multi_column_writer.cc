@@ -17,21 +17,41 @@
 
 #include "kudu/tablet/multi_column_writer.h"
 
-#include <algorithm>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
 
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/cfile/cfile_writer.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/types.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/port.h"
 #include "kudu/gutil/stl_util.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/threadpool.h"
+#include "kudu/util/throttler.h"
+
+DEFINE_int32(flush_column_writer_threads, 1,
+             "Number of threads in the process-wide pool used by flushes and "
+             "compactions to encode, compress and write the columns of their "
+             "output rowsets. If set to 1, all columns are written by the "
+             "thread doing the merge. The pool's size is fixed once it is "
+             "first used.");
+TAG_FLAG(flush_column_writer_threads, experimental);
 
 namespace kudu {
 namespace tablet {
@@ -40,7 +60,73 @@ using cfile::CFileWriter;
 using fs::BlockTransaction;
 using fs::CreateBlockOptions;
 using fs::WritableBlock;
+using std::shared_ptr;
 using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// Number of rows buffered for each column before they're handed to the
+// column writer pool. Batching keeps the per-task overhead small compared
+// to the cost of encoding the rows.
+const size_t kColumnChunkRows = 1024;
+
+// Maximum number of chunks per column which may be queued or being written.
+// This bounds the memory used by copies of the merged rows, and makes the
+// merge wait for a column which can't keep up.
+const int kMaxPendingChunksPerColumn = 4;
+
+// Returns the pool shared by all writers, or null if columns should be
+// written by the appending thread. The pool is sized when first needed.
+ThreadPool* GetColumnWriterPool() {
+  if (FLAGS_flush_column_writer_threads <= 1) {
+    return nullptr;
+  }
+  static ThreadPool* pool = []() {
+    gscoped_ptr<ThreadPool> p;
+    CHECK_OK(ThreadPoolBuilder("column-writer")
+             .set_max_threads(FLAGS_flush_column_writer_threads)
+             .Build(&p));
+    return p.release();
+  }();
+  return pool;
+}
+
+} // anonymous namespace
+
+struct MultiColumnWriter::ColumnChunk {
+  ColumnChunk()
+      : nrows(0),
+        arena(4096, 4 * 1024 * 1024) {
+  }
+
+  // Appends the cells of 'column', copying any indirect data into 'arena'.
+  void Append(const ColumnBlock& column) {
+    const size_t old_nrows = nrows;
+    nrows += column.nrows();
+    data.append(column.data(), column.nrows() * column.stride());
+    if (column.is_nullable()) {
+      null_bitmap.resize(BitmapSize(nrows));
+      for (size_t i = 0; i < column.nrows(); i++) {
+        BitmapChange(null_bitmap.data(), old_nrows + i, !column.is_null(i));
+      }
+    }
+    if (column.type_info()->physical_type() == BINARY) {
+      Slice* cells = reinterpret_cast<Slice*>(data.data()) + old_nrows;
+      for (size_t i = 0; i < column.nrows(); i++) {
+        if (column.is_nullable() && column.is_null(i)) {
+          continue;
+        }
+        CHECK(arena.RelocateSlice(cells[i], &cells[i]));
+      }
+    }
+  }
+
+  faststring data;
+  faststring null_bitmap;
+  size_t nrows;
+  Arena arena;
+};
 
 MultiColumnWriter::MultiColumnWriter(FsManager* fs,
                                      const Schema* schema,
@@ -48,10 +134,14 @@ MultiColumnWriter::MultiColumnWriter(FsManager* fs,
   : fs_(fs),
     schema_(schema),
     finished_(false),
-    tablet_id_(std::move(tablet_id)) {
+    tablet_id_(std::move(tablet_id)),
+    chunk_written_(&lock_) {
 }
 
 MultiColumnWriter::~MultiColumnWriter() {
+  for (const auto& token : tokens_) {
+    token->Shutdown();
+  }
   STLDeleteElements(&cfile_writers_);
 }
 
@@ -102,22 +192,127 @@ Status MultiColumnWriter::Open() {
   }
   LOG(INFO) << "Opened CFile writers for " << cfile_writers_.size() << " column(s)";
 
+  ThreadPool* pool = GetColumnWriterPool();
+  if (pool && schema_->num_columns() > 1) {
+    for (int i = 0; i < schema_->num_columns(); i++) {
+      tokens_.emplace_back(pool->NewToken(ThreadPool::ExecutionMode::SERIAL));
+      chunks_.emplace_back(std::make_shared<ColumnChunk>());
+    }
+    pending_chunks_.resize(schema_->num_columns(), 0);
+    written_sizes_.resize(schema_->num_columns(), 0);
+  }
+
   return Status::OK();
 }
 
+Status MultiColumnWriter::AppendColumn(const RowBlock& block, int col_idx) {
+  ColumnBlock column = block.column_block(col_idx);
+  if (column.is_nullable()) {
+    return cfile_writers_[col_idx]->AppendNullableEntries(column.null_bitmap(),
+        column.data(), column.nrows());
+  }
+  return cfile_writers_[col_idx]->AppendEntries(column.data(), column.nrows());
+}
+
 Status MultiColumnWriter::AppendBlock(const RowBlock& block) {
+  if (tokens_.empty()) {
+    for (int i = 0; i < schema_->num_columns(); i++) {
+      RETURN_NOT_OK(AppendColumn(block, i));
+    }
+    return Status::OK();
+  }
+
+  {
+    MutexLock l(lock_);
+    RETURN_NOT_OK(write_status_);
+  }
   for (int i = 0; i < schema_->num_columns(); i++) {
-    ColumnBlock column = block.column_block(i);
-    if (column.is_nullable()) {
-      RETURN_NOT_OK(cfile_writers_[i]->AppendNullableEntries(column.null_bitmap(),
-          column.data(), column.nrows()));
-    } else {
-      RETURN_NOT_OK(cfile_writers_[i]->AppendEntries(column.data(), column.nrows()));
+    chunks_[i]->Append(block.column_block(i));
+  }
+  // All columns buffer the same rows, so their chunks fill up together.
+  if (chunks_[0]->nrows >= kColumnChunkRows) {
+    RETURN_NOT_OK(SubmitChunks());
+  }
+  return Status::OK();
+}
+
+Status MultiColumnWriter::SubmitChunks() {
+  // The pool threads inherit this thread's background I/O throttling. If it
+  // is deferred, this thread pays for their I/O too, once it may sleep.
+  const bool background_io = ScopedBackgroundIO::IsActive();
+  const bool defer_io_throttle = fs::ScopedDeferBackgroundIOThrottle::IsActive();
+  for (int i = 0; i < schema_->num_columns(); i++) {
+    if (chunks_[i]->nrows == 0) {
+      continue;
+    }
+    {
+      MutexLock l(lock_);
+      while (write_status_.ok() &&
+             pending_chunks_[i] >= kMaxPendingChunksPerColumn) {
+        chunk_written_.Wait();
+      }
+      RETURN_NOT_OK(write_status_);
+      pending_chunks_[i]++;
+    }
+    shared_ptr<ColumnChunk> chunk = std::move(chunks_[i]);
+    chunks_[i] = std::make_shared<ColumnChunk>();
+    Status s = tokens_[i]->SubmitFunc([this, i, chunk, background_io, defer_io_throttle]() {
+      ScopedBackgroundIO scope(background_io);
+      fs::ScopedDeferBackgroundIOThrottle defer_scope(defer_io_throttle, /*pay=*/false);
+      WriteChunk(i, *chunk);
+    });
+    if (PREDICT_FALSE(!s.ok())) {
+      MutexLock l(lock_);
+      pending_chunks_[i]--;
+      return s;
     }
   }
   return Status::OK();
 }
 
+void MultiColumnWriter::WriteChunk(int col_idx, const ColumnChunk& chunk) {
+  bool failed;
+  {
+    MutexLock l(lock_);
+    failed = !write_status_.ok();
+  }
+  Status s;
+  size_t size = 0;
+  if (!failed) {
+    // Each column has its own CFileWriter and output block, and the column's
+    // token runs its chunks one at a time and in order.
+    CFileWriter* writer = cfile_writers_[col_idx];
+    if (schema_->column(col_idx).is_nullable()) {
+      s = writer->AppendNullableEntries(chunk.null_bitmap.data(),
+                                        chunk.data.data(), chunk.nrows);
+    } else {
+      s = writer->AppendEntries(chunk.data.data(), chunk.nrows);
+    }
+    size = writer->written_size();
+  }
+
+  MutexLock l(lock_);
+  if (!failed) {
+    written_sizes_[col_idx] = size;
+    if (!s.ok() && write_status_.ok()) {
+      write_status_ = s.CloneAndPrepend(
+          "Unable to write column " + schema_->column(col_idx).ToString());
+    }
+  }
+  pending_chunks_[col_idx]--;
+  chunk_written_.Broadcast();
+}
+
+Status MultiColumnWriter::DrainColumns() {
+  Status s = SubmitChunks();
+  for (const auto& token : tokens_) {
+    token->Wait();
+  }
+  RETURN_NOT_OK(s);
+  MutexLock l(lock_);
+  return write_status_;
+}
+
 Status MultiColumnWriter::Finish() {
   BlockTransaction transaction;
   RETURN_NOT_OK(FinishAndReleaseBlocks(&transaction));
@@ -126,6 +321,9 @@ Status MultiColumnWriter::Finish() {
 
 Status MultiColumnWriter::FinishAndReleaseBlocks(BlockTransaction* transaction) {
   CHECK(!finished_);
+  if (!tokens_.empty()) {
+    RETURN_NOT_OK(DrainColumns());
+  }
   for (int i = 0; i < schema_->num_columns(); i++) {
     CFileWriter *writer = cfile_writers_[i];
     Status s = writer->FinishAndReleaseBlock(transaction);
@@ -147,7 +345,23 @@ void MultiColumnWriter::GetFlushedBlocksByColumnId(std::map<ColumnId, BlockId>*
   }
 }
 
+CFileWriter* MultiColumnWriter::writer_for_col_idx(int i) {
+  DCHECK_LT(i, cfile_writers_.size());
+  if (!tokens_.empty()) {
+    tokens_[i]->Wait();
+  }
+  return cfile_writers_[i];
+}
+
 size_t MultiColumnWriter::written_size() const {
+  if (!tokens_.empty()) {
+    MutexLock l(lock_);
+    size_t size = 0;
+    for (size_t s : written_sizes_) {
+      size += s;
+    }
+    return size;
+  }
   size_t size = 0;
   for (const CFileWriter *writer : cfile_writers_) {
     size += writer->written_size();
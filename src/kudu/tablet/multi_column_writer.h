@@ -19,6 +19,7 @@
 
 #include <cstddef>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -26,6 +27,8 @@
 
 #include "kudu/fs/block_id.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -33,6 +36,7 @@ namespace kudu {
 class FsManager;
 class RowBlock;
 class Schema;
+class ThreadPoolToken;
 struct ColumnId;
 
 namespace cfile {
@@ -47,6 +51,12 @@ namespace tablet {
 
 // Wrapper which writes several columns in parallel corresponding to some
 // Schema. Written blocks will fall in the tablet_id's data dir group.
+//
+// If --flush_column_writer_threads is greater than 1, appended rows are
+// copied into per-column chunks which are encoded, compressed and written on
+// a thread pool shared by all writers in the process. Each column has a
+// bounded queue of chunks, so the caller only waits on a column which has
+// fallen behind.
 class MultiColumnWriter {
  public:
   MultiColumnWriter(FsManager* fs,
@@ -60,7 +70,10 @@ class MultiColumnWriter {
 
   // Append the given block to the output columns.
   //
-  // Note that the selection vector here is ignored.
+  // Note that the selection vector here is ignored. When column writes are
+  // parallelized, the block's data is copied before returning, so the caller
+  // may reuse the block afterwards. An error from a column written in the
+  // background may be returned by a later call, or by Finish().
   Status AppendBlock(const RowBlock& block);
 
   // Close the in-progress files.
@@ -72,13 +85,13 @@ class MultiColumnWriter {
   // blocks and releasing them to 'transaction'.
   Status FinishAndReleaseBlocks(fs::BlockTransaction* transaction);
 
-  // Return the number of bytes written so far.
+  // Return the number of bytes written so far. When column writes are
+  // parallelized, this doesn't include rows which are still queued.
   size_t written_size() const;
 
-  cfile::CFileWriter* writer_for_col_idx(int i) {
-    DCHECK_LT(i, cfile_writers_.size());
-    return cfile_writers_[i];
-  }
+  // Return the writer for column 'i', waiting for any queued writes to it
+  // to finish first.
+  cfile::CFileWriter* writer_for_col_idx(int i);
 
   // Return the block IDs of the written columns, keyed by column ID.
   //
@@ -86,6 +99,23 @@ class MultiColumnWriter {
   void GetFlushedBlocksByColumnId(std::map<ColumnId, BlockId>* ret) const;
 
  private:
+  // Rows of one column copied out of appended blocks.
+  struct ColumnChunk;
+
+  // Append the given block's data for column 'col_idx' to its CFile.
+  Status AppendColumn(const RowBlock& block, int col_idx);
+
+  // Hand the buffered chunk of every column to that column's token, waiting
+  // for room in its queue if necessary.
+  Status SubmitChunks();
+
+  // Write 'chunk' to column 'col_idx'. Runs on the shared pool.
+  void WriteChunk(int col_idx, const ColumnChunk& chunk);
+
+  // Submit any buffered rows and wait for all queued writes to finish.
+  // Returns the first error hit by a column write.
+  Status DrainColumns();
+
   FsManager* const fs_;
   const Schema* const schema_;
 
@@ -96,6 +126,27 @@ class MultiColumnWriter {
   std::vector<cfile::CFileWriter *> cfile_writers_;
   std::vector<BlockId> block_ids_;
 
+  // Serial tokens on the shared column writer pool, one per column. Empty if
+  // column writes happen on the calling thread.
+  std::vector<std::unique_ptr<ThreadPoolToken>> tokens_;
+
+  // Rows buffered for each column which haven't been submitted yet. Only
+  // accessed by the appending thread.
+  std::vector<std::shared_ptr<ColumnChunk>> chunks_;
+
+  // Protects the fields below, which are updated as chunks are written.
+  mutable Mutex lock_;
+  ConditionVariable chunk_written_;
+
+  // Number of chunks submitted for each column but not yet written.
+  std::vector<int> pending_chunks_;
+
+  // Bytes written to each column so far.
+  std::vector<size_t> written_sizes_;
+
+  // The first error hit while writing a chunk.
+  Status write_status_;
+
   DISALLOW_COPY_AND_ASSIGN(MultiColumnWriter);
 };
 
@@ -352,6 +352,11 @@ Timestamp MvccManager::GetCleanTimestamp() const {
   return cur_snap_.all_committed_before_;
 }
 
+Timestamp MvccManager::GetNoneCommittedAtOrAfterTimestamp() const {
+  std::lock_guard<LockType> l(lock_);
+  return cur_snap_.none_committed_at_or_after_;
+}
+
 void MvccManager::GetApplyingTransactionsTimestamps(std::vector<Timestamp>* timestamps) const {
   std::lock_guard<LockType> l(lock_);
   timestamps->reserve(timestamps_in_flight_.size());
@@ -259,6 +259,9 @@ class MvccManager {
   // All timestamps before this one are guaranteed to be committed.
   Timestamp GetCleanTimestamp() const;
 
+  // Returns a timestamp greater than those of all committed transactions.
+  Timestamp GetNoneCommittedAtOrAfterTimestamp() const;
+
   // Return the timestamps of all transactions which are currently 'APPLYING'
   // (i.e. those which have started to apply their operations to in-memory data
   // structures). Other transactions may have reserved their timestamps via
@@ -184,6 +184,22 @@ Status DuplicatingRowSet::CheckRowPresent(const RowSetKeyProbe &probe,
   return Status::OK();
 }
 
+Status DuplicatingRowSet::ReadTtlValue(const RowSetKeyProbe& probe,
+                                       const MvccSnapshot& snap,
+                                       ProbeStats* stats,
+                                       bool* present,
+                                       int64_t* ttl_micros) const {
+  // Like CheckRowPresent(), reads go to the input rowsets.
+  *present = false;
+  for (const shared_ptr<RowSet> &rowset : old_rowsets_) {
+    RETURN_NOT_OK(rowset->ReadTtlValue(probe, snap, stats, present, ttl_micros));
+    if (*present) {
+      return Status::OK();
+    }
+  }
+  return Status::OK();
+}
+
 Status DuplicatingRowSet::CountRows(rowid_t *count) const {
   int64_t accumulated_count = 0;
   for (const shared_ptr<RowSet> &rs : new_rowsets_) {
@@ -207,6 +207,58 @@ class RowSet {
                                          int64_t* blocks_deleted,
                                          int64_t* bytes_deleted) = 0;
 
+  // Determine whether every row in this rowset has been deleted by a mutation
+  // older than 'ancient_history_mark', in which case no scan at or after the
+  // ancient history mark can observe any of its rows, and the rowset may be
+  // dropped without being rewritten.
+  //
+  // This is answered from delta store stats alone and does no IO, so it is
+  // conservative: '*deleted' is false whenever the stats are not available
+  // (e.g. unflushed deltas or REDO delta stores that have not been opened).
+  virtual Status IsDeletedAndAncient(Timestamp ancient_history_mark, bool* deleted) = 0;
+
+  // Returns true if any REDO delta store of this rowset has not been
+  // initialized, so that IsDeletedAndAncient() can't tell whether the rowset
+  // is deleted yet.
+  virtual bool HasUninitializedRedoDeltas() const = 0;
+
+  // Initialize the REDO delta stores of this rowset, oldest first, until
+  // 'deadline' passes. If 'deadline' is not Initialized() then no deadline
+  // is enforced.
+  //
+  // The out-parameter 'delta_blocks_initialized' may be passed in as nullptr.
+  virtual Status InitRedoDeltas(MonoTime deadline, int64_t* delta_blocks_initialized) = 0;
+
+  // Determine whether every row in this rowset has a value older than
+  // 'ttl_cutoff_micros' in the schema's TTL column, so that none can be
+  // returned by a scan whose TTL predicate starts at the cutoff.
+  //
+  // Like IsDeletedAndAncient(), this is answered from stats alone: the
+  // largest TTL value recorded when the base data was written, provided no
+  // delta updates the TTL column.
+  virtual Status IsExpired(int64_t ttl_cutoff_micros, bool* expired) const = 0;
+
+  // If this rowset is expired as of 'ttl_cutoff_micros' (see IsExpired()),
+  // seal it: from then on, MutateRow() fails with ServiceUnavailable, so that
+  // the rowset can be dropped without losing a concurrent update. Its rows
+  // stay present to writes until the drop is durable and the rowset is gone
+  // from the tablet, so that no write re-inserts them into the MemRowSet
+  // while the old copies may still come back after a restart. Returns whether
+  // the rowset is sealed; rowsets which can't expire always return false.
+  virtual bool SealIfExpired(int64_t ttl_cutoff_micros) = 0;
+
+  // Read the value of the schema's TTL column in the row with the key of
+  // 'probe', as seen by 'snap'. Sets '*present' to false if the row isn't
+  // visible in this rowset, in which case '*ttl_micros' is left unset.
+  //
+  // This is a point lookup of a single cell, for writes which need to know
+  // whether the row they hit is expired.
+  virtual Status ReadTtlValue(const RowSetKeyProbe& probe,
+                              const MvccSnapshot& snap,
+                              ProbeStats* stats,
+                              bool* present,
+                              int64_t* ttl_micros) const = 0;
+
   virtual ~RowSet() {}
 
   // Return true if this RowSet is available for compaction, based on
@@ -326,6 +378,12 @@ class DuplicatingRowSet : public RowSet {
   Status CheckRowPresent(const RowSetKeyProbe &probe, bool *present,
                          ProbeStats* stats) const OVERRIDE;
 
+  Status ReadTtlValue(const RowSetKeyProbe& probe,
+                      const MvccSnapshot& snap,
+                      ProbeStats* stats,
+                      bool* present,
+                      int64_t* ttl_micros) const OVERRIDE;
+
   virtual Status NewRowIterator(const Schema *projection,
                                 const MvccSnapshot &snap,
                                 OrderMode order,
@@ -404,6 +462,27 @@ class DuplicatingRowSet : public RowSet {
     return Status::OK();
   }
 
+  Status IsDeletedAndAncient(Timestamp /*ancient_history_mark*/, bool* deleted) OVERRIDE {
+    *deleted = false;
+    return Status::OK();
+  }
+
+  bool HasUninitializedRedoDeltas() const OVERRIDE { return false; }
+
+  Status InitRedoDeltas(MonoTime /*deadline*/, int64_t* delta_blocks_initialized) OVERRIDE {
+    if (delta_blocks_initialized) *delta_blocks_initialized = 0;
+    return Status::OK();
+  }
+
+  Status IsExpired(int64_t /*ttl_cutoff_micros*/, bool* expired) const OVERRIDE {
+    *expired = false;
+    return Status::OK();
+  }
+
+  bool SealIfExpired(int64_t /*ttl_cutoff_micros*/) OVERRIDE {
+    return false;
+  }
+
   Status MinorCompactDeltaStores() OVERRIDE { return Status::OK(); }
 
  private:
@@ -92,6 +92,12 @@ Status RowSetMetadata::InitFromPB(const RowSetDataPB& pb) {
     undo_delta_blocks_.push_back(BlockId::FromPB(undo_delta_pb.block()));
   }
 
+  // Load TTL column stats
+  if (pb.has_ttl_column_id()) {
+    ttl_column_id_ = ColumnId(pb.ttl_column_id());
+    max_ttl_value_ = pb.max_ttl_value();
+  }
+
   initted_ = true;
   return Status::OK();
 }
@@ -133,6 +139,12 @@ void RowSetMetadata::ToProtobuf(RowSetDataPB *pb) {
   if (!adhoc_index_block_.IsNull()) {
     adhoc_index_block_.CopyToPB(pb->mutable_adhoc_index_block());
   }
+
+  // Write TTL column stats
+  if (ttl_column_id_ != ColumnId(-1)) {
+    pb->set_ttl_column_id(ttl_column_id_);
+    pb->set_max_ttl_value(max_ttl_value_);
+  }
 }
 
 const std::string RowSetMetadata::ToString() const {
@@ -229,6 +241,10 @@ Status RowSetMetadata::CommitUpdate(const RowSetMetadataUpdate& update) {
       if (UpdateReturnCopy(&blocks_by_col_id_, e.first, e.second, &old_block_id)) {
         removed.push_back(old_block_id);
       }
+      // The new base data may have been updated, so its TTL stats are unknown.
+      if (e.first == ttl_column_id_) {
+        ttl_column_id_ = ColumnId(-1);
+      }
     }
 
     for (ColumnId col_id : update.col_ids_to_remove_) {
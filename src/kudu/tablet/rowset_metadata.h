@@ -106,6 +106,24 @@ class RowSetMetadata {
 
   void SetColumnDataBlocks(const std::map<ColumnId, BlockId>& blocks_by_col_id);
 
+  // Record that no row in the base data has a value greater than 'max_value'
+  // in the TTL column 'col_id'.
+  void SetMaxTtlValue(ColumnId col_id, int64_t max_value) {
+    std::lock_guard<LockType> l(lock_);
+    ttl_column_id_ = col_id;
+    max_ttl_value_ = max_value;
+  }
+
+  // Return the value recorded by SetMaxTtlValue() in 'max_value', or false if
+  // none was recorded for 'col_id', or the column's base data has since been
+  // rewritten.
+  bool GetMaxTtlValue(ColumnId col_id, int64_t* max_value) const {
+    std::lock_guard<LockType> l(lock_);
+    if (ttl_column_id_ != col_id) return false;
+    *max_value = max_ttl_value_;
+    return true;
+  }
+
   Status CommitRedoDeltaDataBlock(int64_t dms_id, const BlockId& block_id);
 
   Status CommitUndoDeltaDataBlock(const BlockId& block_id);
@@ -188,7 +206,9 @@ class RowSetMetadata {
   explicit RowSetMetadata(TabletMetadata *tablet_metadata)
     : tablet_metadata_(tablet_metadata),
       initted_(false),
-      last_durable_redo_dms_id_(kNoDurableMemStore) {
+      last_durable_redo_dms_id_(kNoDurableMemStore),
+      ttl_column_id_(ColumnId(-1)),
+      max_ttl_value_(0) {
   }
 
   RowSetMetadata(TabletMetadata *tablet_metadata,
@@ -196,7 +216,9 @@ class RowSetMetadata {
     : tablet_metadata_(DCHECK_NOTNULL(tablet_metadata)),
       initted_(true),
       id_(id),
-      last_durable_redo_dms_id_(kNoDurableMemStore) {
+      last_durable_redo_dms_id_(kNoDurableMemStore),
+      ttl_column_id_(ColumnId(-1)),
+      max_ttl_value_(0) {
   }
 
   Status InitFromPB(const RowSetDataPB& pb);
@@ -218,6 +240,10 @@ class RowSetMetadata {
 
   int64_t last_durable_redo_dms_id_;
 
+  // TTL column stats of the base data; 'ttl_column_id_' is -1 if unknown.
+  ColumnId ttl_column_id_;
+  int64_t max_ttl_value_;
+
   DISALLOW_COPY_AND_ASSIGN(RowSetMetadata);
 };
 
@@ -34,6 +34,7 @@
 #include <glog/logging.h>
 
 #include "kudu/clock/hybrid_clock.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/generic_iterators.h"
@@ -50,11 +51,14 @@
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/opid.pb.h"
+#include "kudu/fs/data_dirs.h"
+#include "kudu/fs/fs.pb.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/basictypes.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/casts.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/move.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/human_readable.h"
@@ -98,6 +102,14 @@ DEFINE_int32(tablet_compaction_budget_mb, 128,
              "Budget for a single compaction");
 TAG_FLAG(tablet_compaction_budget_mb, experimental);
 
+DEFINE_int32(time_windowed_compaction_hot_window_mb, 1024,
+             "Amount of the most recent data, by key, of a tablet which the "
+             "time-windowed compaction policy may compact. Rowsets below this "
+             "window are sealed and never compacted again. This policy is used "
+             "by the tablets of tables whose first key column is marked with "
+             "'time_windowed_compaction'.");
+TAG_FLAG(time_windowed_compaction_hot_window_mb, experimental);
+
 DEFINE_int32(tablet_bloom_block_size, 4096,
              "Block size of the bloom filters used for tablet keys.");
 TAG_FLAG(tablet_bloom_block_size, advanced);
@@ -118,6 +130,13 @@ DEFINE_double(fault_crash_before_flush_tablet_meta_after_flush_mrs, 0.0,
               "Fraction of the time, while flushing an MRS, to crash before flushing metadata");
 TAG_FLAG(fault_crash_before_flush_tablet_meta_after_flush_mrs, unsafe);
 
+DEFINE_double(tablet_inject_io_error_on_deleted_rowset_gc_fraction, 0.0,
+              "Fraction of the time when dropping ancient deleted or expired rowsets will "
+              "fail with an IOError after sealing them, before flushing the tablet metadata. "
+              "(For testing only!)");
+TAG_FLAG(tablet_inject_io_error_on_deleted_rowset_gc_fraction, unsafe);
+TAG_FLAG(tablet_inject_io_error_on_deleted_rowset_gc_fraction, runtime);
+
 DEFINE_int64(tablet_throttler_rpc_per_sec, 0,
              "Maximum write RPC rate (op/s) allowed for a tablet, write RPC exceeding this "
              "limit will be throttled. 0 means no limit.");
@@ -164,6 +183,14 @@ DEFINE_bool(enable_undo_delta_block_gc, true,
     "To change what is considered ancient history use --tablet_history_max_age_sec");
 TAG_FLAG(enable_undo_delta_block_gc, evolving);
 
+DEFINE_bool(enable_deleted_rowset_gc, true,
+    "Whether to enable garbage collection of rowsets in which every row was "
+    "deleted before the ancient history mark, or whose rows had all expired "
+    "by then according to the table's TTL column. Such rowsets are dropped "
+    "directly instead of waiting for a compaction to rewrite them. "
+    "To change what is considered ancient history use --tablet_history_max_age_sec");
+TAG_FLAG(enable_deleted_rowset_gc, evolving);
+
 METRIC_DEFINE_entity(tablet);
 METRIC_DEFINE_gauge_size(tablet, memrowset_size, "MemRowSet Memory Usage",
                          kudu::MetricUnit::kBytes,
@@ -190,7 +217,20 @@ struct IteratorStats;
 
 namespace tablet {
 
-static CompactionPolicy *CreateCompactionPolicy() {
+// Creates the compaction policy for the tablet with metadata 'metadata', as
+// chosen by its schema.
+static CompactionPolicy *CreateCompactionPolicy(TabletMetadata* metadata) {
+  if (metadata->schema().time_windowed_compaction()) {
+    // The sealed key range is persisted along with the tablet's rowsets, so
+    // that rowsets sealed before a restart stay sealed.
+    return new TimeWindowedCompactionPolicy(
+        FLAGS_tablet_compaction_budget_mb,
+        FLAGS_time_windowed_compaction_hot_window_mb,
+        metadata->compaction_sealed_key(),
+        [metadata](const string& sealed_key) {
+          metadata->set_compaction_sealed_key(sealed_key);
+        });
+  }
   return new BudgetedCompactionPolicy(FLAGS_tablet_compaction_budget_mb);
 }
 
@@ -218,9 +258,10 @@ Tablet::Tablet(const scoped_refptr<TabletMetadata>& metadata,
     next_mrs_id_(0),
     clock_(clock),
     rowsets_flush_sem_(1),
+    num_bulk_presence_checks_(0),
     state_(kInitialized) {
       CHECK(schema()->has_column_ids());
-  compaction_policy_.reset(CreateCompactionPolicy());
+  compaction_policy_.reset(CreateCompactionPolicy(metadata_.get()));
 
   if (metric_registry) {
     MetricEntity::AttributeMap attrs;
@@ -244,6 +285,11 @@ Tablet::Tablet(const scoped_refptr<TabletMetadata>& metadata,
                                    FLAGS_tablet_throttler_bytes_per_sec,
                                    FLAGS_tablet_throttler_burst_factor));
   }
+
+  DataDirGroupPB data_dir_group;
+  if (metadata_->fs_manager()->dd_manager()->GetDataDirGroupPB(tablet_id(), &data_dir_group)) {
+    data_dir_uuids_.assign(data_dir_group.uuids().begin(), data_dir_group.uuids().end());
+  }
 }
 
 Tablet::~Tablet() {
@@ -533,19 +579,10 @@ Status Tablet::InsertOrUpsertUnlocked(WriteTransactionState *tx_state,
   DCHECK(op->checked_present);
   DCHECK(op->validated);
 
-  const bool is_upsert = op->decoded_op.type == RowOperationsPB::UPSERT;
   const TabletComponents* comps = DCHECK_NOTNULL(tx_state->tablet_components());
 
   if (op->present_in_rowset) {
-    if (is_upsert) {
-      return ApplyUpsertAsUpdate(tx_state, op, op->present_in_rowset, stats);
-    }
-    Status s = Status::AlreadyPresent("key already present");
-    if (metrics_) {
-      metrics_->insertions_failed_dup_key->Increment();
-    }
-    op->SetFailed(s);
-    return s;
+    return InsertOrUpsertPresentUnlocked(tx_state, op, op->present_in_rowset, stats);
   }
 
   Timestamp ts = tx_state->timestamp();
@@ -561,18 +598,37 @@ Status Tablet::InsertOrUpsertUnlocked(WriteTransactionState *tx_state,
     op->SetInsertSucceeded(comps->memrowset->mrs_id());
   } else {
     if (s.IsAlreadyPresent()) {
-      if (is_upsert) {
-        return ApplyUpsertAsUpdate(tx_state, op, comps->memrowset.get(), stats);
-      }
-      if (metrics_) {
-        metrics_->insertions_failed_dup_key->Increment();
-      }
+      return InsertOrUpsertPresentUnlocked(tx_state, op, comps->memrowset.get(), stats);
     }
     op->SetFailed(s);
   }
   return s;
 }
 
+Status Tablet::InsertOrUpsertPresentUnlocked(WriteTransactionState *tx_state,
+                                             RowOp* op,
+                                             RowSet* rowset,
+                                             ProbeStats* stats) {
+  bool expired = false;
+  Status s = CheckRowExpiredUnlocked(tx_state, *op, rowset, stats, &expired);
+  if (PREDICT_FALSE(!s.ok())) {
+    op->SetFailed(s);
+    return s;
+  }
+  if (expired) {
+    return ReplaceExpiredRow(tx_state, op, rowset, stats);
+  }
+  if (op->decoded_op.type == RowOperationsPB::UPSERT) {
+    return ApplyUpsertAsUpdate(tx_state, op, rowset, stats);
+  }
+  s = Status::AlreadyPresent("key already present");
+  if (metrics_) {
+    metrics_->insertions_failed_dup_key->Increment();
+  }
+  op->SetFailed(s);
+  return s;
+}
+
 Status Tablet::ApplyUpsertAsUpdate(WriteTransactionState* tx_state,
                                    RowOp* upsert,
                                    RowSet* rowset,
@@ -620,6 +676,98 @@ Status Tablet::ApplyUpsertAsUpdate(WriteTransactionState* tx_state,
   return s;
 }
 
+Status Tablet::ReplaceExpiredRow(WriteTransactionState* tx_state,
+                                 RowOp* op,
+                                 RowSet* rowset,
+                                 ProbeStats* stats) {
+  // Unlike ApplyUpsertAsUpdate(), every column is overwritten, including
+  // those left unset by the op: the decoder already filled in their defaults.
+  const auto* schema = this->schema();
+  ConstContiguousRow row(schema, op->decoded_op.row_data);
+  faststring buf;
+  RowChangeListEncoder enc(&buf);
+  for (int i = schema->num_key_columns(); i < schema->num_columns(); i++) {
+    const auto& c = schema->column(i);
+    const void* val = c.is_nullable() ? row.nullable_cell_ptr(i) : row.cell_ptr(i);
+    enc.AddColumnUpdate(c, schema->column_id(i), val);
+  }
+
+  // If the table only has key columns, the row is already as inserted. Its
+  // TTL value is part of the key, so it remains expired either way.
+  gscoped_ptr<OperationResultPB> result(new OperationResultPB());
+  if (enc.is_empty()) {
+    op->SetMutateSucceeded(std::move(result));
+    return Status::OK();
+  }
+
+  Status s = rowset->MutateRow(tx_state->timestamp(),
+                               *op->key_probe,
+                               enc.as_changelist(),
+                               tx_state->op_id(),
+                               stats,
+                               result.get());
+  if (s.ok()) {
+    op->SetMutateSucceeded(std::move(result));
+    return s;
+  }
+  if (s.IsNotFound()) {
+    // The row was deleted since its presence was checked, e.g. by an earlier
+    // op in this batch, so it can only live on in the MemRowSet. A rowset
+    // sealed for being dropped fails with ServiceUnavailable instead, so the
+    // op can be retried once the drop is durable.
+    const TabletComponents* comps = DCHECK_NOTNULL(tx_state->tablet_components());
+    DCHECK_NE(rowset, comps->memrowset.get());
+    s = comps->memrowset->Insert(tx_state->timestamp(), row, tx_state->op_id());
+    if (s.ok()) {
+      op->SetInsertSucceeded(comps->memrowset->mrs_id());
+      return s;
+    }
+  }
+  op->SetFailed(s);
+  return s;
+}
+
+Status Tablet::CheckRowExpiredUnlocked(const WriteTransactionState* tx_state,
+                                       const RowOp& op,
+                                       const RowSet* rowset,
+                                       ProbeStats* stats,
+                                       bool* expired) {
+  *expired = false;
+  int64_t ttl_cutoff_micros;
+  if (!GetTtlCutoff(tx_state->timestamp(), &ttl_cutoff_micros)) {
+    return Status::OK();
+  }
+  const Schema* schema = this->schema();
+  int ttl_col_idx = schema->ttl_column_idx();
+  const ConstContiguousRow& key = op.key_probe->row_key();
+  if (schema->is_key_column(ttl_col_idx)) {
+    *expired = *reinterpret_cast<const int64_t*>(key.cell_ptr(ttl_col_idx)) < ttl_cutoff_micros;
+    return Status::OK();
+  }
+
+  // Include the transaction's own timestamp, so that earlier ops in the same
+  // batch are seen. Other transactions that wrote the row before this one
+  // took its lock are committed, and later ones can't have written it yet.
+  MvccSnapshot snap(Timestamp(tx_state->timestamp().value() + 1));
+  bool present;
+  int64_t ttl_value;
+  RETURN_NOT_OK(rowset->ReadTtlValue(*op.key_probe, snap, stats, &present, &ttl_value));
+  *expired = present && ttl_value < ttl_cutoff_micros;
+  return Status::OK();
+}
+
+bool Tablet::IsStoreInLoggedResult(const OperationResultPB& orig_result,
+                                   const RowSet* rs,
+                                   const TabletComponents* comps) {
+  for (const auto& store : orig_result.mutated_stores()) {
+    if (store.has_mrs_id() ? rs == comps->memrowset.get() :
+                             rs == comps->rowsets->drs_by_id(store.rs_id())) {
+      return true;
+    }
+  }
+  return false;
+}
+
 vector<RowSet*> Tablet::FindRowSetsToCheck(const RowOp* op,
                                            const TabletComponents* comps) {
   vector<RowSet*> to_check;
@@ -713,9 +861,9 @@ void Tablet::BulkCheckPresence(WriteTransactionState* tx_state) {
   keys_and_indexes.reserve(num_ops);
   for (int i = 0; i < num_ops; i++) {
     RowOp* op = row_ops_base[i];
-    // If the op already failed in validation, or if we've got the original result
-    // filled in already during replay, then we don't need to consult the RowSetTree.
-    if (op->has_result() || op->orig_result_from_log_) continue;
+    // If the op already failed in validation, or was skipped during replay,
+    // then we don't need to consult the RowSetTree.
+    if (op->has_result()) continue;
     keys_and_indexes.emplace_back(op->key_probe->encoded_key_slice(), i);
   }
 
@@ -762,6 +910,7 @@ void Tablet::BulkCheckPresence(WriteTransactionState* tx_state) {
   // RowSet) one at a time. So, the callback itself aggregates results into
   // 'pending_group' and then calls 'ProcessPendingGroup' when the next group
   // begins.
+  const TabletComponents* comps = DCHECK_NOTNULL(tx_state->tablet_components());
   vector<pair<RowSet*, int>> pending_group;
   const auto& ProcessPendingGroup = [&]() {
     if (pending_group.empty()) return;
@@ -785,6 +934,12 @@ void Tablet::BulkCheckPresence(WriteTransactionState* tx_state) {
         // Already found this op present somewhere.
         continue;
       }
+      if (PREDICT_FALSE(op->orig_result_from_log_) &&
+          !IsStoreInLoggedResult(*op->orig_result_from_log_, rs, comps)) {
+        // A replayed op may only be applied to the stores that it was applied
+        // to originally (see FindRowSetsToCheck()).
+        continue;
+      }
 
       // TODO(todd) is CHECK_OK correct? it used to be that errors here
       // would just be silently ignored, so this seems at least an improvement.
@@ -797,7 +952,6 @@ void Tablet::BulkCheckPresence(WriteTransactionState* tx_state) {
     pending_group.clear();
   };
 
-  const TabletComponents* comps = DCHECK_NOTNULL(tx_state->tablet_components());
   comps->rowsets->ForEachRowSetContainingKeys(
       keys,
       [&](RowSet* rs, int i) {
@@ -815,15 +969,17 @@ void Tablet::BulkCheckPresence(WriteTransactionState* tx_state) {
   for (auto& p : keys_and_indexes) {
     row_ops_base[p.second]->checked_present = true;
   }
+  num_bulk_presence_checks_.IncrementBy(keys_and_indexes.size());
 }
 
 void Tablet::ApplyRowOperations(WriteTransactionState* tx_state) {
+  DCHECK(tx_state->tablet_components()) << "StartApplying() must be called first";
   int num_ops = tx_state->row_ops().size();
 
-  StartApplying(tx_state);
-
-  // Validate all of the ops.
+  // Validate all of the ops, skipping those which already have a result
+  // (e.g. those that were skipped during log replay).
   for (RowOp* op : tx_state->row_ops()) {
+    if (op->has_result()) continue;
     ValidateOpOrMarkFailed(op);
   }
 
@@ -979,6 +1135,18 @@ HistoryGcOpts Tablet::GetHistoryGcOpts() const {
   return HistoryGcOpts::Disabled();
 }
 
+bool Tablet::GetTtlCutoff(Timestamp timestamp, int64_t* ttl_cutoff_micros) const {
+  const Schema* s = schema();
+  int ttl_col_idx = s->ttl_column_idx();
+  // Timestamps of a logical clock carry no time to compare TTL values with.
+  if (ttl_col_idx == Schema::kColumnNotFound || !clock_->HasPhysicalComponent()) {
+    return false;
+  }
+  *ttl_cutoff_micros = HybridClock::GetPhysicalValueMicros(timestamp) -
+      s->column(ttl_col_idx).attributes().ttl_seconds * 1000000LL;
+  return true;
+}
+
 Status Tablet::Flush() {
   TRACE_EVENT1("tablet", "Tablet::Flush", "id", tablet_id());
   std::lock_guard<Semaphore> lock(rowsets_flush_sem_);
@@ -1117,6 +1285,7 @@ Status Tablet::AlterSchema(AlterSchemaTransactionState *tx_state) {
                         << " to " << tx_state->schema()->ToString()
                         << " version " << tx_state->schema_version();
   DCHECK(schema_lock_.is_locked());
+  bool was_time_windowed = schema()->time_windowed_compaction();
   metadata_->SetSchema(*tx_state->schema(), tx_state->schema_version());
   if (tx_state->has_new_table_name()) {
     metadata_->SetTableName(tx_state->new_table_name());
@@ -1125,6 +1294,15 @@ Status Tablet::AlterSchema(AlterSchemaTransactionState *tx_state) {
     }
   }
 
+  // The schema chooses the compaction policy.
+  if (schema()->time_windowed_compaction() != was_time_windowed) {
+    std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
+    if (!schema()->time_windowed_compaction()) {
+      metadata_->set_compaction_sealed_key("");
+    }
+    compaction_policy_.reset(CreateCompactionPolicy(metadata_.get()));
+  }
+
   // If the current schema and the new one are equal, there is nothing to do.
   if (same_schema) {
     return metadata_->Flush();
@@ -1290,6 +1468,12 @@ void Tablet::RegisterMaintenanceOps(MaintenanceManager* maint_mgr) {
     maint_mgr->RegisterOp(undo_delta_block_gc_op.get());
     maintenance_ops_.push_back(undo_delta_block_gc_op.release());
   }
+
+  if (FLAGS_enable_deleted_rowset_gc) {
+    gscoped_ptr<MaintenanceOp> deleted_rowset_gc_op(new DeletedRowSetGCOp(this));
+    maint_mgr->RegisterOp(deleted_rowset_gc_op.get());
+    maintenance_ops_.push_back(deleted_rowset_gc_op.release());
+  }
 }
 
 void Tablet::UnregisterMaintenanceOps() {
@@ -1340,8 +1524,14 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   shared_ptr<CompactionInput> merge;
   RETURN_NOT_OK(input.CreateCompactionInput(flush_snap, schema(), &merge));
 
+  uint64_t target_rowset_size;
+  {
+    // The policy may be replaced by AlterSchema().
+    std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
+    target_rowset_size = compaction_policy_->target_rowset_size();
+  }
   RollingDiskRowSetWriter drsw(metadata_.get(), merge->schema(), DefaultBloomSizing(),
-                               compaction_policy_->target_rowset_size());
+                               target_rowset_size);
   RETURN_NOT_OK_PREPEND(drsw.Open(), "Failed to open DiskRowSet for flush");
 
   HistoryGcOpts history_gc_opts = GetHistoryGcOpts();
@@ -1562,7 +1752,7 @@ void Tablet::UpdateCompactionStats(MaintenanceOpStats* stats) {
   // been in the last 5 minutes, and somehow scale the compaction quality
   // based on that, so we favor hot tablets.
   double quality = 0;
-  unordered_set<RowSet*> picked_set_ignored;
+  unordered_set<RowSet*> picked_set;
 
   shared_ptr<RowSetTree> rowsets_copy;
   {
@@ -1572,7 +1762,7 @@ void Tablet::UpdateCompactionStats(MaintenanceOpStats* stats) {
 
   {
     std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
-    WARN_NOT_OK(compaction_policy_->PickRowSets(*rowsets_copy, &picked_set_ignored, &quality, NULL),
+    WARN_NOT_OK(compaction_policy_->PickRowSets(*rowsets_copy, &picked_set, &quality, NULL),
                 Substitute("Couldn't determine compaction quality for $0", tablet_id()));
   }
 
@@ -1580,6 +1770,21 @@ void Tablet::UpdateCompactionStats(MaintenanceOpStats* stats) {
 
   stats->set_runnable(quality >= 0);
   stats->set_perf_improvement(quality);
+
+  // A merge compaction reads its input rowsets and writes about as much back.
+  int64_t picked_bytes = 0;
+  for (const RowSet* rs : picked_set) {
+    picked_bytes += rs->OnDiskDataSizeNoUndos();
+  }
+  SetExpectedIOStats(picked_bytes, picked_bytes, stats);
+}
+
+void Tablet::SetExpectedIOStats(int64_t read_bytes,
+                                int64_t write_bytes,
+                                MaintenanceOpStats* stats) const {
+  stats->set_expected_read_bytes(read_bytes);
+  stats->set_expected_write_bytes(write_bytes);
+  stats->set_data_dirs(data_dir_uuids_);
 }
 
 
@@ -1617,6 +1822,27 @@ Status Tablet::CaptureConsistentIterators(
   RETURN_NOT_OK(components_->memrowset->NewRowIterator(projection, snap, order, &ms_iter));
   ret.push_back(shared_ptr<RowwiseIterator>(ms_iter.release()));
 
+  // If the scan has a lower bound on the TTL column (as every scan of a table
+  // with a TTL does), cull the rowsets that are expired as of that bound.
+  bool has_ttl_bound = false;
+  int64_t ttl_lower_bound = 0;
+  int ttl_col_idx = schema()->ttl_column_idx();
+  if (spec != nullptr && ttl_col_idx != Schema::kColumnNotFound) {
+    const ColumnPredicate* pred = FindOrNull(spec->predicates(),
+                                             schema()->column(ttl_col_idx).name());
+    if (pred != nullptr && pred->raw_lower() != nullptr) {
+      has_ttl_bound = true;
+      ttl_lower_bound = *static_cast<const int64_t*>(pred->raw_lower());
+    }
+  }
+  auto is_culled = [&](const RowSet* rs, bool* culled) -> Status {
+    *culled = false;
+    if (has_ttl_bound) {
+      RETURN_NOT_OK(rs->IsExpired(ttl_lower_bound, culled));
+    }
+    return Status::OK();
+  };
+
   // Cull row-sets in the case of key-range queries.
   if (spec != nullptr && spec->lower_bound_key() && spec->exclusive_upper_bound_key()) {
     // TODO : support open-ended intervals
@@ -1629,6 +1855,9 @@ Status Tablet::CaptureConsistentIterators(
         spec->exclusive_upper_bound_key()->encoded_key(),
         &interval_sets);
     for (const RowSet *rs : interval_sets) {
+      bool culled;
+      RETURN_NOT_OK(is_culled(rs, &culled));
+      if (culled) continue;
       gscoped_ptr<RowwiseIterator> row_it;
       RETURN_NOT_OK_PREPEND(rs->NewRowIterator(projection, snap, order, &row_it),
                             Substitute("Could not create iterator for rowset $0",
@@ -1642,6 +1871,9 @@ Status Tablet::CaptureConsistentIterators(
   // If there are no encoded predicates or they represent an open-ended range, then
   // fall back to grabbing all rowset iterators
   for (const shared_ptr<RowSet> &rs : components_->rowsets->all_rowsets()) {
+    bool culled;
+    RETURN_NOT_OK(is_culled(rs.get(), &culled));
+    if (culled) continue;
     gscoped_ptr<RowwiseIterator> row_it;
     RETURN_NOT_OK_PREPEND(rs->NewRowIterator(projection, snap, order, &row_it),
                           Substitute("Could not create iterator for rowset $0",
@@ -2042,6 +2274,116 @@ Status Tablet::DeleteAncientUndoDeltas(int64_t* blocks_deleted, int64_t* bytes_d
   return Status::OK();
 }
 
+Status Tablet::EstimateBytesInDeletedAncientRowSets(int64_t* bytes) {
+  DCHECK(bytes);
+  *bytes = 0;
+
+  Timestamp ancient_history_mark;
+  if (!Tablet::GetTabletAncientHistoryMark(&ancient_history_mark)) return Status::OK();
+  // Rows are only dropped once they have expired as of the ancient history
+  // mark, so that no valid snapshot scan could still return them.
+  int64_t ttl_cutoff_micros = 0;
+  bool has_ttl = GetTtlCutoff(ancient_history_mark, &ttl_cutoff_micros);
+
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  int64_t tablet_bytes = 0;
+  for (const auto& rowset : comps->rowsets->all_rowsets()) {
+    bool deleted;
+    RETURN_NOT_OK(rowset->IsDeletedAndAncient(ancient_history_mark, &deleted));
+    if (!deleted && has_ttl) {
+      RETURN_NOT_OK(rowset->IsExpired(ttl_cutoff_micros, &deleted));
+    }
+    if (deleted || rowset->HasUninitializedRedoDeltas()) {
+      tablet_bytes += rowset->OnDiskSize();
+    }
+  }
+
+  metrics_->deleted_rowset_estimated_retained_bytes->set_value(tablet_bytes);
+  *bytes = tablet_bytes;
+  return Status::OK();
+}
+
+Status Tablet::InitRedoDeltasForDeletedRowSetGC(MonoDelta time_budget) {
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  MonoTime deadline = time_budget.Initialized() ? MonoTime::Now() + time_budget : MonoTime();
+  for (const auto& rowset : comps->rowsets->all_rowsets()) {
+    if (deadline.Initialized() && MonoTime::Now() >= deadline) break;
+    RETURN_NOT_OK(rowset->InitRedoDeltas(deadline, nullptr));
+  }
+  return Status::OK();
+}
+
+Status Tablet::DeleteAncientDeletedRowSets(int64_t* rowsets_deleted, int64_t* bytes_deleted) {
+  Timestamp ancient_history_mark;
+  if (!Tablet::GetTabletAncientHistoryMark(&ancient_history_mark)) return Status::OK();
+  int64_t ttl_cutoff_micros = 0;
+  bool has_ttl = GetTtlCutoff(ancient_history_mark, &ttl_cutoff_micros);
+
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  // As with a compaction, we need to hold the compact_flush_lock of each
+  // rowset we drop, so that no flush or compaction races with its removal.
+  RowSetVector rowsets_to_delete;
+  vector<std::unique_lock<std::mutex>> rowset_locks;
+  int64_t tablet_bytes_deleted = 0;
+  {
+    std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
+    for (const auto& rowset : comps->rowsets->all_rowsets()) {
+      if (!rowset->IsAvailableForCompaction()) {
+        continue;
+      }
+      bool deleted;
+      bool expired = false;
+      RETURN_NOT_OK(rowset->IsDeletedAndAncient(ancient_history_mark, &deleted));
+      if (!deleted && has_ttl) {
+        RETURN_NOT_OK(rowset->IsExpired(ttl_cutoff_micros, &expired));
+      }
+      if (!deleted && !expired) {
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(*rowset->compact_flush_lock(), std::try_to_lock);
+      CHECK(lock.owns_lock()) << rowset->ToString() << " unable to lock compact_flush_lock";
+
+      // Unlike deleted rows, expired rows can still be updated, which could
+      // make them live again. Seal the rowset against writes first; this fails
+      // if an update slipped in since the check above. Writes to a sealed
+      // rowset fail until it's dropped. If the drop fails, the rowset stays
+      // sealed, and a later run of this method retries it.
+      if (!deleted && !rowset->SealIfExpired(ttl_cutoff_micros)) {
+        continue;
+      }
+      tablet_bytes_deleted += rowset->OnDiskSize();
+      rowsets_to_delete.push_back(rowset);
+      rowset_locks.push_back(std::move(lock));
+    }
+  }
+
+  if (!rowsets_to_delete.empty()) {
+    LOG_WITH_PREFIX(INFO) << Substitute("Dropping $0 rowsets ($1) whose rows were all deleted "
+                                        "or expired before the ancient history mark",
+                                        rowsets_to_delete.size(),
+                                        HumanReadableNumBytes::ToString(tablet_bytes_deleted));
+    MAYBE_RETURN_FAILURE(FLAGS_tablet_inject_io_error_on_deleted_rowset_gc_fraction,
+                         Status::IOError("Injected IOError in "
+                                         "Tablet::DeleteAncientDeletedRowSets()"));
+    // No rows survive, so this is handled exactly like a compaction whose
+    // output is empty: the rowsets are removed from the tablet metadata and
+    // swapped out of the tablet's components.
+    RETURN_NOT_OK(HandleEmptyCompactionOrFlush(rowsets_to_delete,
+                                               TabletMetadata::kNoMrsFlushed));
+    metrics_->deleted_rowset_gc_bytes_deleted->IncrementBy(tablet_bytes_deleted);
+  }
+
+  if (rowsets_deleted) *rowsets_deleted = rowsets_to_delete.size();
+  if (bytes_deleted) *bytes_deleted = tablet_bytes_deleted;
+  return Status::OK();
+}
+
 int64_t Tablet::CountUndoDeltasForTests() const {
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
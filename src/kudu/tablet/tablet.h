@@ -41,6 +41,7 @@
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/tablet_mem_trackers.h"
 #include "kudu/tablet/tablet_metadata.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/bloom_filter.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
@@ -72,6 +73,7 @@ class AlterSchemaTransactionState;
 class CompactionPolicy;
 class HistoryGcOpts;
 class MemRowSet;
+class OperationResultPB;
 struct RowOp;
 class RowSetsInCompaction;
 class RowSetTree;
@@ -156,7 +158,10 @@ class Tablet {
   // Signal that the given transaction is about to Apply.
   void StartApplying(WriteTransactionState* tx_state);
 
-  // Apply all of the row operations associated with this transaction.
+  // Apply all of the row operations associated with this transaction. Ops
+  // which already have a result are skipped.
+  //
+  // REQUIRES: StartApplying() was called.
   void ApplyRowOperations(WriteTransactionState* tx_state);
 
   // Apply a single row operation, which must already be prepared.
@@ -224,6 +229,12 @@ class Tablet {
   // Update the statistics for performing a compaction.
   void UpdateCompactionStats(MaintenanceOpStats* stats);
 
+  // Set the data directories and the expected amount of I/O of a maintenance
+  // op which reads 'read_bytes' and writes 'write_bytes' of this tablet's data.
+  void SetExpectedIOStats(int64_t read_bytes,
+                          int64_t write_bytes,
+                          MaintenanceOpStats* stats) const;
+
   // Returns the exact current size of the MRS, in bytes. A value greater than 0 doesn't imply
   // that the MRS has data, only that it has allocated that amount of memory.
   // This method takes a read lock on component_lock_ and is thread-safe.
@@ -300,10 +311,38 @@ class Tablet {
   Status DeleteAncientUndoDeltas(int64_t* blocks_deleted = nullptr,
                                  int64_t* bytes_deleted = nullptr);
 
+  // Count the on-disk bytes of the rowsets in which every row was deleted
+  // prior to the current ancient history mark, or had expired according to
+  // the schema's TTL column as of that mark. See RowSet::IsDeletedAndAncient()
+  // and RowSet::IsExpired().
+  //
+  // Rowsets whose REDO delta stores have not all been initialized may be
+  // deleted too, so they are counted as well. This may be an overestimate.
+  Status EstimateBytesInDeletedAncientRowSets(int64_t* bytes);
+
+  // Initialize REDO delta blocks for up to 'time_budget' amount of time, so
+  // that DeleteAncientDeletedRowSets() can tell which rowsets are deleted.
+  // If 'time_budget' is not Initialized() then there is no time limit.
+  Status InitRedoDeltasForDeletedRowSetGC(MonoDelta time_budget);
+
+  // Find and drop all rowsets in which every row was deleted, or had expired,
+  // prior to the current ancient history mark. Such rowsets are removed from
+  // the tablet metadata directly, without being rewritten by a compaction. If
+  // this method returns OK, the number of rowsets and bytes deleted are
+  // returned in the out-parameters.
+  Status DeleteAncientDeletedRowSets(int64_t* rowsets_deleted = nullptr,
+                                     int64_t* bytes_deleted = nullptr);
+
   // Count the number of deltas in the tablet. Only used for tests.
   int64_t CountUndoDeltasForTests() const;
   int64_t CountRedoDeltasForTests() const;
 
+  // Return the number of row keys whose presence has been checked in bulk by
+  // BulkCheckPresence(). Only used for tests.
+  int64_t num_bulk_presence_checks_for_tests() const {
+    return num_bulk_presence_checks_.Load();
+  }
+
   // Return the current number of rowsets in the tablet.
   size_t num_rowsets() const;
 
@@ -361,6 +400,16 @@ class Tablet {
   // Calculates history GC options based on properties of the Clock implementation.
   HistoryGcOpts GetHistoryGcOpts() const;
 
+  // Calculates the time, in microseconds since the epoch, before which values
+  // of the schema's TTL column are expired as of 'timestamp', and returns true
+  // iff the schema has a TTL column and the clock is a hybrid clock. Rows
+  // with older values must not be returned by a scan at 'timestamp'.
+  //
+  // The cutoff is always derived from the physical component of 'timestamp',
+  // so that scans, writes and GC agree on which rows are expired. Timestamps
+  // of a logical clock carry no time, so rows never expire with one.
+  bool GetTtlCutoff(Timestamp timestamp, int64_t* ttl_cutoff_micros) const WARN_UNUSED_RESULT;
+
   // Method used by tests to retrieve all rowsets of this table. This
   // will be removed once code for selecting the appropriate RowSet is
   // finished and delta files is finished is part of Tablet class.
@@ -437,6 +486,14 @@ class Tablet {
                            RowOp* mutate,
                            ProbeStats* stats);
 
+  // Handles an INSERT or UPSERT whose row key is already present in 'rowset':
+  // fails the INSERT, converts the UPSERT into an UPDATE, or replaces the
+  // existing row if it has expired.
+  Status InsertOrUpsertPresentUnlocked(WriteTransactionState *tx_state,
+                                       RowOp* op,
+                                       RowSet* rowset,
+                                       ProbeStats* stats);
+
   // In the case of an UPSERT against a duplicate row, converts the UPSERT
   // into an internal UPDATE operation and performs it.
   Status ApplyUpsertAsUpdate(WriteTransactionState *tx_state,
@@ -444,14 +501,45 @@ class Tablet {
                              RowSet* rowset,
                              ProbeStats* stats);
 
+  // In the case of an INSERT or UPSERT against an expired row, overwrites
+  // every non-key column of the existing row with the op's values, as if the
+  // row had been absent. The row is instead inserted into the MemRowSet if
+  // it has meanwhile been deleted from 'rowset'.
+  Status ReplaceExpiredRow(WriteTransactionState *tx_state,
+                           RowOp* op,
+                           RowSet* rowset,
+                           ProbeStats* stats);
+
+  // Determines whether the row with the key of 'op' in 'rowset' has expired
+  // as of the transaction's timestamp. If the row is not found, 'expired' is
+  // set to false. Unless the TTL column is part of the key, the TTL value is
+  // read with a point lookup in 'rowset', which is accounted for in 'stats'.
+  //
+  // This is only called once an INSERT or UPSERT has found its key to be
+  // present, so writes to new keys, UPDATEs and DELETEs don't pay for it. The
+  // row is read as of the transaction's timestamp so that the outcome is the
+  // same when the op is replayed during bootstrap.
+  Status CheckRowExpiredUnlocked(const WriteTransactionState* tx_state,
+                                 const RowOp& op,
+                                 const RowSet* rowset,
+                                 ProbeStats* stats,
+                                 bool* expired);
+
   // Return the list of RowSets that need to be consulted when processing the
   // given insertion or mutation.
   static std::vector<RowSet*> FindRowSetsToCheck(const RowOp* op,
                                                  const TabletComponents* comps);
 
+  // Returns true if 'rs' is one of the stores which a replayed op was applied
+  // to, according to its result from the log, 'orig_result'.
+  static bool IsStoreInLoggedResult(const OperationResultPB& orig_result,
+                                    const RowSet* rs,
+                                    const TabletComponents* comps);
+
   // For each of the operations in 'tx_state', check for the presence of their
   // row keys in the RowSets in the current RowSetTree (as determined by the transaction's
-  // captured TabletComponents).
+  // captured TabletComponents). Ops replayed from the log are only checked
+  // against the stores they were originally applied to.
   void BulkCheckPresence(WriteTransactionState* tx_state);
 
   // Capture a set of iterators which, together, reflect all of the data in the tablet.
@@ -587,6 +675,10 @@ class Tablet {
 
   std::unique_ptr<Throttler> throttler_;
 
+  // UUIDs of the data directories in this tablet's data dir group, or empty
+  // if the group is unknown.
+  std::vector<std::string> data_dir_uuids_;
+
   int64_t next_mrs_id_;
 
   // A pointer to the server's clock.
@@ -595,6 +687,8 @@ class Tablet {
   MvccManager mvcc_;
   LockManager lock_manager_;
 
+  // The compaction policy, as chosen by the schema. Protected by
+  // 'compact_select_lock_', since altering the schema may replace it.
   gscoped_ptr<CompactionPolicy> compaction_policy_;
 
   // Lock protecting the selection of rowsets for compaction.
@@ -607,6 +701,9 @@ class Tablet {
   // started earlier completes after the one started later.
   mutable Semaphore rowsets_flush_sem_;
 
+  // The number of row keys checked by BulkCheckPresence(), for tests.
+  AtomicInt<int64_t> num_bulk_presence_checks_;
+
   enum State {
     kInitialized,
     kBootstrapping,
@@ -28,6 +28,7 @@
 #include <vector>
 
 #include <boost/optional/optional.hpp>
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -83,6 +84,8 @@ using std::string;
 using std::unique_ptr;
 using std::vector;
 
+DECLARE_int64(tablet_bootstrap_log_prefetch_bytes);
+
 namespace kudu {
 
 class MemTracker;
@@ -266,6 +269,58 @@ TEST_F(BootstrapTest, TestBootstrapHighOpIdIndex) {
   ASSERT_OPID_EQ(last_opid, boot_info.last_committed_id);
 }
 
+// Test that replay produces the same results regardless of how far ahead of
+// it the log is read.
+TEST_F(BootstrapTest, TestBootstrapLogPrefetching) {
+  const int kNumSegments = 3;
+  const int kEntriesPerSegment = 10;
+  ASSERT_OK(BuildLog());
+  for (int i = 0; i < kNumSegments; i++) {
+    AppendReplicateBatchAndCommitEntryPairsToLog(kEntriesPerSegment);
+    ASSERT_OK(RollLog());
+  }
+
+  OpId last_opid;
+  last_opid.set_term(1);
+  last_opid.set_index(current_index_ - 1);
+
+  // Bootstrap with prefetching disabled, then with the smallest possible
+  // prefetch buffer, which keeps the reader waiting on replay, and then with
+  // the default buffer. Each bootstrap replays the log rewritten by the last.
+  for (int64_t prefetch_bytes : { 0, 1, 64 * 1024 * 1024 }) {
+    SCOPED_TRACE(prefetch_bytes);
+    FLAGS_tablet_bootstrap_log_prefetch_bytes = prefetch_bytes;
+    shared_ptr<Tablet> tablet;
+    ConsensusBootstrapInfo boot_info;
+    ASSERT_OK(BootstrapTestTablet(-1, -1, &tablet, &boot_info));
+    ASSERT_OPID_EQ(last_opid, boot_info.last_id);
+    ASSERT_OPID_EQ(last_opid, boot_info.last_committed_id);
+
+    vector<string> results;
+    IterateTabletRows(tablet.get(), &results);
+    ASSERT_EQ(kNumSegments * kEntriesPerSegment, results.size());
+  }
+}
+
+// Test that replayed ops have their presence checked in bulk, rather than
+// one op at a time.
+TEST_F(BootstrapTest, TestReplayBulkChecksPresence) {
+  const int kNumBatches = 5;
+  ASSERT_OK(BuildLog());
+  AppendReplicateBatchAndCommitEntryPairsToLog(kNumBatches);
+
+  shared_ptr<Tablet> tablet;
+  ConsensusBootstrapInfo boot_info;
+  ASSERT_OK(BootstrapTestTablet(-1, -1, &tablet, &boot_info));
+
+  // Each batch has one insert into the MRS, which is replayed, and one
+  // mutation of a DRS that no longer exists, which is skipped.
+  ASSERT_EQ(kNumBatches, tablet->num_bulk_presence_checks_for_tests());
+  vector<string> results;
+  IterateTabletRows(tablet.get(), &results);
+  ASSERT_EQ(kNumBatches, results.size());
+}
+
 // Tests attempting a local bootstrap of a tablet that was in the middle of a
 // tablet copy before "crashing".
 TEST_F(BootstrapTest, TestIncompleteTabletCopy) {
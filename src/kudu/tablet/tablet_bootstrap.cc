@@ -77,16 +77,19 @@
 #include "kudu/tablet/transactions/write_transaction.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_admin.pb.h"
+#include "kudu/util/blocking_queue.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/env.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/thread.h"
 
 
 DECLARE_int32(group_commit_queue_size_bytes);
@@ -101,6 +104,16 @@ DEFINE_double(fault_crash_during_log_replay, 0.0,
               "(For testing only!)");
 TAG_FLAG(fault_crash_during_log_replay, unsafe);
 
+DEFINE_int64(tablet_bootstrap_log_prefetch_bytes, 64 * 1024 * 1024,
+             "Maximum number of bytes of log entries that may be read and decoded "
+             "ahead of log replay during tablet bootstrap. Reading is done on a "
+             "separate thread so that it overlaps with replay. If 0, log entries "
+             "are read on the replaying thread.");
+DEFINE_validator(tablet_bootstrap_log_prefetch_bytes,
+                 [](const char* /*n*/, int64_t v) { return v >= 0; });
+TAG_FLAG(tablet_bootstrap_log_prefetch_bytes, advanced);
+TAG_FLAG(tablet_bootstrap_log_prefetch_bytes, experimental);
+
 DECLARE_int32(max_clock_sync_error_usec);
 
 namespace kudu {
@@ -146,6 +159,157 @@ using tserver::WriteResponsePB;
 
 struct ReplayState;
 
+// Reads and decodes the entries of a sequence of log segments. Unless
+// prefetching is disabled, reading is done on a separate thread, which runs
+// up to a bounded number of bytes ahead of the consumer of the entries.
+class LogEntryPrefetcher {
+ public:
+  // The result of a single step of reading the log.
+  struct Item {
+    // The entry that was read, or null if the end of the segment was reached
+    // or if reading failed.
+    unique_ptr<LogEntryPB> entry;
+
+    // The error encountered while reading, if any.
+    Status status;
+
+    // The index of the segment the entry was read from.
+    int segment_idx = 0;
+
+    // The number of entries read from the segment so far, including this one.
+    int entry_count = 0;
+
+    // The reader's offset after reading the entry, and the offset up to which
+    // the segment will be read.
+    int64_t offset = 0;
+    int64_t read_up_to_offset = 0;
+
+    // The number of bytes the entry occupied in the segment.
+    int64_t bytes = 0;
+
+    // The memory used by the decoded entry while it is buffered, as charged
+    // to the prefetcher's MemTracker.
+    int64_t tracked_bytes = 0;
+
+    // Whether this is the last item; no further items will follow.
+    bool last = false;
+  };
+
+  // The memory used by prefetched entries is tracked by a child tracker of
+  // 'parent_mem_tracker'.
+  LogEntryPrefetcher(const log::SegmentSequence* segments, int64_t max_prefetch_bytes,
+                     const shared_ptr<MemTracker>& parent_mem_tracker)
+      : segments_(segments),
+        max_prefetch_bytes_(max_prefetch_bytes),
+        mem_tracker_(MemTracker::CreateTracker(-1, "LogPrefetch", parent_mem_tracker)),
+        queue_(std::max<int64_t>(max_prefetch_bytes, 1)),
+        segment_idx_(0),
+        entry_count_(0) {
+  }
+
+  ~LogEntryPrefetcher() {
+    queue_.Shutdown();
+    if (thread_) {
+      thread_->Join();
+    }
+    Item* item;
+    while (queue_.BlockingGet(&item)) {
+      mem_tracker_->Release(item->tracked_bytes);
+      delete item;
+    }
+  }
+
+  // Starts the prefetching thread, if prefetching is enabled.
+  Status Start() {
+    if (max_prefetch_bytes_ == 0 || segments_->empty()) {
+      return Status::OK();
+    }
+    return Thread::Create("tablet", "bootstrap-log-prefetch",
+                          &LogEntryPrefetcher::Run, this, &thread_);
+  }
+
+  // Returns the next item, blocking until it is available. Must not be called
+  // once an item with 'last' set was returned, or if there are no segments.
+  unique_ptr<Item> Next() {
+    if (!thread_) {
+      return ReadNext();
+    }
+    Item* item;
+    CHECK(queue_.BlockingGet(&item));
+    mem_tracker_->Release(item->tracked_bytes);
+    item->tracked_bytes = 0;
+    return unique_ptr<Item>(item);
+  }
+
+ private:
+  struct ItemLogicalSize {
+    static size_t logical_size(const Item* item) {
+      return std::max<int64_t>(item->bytes, 1);
+    }
+  };
+
+  void Run() {
+    while (true) {
+      unique_ptr<Item> item = ReadNext();
+      bool last = item->last;
+      if (item->entry) {
+        item->tracked_bytes = item->entry->SpaceUsed();
+        mem_tracker_->Consume(item->tracked_bytes);
+      }
+      if (!queue_.BlockingPut(item.get())) {
+        mem_tracker_->Release(item->tracked_bytes);
+        return;
+      }
+      item.release();
+      if (last) {
+        return;
+      }
+    }
+  }
+
+  unique_ptr<Item> ReadNext() {
+    DCHECK_LT(segment_idx_, segments_->size());
+    if (!reader_) {
+      reader_.reset(new log::LogEntryReader((*segments_)[segment_idx_].get()));
+      entry_count_ = 0;
+    }
+    unique_ptr<Item> item(new Item);
+    item->segment_idx = segment_idx_;
+    int64_t start_offset = reader_->offset();
+    unique_ptr<LogEntryPB> entry(new LogEntryPB);
+    Status s = reader_->ReadNextEntry(entry.get());
+    item->offset = reader_->offset();
+    item->read_up_to_offset = reader_->read_up_to_offset();
+    item->bytes = item->offset - start_offset;
+    if (PREDICT_TRUE(s.ok())) {
+      item->entry = std::move(entry);
+      item->entry_count = ++entry_count_;
+    } else if (s.IsEndOfFile()) {
+      item->entry_count = entry_count_;
+      reader_.reset();
+      item->last = ++segment_idx_ == segments_->size();
+    } else {
+      item->status = std::move(s);
+      item->entry_count = entry_count_;
+      item->last = true;
+    }
+    return item;
+  }
+
+  const log::SegmentSequence* segments_;
+  const int64_t max_prefetch_bytes_;
+  shared_ptr<MemTracker> mem_tracker_;
+  BlockingQueue<Item*, ItemLogicalSize> queue_;
+  scoped_refptr<Thread> thread_;
+
+  // Reading state. Only accessed by the prefetching thread, if there is one.
+  int segment_idx_;
+  int entry_count_;
+  unique_ptr<log::LogEntryReader> reader_;
+
+  DISALLOW_COPY_AND_ASSIGN(LogEntryPrefetcher);
+};
+
 // Information from the tablet metadata which indicates which data was
 // flushed prior to this restart and which memory stores are still active.
 //
@@ -1147,58 +1311,60 @@ Status TabletBootstrap::PlaySegments(ConsensusBootstrapInfo* consensus_info) {
   const auto kStatusUpdateInterval = MonoDelta::FromSeconds(5);
   int segment_count = 0;
 
-  for (const scoped_refptr<ReadableLogSegment>& segment : segments) {
-    log::LogEntryReader reader(segment.get());
-
-    int entry_count = 0;
-    while (true) {
-      unique_ptr<LogEntryPB> entry(new LogEntryPB);
-
-      Status s = reader.ReadNextEntry(entry.get());
-      if (PREDICT_FALSE(!s.ok())) {
-        if (s.IsEndOfFile()) {
-          break;
-        }
-        return Status::Corruption(Substitute("Error reading Log Segment of tablet $0: $1 "
-                                             "(Read up to entry $2 of segment $3, in path $4)",
-                                             tablet_->tablet_id(),
-                                             s.ToString(),
-                                             entry_count,
-                                             segment->header().sequence_number(),
-                                             segment->path()));
-      }
-      entry_count++;
-
-      s = HandleEntry(&state, entry.get());
-      if (!s.ok()) {
-        DumpReplayStateToLog(state);
-        RETURN_NOT_OK_PREPEND(s, DebugInfo(tablet_->tablet_id(),
+  // Read the log ahead of replay so that decoding entries overlaps with
+  // applying them.
+  LogEntryPrefetcher prefetcher(&segments, FLAGS_tablet_bootstrap_log_prefetch_bytes,
+                                tablet_->mem_tracker());
+  RETURN_NOT_OK_PREPEND(prefetcher.Start(), "Failed to start log prefetching");
+
+  bool done = segments.empty();
+  while (!done) {
+    unique_ptr<LogEntryPrefetcher::Item> item = prefetcher.Next();
+    done = item->last;
+    const scoped_refptr<ReadableLogSegment>& segment = segments[item->segment_idx];
+    if (PREDICT_FALSE(!item->status.ok())) {
+      return Status::Corruption(Substitute("Error reading Log Segment of tablet $0: $1 "
+                                           "(Read up to entry $2 of segment $3, in path $4)",
+                                           tablet_->tablet_id(),
+                                           item->status.ToString(),
+                                           item->entry_count,
                                            segment->header().sequence_number(),
-                                           entry_count, segment->path(),
-                                           *entry));
-      }
+                                           segment->path()));
+    }
 
-      // If HandleEntry returns OK, then it has taken ownership of the entry.
-      entry.release();
-
-      auto now = MonoTime::Now();
-      if (now - last_status_update > kStatusUpdateInterval) {
-        SetStatusMessage(Substitute("Bootstrap replaying log segment $0/$1 "
-                                    "($2/$3 this segment, stats: $4)",
-                                    segment_count + 1, log_reader_->num_segments(),
-                                    HumanReadableNumBytes::ToString(reader.offset()),
-                                    HumanReadableNumBytes::ToString(reader.read_up_to_offset()),
-                                    stats_.ToString()));
-        last_status_update = now;
-      }
+    if (!item->entry) {
+      // Reached the end of the segment.
+      SetStatusMessage(Substitute("Bootstrap replayed $0/$1 log segments. "
+                                  "Stats: $2. Pending: $3 replicates",
+                                  segment_count + 1, log_reader_->num_segments(),
+                                  stats_.ToString(),
+                                  state.pending_replicates.size()));
+      segment_count++;
+      continue;
     }
 
-    SetStatusMessage(Substitute("Bootstrap replayed $0/$1 log segments. "
-                                "Stats: $2. Pending: $3 replicates",
-                                segment_count + 1, log_reader_->num_segments(),
-                                stats_.ToString(),
-                                state.pending_replicates.size()));
-    segment_count++;
+    Status s = HandleEntry(&state, item->entry.get());
+    if (!s.ok()) {
+      DumpReplayStateToLog(state);
+      RETURN_NOT_OK_PREPEND(s, DebugInfo(tablet_->tablet_id(),
+                                         segment->header().sequence_number(),
+                                         item->entry_count, segment->path(),
+                                         *item->entry));
+    }
+
+    // If HandleEntry returns OK, then it has taken ownership of the entry.
+    item->entry.release();
+
+    auto now = MonoTime::Now();
+    if (now - last_status_update > kStatusUpdateInterval) {
+      SetStatusMessage(Substitute("Bootstrap replaying log segment $0/$1 "
+                                  "($2/$3 this segment, stats: $4)",
+                                  segment_count + 1, log_reader_->num_segments(),
+                                  HumanReadableNumBytes::ToString(item->offset),
+                                  HumanReadableNumBytes::ToString(item->read_up_to_offset),
+                                  stats_.ToString()));
+      last_status_update = now;
+    }
   }
 
   // If we have non-applied commits they all must belong to pending operations and
@@ -1522,10 +1688,16 @@ Status TabletBootstrap::ApplyOperations(WriteTransactionState* tx_state,
     }
 
     op->set_original_result_from_log(&orig_result.ops(curr_op_idx));
+  }
 
-    // Actually apply it.
-    ProbeStats stats; // we don't use this, but tablet internals require non-NULL.
-    tablet_->ApplyRowOperation(tx_state, op, &stats);
+  // Actually apply the ops that need replaying, as a batch.
+  tablet_->ApplyRowOperations(tx_state);
+
+  op_idx = 0;
+  for (const RowOp* op : tx_state->row_ops()) {
+    if (new_result->ops(op_idx++).skip_on_replay()) {
+      continue;
+    }
     DCHECK(op->result != nullptr);
 
     // We expect that the above Apply() will always succeed, because we're
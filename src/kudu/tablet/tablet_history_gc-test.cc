@@ -353,6 +353,100 @@ TEST_F(TabletHistoryGcTest, TestRowRemovalGCOnMergeCompaction) {
   ASSERT_EQ(0, tablet()->OnDiskDataSize());
 }
 
+// Test that rowsets in which every row was deleted prior to the AHM are
+// dropped without a compaction, and that rowsets with live rows are kept.
+TEST_F(TabletHistoryGcTest, TestDeletedRowSetGC) {
+  FLAGS_tablet_history_max_age_sec = 100; // Keep history for 100 seconds.
+
+  NO_FATALS(InsertOriginalRows(num_rowsets_, rows_per_rowset_));
+  NO_FATALS(AddTimeToHybridClock(MonoDelta::FromSeconds(200)));
+
+  // Delete all of the rows in every rowset but the last one.
+  const int kNumDeletedRowSets = num_rowsets_ - 1;
+  const int kNumDeletedRows = kNumDeletedRowSets * rows_per_rowset_;
+  LocalTabletWriter writer(tablet().get(), &client_schema_);
+  for (int row_idx = 0; row_idx < kNumDeletedRows; row_idx++) {
+    ASSERT_OK(DeleteTestRow(&writer, row_idx));
+  }
+
+  // Nothing can be dropped while the deletes are still in the DMS.
+  int64_t bytes = 0;
+  ASSERT_OK(tablet()->EstimateBytesInDeletedAncientRowSets(&bytes));
+  ASSERT_EQ(0, bytes);
+
+  // Once flushed, the deletes are still too recent to be GCed.
+  ASSERT_OK(tablet()->FlushAllDMSForTests());
+  ASSERT_OK(tablet()->EstimateBytesInDeletedAncientRowSets(&bytes));
+  ASSERT_EQ(0, bytes);
+  int64_t rowsets_deleted = 0;
+  ASSERT_OK(tablet()->DeleteAncientDeletedRowSets(&rowsets_deleted));
+  ASSERT_EQ(0, rowsets_deleted);
+  ASSERT_EQ(num_rowsets_, tablet()->num_rowsets());
+
+  // Move the AHM so that the deletes are now prior to it.
+  NO_FATALS(AddTimeToHybridClock(MonoDelta::FromSeconds(200)));
+  ASSERT_OK(tablet()->EstimateBytesInDeletedAncientRowSets(&bytes));
+  ASSERT_GT(bytes, 0);
+
+  int64_t bytes_deleted = 0;
+  ASSERT_OK(tablet()->DeleteAncientDeletedRowSets(&rowsets_deleted, &bytes_deleted));
+  ASSERT_EQ(kNumDeletedRowSets, rowsets_deleted);
+  ASSERT_EQ(bytes, bytes_deleted);
+  ASSERT_EQ(1, tablet()->num_rowsets());
+  ASSERT_EQ(bytes_deleted, tablet()->metrics()->deleted_rowset_gc_bytes_deleted->value());
+
+  NO_FATALS(VerifyTestRowsWithVerifier(kNumDeletedRows, rows_per_rowset_, kRowsEqual0));
+
+  // The remaining rowset is untouched by a second pass.
+  ASSERT_OK(tablet()->DeleteAncientDeletedRowSets(&rowsets_deleted));
+  ASSERT_EQ(0, rowsets_deleted);
+  ASSERT_EQ(1, tablet()->num_rowsets());
+}
+
+// Test that deleted rowsets whose REDO delta stores weren't initialized
+// after a restart are still found, once the stores are initialized.
+TEST_F(TabletHistoryGcTest, TestDeletedRowSetGCAfterRestart) {
+  FLAGS_tablet_history_max_age_sec = 100; // Keep history for 100 seconds.
+
+  NO_FATALS(InsertOriginalRows(num_rowsets_, rows_per_rowset_));
+  NO_FATALS(AddTimeToHybridClock(MonoDelta::FromSeconds(200)));
+
+  const int kNumDeletedRowSets = num_rowsets_ - 1;
+  const int kNumDeletedRows = kNumDeletedRowSets * rows_per_rowset_;
+  {
+    LocalTabletWriter writer(tablet().get(), &client_schema_);
+    for (int row_idx = 0; row_idx < kNumDeletedRows; row_idx++) {
+      ASSERT_OK(DeleteTestRow(&writer, row_idx));
+    }
+  }
+  ASSERT_OK(tablet()->FlushAllDMSForTests());
+  NO_FATALS(AddTimeToHybridClock(MonoDelta::FromSeconds(200)));
+
+  // Restart the tablet, keeping the time where it was.
+  uint64_t now = HybridClock::GetPhysicalValueMicros(clock()->Now());
+  NO_FATALS(TabletReOpen());
+  SetMockTime(now);
+
+  // The REDO delta stores aren't initialized, so the deleted rowsets can't be
+  // told apart from the live one yet. They're all counted, and none dropped.
+  int64_t bytes = 0;
+  ASSERT_OK(tablet()->EstimateBytesInDeletedAncientRowSets(&bytes));
+  ASSERT_GT(bytes, 0);
+  int64_t rowsets_deleted = 0;
+  ASSERT_OK(tablet()->DeleteAncientDeletedRowSets(&rowsets_deleted));
+  ASSERT_EQ(0, rowsets_deleted);
+
+  ASSERT_OK(tablet()->InitRedoDeltasForDeletedRowSetGC(MonoDelta()));
+  ASSERT_OK(tablet()->DeleteAncientDeletedRowSets(&rowsets_deleted));
+  ASSERT_EQ(kNumDeletedRowSets, rowsets_deleted);
+  ASSERT_EQ(1, tablet()->num_rowsets());
+  NO_FATALS(VerifyTestRowsWithVerifier(kNumDeletedRows, rows_per_rowset_, kRowsEqual0));
+
+  // Nothing is left to be initialized or dropped.
+  ASSERT_OK(tablet()->EstimateBytesInDeletedAncientRowSets(&bytes));
+  ASSERT_EQ(0, bytes);
+}
+
 // Test that we don't over-aggressively GC history prior to the AHM.
 TEST_F(TabletHistoryGcTest, TestNoUndoGCUntilAncientHistoryMark) {
   FLAGS_tablet_history_max_age_sec = 1000; // 1000 seconds before we GC history.
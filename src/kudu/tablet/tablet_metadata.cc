@@ -417,6 +417,8 @@ Status TabletMetadata::LoadFromSuperBlock(const TabletSuperBlockPB& superblock)
     } else {
       tombstone_last_logged_opid_ = boost::none;
     }
+
+    compaction_sealed_key_ = superblock.compaction_sealed_key();
   }
 
   // Now is a good time to clean up any orphaned blocks that may have been
@@ -601,6 +603,16 @@ boost::optional<consensus::OpId> TabletMetadata::tombstone_last_logged_opid() co
   return tombstone_last_logged_opid_;
 }
 
+string TabletMetadata::compaction_sealed_key() const {
+  std::lock_guard<LockType> l(data_lock_);
+  return compaction_sealed_key_;
+}
+
+void TabletMetadata::set_compaction_sealed_key(string key) {
+  std::lock_guard<LockType> l(data_lock_);
+  compaction_sealed_key_ = std::move(key);
+}
+
 Status TabletMetadata::ReadSuperBlockFromDisk(TabletSuperBlockPB* superblock) const {
   string path = fs_manager_->GetTabletMetadataPath(tablet_id_);
   RETURN_NOT_OK_PREPEND(
@@ -641,6 +653,9 @@ Status TabletMetadata::ToSuperBlockUnlocked(TabletSuperBlockPB* super_block,
       !OpIdEquals(MinimumOpId(), *tombstone_last_logged_opid_)) {
     *pb.mutable_tombstone_last_logged_opid() = *tombstone_last_logged_opid_;
   }
+  if (!compaction_sealed_key_.empty()) {
+    pb.set_compaction_sealed_key(compaction_sealed_key_);
+  }
 
   for (const BlockId& block_id : orphaned_blocks_) {
     block_id.CopyToPB(pb.mutable_orphaned_blocks()->Add());
@@ -232,6 +232,14 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // Return the last-logged opid of a tombstoned tablet, if known.
   boost::optional<consensus::OpId> tombstone_last_logged_opid() const;
 
+  // Returns the key below which the time-windowed compaction policy has
+  // sealed the tablet's rowsets, or an empty string if none are sealed.
+  std::string compaction_sealed_key() const;
+
+  // Sets the key returned by compaction_sealed_key(). It is persisted by the
+  // next Flush().
+  void set_compaction_sealed_key(std::string key);
+
   // Loads the currently-flushed superblock from disk into the given protobuf.
   Status ReadSuperBlockFromDisk(TabletSuperBlockPB* superblock) const;
 
@@ -361,6 +369,10 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // Protected by 'data_lock_'.
   boost::optional<consensus::OpId> tombstone_last_logged_opid_;
 
+  // See compaction_sealed_key().
+  // Protected by 'data_lock_'.
+  std::string compaction_sealed_key_;
+
   // If this counter is > 0 then Flush() will not write any data to
   // disk.
   int32_t num_flush_pins_;
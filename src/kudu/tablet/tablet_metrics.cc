@@ -121,6 +121,13 @@ METRIC_DEFINE_counter(tablet, undo_delta_block_gc_bytes_deleted,
                       "on this tablet since this server was restarted. "
                       "Does not include bytes garbage collected during compactions.");
 
+METRIC_DEFINE_counter(tablet, deleted_rowset_gc_bytes_deleted,
+                      "Deleted RowSet GC Bytes Deleted",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes deleted by dropping rowsets in which every row "
+                      "was deleted before the ancient history mark, since this server "
+                      "was restarted.");
+
 METRIC_DEFINE_histogram(tablet, bloom_lookups_per_op, "Bloom Lookups per Operation",
                         kudu::MetricUnit::kProbes,
                         "Tracks the number of bloom filter lookups performed by each "
@@ -203,6 +210,18 @@ METRIC_DEFINE_gauge_int64(tablet, undo_delta_block_estimated_retained_bytes,
   "Estimated bytes of deletable data in undo delta blocks for this tablet. "
   "May be an overestimate.");
 
+METRIC_DEFINE_gauge_uint32(tablet, deleted_rowset_gc_running,
+  "Deleted RowSet GC Running",
+  kudu::MetricUnit::kMaintenanceOperations,
+  "Number of deleted rowset GC operations currently running.");
+
+METRIC_DEFINE_gauge_int64(tablet, deleted_rowset_estimated_retained_bytes,
+  "Estimated Deletable Bytes Retained in Deleted RowSets",
+  kudu::MetricUnit::kBytes,
+  "Estimated bytes of data in rowsets of this tablet whose rows have all been "
+  "deleted before the ancient history mark, and that can be dropped without "
+  "being compacted.");
+
 METRIC_DEFINE_histogram(tablet, flush_dms_duration,
   "DeltaMemStore Flush Duration",
   kudu::MetricUnit::kMilliseconds,
@@ -243,6 +262,12 @@ METRIC_DEFINE_histogram(tablet, undo_delta_block_gc_perform_duration,
   kudu::MetricUnit::kMilliseconds,
   "Time spent running the maintenance operation to GC ancient UNDO delta blocks.", 60000LU, 1);
 
+METRIC_DEFINE_histogram(tablet, deleted_rowset_gc_duration,
+  "Deleted RowSet GC Duration",
+  kudu::MetricUnit::kMilliseconds,
+  "Time spent running the maintenance operation to drop rowsets whose rows "
+  "were all deleted before the ancient history mark.", 60000LU, 1);
+
 METRIC_DEFINE_counter(tablet, leader_memory_pressure_rejections,
   "Leader Memory Pressure Rejections",
   kudu::MetricUnit::kRequests,
@@ -276,6 +301,7 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(mrs_lookups),
     MINIT(bytes_flushed),
     MINIT(undo_delta_block_gc_bytes_deleted),
+    MINIT(deleted_rowset_gc_bytes_deleted),
     MINIT(bloom_lookups_per_op),
     MINIT(key_file_lookups_per_op),
     MINIT(delta_file_lookups_per_op),
@@ -290,6 +316,8 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     GINIT(delta_major_compact_rs_running),
     GINIT(undo_delta_block_gc_running),
     GINIT(undo_delta_block_estimated_retained_bytes),
+    GINIT(deleted_rowset_gc_running),
+    GINIT(deleted_rowset_estimated_retained_bytes),
     MINIT(flush_dms_duration),
     MINIT(flush_mrs_duration),
     MINIT(compact_rs_duration),
@@ -298,6 +326,7 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(undo_delta_block_gc_init_duration),
     MINIT(undo_delta_block_gc_delete_duration),
     MINIT(undo_delta_block_gc_perform_duration),
+    MINIT(deleted_rowset_gc_duration),
     MINIT(leader_memory_pressure_rejections) {
 }
 #undef MINIT
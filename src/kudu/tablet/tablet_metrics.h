@@ -65,6 +65,7 @@ struct TabletMetrics {
   // Operation stats.
   scoped_refptr<Counter> bytes_flushed;
   scoped_refptr<Counter> undo_delta_block_gc_bytes_deleted;
+  scoped_refptr<Counter> deleted_rowset_gc_bytes_deleted;
 
   scoped_refptr<Histogram> bloom_lookups_per_op;
   scoped_refptr<Histogram> key_file_lookups_per_op;
@@ -82,6 +83,8 @@ struct TabletMetrics {
   scoped_refptr<AtomicGauge<uint32_t> > delta_major_compact_rs_running;
   scoped_refptr<AtomicGauge<uint32_t> > undo_delta_block_gc_running;
   scoped_refptr<AtomicGauge<int64_t> > undo_delta_block_estimated_retained_bytes;
+  scoped_refptr<AtomicGauge<uint32_t> > deleted_rowset_gc_running;
+  scoped_refptr<AtomicGauge<int64_t> > deleted_rowset_estimated_retained_bytes;
 
   scoped_refptr<Histogram> flush_dms_duration;
   scoped_refptr<Histogram> flush_mrs_duration;
@@ -91,6 +94,7 @@ struct TabletMetrics {
   scoped_refptr<Histogram> undo_delta_block_gc_init_duration;
   scoped_refptr<Histogram> undo_delta_block_gc_delete_duration;
   scoped_refptr<Histogram> undo_delta_block_gc_perform_duration;
+  scoped_refptr<Histogram> deleted_rowset_gc_duration;
 
   scoped_refptr<Counter> leader_memory_pressure_rejections;
 };
@@ -18,12 +18,15 @@
 #include "kudu/tablet/tablet_mm_ops.h"
 
 #include <algorithm>
+#include <memory>
 #include <mutex>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/gutil/casts.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet_metrics.h"
@@ -41,6 +44,15 @@ DEFINE_int32(undo_delta_block_gc_init_budget_millis, 1000,
 TAG_FLAG(undo_delta_block_gc_init_budget_millis, evolving);
 TAG_FLAG(undo_delta_block_gc_init_budget_millis, advanced);
 
+DEFINE_int32(deleted_rowset_gc_init_budget_millis, 1000,
+    "The maximum number of milliseconds we will spend initializing "
+    "REDO delta blocks per invocation of DeletedRowSetGCOp. Existing delta "
+    "blocks must be initialized once per process startup to determine "
+    "whether their rowsets are fully deleted.");
+TAG_FLAG(deleted_rowset_gc_init_budget_millis, evolving);
+TAG_FLAG(deleted_rowset_gc_init_budget_millis, advanced);
+
+using std::shared_ptr;
 using std::string;
 using strings::Substitute;
 
@@ -158,10 +170,16 @@ void MinorDeltaCompactionOp::UpdateStats(MaintenanceOpStats* stats) {
     }
   }
 
+  shared_ptr<RowSet> rs;
   double perf_improv = tablet_->GetPerfImprovementForBestDeltaCompact(
-      RowSet::MINOR_DELTA_COMPACTION, nullptr);
+      RowSet::MINOR_DELTA_COMPACTION, &rs);
   prev_stats_.set_perf_improvement(perf_improv);
   prev_stats_.set_runnable(perf_improv > 0);
+  if (rs) {
+    // A minor delta compaction rewrites the rowset's REDO delta files.
+    int64_t redo_bytes = down_cast<DiskRowSet*>(rs.get())->RedoDeltaOnDiskSize();
+    tablet_->SetExpectedIOStats(redo_bytes, redo_bytes, &prev_stats_);
+  }
   *stats = prev_stats_;
 }
 
@@ -234,10 +252,16 @@ void MajorDeltaCompactionOp::UpdateStats(MaintenanceOpStats* stats) {
     }
   }
 
+  shared_ptr<RowSet> rs;
   double perf_improv = tablet_->GetPerfImprovementForBestDeltaCompact(
-      RowSet::MAJOR_DELTA_COMPACTION, nullptr);
+      RowSet::MAJOR_DELTA_COMPACTION, &rs);
   prev_stats_.set_perf_improvement(perf_improv);
   prev_stats_.set_runnable(perf_improv > 0);
+  if (rs) {
+    // At worst, a major delta compaction rewrites all of the rowset's data.
+    int64_t data_bytes = rs->OnDiskDataSizeNoUndos();
+    tablet_->SetExpectedIOStats(data_bytes, data_bytes, &prev_stats_);
+  }
   *stats = prev_stats_;
 }
 
@@ -315,5 +339,46 @@ std::string UndoDeltaBlockGCOp::LogPrefix() const {
   return tablet_->LogPrefix();
 }
 
+////////////////////////////////////////////////////////////
+// DeletedRowSetGCOp
+////////////////////////////////////////////////////////////
+
+DeletedRowSetGCOp::DeletedRowSetGCOp(Tablet* tablet)
+  : TabletOpBase(Substitute("DeletedRowSetGCOp($0)", tablet->tablet_id()),
+                 MaintenanceOp::LOW_IO_USAGE, tablet) {
+}
+
+void DeletedRowSetGCOp::UpdateStats(MaintenanceOpStats* stats) {
+  int64_t retained_bytes = 0;
+  WARN_NOT_OK(tablet_->EstimateBytesInDeletedAncientRowSets(&retained_bytes),
+              "Unable to count bytes in deleted ancient rowsets");
+  stats->set_data_retained_bytes(retained_bytes);
+  stats->set_runnable(retained_bytes > 0);
+}
+
+bool DeletedRowSetGCOp::Prepare() {
+  return true;
+}
+
+void DeletedRowSetGCOp::Perform() {
+  MonoDelta time_budget = MonoDelta::FromMilliseconds(FLAGS_deleted_rowset_gc_init_budget_millis);
+  Status s = tablet_->InitRedoDeltasForDeletedRowSetGC(time_budget);
+  if (PREDICT_FALSE(!s.ok())) {
+    LOG_WITH_PREFIX(WARNING) << s.ToString();
+    return;
+  }
+
+  CHECK_OK_PREPEND(tablet_->DeleteAncientDeletedRowSets(),
+                   Substitute("$0GC of deleted rowsets failed", LogPrefix()));
+}
+
+scoped_refptr<Histogram> DeletedRowSetGCOp::DurationHistogram() const {
+  return tablet_->metrics()->deleted_rowset_gc_duration;
+}
+
+scoped_refptr<AtomicGauge<uint32_t>> DeletedRowSetGCOp::RunningGauge() const {
+  return tablet_->metrics()->deleted_rowset_gc_running;
+}
+
 } // namespace tablet
 } // namespace kudu
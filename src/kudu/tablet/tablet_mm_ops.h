@@ -57,6 +57,9 @@ class CompactRowSetsOp : public TabletOpBase {
  public:
   explicit CompactRowSetsOp(Tablet* tablet);
 
+  // Merge compactions stop between output blocks when preempted.
+  virtual bool preemptible() const OVERRIDE { return true; }
+
   virtual void UpdateStats(MaintenanceOpStats* stats) OVERRIDE;
 
   virtual bool Prepare() OVERRIDE;
@@ -109,6 +112,9 @@ class MajorDeltaCompactionOp : public TabletOpBase {
  public:
   explicit MajorDeltaCompactionOp(Tablet* tablet);
 
+  // Major delta compactions stop between blocks and passes when preempted.
+  virtual bool preemptible() const OVERRIDE { return true; }
+
   virtual void UpdateStats(MaintenanceOpStats* stats) OVERRIDE;
 
   virtual bool Prepare() OVERRIDE;
@@ -158,6 +164,31 @@ class UndoDeltaBlockGCOp : public TabletOpBase {
   DISALLOW_COPY_AND_ASSIGN(UndoDeltaBlockGCOp);
 };
 
+// MaintenanceOp to drop rowsets in which every row was deleted before the
+// ancient history mark, or in which every row has outlived the table's TTL.
+// Such rowsets would otherwise only be reclaimed by a merge compaction, which
+// has to read and rewrite them along with their neighbors even though none of
+// their rows survive.
+class DeletedRowSetGCOp : public TabletOpBase {
+ public:
+  explicit DeletedRowSetGCOp(Tablet* tablet);
+
+  // Counts the on-disk bytes of the rowsets that can be dropped. Only rowsets
+  // whose REDO delta stats are already in memory are considered.
+  void UpdateStats(MaintenanceOpStats* stats) override;
+
+  bool Prepare() override;
+
+  void Perform() override;
+
+  scoped_refptr<Histogram> DurationHistogram() const override;
+
+  scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const override;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(DeletedRowSetGCOp);
+};
+
 
 } // namespace tablet
 } // namespace kudu
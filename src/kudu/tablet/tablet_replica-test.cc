@@ -589,6 +589,16 @@ TEST_F(TabletReplicaTest, TestFlushOpsPerfImprovements) {
   ASSERT_LT(0.7, stats.perf_improvement());
   ASSERT_GT(1.0, stats.perf_improvement());
   stats.Clear();
+
+  // With an explicit threshold, and time-based flushing disallowed.
+  stats.set_ram_anchored(30 * 1024 * 1024);
+  FlushOpPerfImprovementPolicy::SetPerfImprovementForFlush(&stats, 60 * 50 * 1000, 64, false);
+  ASSERT_EQ(0.0, stats.perf_improvement());
+  stats.Clear();
+  stats.set_ram_anchored(30 * 1024 * 1024);
+  FlushOpPerfImprovementPolicy::SetPerfImprovementForFlush(&stats, 1, 20, false);
+  ASSERT_NEAR(stats.perf_improvement(), 10, 0.01);
+  stats.Clear();
 }
 
 } // namespace tablet
@@ -27,10 +27,12 @@
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/flush_controller.h"
 #include "kudu/tablet/tablet_metrics.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/maintenance_manager.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 
 DEFINE_int32(flush_threshold_mb, 1024,
@@ -44,6 +46,8 @@ DEFINE_int32(flush_threshold_secs, 2 * 60,
              "even if it is not large.");
 TAG_FLAG(flush_threshold_secs, experimental);
 
+DECLARE_bool(enable_adaptive_flush_thresholds);
+
 
 METRIC_DEFINE_gauge_uint32(tablet, log_gc_running,
                            "Log GCs Running",
@@ -58,6 +62,7 @@ namespace kudu {
 namespace tablet {
 
 using std::map;
+using std::string;
 using strings::Substitute;
 
 // Upper bound for how long it takes to reach "full perf improvement" in time-based flushing.
@@ -69,18 +74,25 @@ const double kFlushUpperBoundMs = 60 * 60 * 1000;
 
 void FlushOpPerfImprovementPolicy::SetPerfImprovementForFlush(MaintenanceOpStats* stats,
                                                               double elapsed_ms) {
+  SetPerfImprovementForFlush(stats, elapsed_ms, FLAGS_flush_threshold_mb, true);
+}
+
+void FlushOpPerfImprovementPolicy::SetPerfImprovementForFlush(MaintenanceOpStats* stats,
+                                                              double elapsed_ms,
+                                                              double threshold_mb,
+                                                              bool allow_time_based) {
   double anchored_mb = static_cast<double>(stats->ram_anchored()) / (1024 * 1024);
-  if (anchored_mb > FLAGS_flush_threshold_mb) {
+  if (anchored_mb > threshold_mb) {
     // If we're over the user-specified flush threshold, then consider the perf
     // improvement to be 1 for every extra MB.  This produces perf_improvement results
     // which are much higher than most compactions would produce, and means that, when
     // there is an MRS over threshold, a flush will almost always be selected instead of
     // a compaction.  That's not necessarily a good thing, but in the absence of better
     // heuristics, it will do for now.
-    double extra_mb = anchored_mb - static_cast<double>(FLAGS_flush_threshold_mb);
+    double extra_mb = anchored_mb - threshold_mb;
     DCHECK_GE(extra_mb, 0);
     stats->set_perf_improvement(extra_mb);
-  } else if (elapsed_ms > FLAGS_flush_threshold_secs * 1000) {
+  } else if (allow_time_based && elapsed_ms > FLAGS_flush_threshold_secs * 1000) {
     // Even if we aren't over the threshold, consider flushing if we haven't flushed
     // in a long time. But, don't give it a large perf_improvement score. We should
     // only do this if we really don't have much else to do, and if we've already waited a bit.
@@ -98,9 +110,22 @@ void FlushOpPerfImprovementPolicy::SetPerfImprovementForFlush(MaintenanceOpStats
 // FlushMRSOp.
 //
 
+FlushMRSOp::~FlushMRSOp() {
+  FlushController::GetInstance()->RemoveTablet(tablet_replica_->tablet_id());
+}
+
 void FlushMRSOp::UpdateStats(MaintenanceOpStats* stats) {
   std::lock_guard<simple_spinlock> l(lock_);
 
+  const bool adaptive = FLAGS_enable_adaptive_flush_thresholds;
+  FlushController* controller = FlushController::GetInstance();
+  controller->SetEnabled(adaptive);
+  if (adaptive) {
+    controller->UpdateTablet(tablet_replica_->tablet_id(),
+                             tablet_replica_->tablet()->MemRowSetSize(),
+                             MonoTime::Now());
+  }
+
   map<int64_t, int64_t> replay_size_map;
   if (tablet_replica_->tablet()->MemRowSetEmpty() ||
       !tablet_replica_->GetReplaySizeMap(&replay_size_map).ok()) {
@@ -116,6 +141,19 @@ void FlushMRSOp::UpdateStats(MaintenanceOpStats* stats) {
   stats->set_ram_anchored(tablet_replica_->tablet()->MemRowSetSize());
   stats->set_logs_retained_bytes(
       tablet_replica_->tablet()->MemRowSetLogReplaySize(replay_size_map));
+  // A flush writes out roughly as much data as the MRS holds in memory.
+  tablet_replica_->tablet()->SetExpectedIOStats(0, stats->ram_anchored(), stats);
+
+  if (adaptive) {
+    const string& tablet_id = tablet_replica_->tablet_id();
+    double threshold_mb = static_cast<double>(controller->FlushThresholdBytes(
+        tablet_id, controller->MemoryBudgetBytes())) / (1024 * 1024);
+    bool idle = controller->IsIdle(tablet_id, MonoTime::Now(),
+                                   MonoDelta::FromSeconds(FLAGS_flush_threshold_secs));
+    FlushOpPerfImprovementPolicy::SetPerfImprovementForFlush(
+        stats, time_since_flush_.elapsed().wall_millis(), threshold_mb, idle);
+    return;
+  }
 
   // TODO(todd): use workload statistics here to find out how "hot" the tablet has
   // been in the last 5 minutes.
@@ -171,6 +209,7 @@ void FlushDeltaMemStoresOp::UpdateStats(MaintenanceOpStats* stats) {
   stats->set_ram_anchored(dms_size);
   stats->set_runnable(true);
   stats->set_logs_retained_bytes(retention_size);
+  tablet_replica_->tablet()->SetExpectedIOStats(0, dms_size, stats);
 
   FlushOpPerfImprovementPolicy::SetPerfImprovementForFlush(
       stats,
@@ -208,7 +247,7 @@ scoped_refptr<AtomicGauge<uint32_t> > FlushDeltaMemStoresOp::RunningGauge() cons
 
 LogGCOp::LogGCOp(TabletReplica* tablet_replica)
     : MaintenanceOp(StringPrintf("LogGCOp(%s)", tablet_replica->tablet()->tablet_id().c_str()),
-                    MaintenanceOp::LOW_IO_USAGE),
+                    MaintenanceOp::LOW_IO_USAGE, MaintenanceOp::LOG_GC_PRIORITY),
       tablet_replica_(tablet_replica),
       log_gc_duration_(METRIC_log_gc_duration.Instantiate(
                            tablet_replica->tablet()->GetMetricEntity())),
@@ -43,6 +43,11 @@ class FlushOpPerfImprovementPolicy {
   // else it will set it based on how long it has been since the last flush.
   static void SetPerfImprovementForFlush(MaintenanceOpStats* stats, double elapsed_ms);
 
+  // As above, but with an explicit size threshold, and with time-based
+  // flushing only considered if 'allow_time_based' is true.
+  static void SetPerfImprovementForFlush(MaintenanceOpStats* stats, double elapsed_ms,
+                                         double threshold_mb, bool allow_time_based);
+
  private:
   FlushOpPerfImprovementPolicy() {}
 };
@@ -52,11 +57,13 @@ class FlushMRSOp : public MaintenanceOp {
  public:
   explicit FlushMRSOp(TabletReplica* tablet_replica)
     : MaintenanceOp(StringPrintf("FlushMRSOp(%s)", tablet_replica->tablet()->tablet_id().c_str()),
-                    MaintenanceOp::HIGH_IO_USAGE),
+                    MaintenanceOp::HIGH_IO_USAGE, MaintenanceOp::FLUSH_PRIORITY),
       tablet_replica_(tablet_replica) {
     time_since_flush_.start();
   }
 
+  virtual ~FlushMRSOp();
+
   virtual void UpdateStats(MaintenanceOpStats* stats) OVERRIDE;
 
   virtual bool Prepare() OVERRIDE;
@@ -82,7 +89,7 @@ class FlushDeltaMemStoresOp : public MaintenanceOp {
   explicit FlushDeltaMemStoresOp(TabletReplica* tablet_replica)
     : MaintenanceOp(StringPrintf("FlushDeltaMemStoresOp(%s)",
                                  tablet_replica->tablet()->tablet_id().c_str()),
-                    MaintenanceOp::HIGH_IO_USAGE),
+                    MaintenanceOp::HIGH_IO_USAGE, MaintenanceOp::FLUSH_PRIORITY),
       tablet_replica_(tablet_replica) {
     time_since_flush_.start();
   }
@@ -0,0 +1,374 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags_declare.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kudu/clock/clock.h"
+#include "kudu/clock/hybrid_clock.h"
+#include "kudu/clock/mock_ntp.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/iterator.h"
+#include "kudu/common/iterator_stats.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/common/scan_spec.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/timestamp.h"
+#include "kudu/gutil/casts.h"
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/walltime.h"
+#include "kudu/tablet/local_tablet_writer.h"
+#include "kudu/tablet/mvcc.h"
+#include "kudu/tablet/tablet-harness.h"
+#include "kudu/tablet/tablet-test-util.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+
+DECLARE_double(tablet_inject_io_error_on_deleted_rowset_gc_fraction);
+DECLARE_int32(tablet_history_max_age_sec);
+DECLARE_string(time_source);
+
+using kudu::clock::HybridClock;
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace tablet {
+
+static const int64_t kTtlSeconds = 100;
+
+static Schema CreateTtlSchema() {
+  ColumnStorageAttributes ttl_attrs;
+  ttl_attrs.ttl_seconds = kTtlSeconds;
+  return Schema({ ColumnSchema("key", INT64),
+                  ColumnSchema("ts", UNIXTIME_MICROS, false, nullptr, nullptr, ttl_attrs),
+                  ColumnSchema("val", INT32, true) },
+                1);
+}
+
+class TabletTtlTest : public KuduTabletTest {
+ public:
+  TabletTtlTest()
+      : KuduTabletTest(CreateTtlSchema(), TabletHarness::Options::HYBRID_CLOCK) {
+    FLAGS_time_source = "mock";
+  }
+
+  virtual void SetUp() OVERRIDE {
+    NO_FATALS(KuduTabletTest::SetUp());
+    SetMockTime(GetCurrentTimeMicros());
+  }
+
+ protected:
+  void SetMockTime(int64_t micros) {
+    auto* hybrid_clock = down_cast<HybridClock*>(clock());
+    auto* ntp = down_cast<clock::MockNtp*>(hybrid_clock->time_service());
+    ntp->SetMockClockWallTimeForTests(micros);
+  }
+
+  void AddTimeToHybridClock(MonoDelta delta) {
+    SetMockTime(NowMicros() + delta.ToMicroseconds());
+  }
+
+  int64_t NowMicros() {
+    return HybridClock::GetPhysicalValueMicros(clock()->Now());
+  }
+
+  Status Write(RowOperationsPB::Type type, int64_t key, int64_t ts, int32_t val) {
+    LocalTabletWriter writer(tablet().get(), &client_schema());
+    KuduPartialRow row(&client_schema());
+    CHECK_OK(row.SetInt64("key", key));
+    if (type != RowOperationsPB::DELETE) {
+      CHECK_OK(row.SetUnixTimeMicros("ts", ts));
+      CHECK_OK(row.SetInt32("val", val));
+    }
+    return writer.Write(type, row);
+  }
+
+  // Scans the tablet at 'timestamp' the way the tablet server does, with a
+  // predicate hiding the rows that are expired as of then.
+  void ScanAt(Timestamp timestamp, vector<string>* rows,
+              IteratorStats* ttl_col_stats = nullptr) {
+    int64_t ttl_cutoff_micros;
+    ASSERT_TRUE(tablet()->GetTtlCutoff(timestamp, &ttl_cutoff_micros));
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::Range(schema().column(1), &ttl_cutoff_micros, nullptr));
+
+    gscoped_ptr<RowwiseIterator> iter;
+    ASSERT_OK(tablet()->NewRowIterator(client_schema(), MvccSnapshot(timestamp), UNORDERED,
+                                       &iter));
+    ASSERT_OK(iter->Init(&spec));
+    rows->clear();
+    ASSERT_OK(IterateToStringList(iter.get(), rows));
+    if (ttl_col_stats) {
+      vector<IteratorStats> stats;
+      iter->GetIteratorStats(&stats);
+      *ttl_col_stats = stats[1];
+    }
+  }
+};
+
+// Scans hide the rows that are expired as of their snapshot, not as of now.
+TEST_F(TabletTtlTest, TestScanHidesExpiredRows) {
+  const int64_t t = NowMicros();
+  ASSERT_OK(Write(RowOperationsPB::INSERT, 0, t - 50 * 1000000LL, 0));
+  ASSERT_OK(Write(RowOperationsPB::INSERT, 1, t - 150 * 1000000LL, 1));
+  ASSERT_OK(Write(RowOperationsPB::INSERT, 2, t, 2));
+  Timestamp before = clock()->Now();
+
+  vector<string> rows;
+  NO_FATALS(ScanAt(before, &rows));
+  ASSERT_EQ(2, rows.size());
+
+  // Row 0 expires once a minute has passed, whether or not it was flushed.
+  AddTimeToHybridClock(MonoDelta::FromSeconds(60));
+  NO_FATALS(ScanAt(clock()->Now(), &rows));
+  ASSERT_EQ(1, rows.size());
+  ASSERT_STR_CONTAINS(rows[0], "val=2");
+  ASSERT_OK(tablet()->Flush());
+  NO_FATALS(ScanAt(clock()->Now(), &rows));
+  ASSERT_EQ(1, rows.size());
+
+  // It is still returned by a scan at an earlier snapshot.
+  NO_FATALS(ScanAt(before, &rows));
+  ASSERT_EQ(2, rows.size());
+}
+
+// Scans skip the rowsets whose rows are all expired, without reading them.
+TEST_F(TabletTtlTest, TestScanCullsExpiredRowSets) {
+  const int kNumRows = 100;
+  const int64_t t = NowMicros();
+  for (int i = 0; i < kNumRows; i++) {
+    ASSERT_OK(Write(RowOperationsPB::INSERT, i, t - 50 * 1000000LL, i));
+  }
+  ASSERT_OK(tablet()->Flush());
+  for (int i = kNumRows; i < 2 * kNumRows; i++) {
+    ASSERT_OK(Write(RowOperationsPB::INSERT, i, t + 1000 * 1000000LL, i));
+  }
+  ASSERT_OK(tablet()->Flush());
+
+  vector<string> rows;
+  IteratorStats ttl_col_stats;
+  NO_FATALS(ScanAt(clock()->Now(), &rows, &ttl_col_stats));
+  ASSERT_EQ(2 * kNumRows, rows.size());
+  ASSERT_EQ(2 * kNumRows, ttl_col_stats.cells_read_from_disk);
+
+  // A minute from now, the first rowset is expired.
+  Timestamp later = HybridClock::TimestampFromMicroseconds(t + 60 * 1000000LL);
+  NO_FATALS(ScanAt(later, &rows, &ttl_col_stats));
+  ASSERT_EQ(kNumRows, rows.size());
+  ASSERT_EQ(kNumRows, ttl_col_stats.cells_read_from_disk);
+
+  // Updating the TTL column of the rowset could revive its rows, so it may no
+  // longer be culled.
+  ASSERT_OK(Write(RowOperationsPB::UPDATE, 0, t + 1000 * 1000000LL, 0));
+  NO_FATALS(ScanAt(later, &rows, &ttl_col_stats));
+  ASSERT_EQ(kNumRows + 1, rows.size());
+  ASSERT_EQ(2 * kNumRows, ttl_col_stats.cells_read_from_disk);
+}
+
+// Rowsets are dropped once all of their rows have expired as of the ancient
+// history mark, so that no valid snapshot scan could still return them.
+TEST_F(TabletTtlTest, TestExpiredRowSetGC) {
+  FLAGS_tablet_history_max_age_sec = 100;
+  const int64_t t = NowMicros();
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(Write(RowOperationsPB::INSERT, i, t, i));
+  }
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_EQ(1, tablet()->num_rowsets());
+
+  // The rows are expired as of now, but not as of the ancient history mark.
+  AddTimeToHybridClock(MonoDelta::FromSeconds(150));
+  int64_t bytes = 0;
+  ASSERT_OK(tablet()->EstimateBytesInDeletedAncientRowSets(&bytes));
+  ASSERT_EQ(0, bytes);
+  int64_t rowsets_deleted = 0;
+  ASSERT_OK(tablet()->DeleteAncientDeletedRowSets(&rowsets_deleted));
+  ASSERT_EQ(0, rowsets_deleted);
+  ASSERT_EQ(1, tablet()->num_rowsets());
+
+  AddTimeToHybridClock(MonoDelta::FromSeconds(100));
+  ASSERT_OK(tablet()->EstimateBytesInDeletedAncientRowSets(&bytes));
+  ASSERT_GT(bytes, 0);
+  int64_t bytes_deleted = 0;
+  ASSERT_OK(tablet()->DeleteAncientDeletedRowSets(&rowsets_deleted, &bytes_deleted));
+  ASSERT_EQ(1, rowsets_deleted);
+  ASSERT_EQ(bytes, bytes_deleted);
+  ASSERT_EQ(0, tablet()->num_rowsets());
+
+  vector<string> rows;
+  NO_FATALS(ScanAt(clock()->Now(), &rows));
+  ASSERT_EQ(0, rows.size());
+}
+
+// Writes to the rows of an expired rowset which is being dropped fail with a
+// retriable error until the drop is durable, even if the drop fails after the
+// rowset was sealed. Otherwise, a restart could bring back the rowset's rows
+// next to their replacements in the MemRowSet.
+TEST_F(TabletTtlTest, TestWritesFailUntilExpiredRowSetDropped) {
+  FLAGS_tablet_history_max_age_sec = 100;
+  const int64_t t = NowMicros();
+  for (int i = 0; i < 3; i++) {
+    ASSERT_OK(Write(RowOperationsPB::INSERT, i, t, i));
+  }
+  ASSERT_OK(tablet()->Flush());
+  AddTimeToHybridClock(MonoDelta::FromSeconds(250));
+
+  FLAGS_tablet_inject_io_error_on_deleted_rowset_gc_fraction = 1.0;
+  Status s = tablet()->DeleteAncientDeletedRowSets();
+  ASSERT_TRUE(s.IsIOError()) << s.ToString();
+  ASSERT_EQ(1, tablet()->num_rowsets());
+
+  const int64_t now = NowMicros();
+  s = Write(RowOperationsPB::INSERT, 0, now, 1);
+  ASSERT_TRUE(s.IsServiceUnavailable()) << s.ToString();
+  s = Write(RowOperationsPB::UPSERT, 0, now, 1);
+  ASSERT_TRUE(s.IsServiceUnavailable()) << s.ToString();
+  s = Write(RowOperationsPB::UPDATE, 1, now, 1);
+  ASSERT_TRUE(s.IsServiceUnavailable()) << s.ToString();
+  s = Write(RowOperationsPB::DELETE, 2, 0, 0);
+  ASSERT_TRUE(s.IsServiceUnavailable()) << s.ToString();
+
+  // None of the writes reached the MemRowSet.
+  ASSERT_TRUE(tablet()->MemRowSetEmpty());
+
+  // Once the drop succeeds, the keys are free again.
+  FLAGS_tablet_inject_io_error_on_deleted_rowset_gc_fraction = 0.0;
+  int64_t rowsets_deleted = 0;
+  ASSERT_OK(tablet()->DeleteAncientDeletedRowSets(&rowsets_deleted));
+  ASSERT_EQ(1, rowsets_deleted);
+  ASSERT_EQ(0, tablet()->num_rowsets());
+  ASSERT_OK(Write(RowOperationsPB::INSERT, 0, now, 1));
+  vector<string> rows;
+  NO_FATALS(ScanAt(clock()->Now(), &rows));
+  ASSERT_EQ(1, rows.size());
+}
+
+// An INSERT or UPSERT over an expired row succeeds as if the row were absent,
+// whether the row is in the MemRowSet or in a DiskRowSet.
+TEST_F(TabletTtlTest, TestInsertOverExpiredRow) {
+  const int64_t t = NowMicros();
+  ASSERT_OK(Write(RowOperationsPB::INSERT, 0, t, 1));
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_OK(Write(RowOperationsPB::INSERT, 1, t, 1));
+  ASSERT_OK(Write(RowOperationsPB::INSERT, 2, t, 1));
+  Timestamp before = clock()->Now();
+
+  // Rows which haven't expired are still duplicates.
+  Status s = Write(RowOperationsPB::INSERT, 0, t, 2);
+  ASSERT_TRUE(s.IsAlreadyPresent()) << s.ToString();
+  s = Write(RowOperationsPB::INSERT, 1, t, 2);
+  ASSERT_TRUE(s.IsAlreadyPresent()) << s.ToString();
+
+  AddTimeToHybridClock(MonoDelta::FromSeconds(150));
+  const int64_t now = NowMicros();
+  ASSERT_OK(Write(RowOperationsPB::INSERT, 0, now, 2));
+  ASSERT_OK(Write(RowOperationsPB::INSERT, 1, now, 2));
+
+  // An UPSERT of an expired row doesn't keep the values it leaves unset.
+  LocalTabletWriter writer(tablet().get(), &client_schema());
+  KuduPartialRow row(&client_schema());
+  ASSERT_OK(row.SetInt64("key", 2));
+  ASSERT_OK(row.SetUnixTimeMicros("ts", now));
+  ASSERT_OK(writer.Upsert(row));
+
+  vector<string> rows;
+  NO_FATALS(ScanAt(clock()->Now(), &rows));
+  ASSERT_EQ(3, rows.size());
+  for (const string& r : rows) {
+    ASSERT_STR_CONTAINS(r, r.find("key=2") != string::npos ? "val=NULL" : "val=2");
+  }
+
+  // The replaced rows' history is kept.
+  NO_FATALS(ScanAt(before, &rows));
+  ASSERT_EQ(3, rows.size());
+  for (const string& r : rows) {
+    ASSERT_STR_CONTAINS(r, "val=1");
+  }
+}
+
+// An UPDATE or DELETE applies to an expired row without checking its TTL
+// value. Only an UPDATE which moves the TTL value forward revives the row.
+TEST_F(TabletTtlTest, TestUpdateAndDeleteOfExpiredRow) {
+  const int64_t t = NowMicros();
+  ASSERT_OK(Write(RowOperationsPB::INSERT, 0, t, 1));
+  ASSERT_OK(Write(RowOperationsPB::INSERT, 1, t, 1));
+  ASSERT_OK(Write(RowOperationsPB::INSERT, 2, t, 1));
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_OK(Write(RowOperationsPB::INSERT, 3, t, 1));
+
+  AddTimeToHybridClock(MonoDelta::FromSeconds(150));
+  const int64_t now = NowMicros();
+  ASSERT_OK(Write(RowOperationsPB::UPDATE, 0, t, 2));
+  ASSERT_OK(Write(RowOperationsPB::UPDATE, 1, now, 2));
+  ASSERT_OK(Write(RowOperationsPB::DELETE, 2, 0, 0));
+  ASSERT_OK(Write(RowOperationsPB::UPDATE, 3, now, 2));
+
+  vector<string> rows;
+  NO_FATALS(ScanAt(clock()->Now(), &rows));
+  ASSERT_EQ(2, rows.size());
+  for (const string& r : rows) {
+    ASSERT_STR_CONTAINS(r, "val=2");
+  }
+
+  // The deleted row is absent to a later INSERT like any deleted row.
+  ASSERT_OK(Write(RowOperationsPB::INSERT, 2, now, 3));
+}
+
+// Writes see the latest TTL value of the row they hit, including updates to
+// it in a DiskRowSet's deltas or in the MemRowSet.
+TEST_F(TabletTtlTest, TestWritesSeeUpdatedTtlValue) {
+  const int64_t t = NowMicros();
+  const int64_t later = t + 1000 * 1000000LL;
+  ASSERT_OK(Write(RowOperationsPB::INSERT, 0, t, 1));
+  ASSERT_OK(Write(RowOperationsPB::INSERT, 1, t, 1));
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_OK(Write(RowOperationsPB::INSERT, 2, t, 1));
+
+  // Row 0's new TTL value is in a delta file, row 1's in the DeltaMemStore,
+  // and row 2's in the MemRowSet.
+  ASSERT_OK(Write(RowOperationsPB::UPDATE, 0, later, 1));
+  ASSERT_OK(tablet()->FlushBiggestDMS());
+  ASSERT_OK(Write(RowOperationsPB::UPDATE, 1, later, 1));
+  ASSERT_OK(Write(RowOperationsPB::UPDATE, 2, later, 1));
+
+  // None of the rows are expired, so they're still present to writes.
+  AddTimeToHybridClock(MonoDelta::FromSeconds(150));
+  for (int64_t key = 0; key < 3; key++) {
+    Status s = Write(RowOperationsPB::INSERT, key, later, 2);
+    ASSERT_TRUE(s.IsAlreadyPresent()) << s.ToString();
+    ASSERT_OK(Write(RowOperationsPB::UPDATE, key, later, 2));
+  }
+
+  vector<string> rows;
+  NO_FATALS(ScanAt(clock()->Now(), &rows));
+  ASSERT_EQ(3, rows.size());
+  for (const string& r : rows) {
+    ASSERT_STR_CONTAINS(r, "val=2");
+  }
+}
+
+} // namespace tablet
+} // namespace kudu
@@ -157,6 +157,7 @@ Status WriteTransaction::Apply(gscoped_ptr<CommitMsg>* commit_msg) {
 
   Tablet* tablet = state()->tablet_replica()->tablet();
 
+  tablet->StartApplying(state());
   tablet->ApplyRowOperations(state());
 
   // Add per-row errors to the result, update metrics.
@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -335,6 +336,45 @@ TEST_F(TabletCopyTest, TestBlocksEqual) {
   }
 }
 
+// Test fetching blocks in small pieces, which are read ahead by the session,
+// and that pieces fetched out of order are still correct.
+TEST_F(TabletCopyTest, TestBlockPiecesReadAhead) {
+  const int64_t kPieceSize = 100;
+  TabletSuperBlockPB tablet_superblock;
+  ASSERT_OK(tablet()->metadata()->ToSuperBlock(&tablet_superblock));
+  for (const RowSetDataPB& rowset : tablet_superblock.rowsets()) {
+    for (const ColumnDataPB& column : rowset.columns()) {
+      BlockId block_id = BlockId::FromPB(column.block());
+
+      unique_ptr<ReadableBlock> tablet_block;
+      ASSERT_OK(fs_manager()->OpenBlock(block_id, &tablet_block));
+      uint64_t tablet_block_size = 0;
+      ASSERT_OK(tablet_block->Size(&tablet_block_size));
+      faststring buf;
+      buf.resize(tablet_block_size);
+      Slice expected(buf.data(), tablet_block_size);
+      ASSERT_OK(tablet_block->Read(0, &expected));
+
+      // Fetch the block sequentially, going back to the start halfway through.
+      vector<uint64_t> offsets;
+      for (uint64_t offset = 0; offset < tablet_block_size; offset += kPieceSize) {
+        offsets.push_back(offset);
+      }
+      offsets.insert(offsets.begin() + offsets.size() / 2, 0);
+      for (uint64_t offset : offsets) {
+        string data;
+        int64_t block_file_size;
+        TabletCopyErrorPB::Code error_code;
+        ASSERT_OK(session_->GetBlockPiece(block_id, offset, kPieceSize,
+                                          &data, &block_file_size, &error_code));
+        ASSERT_EQ(tablet_block_size, block_file_size);
+        ASSERT_EQ(std::min<uint64_t>(kPieceSize, tablet_block_size - offset), data.size());
+        ASSERT_EQ(0, memcmp(data.data(), expected.data() + offset, data.size()));
+      }
+    }
+  }
+}
+
 // Ensure that blocks are still readable through the open session even
 // after they've been deleted.
 TEST_F(TabletCopyTest, TestBlocksAreFetchableAfterBeingDeleted) {
@@ -19,6 +19,8 @@
 #include <algorithm>
 #include <cstdint>
 #include <cstring>
+#include <memory>
+#include <mutex>
 #include <ostream>
 #include <vector>
 
@@ -44,6 +46,7 @@
 #include "kudu/rpc/transfer.h"
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/tablet/tablet_replica.h"
+#include "kudu/util/countdown_latch.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/mutex.h"
 #include "kudu/util/pb_util.h"
@@ -56,6 +59,12 @@ DEFINE_int32(tablet_copy_transfer_chunk_size_bytes, 4 * 1024 * 1024,
              "tablet servers.");
 TAG_FLAG(tablet_copy_transfer_chunk_size_bytes, hidden);
 
+DEFINE_bool(tablet_copy_read_ahead, true,
+            "Whether tablet copy sources read the next piece of a block "
+            "asynchronously while sending the current piece.");
+TAG_FLAG(tablet_copy_read_ahead, advanced);
+TAG_FLAG(tablet_copy_read_ahead, runtime);
+
 METRIC_DEFINE_counter(server, tablet_copy_bytes_sent,
                       "Bytes Sent For Tablet Copy",
                       kudu::MetricUnit::kBytes,
@@ -200,6 +209,76 @@ const std::string& TabletCopySourceSession::requestor_uuid() const {
   return requestor_uuid_;
 }
 
+struct ImmutableReadableBlockInfo::ReadAhead {
+  ReadAhead(uint64_t offset, size_t length)
+      : offset(offset),
+        buf(new uint8_t[length]),
+        results({ Slice(buf.get(), length) }),
+        done(1) {
+  }
+
+  const uint64_t offset;
+  unique_ptr<uint8_t[]> buf;
+  vector<Slice> results;
+  CountDownLatch done;
+  Status status;
+};
+
+ImmutableReadableBlockInfo::ImmutableReadableBlockInfo(ReadableBlock* readable,
+                                                       int64_t size)
+    : readable(readable),
+      size(size) {
+}
+
+ImmutableReadableBlockInfo::~ImmutableReadableBlockInfo() {
+  TakeReadAhead();
+}
+
+shared_ptr<ImmutableReadableBlockInfo::ReadAhead>
+ImmutableReadableBlockInfo::TakeReadAhead() const {
+  shared_ptr<ReadAhead> ra;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    ra.swap(read_ahead_);
+  }
+  if (ra) {
+    ra->done.Wait();
+  }
+  return ra;
+}
+
+Status ImmutableReadableBlockInfo::Read(uint64_t offset, Slice* data) const {
+  // If the read ahead failed, read again so that the error is reported in
+  // the context of this request.
+  shared_ptr<ReadAhead> ra = TakeReadAhead();
+  if (ra && ra->status.ok() && ra->offset == offset &&
+      ra->results[0].size() >= data->size()) {
+    memcpy(data->mutable_data(), ra->results[0].data(), data->size());
+  } else {
+    RETURN_NOT_OK(readable->Read(offset, data));
+  }
+
+  const uint64_t next_offset = offset + data->size();
+  if (!FLAGS_tablet_copy_read_ahead || next_offset >= size) {
+    return Status::OK();
+  }
+  ra = std::make_shared<ReadAhead>(
+      next_offset, std::min<uint64_t>(data->size(), size - next_offset));
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (read_ahead_) {
+      // Another request for this block is already reading ahead.
+      return Status::OK();
+    }
+    read_ahead_ = ra;
+  }
+  readable->ReadVAsync(next_offset, &ra->results, [ra](const Status& s) {
+    ra->status = s;
+    ra->done.CountDown();
+  });
+  return Status::OK();
+}
+
 // Determine the length of the data chunk to return to the client.
 static int64_t DetermineReadLength(int64_t bytes_remaining, int64_t requested_len) {
   // Overhead in the RPC for things like headers, protobuf data, etc.
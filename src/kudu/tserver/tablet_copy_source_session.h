@@ -37,6 +37,7 @@
 #include "kudu/tserver/tablet_copy.pb.h"
 #include "kudu/util/env.h"
 #include "kudu/gutil/integral_types.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/mutex.h"
 #include "kudu/util/status.h"
@@ -77,19 +78,32 @@ struct ImmutableRandomAccessFileInfo {
 
 // Caches block size and holds an exclusive reference to a ReadableBlock.
 // Assumes that the block underlying the ReadableBlock is immutable.
+//
+// Clients fetch blocks piece by piece from start to end, so after each read
+// the following piece is read asynchronously, overlapping the disk read with
+// sending the current piece and the client's next request.
 struct ImmutableReadableBlockInfo {
   std::unique_ptr<fs::ReadableBlock> readable;
   int64_t size;
 
   ImmutableReadableBlockInfo(fs::ReadableBlock* readable,
-                             int64_t size)
-  : readable(readable),
-    size(size) {
-  }
+                             int64_t size);
 
-  Status Read(uint64_t offset, Slice* data) const {
-    return readable->Read(offset, data);
-  }
+  // Waits for any read ahead, which requires the block to remain open.
+  ~ImmutableReadableBlockInfo();
+
+  Status Read(uint64_t offset, Slice* data) const;
+
+ private:
+  struct ReadAhead;
+
+  // Returns the pending read ahead, if any, once it has finished.
+  std::shared_ptr<ReadAhead> TakeReadAhead() const;
+
+  mutable simple_spinlock lock_;
+  mutable std::shared_ptr<ReadAhead> read_ahead_; // Protected by lock_.
+
+  DISALLOW_COPY_AND_ASSIGN(ImmutableReadableBlockInfo);
 };
 
 // A potential Learner must establish a TabletCopySourceSession with the leader in order
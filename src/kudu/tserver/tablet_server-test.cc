@@ -45,9 +45,12 @@
 #include "kudu/common/wire_protocol-test-util.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/common/wire_protocol.pb.h"
+#include "kudu/consensus/consensus.pb.h"
+#include "kudu/consensus/consensus.proxy.h"
 #include "kudu/consensus/log-test-base.h"
 #include "kudu/consensus/log.h"
 #include "kudu/consensus/metadata.pb.h"
+#include "kudu/consensus/opid_util.h"
 #include "kudu/fs/fs.pb.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/casts.h"
@@ -60,6 +63,7 @@
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/server/rpc_server.h"
 #include "kudu/server/server_base.pb.h"
 #include "kudu/server/server_base.proxy.h"
@@ -99,11 +103,17 @@
 using google::protobuf::util::MessageDifferencer;
 using kudu::clock::Clock;
 using kudu::clock::HybridClock;
+using kudu::consensus::ConsensusErrorPB;
+using kudu::consensus::ConsensusRequestPB;
+using kudu::consensus::ConsensusResponsePB;
+using kudu::consensus::MultiRaftUpdateConsensusRequestPB;
+using kudu::consensus::MultiRaftUpdateConsensusResponsePB;
 using kudu::pb_util::SecureDebugString;
 using kudu::pb_util::SecureShortDebugString;
 using kudu::rpc::Messenger;
 using kudu::rpc::MessengerBuilder;
 using kudu::rpc::RpcController;
+using kudu::rpc::RpcSidecar;
 using kudu::tablet::Tablet;
 using kudu::tablet::TabletReplica;
 using kudu::tablet::TabletSuperBlockPB;
@@ -122,6 +132,7 @@ DEFINE_int32(single_threaded_insert_latency_bench_insert_rows, 1000,
              " tablet server insert latency micro-benchmark");
 
 DECLARE_bool(fail_dns_resolution);
+DECLARE_bool(raft_enable_leader_leases);
 DECLARE_int32(metrics_retirement_age_ms);
 DECLARE_int32(scanner_batch_size_rows);
 DECLARE_string(block_manager);
@@ -1312,6 +1323,89 @@ TEST_F(TabletServerTest, TestSnapshotScan_WithoutSnapshotTimestamp) {
   ASSERT_GT(resp.propagated_timestamp(), resp.snap_timestamp());
 }
 
+// Tests that a leader holding a lease scans just past its latest committed
+// write rather than at the current time.
+TEST_F(TabletServerTest, TestSnapshotScan_LeaderLease) {
+  FLAGS_raft_enable_leader_leases = true;
+  vector<uint64_t> write_timestamps_collector;
+  // perform a write
+  InsertTestRowsRemote(0, 0, 1, 1, nullptr, kTabletId, &write_timestamps_collector);
+
+  // A single voter holds the lease on its own.
+  Timestamp term_start_timestamp;
+  ASSERT_TRUE(tablet_replica_->consensus()->HasLeaderLease(&term_start_timestamp));
+  ASSERT_LT(term_start_timestamp.ToUint64(), write_timestamps_collector[0]);
+
+  ScanRequestPB req;
+  ScanResponsePB resp;
+  RpcController rpc;
+
+  // Set up a new request with no predicates, all columns.
+  const Schema& projection = schema_;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToColumnPBs(projection, scan->mutable_projected_columns()));
+  req.set_call_seq_id(0);
+  req.set_batch_size_bytes(0); // so it won't return data right away
+  scan->set_read_mode(READ_AT_SNAPSHOT);
+
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+  }
+  ASSERT_EQ(write_timestamps_collector[0] + 1, resp.snap_timestamp());
+  vector<string> results;
+  NO_FATALS(DrainScannerToStrings(resp.scanner_id(), schema_, &results));
+  ASSERT_EQ(1, results.size());
+}
+
+// Tests that a bounded-staleness scan is served by the leader, whose safe time
+// moves with its clock, and that it's rejected unless it's a snapshot scan.
+TEST_F(TabletServerTest, TestSnapshotScan_BoundedStaleness) {
+  vector<uint64_t> write_timestamps_collector;
+  // perform a write
+  InsertTestRowsRemote(0, 0, 1, 1, nullptr, kTabletId, &write_timestamps_collector);
+
+  ScanRequestPB req;
+  ScanResponsePB resp;
+  RpcController rpc;
+
+  // Set up a new request with no predicates, all columns.
+  const Schema& projection = schema_;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToColumnPBs(projection, scan->mutable_projected_columns()));
+  req.set_call_seq_id(0);
+  req.set_batch_size_bytes(0); // so it won't return data right away
+  scan->set_read_mode(READ_AT_SNAPSHOT);
+  scan->set_max_staleness_us(60000000);
+
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+  }
+  // The snapshot includes the write.
+  ASSERT_GE(resp.snap_timestamp(), write_timestamps_collector[0]);
+  vector<string> results;
+  NO_FATALS(DrainScannerToStrings(resp.scanner_id(), schema_, &results));
+  ASSERT_EQ(1, results.size());
+
+  scan->set_read_mode(READ_LATEST);
+  resp.Clear();
+  rpc.Reset();
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+  }
+}
+
 // Tests that a snapshot in the future (beyond the current time plus maximum
 // synchronization error) fails as an invalid snapshot.
 TEST_F(TabletServerTest, TestSnapshotScan_SnapshotInTheFutureFails) {
@@ -2166,6 +2260,90 @@ TEST_F(TabletServerTest, TestDeleteTablet_TabletNotCreated) {
   }
 }
 
+// Test that the requests in a MultiRaftUpdateConsensus batch are applied, and
+// fail, independently of one another.
+TEST_F(TabletServerTest, TestMultiRaftUpdateConsensus) {
+  const string uuid = mini_server_->server()->fs_manager()->uuid();
+  MultiRaftUpdateConsensusRequestPB req;
+  MultiRaftUpdateConsensusResponsePB resp;
+  RpcController rpc;
+
+  // A batch addressed to another server is rejected as a whole.
+  req.set_dest_uuid("NotThisServer");
+  ASSERT_OK(consensus_proxy_->MultiRaftUpdateConsensus(req, &resp, &rpc));
+  ASSERT_TRUE(resp.has_error());
+  ASSERT_EQ(TabletServerErrorPB::WRONG_SERVER_UUID, resp.error().code());
+
+  req.set_dest_uuid(uuid);
+  // A heartbeat from a deposed leader.
+  ConsensusRequestPB* stale = req.add_requests();
+  stale->set_dest_uuid(uuid);
+  stale->set_tablet_id(kTabletId);
+  stale->set_caller_uuid("OtherServer");
+  stale->set_caller_term(0);
+  // A heartbeat for a tablet the server doesn't host.
+  ConsensusRequestPB* missing = req.add_requests();
+  missing->CopyFrom(*stale);
+  missing->set_tablet_id("NotPresentTabletId");
+  // A request carrying operations, which may not be batched.
+  ConsensusRequestPB* with_ops = req.add_requests();
+  with_ops->CopyFrom(*stale);
+  consensus::ReplicateMsg* op = with_ops->add_ops();
+  op->mutable_id()->CopyFrom(consensus::MakeOpId(1, 100));
+  op->set_timestamp(0);
+  op->set_op_type(consensus::NO_OP);
+
+  rpc.Reset();
+  resp.Clear();
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(consensus_proxy_->MultiRaftUpdateConsensus(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_EQ(3, resp.responses_size());
+    ASSERT_FALSE(resp.responses(0).has_error());
+    ASSERT_EQ(ConsensusErrorPB::INVALID_TERM, resp.responses(0).status().error().code());
+    ASSERT_EQ(TabletServerErrorPB::TABLET_NOT_FOUND, resp.responses(1).error().code());
+    ASSERT_TRUE(StatusFromPB(resp.responses(2).error().status()).IsInvalidArgument());
+  }
+}
+
+// Test that UpdateConsensus rejects a request whose operations sidecar can't
+// be parsed or wasn't sent.
+TEST_F(TabletServerTest, TestUpdateConsensusWithCorruptOpsSidecar) {
+  ConsensusRequestPB req;
+  req.set_dest_uuid(mini_server_->server()->fs_manager()->uuid());
+  req.set_tablet_id(kTabletId);
+  req.set_caller_uuid("OtherServer");
+  req.set_caller_term(0);
+  ConsensusResponsePB resp;
+
+  {
+    RpcController rpc;
+    unique_ptr<faststring> garbage(new faststring());
+    garbage->append("\xff\xff\xff");
+    int idx;
+    ASSERT_OK(rpc.AddOutboundSidecar(RpcSidecar::FromFaststring(std::move(garbage)), &idx));
+    req.set_ops_sidecar_idx(idx);
+    rpc.RequireServerFeature(consensus::OPS_SIDECAR);
+    ASSERT_OK(consensus_proxy_->UpdateConsensus(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_TRUE(StatusFromPB(resp.error().status()).IsCorruption());
+  }
+
+  {
+    RpcController rpc;
+    resp.Clear();
+    req.set_ops_sidecar_idx(1);
+    rpc.RequireServerFeature(consensus::OPS_SIDECAR);
+    ASSERT_OK(consensus_proxy_->UpdateConsensus(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_TRUE(StatusFromPB(resp.error().status()).IsInvalidArgument());
+  }
+}
+
 // Test that with concurrent requests to delete the same tablet, one wins and
 // the other fails, with no assertion failures. Regression test for KUDU-345.
 TEST_F(TabletServerTest, TestConcurrentDeleteTablet) {
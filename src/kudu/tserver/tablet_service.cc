@@ -34,6 +34,7 @@
 #include <glog/logging.h>
 
 #include "kudu/clock/clock.h"
+#include "kudu/clock/hybrid_clock.h"
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
@@ -51,6 +52,7 @@
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/consensus/metadata.pb.h"
 #include "kudu/consensus/opid.pb.h"
+#include "kudu/consensus/ops_sidecar.h"
 #include "kudu/consensus/raft_consensus.h"
 #include "kudu/consensus/time_manager.h"
 #include "kudu/gutil/casts.h"
@@ -124,6 +126,20 @@ DEFINE_int32(scanner_max_wait_ms, 1000,
              "longer.");
 TAG_FLAG(scanner_max_wait_ms, advanced);
 
+DEFINE_bool(consensus_support_ops_sidecar, true,
+            "Whether to accept the operations of UpdateConsensus requests in an "
+            "RPC sidecar. Used for testing version compatibility fallback in "
+            "the leader.");
+TAG_FLAG(consensus_support_ops_sidecar, unsafe);
+TAG_FLAG(consensus_support_ops_sidecar, hidden);
+
+DEFINE_bool(consensus_support_multi_raft_update, true,
+            "Whether to accept MultiRaftUpdateConsensus RPCs, i.e. batched "
+            "heartbeats. Used for testing version compatibility fallback in "
+            "the leader.");
+TAG_FLAG(consensus_support_multi_raft_update, unsafe);
+TAG_FLAG(consensus_support_multi_raft_update, hidden);
+
 // Fault injection flags.
 DEFINE_int32(scanner_inject_latency_on_each_batch_ms, 0,
              "If set, the scanner will pause the specified number of milliesconds "
@@ -137,6 +153,7 @@ DECLARE_int32(tablet_history_max_age_sec);
 using google::protobuf::RepeatedPtrField;
 using kudu::consensus::ChangeConfigRequestPB;
 using kudu::consensus::ChangeConfigResponsePB;
+using kudu::consensus::ConsensusFeatures;
 using kudu::consensus::ConsensusRequestPB;
 using kudu::consensus::ConsensusResponsePB;
 using kudu::consensus::GetLastOpIdRequestPB;
@@ -144,6 +161,8 @@ using kudu::consensus::GetNodeInstanceRequestPB;
 using kudu::consensus::GetNodeInstanceResponsePB;
 using kudu::consensus::LeaderStepDownRequestPB;
 using kudu::consensus::LeaderStepDownResponsePB;
+using kudu::consensus::MultiRaftUpdateConsensusRequestPB;
+using kudu::consensus::MultiRaftUpdateConsensusResponsePB;
 using kudu::consensus::OpId;
 using kudu::consensus::UnsafeChangeConfigRequestPB;
 using kudu::consensus::UnsafeChangeConfigResponsePB;
@@ -207,24 +226,34 @@ bool LookupTabletReplicaOrRespond(TabletReplicaLookupIf* tablet_manager,
   return true;
 }
 
-template<class RespClass>
-void RespondTabletNotRunning(const scoped_refptr<TabletReplica>& replica,
+// Returns the error describing that 'replica' is not running, setting
+// 'error_code' to the code to report it with.
+Status TabletNotRunningError(const scoped_refptr<TabletReplica>& replica,
                              tablet::TabletStatePB tablet_state,
-                             RespClass* resp,
-                             rpc::RpcContext* context) {
+                             TabletServerErrorPB::Code* error_code) {
   Status s = Status::IllegalState("Tablet not RUNNING",
                                   tablet::TabletStatePB_Name(tablet_state));
-  auto error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+  *error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
   if (replica->tablet_metadata()->tablet_data_state() == TABLET_DATA_TOMBSTONED ||
       replica->tablet_metadata()->tablet_data_state() == TABLET_DATA_DELETED) {
     // Treat tombstoned tablets as if they don't exist for most purposes.
     // This takes precedence over failed, since we don't reset the failed
     // status of a TabletReplica when deleting it. Only tablet copy does that.
-    error_code = TabletServerErrorPB::TABLET_NOT_FOUND;
+    *error_code = TabletServerErrorPB::TABLET_NOT_FOUND;
   } else if (tablet_state == tablet::FAILED) {
     s = s.CloneAndAppend(replica->error().ToString());
-    error_code = TabletServerErrorPB::TABLET_FAILED;
+    *error_code = TabletServerErrorPB::TABLET_FAILED;
   }
+  return s;
+}
+
+template<class RespClass>
+void RespondTabletNotRunning(const scoped_refptr<TabletReplica>& replica,
+                             tablet::TabletStatePB tablet_state,
+                             RespClass* resp,
+                             rpc::RpcContext* context) {
+  TabletServerErrorPB::Code error_code;
+  Status s = TabletNotRunningError(replica, tablet_state, &error_code);
   SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
 }
 
@@ -310,6 +339,50 @@ bool GetConsensusOrRespond(const scoped_refptr<TabletReplica>& replica,
   return true;
 }
 
+// Applies one of the requests of a MultiRaftUpdateConsensus batch. Returns an
+// error, setting 'error_code' to the code to report it with, if the request
+// could not be applied. If the replica is busy with another update, sets
+// 'busy' to true and returns without waiting for it.
+Status UpdateConsensusInBatch(TabletReplicaLookupIf* tablet_manager,
+                              const ConsensusRequestPB& req,
+                              ConsensusResponsePB* resp,
+                              bool* busy,
+                              TabletServerErrorPB::Code* error_code) {
+  *busy = false;
+  *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+  if (PREDICT_FALSE(req.ops_size() > 0 || req.has_ops_sidecar_idx())) {
+    return Status::InvalidArgument("batched consensus requests may not carry operations");
+  }
+  scoped_refptr<TabletReplica> replica;
+  Status s = tablet_manager->GetTabletReplica(req.tablet_id(), &replica);
+  if (PREDICT_FALSE(!s.ok())) {
+    *error_code = TabletServerErrorPB::TABLET_NOT_FOUND;
+    return s;
+  }
+  tablet::TabletStatePB state = replica->state();
+  if (PREDICT_FALSE(state != tablet::RUNNING)) {
+    return TabletNotRunningError(replica, state, error_code);
+  }
+  shared_ptr<RaftConsensus> consensus = replica->shared_consensus();
+  if (PREDICT_FALSE(!consensus)) {
+    *error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+    return Status::ServiceUnavailable("Raft Consensus unavailable",
+                                      "Tablet replica not initialized");
+  }
+  return consensus->TryUpdate(&req, resp, busy);
+}
+
+// Merges the operations that a leader sent in a sidecar of 'context' into
+// 'req' (see ConsensusRequestPB::ops_sidecar_idx), and sets 'serialized_ops'
+// to their serialized form, which points into the sidecar.
+Status MergeOpsFromSidecar(rpc::RpcContext* context,
+                           ConsensusRequestPB* req,
+                           vector<Slice>* serialized_ops) {
+  Slice ops_data;
+  RETURN_NOT_OK(context->GetInboundSidecar(req->ops_sidecar_idx(), &ops_data));
+  return consensus::MergeOpsFromSidecar(ops_data, req, serialized_ops);
+}
+
 Status GetTabletRef(const scoped_refptr<TabletReplica>& replica,
                     shared_ptr<Tablet>* tablet,
                     TabletServerErrorPB::Code* error_code) {
@@ -940,6 +1013,22 @@ void ConsensusServiceImpl::UpdateConsensus(const ConsensusRequestPB* req,
   if (!CheckUuidMatchOrRespond(tablet_manager_, "UpdateConsensus", req, resp, context)) {
     return;
   }
+  // If the ops were sent in a sidecar, they're merged into a copy of the
+  // request, which is cheap to make since the request itself holds no ops.
+  // Their serialized form is passed along so they aren't serialized again.
+  ConsensusRequestPB req_with_ops;
+  vector<Slice> serialized_ops;
+  if (req->has_ops_sidecar_idx()) {
+    req_with_ops.CopyFrom(*req);
+    req = &req_with_ops;
+    Status s = MergeOpsFromSidecar(context, &req_with_ops, &serialized_ops);
+    if (PREDICT_FALSE(!s.ok())) {
+      SetupErrorAndRespond(resp->mutable_error(), s,
+                           TabletServerErrorPB::UNKNOWN_ERROR,
+                           context);
+      return;
+    }
+  }
   scoped_refptr<TabletReplica> replica;
   if (!LookupRunningTabletReplicaOrRespond(tablet_manager_, req->tablet_id(), resp, context,
                                            &replica)) {
@@ -951,7 +1040,8 @@ void ConsensusServiceImpl::UpdateConsensus(const ConsensusRequestPB* req,
   // Submit the update directly to the TabletReplica's RaftConsensus instance.
   shared_ptr<RaftConsensus> consensus;
   if (!GetConsensusOrRespond(replica, resp, context, &consensus)) return;
-  Status s = consensus->Update(req, resp);
+  Status s = req == &req_with_ops ? consensus->Update(req, serialized_ops, resp)
+                                  : consensus->Update(req, resp);
   if (PREDICT_FALSE(!s.ok())) {
     // Clear the response first, since a partially-filled response could
     // result in confusing a caller, or in having missing required fields
@@ -966,6 +1056,55 @@ void ConsensusServiceImpl::UpdateConsensus(const ConsensusRequestPB* req,
   context->RespondSuccess();
 }
 
+bool ConsensusServiceImpl::SupportsFeature(uint32_t feature) const {
+  switch (feature) {
+    case ConsensusFeatures::OPS_SIDECAR:
+      return FLAGS_consensus_support_ops_sidecar;
+    default:
+      return false;
+  }
+}
+
+void ConsensusServiceImpl::MultiRaftUpdateConsensus(
+    const MultiRaftUpdateConsensusRequestPB* req,
+    MultiRaftUpdateConsensusResponsePB* resp,
+    rpc::RpcContext* context) {
+  DVLOG(3) << "Received Multi-Raft Consensus Update RPC with " << req->requests_size()
+           << " requests";
+  if (PREDICT_FALSE(!FLAGS_consensus_support_multi_raft_update)) {
+    context->RespondRpcFailure(rpc::ErrorStatusPB::ERROR_NO_SUCH_METHOD,
+                               Status::NotSupported("MultiRaftUpdateConsensus not supported"));
+    return;
+  }
+  if (!CheckUuidMatchOrRespond(tablet_manager_, "MultiRaftUpdateConsensus", req, resp,
+                               context)) {
+    return;
+  }
+  // The requests are applied one after another on this thread. Those whose
+  // replica is busy, e.g. appending operations, are handed back rather than
+  // waited for, so that one slow replica doesn't delay the heartbeats of all
+  // the others.
+  for (int i = 0; i < req->requests_size(); i++) {
+    const ConsensusRequestPB& tablet_req = req->requests(i);
+    ConsensusResponsePB* tablet_resp = resp->add_responses();
+    bool busy;
+    TabletServerErrorPB::Code error_code;
+    Status s = UpdateConsensusInBatch(tablet_manager_, tablet_req, tablet_resp, &busy,
+                                      &error_code);
+    if (busy) {
+      resp->add_deferred_idx(i);
+      continue;
+    }
+    if (PREDICT_FALSE(!s.ok())) {
+      // As in UpdateConsensus(), don't leave a partially-filled response.
+      tablet_resp->Clear();
+      StatusToPB(s, tablet_resp->mutable_error()->mutable_status());
+      tablet_resp->mutable_error()->set_code(error_code);
+    }
+  }
+  context->RespondSuccess();
+}
+
 void ConsensusServiceImpl::RequestConsensusVote(const VoteRequestPB* req,
                                                 VoteResponsePB* resp,
                                                 rpc::RpcContext* context) {
@@ -1430,6 +1569,7 @@ bool TabletServiceImpl::SupportsFeature(uint32_t feature) const {
   switch (feature) {
     case TabletServerFeatures::COLUMN_PREDICATES:
     case TabletServerFeatures::PAD_UNIXTIME_MICROS_TO_16_BYTES:
+    case TabletServerFeatures::BOUNDED_STALENESS_SCANS:
       return true;
     default:
       return false;
@@ -1583,6 +1723,17 @@ static Status SetupScanSpec(const NewScanRequestPB& scan_pb,
     }
   }
 
+  // If the table has a TTL column, the scan gets a predicate on it which hides
+  // expired rows (see AddTtlPredicate()), so the column must be read.
+  if (tablet_schema.ttl_column_idx() != Schema::kColumnNotFound) {
+    const ColumnSchema& col = tablet_schema.column(tablet_schema.ttl_column_idx());
+    if (projection.find_column(col.name()) == Schema::kColumnNotFound &&
+        !ContainsKey(missing_col_names, col.name())) {
+      missing_cols->push_back(col);
+      InsertOrDie(&missing_col_names, col.name());
+    }
+  }
+
   // When doing an ordered scan, we need to include the key columns to be able to encode
   // the last row key for the scan response.
   if (scan_pb.order_mode() == kudu::ORDERED &&
@@ -1604,6 +1755,22 @@ static Status SetupScanSpec(const NewScanRequestPB& scan_pb,
 }
 
 namespace {
+// If the table has a TTL column, adds a predicate to 'spec' which hides the
+// rows that have expired as of the scan's snapshot, or as of now for a
+// READ_LATEST scan. The predicate also lets the tablet skip expired rowsets.
+void AddTtlPredicate(const Tablet& tablet, const Schema& tablet_schema, ReadMode read_mode,
+                     Timestamp snap_timestamp, const SharedScanner& scanner, ScanSpec* spec) {
+  Timestamp expiry_timestamp = read_mode == READ_AT_SNAPSHOT ?
+      snap_timestamp : tablet.clock()->Now();
+  int64_t ttl_cutoff_micros;
+  if (!tablet.GetTtlCutoff(expiry_timestamp, &ttl_cutoff_micros)) {
+    return;
+  }
+  const ColumnSchema& col = tablet_schema.column(tablet_schema.ttl_column_idx());
+  int64_t* cutoff = scanner->arena()->NewObject<int64_t>(ttl_cutoff_micros);
+  spec->AddPredicate(ColumnPredicate::Range(col, cutoff, nullptr));
+}
+
 // Checks if 'timestamp' is before the 'tablet's AHM if this is a READ_AT_SNAPSHOT scan.
 // Returns Status::OK() if it's not or Status::InvalidArgument() if it is.
 Status VerifyNotAncientHistory(Tablet* tablet, ReadMode read_mode, Timestamp timestamp) {
@@ -1665,6 +1832,12 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     return Status::InvalidArgument("User requests should not have Column IDs");
   }
 
+  if (scan_pb.has_max_staleness_us() && scan_pb.read_mode() != READ_AT_SNAPSHOT) {
+    *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+    return Status::InvalidArgument("Cannot bound the staleness of a scan that is not a "
+                                   "snapshot read");
+  }
+
   if (scan_pb.order_mode() == ORDERED) {
     // Ordered scans must be at a snapshot so that we perform a serializable read (which can be
     // resumed). Otherwise, this would be read committed isolation, which is not resumable.
@@ -1674,6 +1847,9 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     }
   }
 
+  shared_ptr<Tablet> tablet;
+  RETURN_NOT_OK(GetTabletRef(replica, &tablet, error_code));
+
   gscoped_ptr<ScanSpec> spec(new ScanSpec);
 
   // Missing columns will contain the columns that are not mentioned in the client
@@ -1716,8 +1892,6 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
   // Preset the error code for when creating the iterator on the tablet fails
   TabletServerErrorPB::Code tmp_error_code = TabletServerErrorPB::MISMATCHED_SCHEMA;
 
-  shared_ptr<Tablet> tablet;
-  RETURN_NOT_OK(GetTabletRef(replica, &tablet, error_code));
   {
     TRACE("Creating iterator");
     TRACE_EVENT0("tserver", "Create iterator");
@@ -1733,8 +1907,14 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
         break;
       }
       case READ_AT_SNAPSHOT: {
+        bool replica_too_stale = false;
         s = HandleScanAtSnapshot(scan_pb, rpc_context, projection, replica,
-                                 &iter, snap_timestamp);
+                                 &iter, snap_timestamp, &replica_too_stale);
+        // Let the client retry a bounded-staleness scan at another replica.
+        if (replica_too_stale) {
+          *error_code = TabletServerErrorPB::REPLICA_TOO_STALE;
+          return s;
+        }
         // If we got a Status::ServiceUnavailable() from HandleScanAtSnapshot() it might
         // mean we're just behind so let the client try again.
         if (s.IsServiceUnavailable()) {
@@ -1751,6 +1931,11 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     }
   }
 
+  if (PREDICT_TRUE(s.ok())) {
+    AddTtlPredicate(*tablet, tablet_schema, scan_pb.read_mode(), *snap_timestamp, scanner,
+                    spec.get());
+  }
+
   // Make a copy of the optimized spec before it's passed to the iterator.
   // This copy will be given to the Scanner so it can report its predicates to
   // /scans. The copy is necessary because the original spec will be modified
@@ -2012,7 +2197,8 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
                                                const Schema& projection,
                                                TabletReplica* replica,
                                                gscoped_ptr<RowwiseIterator>* iter,
-                                               Timestamp* snap_timestamp) {
+                                               Timestamp* snap_timestamp,
+                                               bool* replica_too_stale) {
   // If the client sent a timestamp update our clock with it.
   if (scan_pb.has_propagated_timestamp()) {
     Timestamp propagated_timestamp(scan_pb.propagated_timestamp());
@@ -2027,9 +2213,38 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
   Timestamp tmp_snap_timestamp;
 
   // If the client provided no snapshot timestamp we take the current clock
-  // time as the snapshot timestamp.
+  // time as the snapshot timestamp, or for a bounded-staleness scan, the
+  // replica's safe time.
   if (!scan_pb.has_snap_timestamp()) {
-    tmp_snap_timestamp = server_->clock()->Now();
+    if (scan_pb.has_max_staleness_us()) {
+      RETURN_NOT_OK(PickBoundedStalenessSnapshot(scan_pb, replica, &tmp_snap_timestamp,
+                                                 replica_too_stale));
+    } else {
+      tmp_snap_timestamp = server_->clock()->Now();
+
+      // A leader holding a lease knows of every operation that any leader may
+      // have acknowledged: those of previous terms precede the first one of
+      // its term, and those of its term have committed. So it can scan just
+      // past the latest of them, only waiting for the in-flight operations
+      // that precede it rather than for all of them. The lease is checked
+      // after reading the MVCC state, so that no other leader can have
+      // acknowledged anything by then.
+      Timestamp lease_snap_timestamp =
+          replica->tablet()->mvcc_manager()->GetNoneCommittedAtOrAfterTimestamp();
+      Timestamp term_start_timestamp;
+      if (replica->consensus()->HasLeaderLease(&term_start_timestamp)) {
+        lease_snap_timestamp = std::max(lease_snap_timestamp, term_start_timestamp);
+        if (scan_pb.has_propagated_timestamp()) {
+          lease_snap_timestamp = std::max(lease_snap_timestamp,
+                                          Timestamp(scan_pb.propagated_timestamp() + 1));
+        }
+        if (lease_snap_timestamp < tmp_snap_timestamp) {
+          TRACE("Scanning at $0 under the leader lease",
+                server_->clock()->Stringify(lease_snap_timestamp));
+          tmp_snap_timestamp = lease_snap_timestamp;
+        }
+      }
+    }
   // ... else we use the client provided one, but make sure it is not too far
   // in the future as to be invalid.
   } else {
@@ -2111,5 +2326,45 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
   return Status::OK();
 }
 
+Status TabletServiceImpl::PickBoundedStalenessSnapshot(const NewScanRequestPB& scan_pb,
+                                                       TabletReplica* replica,
+                                                       Timestamp* snap_timestamp,
+                                                       bool* replica_too_stale) {
+  // Everything up to the safe time has been replicated to this replica, so a
+  // scan at the safe time doesn't need to wait for the replica to catch up
+  // with the leader, only for the operations it already has to commit.
+  Timestamp now = server_->clock()->Now();
+  Timestamp safe_time = replica->time_manager()->GetSafeTime();
+
+  Timestamp unused;
+  Status s = server_->clock()->GetGlobalLatest(&unused);
+  if (s.IsNotSupported()) {
+    // Without physical timestamps the staleness can't be measured.
+    if (PREDICT_TRUE(!FLAGS_scanner_allow_snapshot_scans_with_logical_timestamps)) {
+      return Status::NotSupported("Bounded-staleness scans not supported on this server",
+                                  s.ToString());
+    }
+    *snap_timestamp = safe_time;
+    return Status::OK();
+  }
+
+  uint64_t staleness_us = 0;
+  if (safe_time < now) {
+    staleness_us = clock::HybridClock::GetPhysicalValueMicros(now) -
+                   clock::HybridClock::GetPhysicalValueMicros(safe_time);
+  }
+  if (staleness_us > scan_pb.max_staleness_us()) {
+    *replica_too_stale = true;
+    return Status::ServiceUnavailable(
+        Substitute("replica's safe time $0 is $1us old, more than the allowed $2us",
+                   server_->clock()->Stringify(safe_time), staleness_us,
+                   scan_pb.max_staleness_us()));
+  }
+  TRACE("Scanning at safe time $0, $1us old", server_->clock()->Stringify(safe_time),
+        staleness_us);
+  *snap_timestamp = safe_time;
+  return Status::OK();
+}
+
 } // namespace tserver
 } // namespace kudu
@@ -57,6 +57,8 @@ class GetNodeInstanceRequestPB;
 class GetNodeInstanceResponsePB;
 class LeaderStepDownRequestPB;
 class LeaderStepDownResponsePB;
+class MultiRaftUpdateConsensusRequestPB;
+class MultiRaftUpdateConsensusResponsePB;
 class RunLeaderElectionRequestPB;
 class RunLeaderElectionResponsePB;
 class StartTabletCopyRequestPB;
@@ -148,7 +150,16 @@ class TabletServiceImpl : public TabletServerServiceIf {
                               const Schema& projection,
                               tablet::TabletReplica* tablet_replica,
                               gscoped_ptr<RowwiseIterator>* iter,
-                              Timestamp* snap_timestamp);
+                              Timestamp* snap_timestamp,
+                              bool* replica_too_stale);
+
+  // Picks the snapshot timestamp of a bounded-staleness scan (see
+  // NewScanRequestPB::max_staleness_us): the safe time of 'replica', if it's
+  // recent enough. Otherwise returns an error and sets 'replica_too_stale'.
+  Status PickBoundedStalenessSnapshot(const NewScanRequestPB& scan_pb,
+                                      tablet::TabletReplica* replica,
+                                      Timestamp* snap_timestamp,
+                                      bool* replica_too_stale);
 
   TabletServer* server_;
 };
@@ -188,10 +199,17 @@ class ConsensusServiceImpl : public consensus::ConsensusServiceIf {
                             google::protobuf::Message* resp,
                             rpc::RpcContext* rpc) override;
 
+  bool SupportsFeature(uint32_t feature) const override;
+
   virtual void UpdateConsensus(const consensus::ConsensusRequestPB* req,
                                consensus::ConsensusResponsePB* resp,
                                rpc::RpcContext* context) OVERRIDE;
 
+  virtual void MultiRaftUpdateConsensus(
+      const consensus::MultiRaftUpdateConsensusRequestPB* req,
+      consensus::MultiRaftUpdateConsensusResponsePB* resp,
+      rpc::RpcContext* context) OVERRIDE;
+
   virtual void RequestConsensusVote(const consensus::VoteRequestPB* req,
                                     consensus::VoteResponsePB* resp,
                                     rpc::RpcContext* context) OVERRIDE;
@@ -18,11 +18,14 @@
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include <gtest/gtest.h>
 
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/compression/compression.pb.h"
 #include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/slice.h"
@@ -31,6 +34,8 @@
 
 namespace kudu {
 
+using std::string;
+using std::unique_ptr;
 using std::vector;
 
 class TestCompression : public KuduTest {};
@@ -87,4 +92,62 @@ TEST_F(TestCompression, TestZlibCompressionCodec) {
   TestCompressionCodec(ZLIB);
 }
 
+// Test that compressing small, similar inputs with a dictionary built from
+// samples of them round-trips and is more effective than compressing them
+// independently.
+TEST_F(TestCompression, TestLz4CompressionDictionary) {
+  const CompressionCodec* codec;
+  ASSERT_OK(GetCompressionCodec(LZ4, &codec));
+  ASSERT_TRUE(codec->SupportsDictionary());
+
+  vector<string> inputs;
+  for (int i = 0; i < 20; i++) {
+    inputs.emplace_back(strings::Substitute(
+        "{ tablet_id: \"a3f1c2\" column_name: \"customer_id\" value: $0 "
+        "column_name: \"order_timestamp\" value: $1 }", i * 7919, i * 104729));
+  }
+  vector<Slice> samples(inputs.begin(), inputs.begin() + 10);
+  string dictionary = BuildCompressionDictionary(samples, 512);
+  ASSERT_LE(dictionary.size(), 512);
+  ASSERT_FALSE(dictionary.empty());
+
+  // A prepared dictionary is reused for every input.
+  unique_ptr<PreparedCompressionDictionary> prepared;
+  ASSERT_OK(codec->PrepareDictionary(dictionary, &prepared));
+
+  size_t total_plain = 0;
+  size_t total_with_dictionary = 0;
+  for (const string& input : inputs) {
+    gscoped_array<uint8_t> cbuffer(new uint8_t[codec->MaxCompressedLength(input.size())]);
+    size_t compressed;
+    ASSERT_OK(codec->Compress(input, cbuffer.get(), &compressed));
+    total_plain += compressed;
+
+    ASSERT_OK(codec->CompressWithDictionary(input, dictionary, cbuffer.get(), &compressed));
+    total_with_dictionary += compressed;
+    string output(input.size(), '\0');
+    ASSERT_OK(codec->UncompressWithDictionary(Slice(cbuffer.get(), compressed), dictionary,
+                                              reinterpret_cast<uint8_t*>(&output[0]),
+                                              output.size()));
+    ASSERT_EQ(input, output);
+
+    // Compressing with the prepared dictionary produces the same output.
+    gscoped_array<uint8_t> pbuffer(new uint8_t[codec->MaxCompressedLength(input.size())]);
+    size_t prepared_compressed;
+    ASSERT_OK(codec->CompressWithPreparedDictionary(input, *prepared, pbuffer.get(),
+                                                    &prepared_compressed));
+    ASSERT_EQ(Slice(cbuffer.get(), compressed), Slice(pbuffer.get(), prepared_compressed));
+  }
+  ASSERT_LT(total_with_dictionary, total_plain);
+
+  // Codecs without dictionary support say so.
+  ASSERT_OK(GetCompressionCodec(SNAPPY, &codec));
+  ASSERT_FALSE(codec->SupportsDictionary());
+  uint8_t buf[64];
+  size_t compressed;
+  ASSERT_TRUE(codec->CompressWithDictionary(inputs[0], dictionary, buf, &compressed)
+              .IsNotSupported());
+  ASSERT_TRUE(codec->PrepareDictionary(dictionary, &prepared).IsNotSupported());
+}
+
 } // namespace kudu
@@ -17,6 +17,7 @@
 
 #include "kudu/util/compression/compression_codec.h"
 
+#include <algorithm>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -28,6 +29,7 @@
 #include <snappy.h>
 #include <zlib.h>
 
+#include "kudu/gutil/casts.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/singleton.h"
 #include "kudu/gutil/stringprintf.h"
@@ -37,6 +39,8 @@
 
 namespace kudu {
 
+using std::string;
+using std::unique_ptr;
 using std::vector;
 
 CompressionCodec::CompressionCodec() {
@@ -44,6 +48,38 @@ CompressionCodec::CompressionCodec() {
 CompressionCodec::~CompressionCodec() {
 }
 
+Status CompressionCodec::CompressWithDictionary(const Slice& /*input*/,
+                                                const Slice& /*dictionary*/,
+                                                uint8_t* /*compressed*/,
+                                                size_t* /*compressed_length*/) const {
+  return Status::NotSupported("codec does not support dictionaries",
+                              CompressionType_Name(type()));
+}
+
+Status CompressionCodec::PrepareDictionary(
+    const Slice& /*dictionary*/,
+    unique_ptr<PreparedCompressionDictionary>* /*prepared*/) const {
+  return Status::NotSupported("codec does not support dictionaries",
+                              CompressionType_Name(type()));
+}
+
+Status CompressionCodec::CompressWithPreparedDictionary(
+    const Slice& /*input*/,
+    const PreparedCompressionDictionary& /*dictionary*/,
+    uint8_t* /*compressed*/,
+    size_t* /*compressed_length*/) const {
+  return Status::NotSupported("codec does not support dictionaries",
+                              CompressionType_Name(type()));
+}
+
+Status CompressionCodec::UncompressWithDictionary(const Slice& /*compressed*/,
+                                                  const Slice& /*dictionary*/,
+                                                  uint8_t* /*uncompressed*/,
+                                                  size_t /*uncompressed_length*/) const {
+  return Status::NotSupported("codec does not support dictionaries",
+                              CompressionType_Name(type()));
+}
+
 class SlicesSource : public snappy::Source {
  public:
   explicit SlicesSource(const std::vector<Slice>& slices)
@@ -149,6 +185,28 @@ class SnappyCodec : public CompressionCodec {
   }
 };
 
+// An LZ4 stream with a dictionary already loaded into it.
+class Lz4PreparedDictionary : public PreparedCompressionDictionary {
+ public:
+  explicit Lz4PreparedDictionary(const Slice& dictionary)
+      : dictionary_(dictionary.ToString()) {
+    LZ4_resetStream(&stream_);
+    // LZ4 only references the last 64KB of the dictionary.
+    LZ4_loadDict(&stream_, dictionary_.data(), dictionary_.size());
+  }
+
+  const LZ4_stream_t& stream() const {
+    return stream_;
+  }
+
+ private:
+  // The stream points into the dictionary, so it's kept alive here.
+  const string dictionary_;
+  LZ4_stream_t stream_;
+
+  DISALLOW_COPY_AND_ASSIGN(Lz4PreparedDictionary);
+};
+
 class Lz4Codec : public CompressionCodec {
  public:
   static Lz4Codec *GetSingleton() {
@@ -192,6 +250,55 @@ class Lz4Codec : public CompressionCodec {
     return LZ4_compressBound(source_bytes);
   }
 
+  bool SupportsDictionary() const override {
+    return true;
+  }
+
+  Status CompressWithDictionary(const Slice& input, const Slice& dictionary,
+                                uint8_t *compressed, size_t *compressed_length) const override {
+    Lz4PreparedDictionary prepared(dictionary);
+    return CompressWithPreparedDictionary(input, prepared, compressed, compressed_length);
+  }
+
+  Status PrepareDictionary(const Slice& dictionary,
+                           unique_ptr<PreparedCompressionDictionary>* prepared) const override {
+    prepared->reset(new Lz4PreparedDictionary(dictionary));
+    return Status::OK();
+  }
+
+  Status CompressWithPreparedDictionary(const Slice& input,
+                                        const PreparedCompressionDictionary& dictionary,
+                                        uint8_t *compressed,
+                                        size_t *compressed_length) const override {
+    // Compressing advances the stream, so work on a copy of the primed one.
+    // Copying it is much cheaper than loading the dictionary again, which
+    // hashes all of it.
+    LZ4_stream_t stream = down_cast<const Lz4PreparedDictionary&>(dictionary).stream();
+    int n = LZ4_compress_continue(&stream, reinterpret_cast<const char *>(input.data()),
+                                  reinterpret_cast<char *>(compressed), input.size());
+    if (n <= 0) {
+      return Status::RuntimeError("unable to compress the buffer");
+    }
+    *compressed_length = n;
+    return Status::OK();
+  }
+
+  Status UncompressWithDictionary(const Slice& compressed, const Slice& dictionary,
+                                  uint8_t *uncompressed,
+                                  size_t uncompressed_length) const override {
+    int n = LZ4_decompress_safe_usingDict(reinterpret_cast<const char *>(compressed.data()),
+                                          reinterpret_cast<char *>(uncompressed),
+                                          compressed.size(), uncompressed_length,
+                                          reinterpret_cast<const char *>(dictionary.data()),
+                                          dictionary.size());
+    if (n != uncompressed_length) {
+      return Status::Corruption(
+        StringPrintf("unable to uncompress the buffer with dictionary. error near %d, buffer", -n),
+                     KUDU_REDACT(compressed.ToDebugString(100)));
+    }
+    return Status::OK();
+  }
+
   CompressionType type() const override {
     return LZ4;
   }
@@ -283,4 +390,21 @@ CompressionType GetCompressionCodecType(const std::string& name) {
   return NO_COMPRESSION;
 }
 
+string BuildCompressionDictionary(const vector<Slice>& samples, size_t max_size) {
+  string dictionary;
+  if (samples.empty() || max_size == 0) {
+    return dictionary;
+  }
+  dictionary.reserve(max_size);
+  const size_t per_sample = std::max<size_t>(max_size / samples.size(), 1);
+  for (const Slice& sample : samples) {
+    size_t len = std::min({ per_sample, sample.size(), max_size - dictionary.size() });
+    dictionary.append(reinterpret_cast<const char*>(sample.data()), len);
+    if (dictionary.size() == max_size) {
+      break;
+    }
+  }
+  return dictionary;
+}
+
 } // namespace kudu
@@ -19,6 +19,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -30,6 +31,14 @@
 
 namespace kudu {
 
+// A dictionary loaded into a codec's compression state, so that it can be
+// used to compress many inputs without being reloaded for each of them.
+// Created by CompressionCodec::PrepareDictionary().
+class PreparedCompressionDictionary {
+ public:
+  virtual ~PreparedCompressionDictionary() {}
+};
+
 class CompressionCodec {
  public:
   CompressionCodec();
@@ -59,6 +68,42 @@ class CompressionCodec {
   // input data that is "source_bytes" bytes in length.
   virtual size_t MaxCompressedLength(size_t source_bytes) const = 0;
 
+  // Returns whether this codec supports compressing with a dictionary.
+  virtual bool SupportsDictionary() const { return false; }
+
+  // Like Compress(), but primes the codec with "dictionary", which should
+  // contain content typical of the input. This allows small inputs that
+  // resemble each other, but have little redundancy within themselves, to
+  // compress well.
+  //
+  // Returns NotSupported if the codec doesn't support dictionaries.
+  virtual Status CompressWithDictionary(const Slice& input, const Slice& dictionary,
+                                        uint8_t *compressed, size_t *compressed_length) const;
+
+  // Loads "dictionary" into a reusable state for CompressWithPreparedDictionary().
+  // The dictionary is copied, so it need not outlive "prepared".
+  //
+  // Returns NotSupported if the codec doesn't support dictionaries.
+  virtual Status PrepareDictionary(
+      const Slice& dictionary,
+      std::unique_ptr<PreparedCompressionDictionary>* prepared) const;
+
+  // Like CompressWithDictionary(), but with a dictionary prepared by this
+  // codec's PrepareDictionary(). Cheaper when the same dictionary is used for
+  // many inputs. The output may be uncompressed by UncompressWithDictionary().
+  virtual Status CompressWithPreparedDictionary(const Slice& input,
+                                                const PreparedCompressionDictionary& dictionary,
+                                                uint8_t *compressed,
+                                                size_t *compressed_length) const;
+
+  // Like Uncompress(), for data compressed by CompressWithDictionary(). The
+  // same dictionary must be provided.
+  //
+  // Returns NotSupported if the codec doesn't support dictionaries.
+  virtual Status UncompressWithDictionary(const Slice& compressed, const Slice& dictionary,
+                                          uint8_t *uncompressed,
+                                          size_t uncompressed_length) const;
+
   // Return the type of compression implemented by this codec.
   virtual CompressionType type() const = 0;
  private:
@@ -74,5 +119,12 @@ Status GetCompressionCodec(CompressionType compression,
 // Returns the compression codec type given the name
 CompressionType GetCompressionCodecType(const std::string& name);
 
+// Builds a dictionary of at most 'max_size' bytes from 'samples' of the data
+// to be compressed, for use with CompressionCodec::CompressWithDictionary().
+//
+// An equally-sized prefix of each sample is used, so that the dictionary
+// reflects the variety of the samples rather than just the first few.
+std::string BuildCompressionDictionary(const std::vector<Slice>& samples, size_t max_size);
+
 } // namespace kudu
 #endif
@@ -52,6 +52,7 @@
 #include "kudu/gutil/strings/human_readable.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/strings/util.h"
+#include "kudu/util/async_util.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
 #include "kudu/util/faststring.h"
@@ -535,6 +536,100 @@ TEST_F(TestEnv, TestReadVFully) {
   ASSERT_STR_CONTAINS(status.ToString(), "EOF");
 }
 
+TEST_F(TestEnv, TestDirectReads) {
+  SeedRandom();
+  const string kTestPath = GetTestPath("test");
+  // Not a multiple of the direct I/O alignment, and larger than a single
+  // staging buffer.
+  const size_t kFileSize = 3 * kOneMb + 123;
+  NO_FATALS(WriteTestFile(env_, kTestPath, kFileSize));
+  auto expected_byte = [](uint64_t off) { return static_cast<uint8_t>((off * 31) & 0xff); };
+
+  RandomAccessFileOptions opts;
+  opts.direct_io = true;
+  unique_ptr<RandomAccessFile> raf;
+  ASSERT_OK(env_->NewRandomAccessFile(opts, kTestPath, &raf));
+
+  // Unaligned reads of various sizes, some spanning multiple slices.
+  for (int i = 0; i < 100; i++) {
+    uint64_t offset = rand() % kFileSize;
+    size_t len1 = rand() % std::min<uint64_t>(kFileSize - offset + 1, kTwoMb);
+    size_t len2 = rand() % (kFileSize - offset - len1 + 1);
+    unique_ptr<uint8_t[]> scratch1(new uint8_t[len1]);
+    unique_ptr<uint8_t[]> scratch2(new uint8_t[len2]);
+    vector<Slice> results = { Slice(scratch1.get(), len1), Slice(scratch2.get(), len2) };
+    ASSERT_OK(raf->ReadV(offset, &results));
+    for (size_t j = 0; j < len1; j++) {
+      ASSERT_EQ(expected_byte(offset + j), scratch1[j]);
+    }
+    for (size_t j = 0; j < len2; j++) {
+      ASSERT_EQ(expected_byte(offset + len1 + j), scratch2[j]);
+    }
+  }
+
+  // Reading past EOF fails.
+  uint8_t scratch[10];
+  Slice result(scratch, sizeof(scratch));
+  Status s = raf->Read(kFileSize - 5, &result);
+  ASSERT_TRUE(s.IsIOError()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "EOF");
+
+  // Direct reads through an RWFile observe its buffered writes.
+  RWFileOptions rw_opts;
+  rw_opts.mode = Env::OPEN_EXISTING;
+  rw_opts.direct_reads = true;
+  unique_ptr<RWFile> rwf;
+  ASSERT_OK(env_->NewRWFile(rw_opts, kTestPath, &rwf));
+  ASSERT_OK(rwf->Write(kFileSize, "abcde12345"));
+  ASSERT_OK(rwf->Read(kFileSize, &result));
+  ASSERT_EQ("abcde12345", result);
+  ASSERT_OK(rwf->Close());
+}
+
+TEST_F(TestEnv, TestReadVAsync) {
+  SeedRandom();
+  const string kTestPath = GetTestPath("test");
+  const size_t kFileSize = kOneMb;
+  NO_FATALS(WriteTestFile(env_, kTestPath, kFileSize));
+
+  unique_ptr<RandomAccessFile> raf;
+  ASSERT_OK(env_->NewRandomAccessFile(kTestPath, &raf));
+
+  // Keep many reads outstanding at once.
+  const int kNumReads = 64;
+  vector<unique_ptr<uint8_t[]>> scratches;
+  vector<vector<Slice>> results(kNumReads);
+  vector<uint64_t> offsets;
+  vector<Synchronizer> syncs(kNumReads);
+  for (int i = 0; i < kNumReads; i++) {
+    uint64_t offset = rand() % kFileSize;
+    size_t len = rand() % std::min<uint64_t>(kFileSize - offset + 1, 64 * 1024);
+    scratches.emplace_back(new uint8_t[len]);
+    offsets.push_back(offset);
+    results[i] = { Slice(scratches.back().get(), len / 2),
+                   Slice(scratches.back().get() + len / 2, len - len / 2) };
+    raf->ReadVAsync(offset, &results[i], syncs[i].AsStdStatusCallback());
+  }
+  for (int i = 0; i < kNumReads; i++) {
+    ASSERT_OK(syncs[i].Wait());
+    size_t j = 0;
+    for (const auto& result : results[i]) {
+      for (size_t k = 0; k < result.size(); k++, j++) {
+        ASSERT_EQ(static_cast<uint8_t>(((offsets[i] + j) * 31) & 0xff), result[k]);
+      }
+    }
+  }
+
+  // Reading past EOF fails.
+  uint8_t scratch[10];
+  vector<Slice> eof_results = { Slice(scratch, sizeof(scratch)) };
+  Synchronizer eof;
+  raf->ReadVAsync(kFileSize - 5, &eof_results, eof.AsStdStatusCallback());
+  Status s = eof.Wait();
+  ASSERT_TRUE(s.IsIOError()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "EOF");
+}
+
 TEST_F(TestEnv, TestIOVMax) {
   Env* env = Env::Default();
   const string kTestPath = GetTestPath("test");
@@ -931,6 +1026,23 @@ TEST_F(TestEnv, TestTempRWFile) {
   ASSERT_OK(env_->DeleteFile(path));
 }
 
+// Test that a file system handle can be kept open and synced repeatedly.
+TEST_F(TestEnv, TestSyncableFileSystem) {
+  unique_ptr<SyncableFileSystem> fs;
+  Status s = env_->NewSyncableFileSystem(test_dir_, &fs);
+#if defined(__linux__)
+  ASSERT_OK(s);
+  NO_FATALS(WriteTestFile(env_, GetTestPath("test"), 1024));
+  ASSERT_OK(fs->Sync());
+  ASSERT_OK(fs->Sync());
+
+  s = env_->NewSyncableFileSystem(GetTestPath("nonexistent"), &fs);
+  ASSERT_TRUE(s.IsNotFound()) << s.ToString();
+#else
+  ASSERT_TRUE(s.IsNotSupported()) << s.ToString();
+#endif
+}
+
 // Test that when we write data to disk we see SpaceInfo.free_bytes go down.
 TEST_F(TestEnv, TestGetSpaceInfoFreeBytes) {
   const string kDataDir = GetTestPath("parent");
@@ -5,6 +5,7 @@
 #include "kudu/util/env.h"
 
 #include <memory>
+#include <vector>
 
 #include <glog/logging.h>
 
@@ -24,12 +25,25 @@ SequentialFile::~SequentialFile() {
 RandomAccessFile::~RandomAccessFile() {
 }
 
+void RandomAccessFile::ReadVAsync(uint64_t offset, std::vector<Slice>* results,
+                                  const StdStatusCallback& cb) const {
+  cb(ReadV(offset, results));
+}
+
 WritableFile::~WritableFile() {
 }
 
 RWFile::~RWFile() {
 }
 
+void RWFile::ReadVAsync(uint64_t offset, std::vector<Slice>* results,
+                        const StdStatusCallback& cb) const {
+  cb(ReadV(offset, results));
+}
+
+SyncableFileSystem::~SyncableFileSystem() {
+}
+
 FileLock::~FileLock() {
 }
 
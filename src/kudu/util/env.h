@@ -23,6 +23,7 @@
 #include "kudu/gutil/callback_forward.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/util/status.h"
+#include "kudu/util/status_callback.h"
 
 namespace kudu {
 
@@ -32,6 +33,7 @@ class RandomAccessFile;
 class RWFile;
 class SequentialFile;
 class Slice;
+class SyncableFileSystem;
 class WritableFile;
 
 struct RandomAccessFileOptions;
@@ -169,6 +171,14 @@ class Env {
   // Synchronize the entry for a specific directory.
   virtual Status SyncDir(const std::string& dirname) = 0;
 
+  // Opens the file system containing 'path', so that all of its written data
+  // and metadata can be synchronized with one call instead of syncing many of
+  // its files. See SyncableFileSystem.
+  //
+  // Returns NotSupported on platforms that lack syncfs(2).
+  virtual Status NewSyncableFileSystem(const std::string& path,
+                                       std::unique_ptr<SyncableFileSystem>* result) = 0;
+
   // Recursively delete the specified directory.
   // This should operate safely, not following any symlinks, etc.
   virtual Status DeleteRecursively(const std::string &dirname) = 0;
@@ -407,6 +417,18 @@ class RandomAccessFile {
   // Safe for concurrent use by multiple threads.
   virtual Status ReadV(uint64_t offset, std::vector<Slice>* results) const = 0;
 
+  // Like ReadV(), but returns immediately and invokes 'cb' with the outcome
+  // once the read has completed. Until then, 'results', the memory it points
+  // to, and this file must remain valid. 'cb' may be invoked on an internal
+  // I/O thread (or on the calling thread if the read completes immediately)
+  // and must not block.
+  //
+  // The default implementation reads synchronously.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual void ReadVAsync(uint64_t offset, std::vector<Slice>* results,
+                          const StdStatusCallback& cb) const;
+
   // Returns the size of the file
   virtual Status Size(uint64_t *size) const = 0;
 
@@ -433,7 +455,14 @@ struct WritableFileOptions {
 
 // Options specified when a file is opened for random access.
 struct RandomAccessFileOptions {
-  RandomAccessFileOptions() {}
+  // Bypass the OS page cache (O_DIRECT) when reading. Reads of any offset and
+  // length are still permitted; they are widened to the filesystem's
+  // alignment and staged through an aligned buffer. Falls back to buffered
+  // reads if the filesystem doesn't support direct I/O.
+  bool direct_io;
+
+  RandomAccessFileOptions()
+    : direct_io(false) { }
 };
 
 // A file abstraction for sequential writing.  The implementation
@@ -499,9 +528,14 @@ struct RWFileOptions {
   // See CreateMode for details.
   Env::CreateMode mode;
 
+  // Bypass the OS page cache when reading, as per
+  // RandomAccessFileOptions::direct_io. Writes remain buffered.
+  bool direct_reads;
+
   RWFileOptions()
     : sync_on_close(false),
-      mode(Env::CREATE_IF_NON_EXISTING_TRUNCATE) { }
+      mode(Env::CREATE_IF_NON_EXISTING_TRUNCATE),
+      direct_reads(false) { }
 };
 
 // A file abstraction for both reading and writing. No notion of a built-in
@@ -547,6 +581,18 @@ class RWFile {
   // Safe for concurrent use by multiple threads.
   virtual Status ReadV(uint64_t offset, std::vector<Slice>* results) const = 0;
 
+  // Like ReadV(), but returns immediately and invokes 'cb' with the outcome
+  // once the read has completed. Until then, 'results', the memory it points
+  // to, and this file must remain valid. 'cb' may be invoked on an internal
+  // I/O thread (or on the calling thread if the read completes immediately)
+  // and must not block.
+  //
+  // The default implementation reads synchronously.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual void ReadVAsync(uint64_t offset, std::vector<Slice>* results,
+                          const StdStatusCallback& cb) const;
+
   // Writes 'data' to the file position given by 'offset'.
   virtual Status Write(uint64_t offset, const Slice& data) = 0;
 
@@ -630,6 +676,24 @@ class RWFile {
   DISALLOW_COPY_AND_ASSIGN(RWFile);
 };
 
+// A file system opened with Env::NewSyncableFileSystem().
+//
+// Errors writing back data are tracked per file system and reported to each
+// open handle at most once. A sync is therefore only guaranteed to report the
+// errors which occurred after the handle was opened: a handle should be
+// opened before the writes it is meant to make durable, and kept open.
+class SyncableFileSystem {
+ public:
+  SyncableFileSystem() { }
+  virtual ~SyncableFileSystem();
+
+  // Synchronizes all written data and metadata of the file system.
+  virtual Status Sync() = 0;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(SyncableFileSystem);
+};
+
 // Identifies a locked file.
 class FileLock {
  public:
@@ -17,13 +17,16 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <cerrno>
 #include <ostream>
@@ -45,6 +48,7 @@
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/alignment.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/env.h"
 #include "kudu/util/errno.h"
@@ -54,12 +58,15 @@
 #include "kudu/util/logging.h"
 #include "kudu/util/malloc.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/thread.h"
 #include "kudu/util/thread_restrictions.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 #include "kudu/gutil/stringprintf.h"
 
@@ -76,6 +83,15 @@
 #include <sys/sysinfo.h>
 #include <sys/vfs.h>  // IWYU pragma: keep
 #endif  // defined(__APPLE__)
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define KUDU_HAVE_IO_URING 1
+#endif
+#endif
 // IWYU pragma: no_include <asm/int-ll64.h>
 // IWYU pragma: no_include <asm/ioctl.h>
 // IWYU pragma: no_include <linux/sysinfo.h>
@@ -182,6 +198,34 @@ DEFINE_bool(never_fsync, false,
 TAG_FLAG(never_fsync, advanced);
 TAG_FLAG(never_fsync, unsafe);
 
+DEFINE_string(env_async_io_engine, "threadpool",
+              "The mechanism used to issue asynchronous file I/O. Valid values "
+              "are 'threadpool' and 'io_uring'. If io_uring is unavailable "
+              "(e.g. on kernels older than 5.1), 'threadpool' is used instead.");
+TAG_FLAG(env_async_io_engine, advanced);
+TAG_FLAG(env_async_io_engine, experimental);
+
+static bool ValidateAsyncIOEngine(const char* flagname, const string& value) {
+  if (value == "io_uring" || value == "threadpool") {
+    return true;
+  }
+  LOG(ERROR) << Substitute("Invalid value for --$0: $1", flagname, value);
+  return false;
+}
+DEFINE_validator(env_async_io_engine, &ValidateAsyncIOEngine);
+
+DEFINE_int32(env_io_uring_queue_depth, 256,
+             "Maximum number of asynchronous I/Os outstanding in the io_uring "
+             "submission queue. Further I/Os are queued until some complete.");
+TAG_FLAG(env_io_uring_queue_depth, advanced);
+TAG_FLAG(env_io_uring_queue_depth, experimental);
+
+DEFINE_int32(env_async_io_threads, 8,
+             "Number of threads used to perform asynchronous I/O when it can't "
+             "be submitted to io_uring.");
+TAG_FLAG(env_async_io_threads, advanced);
+TAG_FLAG(env_async_io_threads, experimental);
+
 DEFINE_int32(env_inject_short_read_bytes, 0,
              "The number of bytes less than the requested bytes to read");
 TAG_FLAG(env_inject_short_read_bytes, hidden);
@@ -431,6 +475,602 @@ Status DoReadV(int fd, const string& filename, uint64_t offset, vector<Slice>* r
   return Status::OK();
 }
 
+// Alignment of the file offset, length, and buffer address of every direct
+// (O_DIRECT) read. This is at least the logical block size of any device
+// we're likely to encounter.
+const size_t kDirectIOAlignment = 4096;
+
+// Upper bound on the size of the aligned staging buffer used for a single
+// direct read; larger reads are issued in several chunks.
+const size_t kDirectIOMaxChunkBytes = 1024 * 1024;
+
+// Opens 'filename' read-only, bypassing the page cache. Returns NotSupported
+// if neither the platform nor the underlying filesystem allows it, in which
+// case callers are expected to fall back to buffered reads.
+Status DoOpenForDirectReads(const string& filename, int* fd) {
+  ThreadRestrictions::AssertIOAllowed();
+#if defined(O_DIRECT)
+  int f = open(filename.c_str(), O_RDONLY | O_DIRECT);
+  if (f < 0) {
+    if (errno == EINVAL) {
+      return Status::NotSupported("filesystem does not support direct I/O", filename);
+    }
+    return IOError(filename, errno);
+  }
+  *fd = f;
+  return Status::OK();
+#else
+  return Status::NotSupported("direct I/O not supported on this platform", filename);
+#endif
+}
+
+// Like DoReadV(), but for a descriptor opened by DoOpenForDirectReads().
+//
+// O_DIRECT requires the offset, length, and buffer of every read to be
+// aligned, whereas callers read arbitrary byte ranges into arbitrary
+// buffers. The enclosing aligned range is read into an aligned staging
+// buffer and the requested bytes are copied out of it.
+Status DoReadVDirect(int fd, const string& filename, uint64_t offset,
+                     vector<Slice>* results) {
+  MAYBE_RETURN_EIO(filename, IOError(Env::kInjectedFailureStatusMsg, EIO));
+  ThreadRestrictions::AssertIOAllowed();
+
+  size_t bytes_req = 0;
+  for (const Slice& result : *results) {
+    bytes_req += result.size();
+  }
+  if (bytes_req == 0) {
+    return Status::OK();
+  }
+
+  const uint64_t end = offset + bytes_req;
+  const uint64_t aligned_start = KUDU_ALIGN_DOWN(offset, kDirectIOAlignment);
+  const uint64_t aligned_end = KUDU_ALIGN_UP(end, kDirectIOAlignment);
+  const size_t buf_size = std::min<uint64_t>(aligned_end - aligned_start,
+                                             kDirectIOMaxChunkBytes);
+  unique_ptr<uint8_t, void(*)(void*)> buf(
+      static_cast<uint8_t*>(aligned_malloc(buf_size, kDirectIOAlignment)),
+      &aligned_free);
+  if (PREDICT_FALSE(!buf)) {
+    return Status::RuntimeError(Substitute(
+        "could not allocate $0 byte buffer to read $1", buf_size, filename));
+  }
+
+  size_t result_idx = 0;
+  size_t result_offset = 0;
+  for (uint64_t chunk_start = aligned_start; chunk_start < end; chunk_start += buf_size) {
+    const size_t chunk_len = std::min<uint64_t>(buf_size, aligned_end - chunk_start);
+    size_t filled = 0;
+    while (filled < chunk_len) {
+      ssize_t r;
+      RETRY_ON_EINTR(r, pread(fd, buf.get() + filled, chunk_len - filled,
+                              chunk_start + filled));
+      if (PREDICT_FALSE(r < 0)) {
+        return IOError(filename, errno);
+      }
+      filled += r;
+      // Direct reads only come up short at the end of the file, and the
+      // tail of an unaligned file can't be re-requested anyway.
+      if (r == 0 || filled % kDirectIOAlignment != 0) {
+        break;
+      }
+    }
+
+    // Copy the part of the chunk that overlaps the requested range.
+    const uint64_t copy_start = std::max(chunk_start, offset);
+    const uint64_t copy_end = std::min<uint64_t>(chunk_start + filled, end);
+    if (PREDICT_FALSE(copy_end < std::min<uint64_t>(chunk_start + chunk_len, end))) {
+      return Status::IOError(
+          Substitute("EOF trying to read $0 bytes at offset $1", bytes_req, offset));
+    }
+    const uint8_t* src = buf.get() + (copy_start - chunk_start);
+    size_t rem = copy_end - copy_start;
+    while (rem > 0) {
+      Slice& result = (*results)[result_idx];
+      size_t n = std::min(rem, result.size() - result_offset);
+      memcpy(result.mutable_data() + result_offset, src, n);
+      src += n;
+      rem -= n;
+      result_offset += n;
+      if (result_offset == result.size()) {
+        result_idx++;
+        result_offset = 0;
+      }
+    }
+  }
+  return Status::OK();
+}
+
+// Issues file I/O asynchronously on behalf of the posix files. Instances live
+// for the lifetime of the process.
+class AsyncIOEngine {
+ public:
+  virtual ~AsyncIOEngine() {}
+
+  // Reads into 'results' from 'fd' at 'offset' as per DoReadV(), invoking
+  // 'cb' with the outcome once done.
+  virtual void ReadV(int fd, const string& filename, uint64_t offset,
+                     vector<Slice>* results, StdStatusCallback cb) = 0;
+};
+
+// Performs I/O synchronously on a pool of threads. Always available.
+class ThreadPoolAsyncIOEngine : public AsyncIOEngine {
+ public:
+  ThreadPoolAsyncIOEngine() {
+    CHECK_OK(ThreadPoolBuilder("async-io")
+             .set_max_threads(FLAGS_env_async_io_threads)
+             .Build(&pool_));
+  }
+
+  void ReadV(int fd, const string& filename, uint64_t offset,
+             vector<Slice>* results, StdStatusCallback cb) override {
+    Run([=]() { cb(DoReadV(fd, filename, offset, results)); });
+  }
+
+  // Runs 'f' on the pool, or on the calling thread if the pool can't accept it.
+  void Run(std::function<void()> f) {
+    Status s = pool_->SubmitFunc(f);
+    if (PREDICT_FALSE(!s.ok())) {
+      f();
+    }
+  }
+
+ private:
+  gscoped_ptr<ThreadPool> pool_;
+};
+
+ThreadPoolAsyncIOEngine* GetThreadPoolAsyncIOEngine() {
+  static ThreadPoolAsyncIOEngine* engine = new ThreadPoolAsyncIOEngine();
+  return engine;
+}
+
+#if defined(KUDU_HAVE_IO_URING)
+// Submits I/O to the kernel through an io_uring(7) instance shared by all
+// files, allowing many reads to be outstanding without a thread apiece.
+// Completions are reaped by a dedicated thread; callbacks are invoked on
+// the thread pool engine's threads.
+//
+// Once --env_io_uring_queue_depth reads are in flight, further reads wait in
+// a backlog and are submitted as earlier ones complete, so issuing a read
+// never blocks on the device.
+//
+// If the ring fails, reads not yet taken by the kernel fail with the error,
+// those already taken are reaped as they complete, and later reads are
+// issued through the thread pool engine instead.
+//
+// The ring is driven with raw system calls rather than liburing, which
+// isn't a dependency of this project.
+class IoUringAsyncIOEngine : public AsyncIOEngine {
+ public:
+  // Returns NotSupported if the kernel doesn't provide io_uring or doesn't
+  // let this process use it.
+  static Status Create(unique_ptr<AsyncIOEngine>* engine) {
+    unique_ptr<IoUringAsyncIOEngine> e(new IoUringAsyncIOEngine());
+    RETURN_NOT_OK(e->Init());
+    *engine = std::move(e);
+    return Status::OK();
+  }
+
+  void ReadV(int fd, const string& filename, uint64_t offset,
+             vector<Slice>* results, StdStatusCallback cb) override {
+    if (PREDICT_FALSE(failed())) {
+      GetThreadPoolAsyncIOEngine()->ReadV(fd, filename, offset, results, std::move(cb));
+      return;
+    }
+    unique_ptr<Request> req(new Request);
+    req->fd = fd;
+    req->filename = filename;
+    req->start_offset = offset;
+    req->offset = offset;
+    req->bytes_rem = 0;
+    req->iov_idx = 0;
+    req->iov.reserve(results->size());
+    for (Slice& result : *results) {
+      if (result.size() > 0) {
+        req->iov.push_back({ result.mutable_data(), result.size() });
+        req->bytes_rem += result.size();
+      }
+    }
+    req->bytes_req = req->bytes_rem;
+    req->cb = std::move(cb);
+    if (req->bytes_rem == 0) {
+      req->cb(Status::OK());
+      return;
+    }
+    if (PREDICT_FALSE(!Submit(req.get(), false))) {
+      // The ring failed before the read could be queued.
+      GetThreadPoolAsyncIOEngine()->ReadV(fd, filename, offset, results, std::move(req->cb));
+      return;
+    }
+    ignore_result(req.release());
+  }
+
+ private:
+  struct Request {
+    int fd;
+    string filename;
+    uint64_t start_offset;
+    uint64_t offset;
+    size_t bytes_req;
+    size_t bytes_rem;
+    vector<struct iovec> iov;
+    size_t iov_idx;
+    StdStatusCallback cb;
+    Status status;
+  };
+
+  IoUringAsyncIOEngine()
+      : ring_fd_(-1),
+        in_flight_(0) {
+  }
+
+  bool failed() {
+    MutexLock l(lock_);
+    return !failure_.ok();
+  }
+
+  Status Init() {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = syscall(__NR_io_uring_setup, FLAGS_env_io_uring_queue_depth, &params);
+    if (fd < 0) {
+      int err = errno;
+      return Status::NotSupported("io_uring_setup failed", ErrnoToString(err), err);
+    }
+    ring_fd_ = fd;
+    sq_entries_ = params.sq_entries;
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+      sq_size = cq_size = std::max(sq_size, cq_size);
+    }
+    uint8_t* sq_ptr;
+    uint8_t* cq_ptr;
+    RETURN_NOT_OK(Map(sq_size, IORING_OFF_SQ_RING, &sq_ptr));
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+      cq_ptr = sq_ptr;
+    } else {
+      RETURN_NOT_OK(Map(cq_size, IORING_OFF_CQ_RING, &cq_ptr));
+    }
+    uint8_t* sqes_ptr;
+    RETURN_NOT_OK(Map(params.sq_entries * sizeof(struct io_uring_sqe),
+                      IORING_OFF_SQES, &sqes_ptr));
+
+    sq_head_ = reinterpret_cast<uint32_t*>(sq_ptr + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<uint32_t*>(sq_ptr + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<uint32_t*>(sq_ptr + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<uint32_t*>(sq_ptr + params.sq_off.array);
+    sqes_ = reinterpret_cast<struct io_uring_sqe*>(sqes_ptr);
+    cq_head_ = reinterpret_cast<uint32_t*>(cq_ptr + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<uint32_t*>(cq_ptr + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<uint32_t*>(cq_ptr + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq_ptr + params.cq_off.cqes);
+
+    return Thread::Create("async-io", "io_uring-reaper",
+                          &IoUringAsyncIOEngine::ReapLoop, this, &reaper_);
+  }
+
+  Status Map(size_t size, off_t offset, uint8_t** ptr) {
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ring_fd_, offset);
+    if (p == MAP_FAILED) {
+      int err = errno;
+      return Status::NotSupported("could not map io_uring", ErrnoToString(err), err);
+    }
+    *ptr = static_cast<uint8_t*>(p);
+    return Status::OK();
+  }
+
+  // Queues 'req' for (re)submission to the kernel. If 'reserved' is false
+  // and the submission queue is full, 'req' is added to the backlog instead,
+  // to be submitted by Finish() once a slot frees up. Resubmissions of
+  // partially completed requests, and requests taken from the backlog,
+  // already hold their slot.
+  //
+  // Returns false, with the error in 'req->status', if the ring has failed
+  // and 'req' wasn't queued. Once queued, 'req' is finished through the
+  // completion queue, or with the ring's failure if it fails first.
+  //
+  // May wait for the reaper, so mustn't be called on the reaper's thread.
+  bool Submit(Request* req, bool reserved) {
+    {
+      MutexLock l(lock_);
+      if (PREDICT_FALSE(!failure_.ok())) {
+        req->status = failure_;
+        return false;
+      }
+      if (!reserved) {
+        if (in_flight_ >= sq_entries_) {
+          backlog_.push_back(req);
+          return true;
+        }
+        in_flight_++;
+      }
+
+      // Only ever written with 'lock_' held, so a relaxed load suffices.
+      uint32_t tail = *sq_tail_;
+      uint32_t idx = tail & sq_mask_;
+      struct io_uring_sqe* sqe = &sqes_[idx];
+      memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = IORING_OP_READV;
+      sqe->fd = req->fd;
+      sqe->off = req->offset;
+      sqe->addr = reinterpret_cast<uint64_t>(&req->iov[req->iov_idx]);
+      sqe->len = std::min<size_t>(req->iov.size() - req->iov_idx, IOV_MAX);
+      sqe->user_data = reinterpret_cast<uint64_t>(req);
+      sq_array_[idx] = idx;
+      __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    // The kernel consumes queued entries in order, one per successful call
+    // here, so it doesn't matter whose entry a given call submits. Calls are
+    // serialized by 'submit_lock_' rather than 'lock_' so that the reaper
+    // isn't held up while the kernel is short of resources, and so that once
+    // the ring has failed, no entry is submitted behind FailUnsubmitted().
+    MutexLock sl(submit_lock_);
+    int backoff_us = 10;
+    while (true) {
+      {
+        MutexLock l(lock_);
+        if (PREDICT_FALSE(!failure_.ok())) {
+          // Whoever failed the ring also failed the entries still queued.
+          return true;
+        }
+      }
+      int r = syscall(__NR_io_uring_enter, ring_fd_, 1, 0, 0, nullptr, 0);
+      if (PREDICT_TRUE(r > 0)) {
+        break;
+      }
+      if (r < 0 && errno == EINTR) {
+        continue;
+      }
+      if (r < 0 && errno != EAGAIN && errno != EBUSY) {
+        if (MarkFailed(IOError("io_uring_enter failed", errno))) {
+          FailUnsubmitted();
+        }
+        return true;
+      }
+      // The kernel is short of resources, or wants completions reaped first.
+      // The entry stays queued; give the reaper a chance before retrying.
+      SleepFor(MonoDelta::FromMicroseconds(backoff_us));
+      backoff_us = std::min(backoff_us * 2, 10000);
+    }
+    return true;
+  }
+
+  // Marks the ring as failed with 's', failing the requests in the backlog.
+  // Returns false if it had already failed.
+  bool MarkFailed(const Status& s) {
+    std::deque<Request*> backlog;
+    {
+      MutexLock l(lock_);
+      if (!failure_.ok()) {
+        return false;
+      }
+      LOG(ERROR) << "io_uring failed, falling back to a thread pool: " << s.ToString();
+      failure_ = s;
+      backlog.swap(backlog_);
+    }
+    for (Request* req : backlog) {
+      req->status = s;
+      RunCallback(req);
+    }
+    return true;
+  }
+
+  // Finishes with the ring's failure the requests that were queued but not
+  // yet taken by the kernel, which no longer will be.
+  //
+  // Requires 'submit_lock_' to be held, and the ring to have been marked as
+  // failed.
+  void FailUnsubmitted() {
+    vector<Request*> failed;
+    {
+      MutexLock l(lock_);
+      DCHECK(!failure_.ok());
+      uint32_t head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+      for (uint32_t tail = *sq_tail_; head != tail; head++) {
+        const struct io_uring_sqe* sqe = &sqes_[sq_array_[head & sq_mask_]];
+        Request* req = reinterpret_cast<Request*>(sqe->user_data);
+        req->status = failure_;
+        failed.push_back(req);
+      }
+    }
+    Finish(failed);
+  }
+
+  // Releases the submission queue slots of the finished requests in 'reqs',
+  // handing them to requests from the backlog, then runs the callbacks of
+  // 'reqs' and frees them.
+  void Finish(const vector<Request*>& reqs) {
+    if (reqs.empty()) {
+      return;
+    }
+    vector<Request*> unblocked;
+    {
+      MutexLock l(lock_);
+      in_flight_ -= reqs.size();
+      while (!backlog_.empty() && in_flight_ < sq_entries_) {
+        unblocked.push_back(backlog_.front());
+        backlog_.pop_front();
+        in_flight_++;
+      }
+    }
+    // Submitting may need to wait for the reaper, which may be this thread.
+    for (Request* req : unblocked) {
+      GetThreadPoolAsyncIOEngine()->Run([this, req]() {
+        if (PREDICT_FALSE(!Submit(req, true))) {
+          Finish({ req });
+        }
+      });
+    }
+    for (Request* req : reqs) {
+      RunCallback(req);
+    }
+  }
+
+  // Runs the callback of the finished request 'req' and frees it.
+  //
+  // Callbacks run elsewhere: one that issues another read may need a slot
+  // that only the reaper can free, and a slow one would hold up reaping.
+  static void RunCallback(Request* req) {
+    GetThreadPoolAsyncIOEngine()->Run([req]() {
+      unique_ptr<Request> done(req);
+      done->cb(done->status);
+    });
+  }
+
+  void ReapLoop() {
+    vector<std::pair<Request*, int>> completions;
+    vector<Request*> finished;
+    bool waiting_failed = false;
+    while (true) {
+      if (PREDICT_TRUE(!waiting_failed)) {
+        int r = syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS,
+                        nullptr, 0);
+        if (PREDICT_FALSE(r < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)) {
+          // Requests the kernel has already taken may still complete, so keep
+          // reaping them by polling the completion queue. Marking the ring
+          // as failed first stops submitters from retrying, so that the
+          // submit lock can be had.
+          waiting_failed = true;
+          if (MarkFailed(IOError("io_uring_enter failed", errno))) {
+            MutexLock sl(submit_lock_);
+            FailUnsubmitted();
+          }
+        }
+      } else {
+        SleepFor(MonoDelta::FromMilliseconds(1));
+      }
+      uint32_t head = *cq_head_;
+      uint32_t tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      completions.clear();
+      for (; head != tail; head++) {
+        const struct io_uring_cqe* cqe = &cqes_[head & cq_mask_];
+        completions.emplace_back(reinterpret_cast<Request*>(cqe->user_data), cqe->res);
+      }
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+      finished.clear();
+      for (const auto& c : completions) {
+        if (Complete(c.first, c.second)) {
+          finished.push_back(c.first);
+        }
+      }
+      Finish(finished);
+    }
+  }
+
+  // Handles the completion of 'req' with result 'res'. Returns true if the
+  // request is finished, with its outcome in 'req->status', or false if it
+  // is to be resubmitted to read the remainder after a short read.
+  bool Complete(Request* req, int res) {
+    if (PREDICT_FALSE(res < 0)) {
+      req->status = IOError(req->filename, -res);
+    } else if (PREDICT_FALSE(res == 0)) {
+      req->status = Status::IOError(Substitute("EOF trying to read $0 bytes at offset $1",
+                                             req->bytes_req, req->start_offset));
+    } else if (res < req->bytes_rem) {
+      // Short read: advance past what was read and go again.
+      req->offset += res;
+      req->bytes_rem -= res;
+      size_t n = res;
+      while (n >= req->iov[req->iov_idx].iov_len) {
+        n -= req->iov[req->iov_idx].iov_len;
+        req->iov_idx++;
+      }
+      struct iovec& partial = req->iov[req->iov_idx];
+      partial.iov_base = static_cast<uint8_t*>(partial.iov_base) + n;
+      partial.iov_len -= n;
+      GetThreadPoolAsyncIOEngine()->Run([this, req]() {
+        if (PREDICT_FALSE(!Submit(req, true))) {
+          Finish({ req });
+        }
+      });
+      return false;
+    }
+    return true;
+  }
+
+  int ring_fd_;
+  uint32_t sq_entries_;
+
+  // Submission queue, shared with the kernel.
+  uint32_t* sq_head_;
+  uint32_t* sq_tail_;
+  uint32_t sq_mask_;
+  uint32_t* sq_array_;
+  struct io_uring_sqe* sqes_;
+
+  // Completion queue, shared with the kernel.
+  uint32_t* cq_head_;
+  uint32_t* cq_tail_;
+  uint32_t cq_mask_;
+  struct io_uring_cqe* cqes_;
+
+  // Protects the submission queue, 'in_flight_', 'backlog_' and 'failure_'.
+  Mutex lock_;
+
+  // Serializes io_uring_enter() calls that submit entries.
+  Mutex submit_lock_;
+
+  // Set if the ring has failed, after which it's no longer used.
+  Status failure_;
+
+  // Number of requests submitted but not yet finished. Bounded by the size
+  // of the submission queue, which also keeps the (larger) completion queue
+  // from overflowing.
+  uint32_t in_flight_;
+
+  // Requests waiting for a slot in the submission queue, oldest first.
+  std::deque<Request*> backlog_;
+
+  scoped_refptr<Thread> reaper_;
+};
+#endif // defined(KUDU_HAVE_IO_URING)
+
+// Returns the engine selected by --env_async_io_engine.
+AsyncIOEngine* GetAsyncIOEngine() {
+  static AsyncIOEngine* engine = []() -> AsyncIOEngine* {
+#if defined(KUDU_HAVE_IO_URING)
+    if (FLAGS_env_async_io_engine == "io_uring") {
+      unique_ptr<AsyncIOEngine> e;
+      Status s = IoUringAsyncIOEngine::Create(&e);
+      if (s.ok()) {
+        LOG(INFO) << "Using io_uring for asynchronous I/O";
+        return e.release();
+      }
+      LOG(WARNING) << "Could not use io_uring for asynchronous I/O, "
+                   << "falling back to a thread pool: " << s.ToString();
+    }
+#endif
+    return GetThreadPoolAsyncIOEngine();
+  }();
+  return engine;
+}
+
+// Implements ReadVAsync() for the posix files.
+void DoReadVAsync(int fd, const string& filename, uint64_t offset, bool direct,
+                  vector<Slice>* results, const StdStatusCallback& cb) {
+  Status s = [&]() {
+    MAYBE_RETURN_EIO(filename, IOError(Env::kInjectedFailureStatusMsg, EIO));
+    return Status::OK();
+  }();
+  if (PREDICT_FALSE(!s.ok())) {
+    cb(s);
+    return;
+  }
+  if (direct) {
+    // io_uring would need the caller's buffers to be aligned.
+    GetThreadPoolAsyncIOEngine()->Run([=]() {
+      cb(DoReadVDirect(fd, filename, offset, results));
+    });
+    return;
+  }
+  GetAsyncIOEngine()->ReadV(fd, filename, offset, results, cb);
+}
+
 Status DoWriteV(int fd, const string& filename, uint64_t offset,
                 const vector<Slice>& data) {
   MAYBE_RETURN_EIO(filename, IOError(Env::kInjectedFailureStatusMsg, EIO));
@@ -560,9 +1200,12 @@ class PosixRandomAccessFile: public RandomAccessFile {
   std::string filename_;
   int fd_;
 
+  // Whether 'fd_' was opened with O_DIRECT.
+  bool direct_io_;
+
  public:
-  PosixRandomAccessFile(std::string fname, int fd)
-      : filename_(std::move(fname)), fd_(fd) {}
+  PosixRandomAccessFile(std::string fname, int fd, bool direct_io)
+      : filename_(std::move(fname)), fd_(fd), direct_io_(direct_io) {}
   virtual ~PosixRandomAccessFile() { close(fd_); }
 
   virtual Status Read(uint64_t offset, Slice* result) const OVERRIDE {
@@ -571,9 +1214,17 @@ class PosixRandomAccessFile: public RandomAccessFile {
   }
 
   virtual Status ReadV(uint64_t offset, vector<Slice>* results) const OVERRIDE {
+    if (direct_io_) {
+      return DoReadVDirect(fd_, filename_, offset, results);
+    }
     return DoReadV(fd_, filename_, offset, results);
   }
 
+  virtual void ReadVAsync(uint64_t offset, vector<Slice>* results,
+                          const StdStatusCallback& cb) const OVERRIDE {
+    DoReadVAsync(fd_, filename_, offset, direct_io_, results, cb);
+  }
+
   virtual Status Size(uint64_t *size) const OVERRIDE {
     MAYBE_RETURN_EIO(filename_, IOError(Env::kInjectedFailureStatusMsg, EIO));
     TRACE_EVENT1("io", "PosixRandomAccessFile::Size", "path", filename_);
@@ -712,8 +1363,7 @@ class PosixWritableFile : public WritableFile {
     TRACE_EVENT1("io", "PosixWritableFile::Sync", "path", filename_);
     ThreadRestrictions::AssertIOAllowed();
     LOG_SLOW_EXECUTION(WARNING, 1000, Substitute("sync call for $0", filename_)) {
-      if (pending_sync_) {
-        pending_sync_ = false;
+      if (pending_sync_.exchange(false)) {
         RETURN_NOT_OK(DoSync(fd_, filename_));
       }
     }
@@ -733,15 +1383,19 @@ class PosixWritableFile : public WritableFile {
   uint64_t filesize_;
   uint64_t pre_allocated_size_;
 
-  bool pending_sync_;
+  // Atomic so that a Sync() may run concurrently with an Append(), as is done
+  // by the WAL when syncing one group of entries while appending the next.
+  std::atomic<bool> pending_sync_;
 };
 
 class PosixRWFile : public RWFile {
  public:
-  PosixRWFile(string fname, int fd, bool sync_on_close)
+  PosixRWFile(string fname, int fd, bool sync_on_close, bool direct_reads)
       : filename_(std::move(fname)),
         fd_(fd),
         sync_on_close_(sync_on_close),
+        direct_reads_(direct_reads),
+        direct_read_fd_(-1),
         is_on_xfs_(false),
         closed_(false) {}
 
@@ -755,9 +1409,30 @@ class PosixRWFile : public RWFile {
   }
 
   virtual Status ReadV(uint64_t offset, vector<Slice>* results) const OVERRIDE {
+    if (direct_reads_) {
+      // The O_DIRECT descriptor is opened on first read so that files which
+      // are only ever written (e.g. log block container metadata) don't pay
+      // for a second descriptor.
+      OpenDirectReadFd();
+      if (direct_read_fd_ >= 0) {
+        return DoReadVDirect(direct_read_fd_, filename_, offset, results);
+      }
+    }
     return DoReadV(fd_, filename_, offset, results);
   }
 
+  virtual void ReadVAsync(uint64_t offset, vector<Slice>* results,
+                          const StdStatusCallback& cb) const OVERRIDE {
+    if (direct_reads_) {
+      OpenDirectReadFd();
+      if (direct_read_fd_ >= 0) {
+        DoReadVAsync(direct_read_fd_, filename_, offset, true, results, cb);
+        return;
+      }
+    }
+    DoReadVAsync(fd_, filename_, offset, false, results, cb);
+  }
+
   virtual Status Write(uint64_t offset, const Slice& data) OVERRIDE {
     return WriteV(offset, { data });
   }
@@ -889,6 +1564,11 @@ class PosixRWFile : public RWFile {
         s = IOError(filename_, errno);
       }
     }
+    if (direct_read_fd_ >= 0 && close(direct_read_fd_) < 0) {
+      if (s.ok()) {
+        s = IOError(filename_, errno);
+      }
+    }
 
     closed_ = true;
     return s;
@@ -986,6 +1666,23 @@ class PosixRWFile : public RWFile {
   const int fd_;
   const bool sync_on_close_;
 
+  // Whether reads bypass the page cache via 'direct_read_fd_', a separate
+  // O_DIRECT descriptor opened lazily on first read (-1 if not open, or if
+  // the filesystem doesn't support direct I/O).
+  const bool direct_reads_;
+  mutable std::once_flag direct_read_once_;
+  mutable int direct_read_fd_;
+
+  void OpenDirectReadFd() const {
+    std::call_once(direct_read_once_, [this]() {
+      Status s = DoOpenForDirectReads(filename_, &direct_read_fd_);
+      if (!s.ok()) {
+        KLOG_FIRST_N(WARNING, 1) << "Falling back to buffered reads: " << s.ToString();
+        direct_read_fd_ = -1;
+      }
+    });
+  }
+
   GoogleOnceDynamic once_;
   bool is_on_xfs_;
   bool closed_;
@@ -1003,6 +1700,35 @@ int LockOrUnlock(int fd, bool lock) {
   return fcntl(fd, F_SETLK, &f);
 }
 
+#if defined(__linux__)
+class PosixSyncableFileSystem : public SyncableFileSystem {
+ public:
+  PosixSyncableFileSystem(std::string path, int fd)
+      : path_(std::move(path)),
+        fd_(fd) {
+  }
+
+  virtual ~PosixSyncableFileSystem() { close(fd_); }
+
+  virtual Status Sync() OVERRIDE {
+    TRACE_EVENT1("io", "PosixSyncableFileSystem::Sync", "path", path_);
+    MAYBE_RETURN_EIO(path_, IOError(Env::kInjectedFailureStatusMsg, EIO));
+    ThreadRestrictions::AssertIOAllowed();
+    if (FLAGS_never_fsync) return Status::OK();
+    // Since Linux 5.8, syncfs() reports the writeback errors recorded since
+    // 'fd_' was opened, or since they were last reported through it.
+    if (syncfs(fd_) != 0) {
+      return IOError(path_, errno);
+    }
+    return Status::OK();
+  }
+
+ private:
+  const std::string path_;
+  const int fd_;
+};
+#endif
+
 class PosixFileLock : public FileLock {
  public:
   int fd_;
@@ -1041,12 +1767,24 @@ class PosixEnv : public Env {
     TRACE_EVENT1("io", "PosixEnv::NewRandomAccessFile", "path", fname);
     MAYBE_RETURN_EIO(fname, IOError(Env::kInjectedFailureStatusMsg, EIO));
     ThreadRestrictions::AssertIOAllowed();
-    int fd = open(fname.c_str(), O_RDONLY);
+    int fd;
+    if (opts.direct_io) {
+      Status s = DoOpenForDirectReads(fname, &fd);
+      if (s.ok()) {
+        result->reset(new PosixRandomAccessFile(fname, fd, true));
+        return Status::OK();
+      }
+      if (!s.IsNotSupported()) {
+        return s;
+      }
+      KLOG_FIRST_N(WARNING, 1) << "Falling back to buffered reads: " << s.ToString();
+    }
+    fd = open(fname.c_str(), O_RDONLY);
     if (fd < 0) {
       return IOError(fname, errno);
     }
 
-    result->reset(new PosixRandomAccessFile(fname, fd));
+    result->reset(new PosixRandomAccessFile(fname, fd, false));
     return Status::OK();
   }
 
@@ -1088,7 +1826,7 @@ class PosixEnv : public Env {
     TRACE_EVENT1("io", "PosixEnv::NewRWFile", "path", fname);
     int fd;
     RETURN_NOT_OK(DoOpen(fname, opts.mode, &fd));
-    result->reset(new PosixRWFile(fname, fd, opts.sync_on_close));
+    result->reset(new PosixRWFile(fname, fd, opts.sync_on_close, opts.direct_reads));
     return Status::OK();
   }
 
@@ -1097,7 +1835,7 @@ class PosixEnv : public Env {
     TRACE_EVENT1("io", "PosixEnv::NewTempRWFile", "template", name_template);
     int fd;
     RETURN_NOT_OK(MkTmpFile(name_template, &fd, created_filename));
-    res->reset(new PosixRWFile(*created_filename, fd, opts.sync_on_close));
+    res->reset(new PosixRWFile(*created_filename, fd, opts.sync_on_close, opts.direct_reads));
     return Status::OK();
   }
 
@@ -1199,6 +1937,24 @@ class PosixEnv : public Env {
     return Status::OK();
   }
 
+  virtual Status NewSyncableFileSystem(const std::string& path,
+                                       unique_ptr<SyncableFileSystem>* result) OVERRIDE {
+    TRACE_EVENT1("io", "PosixEnv::NewSyncableFileSystem", "path", path);
+#if defined(__linux__)
+    MAYBE_RETURN_EIO(path, IOError(Env::kInjectedFailureStatusMsg, EIO));
+    ThreadRestrictions::AssertIOAllowed();
+    int fd;
+    RETRY_ON_EINTR(fd, open(path.c_str(), O_RDONLY));
+    if (fd < 0) {
+      return IOError(path, errno);
+    }
+    result->reset(new PosixSyncableFileSystem(path, fd));
+    return Status::OK();
+#else
+    return Status::NotSupported("syncfs not supported on this platform");
+#endif
+  }
+
   virtual Status DeleteRecursively(const std::string &name) OVERRIDE {
     return Walk(name, POST_ORDER, Bind(&PosixEnv::DeleteRecursivelyCb,
                                        Unretained(this)));
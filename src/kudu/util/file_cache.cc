@@ -164,6 +164,8 @@ class BaseDescriptor {
 
   Env* env() const { return file_cache_->env_; }
 
+  bool direct_reads() const { return file_cache_->direct_reads_; }
+
   const string& filename() const { return file_name_; }
 
   bool deleted() const { return flags_.load() & FILE_DELETED; }
@@ -244,6 +246,20 @@ class Descriptor<RWFile> : public RWFile {
     return opened.file()->ReadV(offset, results);
   }
 
+  void ReadVAsync(uint64_t offset, vector<Slice>* results,
+                  const StdStatusCallback& cb) const override {
+    // Keep the file open (i.e. unevictable) until the read completes.
+    auto opened = std::make_shared<ScopedOpenedDescriptor<RWFile>>(&base_);
+    Status s = ReopenFileIfNecessary(opened.get());
+    if (!s.ok()) {
+      cb(s);
+      return;
+    }
+    opened->file()->ReadVAsync(offset, results, [opened, cb](const Status& read_status) {
+      cb(read_status);
+    });
+  }
+
   Status Write(uint64_t offset, const Slice& data) override {
     ScopedOpenedDescriptor<RWFile> opened(&base_);
     RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
@@ -336,6 +352,7 @@ class Descriptor<RWFile> : public RWFile {
     RWFileOptions opts;
     opts.sync_on_close = true;
     opts.mode = Env::OPEN_EXISTING;
+    opts.direct_reads = base_.direct_reads();
     unique_ptr<RWFile> f;
     RETURN_NOT_OK(base_.env()->NewRWFile(opts, base_.filename(), &f));
 
@@ -375,6 +392,20 @@ class Descriptor<RandomAccessFile> : public RandomAccessFile {
     return opened.file()->ReadV(offset, results);
   }
 
+  void ReadVAsync(uint64_t offset, vector<Slice>* results,
+                  const StdStatusCallback& cb) const override {
+    // Keep the file open (i.e. unevictable) until the read completes.
+    auto opened = std::make_shared<ScopedOpenedDescriptor<RandomAccessFile>>(&base_);
+    Status s = ReopenFileIfNecessary(opened.get());
+    if (!s.ok()) {
+      cb(s);
+      return;
+    }
+    opened->file()->ReadVAsync(offset, results, [opened, cb](const Status& read_status) {
+      cb(read_status);
+    });
+  }
+
   Status Size(uint64_t *size) const override {
     ScopedOpenedDescriptor<RandomAccessFile> opened(&base_);
     RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
@@ -433,8 +464,10 @@ class Descriptor<RandomAccessFile> : public RandomAccessFile {
     }
 
     // The file was evicted, reopen it.
+    RandomAccessFileOptions opts;
+    opts.direct_io = base_.direct_reads();
     unique_ptr<RandomAccessFile> f;
-    RETURN_NOT_OK(base_.env()->NewRandomAccessFile(base_.filename(), &f));
+    RETURN_NOT_OK(base_.env()->NewRandomAccessFile(opts, base_.filename(), &f));
 
     // The cache will take ownership of the newly opened file.
     ScopedOpenedDescriptor<RandomAccessFile> opened(
@@ -460,6 +493,7 @@ FileCache<FileType>::FileCache(const string& cache_name,
                                const scoped_refptr<MetricEntity>& entity)
     : env_(env),
       cache_name_(cache_name),
+      direct_reads_(false),
       eviction_cb_(new EvictionCallback<FileType>()),
       cache_(NewLRUCache(DRAM_CACHE, max_open_files, cache_name)),
       running_(1) {
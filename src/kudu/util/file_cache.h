@@ -111,6 +111,11 @@ class FileCache {
   // Initializes the file cache. Initialization done here may fail.
   Status Init();
 
+  // If true, files opened through the cache bypass the OS page cache when
+  // read (see RandomAccessFileOptions::direct_io). Must be called before any
+  // files are opened.
+  void set_direct_reads(bool direct_reads) { direct_reads_ = direct_reads; }
+
   // Opens an existing file by name through the cache.
   //
   // The returned 'file' is actually an object called a descriptor. It adheres
@@ -183,6 +188,9 @@ class FileCache {
   // Name of the cache.
   const std::string cache_name_;
 
+  // Whether opened files should bypass the OS page cache when read.
+  bool direct_reads_;
+
   // Invoked whenever a cached file reaches zero references (i.e. it was
   // removed from the cache and is no longer in use by any file operations).
   std::unique_ptr<Cache::EvictionCallback> eviction_cb_;
@@ -21,6 +21,7 @@
 #include <mutex>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <boost/bind.hpp> // IWYU pragma: keep
@@ -55,6 +56,9 @@ METRIC_DEFINE_histogram(test, maintenance_op_duration,
                         "Maintenance Operation Duration",
                         kudu::MetricUnit::kSeconds, "", 60000000LU, 2);
 
+DECLARE_bool(maintenance_manager_enable_preemption);
+DECLARE_int32(maintenance_manager_disk_io_budget_mb_per_sec);
+DECLARE_int32(maintenance_manager_reserved_threads);
 DECLARE_int64(log_target_replay_size_mb);
 
 namespace kudu {
@@ -94,17 +98,20 @@ TEST_F(MaintenanceManagerTest, TestCreateAndShutdown) {
 class TestMaintenanceOp : public MaintenanceOp {
  public:
   TestMaintenanceOp(const std::string& name,
-                    IOUsage io_usage)
-    : MaintenanceOp(name, io_usage),
+                    IOUsage io_usage,
+                    PriorityClass priority = COMPACTION_PRIORITY)
+    : MaintenanceOp(name, io_usage, priority),
       ram_anchored_(500),
       logs_retained_bytes_(0),
       perf_improvement_(0),
+      expected_io_bytes_(0),
       metric_entity_(METRIC_ENTITY_test.Instantiate(&metric_registry_, "test")),
       maintenance_op_duration_(METRIC_maintenance_op_duration.Instantiate(metric_entity_)),
       maintenance_ops_running_(METRIC_maintenance_ops_running.Instantiate(metric_entity_, 0)),
       remaining_runs_(1),
       prepared_runs_(0),
-      sleep_time_(MonoDelta::FromSeconds(0)) {
+      sleep_time_(MonoDelta::FromSeconds(0)),
+      preemptible_(false) {
   }
 
   virtual ~TestMaintenanceOp() {}
@@ -140,6 +147,9 @@ class TestMaintenanceOp : public MaintenanceOp {
     stats->set_ram_anchored(ram_anchored_);
     stats->set_logs_retained_bytes(logs_retained_bytes_);
     stats->set_perf_improvement(perf_improvement_);
+    stats->set_expected_read_bytes(expected_io_bytes_);
+    stats->set_expected_write_bytes(expected_io_bytes_);
+    stats->set_data_dirs(data_dirs_);
   }
 
   void set_remaining_runs(int runs) {
@@ -167,6 +177,12 @@ class TestMaintenanceOp : public MaintenanceOp {
     perf_improvement_ = perf_improvement;
   }
 
+  void set_expected_io(int64_t io_bytes, vector<string> data_dirs) {
+    std::lock_guard<Mutex> guard(lock_);
+    expected_io_bytes_ = io_bytes;
+    data_dirs_ = std::move(data_dirs);
+  }
+
   virtual scoped_refptr<Histogram> DurationHistogram() const OVERRIDE {
     return maintenance_op_duration_;
   }
@@ -175,12 +191,22 @@ class TestMaintenanceOp : public MaintenanceOp {
     return maintenance_ops_running_;
   }
 
+  virtual bool preemptible() const OVERRIDE {
+    return preemptible_;
+  }
+
+  void set_preemptible(bool preemptible) {
+    preemptible_ = preemptible;
+  }
+
  private:
   Mutex lock_;
 
   uint64_t ram_anchored_;
   uint64_t logs_retained_bytes_;
   uint64_t perf_improvement_;
+  int64_t expected_io_bytes_;
+  vector<string> data_dirs_;
   MetricRegistry metric_registry_;
   scoped_refptr<MetricEntity> metric_entity_;
   scoped_refptr<Histogram> maintenance_op_duration_;
@@ -194,6 +220,8 @@ class TestMaintenanceOp : public MaintenanceOp {
 
   // The amount of time each op invocation will sleep.
   MonoDelta sleep_time_;
+
+  bool preemptible_;
 };
 
 // Create an op and wait for it to start running.  Unregister it while it is
@@ -304,6 +332,195 @@ TEST_F(MaintenanceManagerTest, TestLogRetentionPrioritization) {
   manager_->UnregisterOp(&op2);
 }
 
+// Test that ops aren't scheduled on a data directory whose I/O budget has
+// been used up, while ops on other directories can still run.
+TEST_F(MaintenanceManagerTest, TestDiskIOBudget) {
+  const int64_t kMB = 1024 * 1024;
+  FLAGS_maintenance_manager_disk_io_budget_mb_per_sec = 1;
+
+  manager_->Shutdown();
+
+  TestMaintenanceOp op1("op1", MaintenanceOp::HIGH_IO_USAGE);
+  op1.set_ram_anchored(0);
+  op1.set_perf_improvement(10);
+  op1.set_expected_io(10 * kMB, { "dir-a" });
+
+  TestMaintenanceOp op2("op2", MaintenanceOp::HIGH_IO_USAGE);
+  op2.set_ram_anchored(0);
+  op2.set_perf_improvement(5);
+  op2.set_expected_io(10 * kMB, { "dir-b" });
+
+  manager_->RegisterOp(&op1);
+  manager_->RegisterOp(&op2);
+
+  // With no I/O scheduled yet, the best op is picked.
+  ASSERT_EQ(&op1, manager_->FindBestOp());
+  manager_->ChargeDiskIOBudget(manager_->ops_[&op1]);
+
+  // 'dir-a' now has ~10 seconds of outstanding I/O, so the op on the idle
+  // 'dir-b' is picked instead.
+  ASSERT_EQ(&op2, manager_->FindBestOp());
+  manager_->ChargeDiskIOBudget(manager_->ops_[&op2]);
+  ASSERT_EQ(nullptr, manager_->FindBestOp());
+
+  // Without a budget, the best op is picked regardless of disk load.
+  FLAGS_maintenance_manager_disk_io_budget_mb_per_sec = 0;
+  ASSERT_EQ(&op1, manager_->FindBestOp());
+
+  manager_->UnregisterOp(&op1);
+  manager_->UnregisterOp(&op2);
+}
+
+// Test that ops which free log retention, and flushes, are scheduled even on
+// a data directory whose I/O budget has been used up.
+TEST_F(MaintenanceManagerTest, TestDiskIOBudgetExemptsLogRetentionAndFlushes) {
+  const int64_t kMB = 1024 * 1024;
+  FLAGS_maintenance_manager_disk_io_budget_mb_per_sec = 1;
+
+  manager_->Shutdown();
+
+  TestMaintenanceOp busy_op("busy_op", MaintenanceOp::HIGH_IO_USAGE);
+  busy_op.set_ram_anchored(0);
+  busy_op.set_perf_improvement(10);
+  busy_op.set_expected_io(10 * kMB, { "dir-a" });
+  manager_->RegisterOp(&busy_op);
+  ASSERT_EQ(&busy_op, manager_->FindBestOp());
+  manager_->ChargeDiskIOBudget(manager_->ops_[&busy_op]);
+  ASSERT_EQ(nullptr, manager_->FindBestOp());
+  manager_->UnregisterOp(&busy_op);
+
+  // An op which would free log retention still runs on the busy disk.
+  TestMaintenanceOp log_op("log_op", MaintenanceOp::LOW_IO_USAGE);
+  log_op.set_ram_anchored(0);
+  log_op.set_logs_retained_bytes(100 * kMB);
+  log_op.set_perf_improvement(0);
+  log_op.set_expected_io(10 * kMB, { "dir-a" });
+  manager_->RegisterOp(&log_op);
+  ASSERT_EQ(&log_op, manager_->FindBestOp());
+  manager_->UnregisterOp(&log_op);
+
+  // So does a flush.
+  TestMaintenanceOp flush_op("flush_op", MaintenanceOp::HIGH_IO_USAGE,
+                             MaintenanceOp::FLUSH_PRIORITY);
+  flush_op.set_ram_anchored(0);
+  flush_op.set_perf_improvement(10);
+  flush_op.set_expected_io(10 * kMB, { "dir-a" });
+  manager_->RegisterOp(&flush_op);
+  ASSERT_EQ(&flush_op, manager_->FindBestOp());
+  manager_->UnregisterOp(&flush_op);
+}
+
+// Test that compaction-class ops can't use the threads reserved for more
+// urgent ops.
+TEST_F(MaintenanceManagerTest, TestReservedThreads) {
+  FLAGS_maintenance_manager_reserved_threads = 1;
+
+  manager_->Shutdown();
+
+  TestMaintenanceOp compaction_op("compaction", MaintenanceOp::HIGH_IO_USAGE);
+  compaction_op.set_ram_anchored(0);
+  compaction_op.set_perf_improvement(10);
+
+  TestMaintenanceOp flush_op("flush", MaintenanceOp::HIGH_IO_USAGE,
+                             MaintenanceOp::FLUSH_PRIORITY);
+  flush_op.set_ram_anchored(0);
+  flush_op.set_perf_improvement(5);
+
+  manager_->RegisterOp(&compaction_op);
+  manager_->RegisterOp(&flush_op);
+
+  // With all threads free, the op with the best perf improvement is picked.
+  ASSERT_EQ(&compaction_op, manager_->FindBestOp());
+
+  // Simulate a compaction-class op occupying the only unreserved thread. The
+  // remaining thread may only be used by the flush.
+  manager_->running_ops_ = 1;
+  manager_->running_compaction_ops_ = 1;
+  ASSERT_EQ(&flush_op, manager_->FindBestOp());
+
+  manager_->running_ops_ = 0;
+  manager_->running_compaction_ops_ = 0;
+  manager_->UnregisterOp(&compaction_op);
+  manager_->UnregisterOp(&flush_op);
+}
+
+// Test that a running compaction-class op is asked to yield when all threads
+// are busy, the server is under memory pressure, and a flush is waiting.
+TEST_F(MaintenanceManagerTest, TestPreemption) {
+  FLAGS_maintenance_manager_enable_preemption = true;
+  manager_->Shutdown();
+
+  // Ops are ordered by name, so the non-preemptible op comes first.
+  TestMaintenanceOp gc_op("a_gc", MaintenanceOp::HIGH_IO_USAGE);
+  TestMaintenanceOp new_op("b_compaction", MaintenanceOp::HIGH_IO_USAGE);
+  new_op.set_preemptible(true);
+  TestMaintenanceOp old_op("c_compaction", MaintenanceOp::HIGH_IO_USAGE);
+  old_op.set_preemptible(true);
+  TestMaintenanceOp flush_op("flush", MaintenanceOp::HIGH_IO_USAGE,
+                             MaintenanceOp::FLUSH_PRIORITY);
+  flush_op.set_ram_anchored(100);
+
+  manager_->RegisterOp(&gc_op);
+  manager_->RegisterOp(&new_op);
+  manager_->RegisterOp(&old_op);
+  manager_->RegisterOp(&flush_op);
+
+  // Simulate the three compaction-class ops running, 'old_op'
+  // having started first.
+  MonoTime now = MonoTime::Now();
+  gc_op.running_ = 1;
+  gc_op.running_since_ = now - MonoDelta::FromSeconds(30);
+  old_op.running_ = 1;
+  old_op.running_since_ = now - MonoDelta::FromSeconds(20);
+  new_op.running_ = 1;
+  new_op.running_since_ = now - MonoDelta::FromSeconds(10);
+  manager_->running_ops_ = 3;
+  manager_->running_compaction_ops_ = 3;
+
+  // No memory pressure, no preemption.
+  ASSERT_FALSE(manager_->MaybePreemptForFlush());
+  ASSERT_FALSE(old_op.preempted());
+
+  // The longest-running preemptible op is asked to yield.
+  indicate_memory_pressure_ = true;
+  ASSERT_TRUE(manager_->MaybePreemptForFlush());
+  ASSERT_FALSE(gc_op.preempted());
+  ASSERT_TRUE(old_op.preempted());
+  ASSERT_FALSE(new_op.preempted());
+  ASSERT_FALSE(flush_op.preempted());
+
+  // An op which hasn't yielded yet doesn't keep the others from being
+  // preempted.
+  ASSERT_TRUE(manager_->MaybePreemptForFlush());
+  ASSERT_TRUE(new_op.preempted());
+  ASSERT_FALSE(manager_->MaybePreemptForFlush());
+  ASSERT_FALSE(gc_op.preempted());
+
+  // Preemption is only visible to the thread performing the op.
+  ASSERT_FALSE(MaintenanceOp::CurrentOpPreempted());
+
+  // An op which was preempted isn't preempted again on its next run.
+  old_op.running_ = 0;
+  old_op.last_run_preempted_ = true;
+  old_op.preempt_.Store(false);
+  new_op.running_ = 0;
+  new_op.preempt_.Store(false);
+  old_op.running_ = 1;
+  manager_->running_ops_ = 2;
+  manager_->running_compaction_ops_ = 2;
+  ASSERT_FALSE(manager_->MaybePreemptForFlush());
+  ASSERT_FALSE(old_op.preempted());
+
+  gc_op.running_ = 0;
+  old_op.running_ = 0;
+  manager_->running_ops_ = 0;
+  manager_->running_compaction_ops_ = 0;
+  manager_->UnregisterOp(&gc_op);
+  manager_->UnregisterOp(&new_op);
+  manager_->UnregisterOp(&old_op);
+  manager_->UnregisterOp(&flush_op);
+}
+
 // Test retrieving a list of an op's running instances
 TEST_F(MaintenanceManagerTest, TestRunningInstances) {
   TestMaintenanceOp op("op", MaintenanceOp::HIGH_IO_USAGE);
@@ -17,6 +17,7 @@
 
 #include "kudu/util/maintenance_manager.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -44,6 +45,7 @@
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/thread.h"
 #include "kudu/util/threadpool.h"
+#include "kudu/util/throttler.h"
 #include "kudu/util/trace.h"
 
 using std::pair;
@@ -88,6 +90,32 @@ DEFINE_double(data_gc_prioritization_prob, 0.5,
              "such as delta compaction.");
 TAG_FLAG(data_gc_prioritization_prob, experimental);
 
+DEFINE_int32(maintenance_manager_disk_io_budget_mb_per_sec, 0,
+             "The number of megabytes per second of maintenance op I/O that "
+             "each data directory is expected to sustain. Ops declaring the "
+             "data directories they touch and the amount of data they expect "
+             "to read and write are not scheduled on a directory which has "
+             "more than a second's worth of outstanding I/O, so that ops on "
+             "idle disks can run while busy disks are left alone. Flushes and "
+             "ops which free WAL segments are scheduled regardless. If 0, no "
+             "per-disk I/O budget is enforced.");
+TAG_FLAG(maintenance_manager_disk_io_budget_mb_per_sec, experimental);
+TAG_FLAG(maintenance_manager_disk_io_budget_mb_per_sec, runtime);
+
+DEFINE_int32(maintenance_manager_reserved_threads, 0,
+             "Number of maintenance manager threads reserved for ops more "
+             "urgent than compactions, such as flushes and log GC. Compactions "
+             "and other low-priority ops can always use at least one thread.");
+TAG_FLAG(maintenance_manager_reserved_threads, experimental);
+TAG_FLAG(maintenance_manager_reserved_threads, runtime);
+
+DEFINE_bool(maintenance_manager_enable_preemption, false,
+            "Whether the maintenance manager may ask running compactions to "
+            "stop early when the server is under memory pressure, all threads "
+            "are busy, and a flush is waiting to run.");
+TAG_FLAG(maintenance_manager_enable_preemption, experimental);
+TAG_FLAG(maintenance_manager_enable_preemption, runtime);
+
 namespace kudu {
 
 MaintenanceOpStats::MaintenanceOpStats() {
@@ -101,14 +129,22 @@ void MaintenanceOpStats::Clear() {
   logs_retained_bytes_ = 0;
   data_retained_bytes_ = 0;
   perf_improvement_ = 0;
+  expected_read_bytes_ = 0;
+  expected_write_bytes_ = 0;
+  data_dirs_.clear();
   last_modified_ = MonoTime();
 }
 
-MaintenanceOp::MaintenanceOp(std::string name, IOUsage io_usage)
+__thread MaintenanceOp* MaintenanceOp::current_op_ = nullptr;
+
+MaintenanceOp::MaintenanceOp(std::string name, IOUsage io_usage, PriorityClass priority)
     : name_(std::move(name)),
       running_(0),
       cancel_(false),
-      io_usage_(io_usage) {
+      preempt_(false),
+      last_run_preempted_(false),
+      io_usage_(io_usage),
+      priority_(priority) {
 }
 
 MaintenanceOp::~MaintenanceOp() {
@@ -121,6 +157,10 @@ void MaintenanceOp::Unregister() {
   manager_->UnregisterOp(this);
 }
 
+bool MaintenanceOp::CurrentOpPreempted() {
+  return current_op_ != nullptr && current_op_->preempted();
+}
+
 MaintenanceManagerStatusPB_OpInstancePB OpInstance::DumpToPB() const {
   MaintenanceManagerStatusPB_OpInstancePB pb;
   pb.set_thread_id(thread_id);
@@ -148,6 +188,7 @@ MaintenanceManager::MaintenanceManager(const Options& options)
           FLAGS_maintenance_manager_polling_interval_ms :
           options.polling_interval_ms),
     running_ops_(0),
+    running_compaction_ops_(0),
     completed_ops_count_(0),
     rand_(GetRandomSeed32()),
     memory_pressure_func_(&process_memory::UnderMemoryPressure) {
@@ -257,6 +298,9 @@ void MaintenanceManager::RunSchedulerThread() {
            !shutdown_) {
       cond_.TimedWait(polling_interval);
       prev_iter_found_no_work = false;
+      if (!shutdown_ && !disabled_for_tests()) {
+        MaybePreemptForFlush();
+      }
     }
     if (shutdown_) {
       VLOG_AND_TRACE("maintenance", 1) << LogPrefix() << "Shutting down maintenance manager.";
@@ -275,8 +319,13 @@ void MaintenanceManager::RunSchedulerThread() {
     }
 
     // Prepare the maintenance operation.
+    bool is_compaction_op = op->priority() == MaintenanceOp::COMPACTION_PRIORITY;
+    if (op->running_ == 0) {
+      op->running_since_ = MonoTime::Now();
+    }
     op->running_++;
     running_ops_++;
+    if (is_compaction_op) running_compaction_ops_++;
     guard.unlock();
     bool ready = op->Prepare();
     guard.lock();
@@ -285,9 +334,11 @@ void MaintenanceManager::RunSchedulerThread() {
                             << ".  Re-running scheduler.";
       op->running_--;
       running_ops_--;
+      if (is_compaction_op) running_compaction_ops_--;
       op->cond_->Signal();
       continue;
     }
+    ChargeDiskIOBudget(FindOrDie(ops_, op));
 
     // Run the maintenance operation.
     Status s = thread_pool_->SubmitFunc(boost::bind(
@@ -325,6 +376,9 @@ MaintenanceOp* MaintenanceManager::FindBestOp() {
                                      << "There are no free threads, so we can't run anything.";
     return nullptr;
   }
+  // Once compaction-class ops occupy all of the threads they may use, only
+  // more urgent ops can be scheduled on the remaining, reserved threads.
+  bool compaction_threads_full = running_compaction_ops_ >= num_compaction_threads();
 
   int64_t low_io_most_logs_retained_bytes = 0;
   MaintenanceOp* low_io_most_logs_retained_bytes_op = nullptr;
@@ -351,6 +405,25 @@ MaintenanceOp* MaintenanceManager::FindBestOp() {
     if (op->cancelled() || !stats.valid() || !stats.runnable()) {
       continue;
     }
+    if (compaction_threads_full && op->priority() == MaintenanceOp::COMPACTION_PRIORITY) {
+      continue;
+    }
+
+    // An op which would overload one of its disks may still be picked to
+    // relieve memory pressure, but is otherwise left for a later round.
+    // Flushes and ops which free WAL segments are exempt: holding them back
+    // would let memory or log retention grow without bound on a busy disk.
+    if (op->priority() != MaintenanceOp::FLUSH_PRIORITY &&
+        stats.logs_retained_bytes() == 0 &&
+        !HasDiskIOBudget(stats)) {
+      VLOG_AND_TRACE("maintenance", 2) << LogPrefix() << "Op " << op->name()
+                                       << " exceeds the I/O budget of its data directories";
+      if (stats.ram_anchored() > most_mem_anchored) {
+        most_mem_anchored_op = op;
+        most_mem_anchored = stats.ram_anchored();
+      }
+      continue;
+    }
     if (stats.logs_retained_bytes() > low_io_most_logs_retained_bytes &&
         op->io_usage() == MaintenanceOp::LOW_IO_USAGE) {
       low_io_most_logs_retained_bytes_op = op;
@@ -450,6 +523,114 @@ MaintenanceOp* MaintenanceManager::FindBestOp() {
   return nullptr;
 }
 
+int32_t MaintenanceManager::num_compaction_threads() const {
+  return std::max<int32_t>(1, num_threads_ - FLAGS_maintenance_manager_reserved_threads);
+}
+
+bool MaintenanceManager::MaybePreemptForFlush() {
+  if (!FLAGS_maintenance_manager_enable_preemption ||
+      running_ops_ < num_threads_ ||
+      running_compaction_ops_ == 0) {
+    return false;
+  }
+  double capacity_pct;
+  if (!memory_pressure_func_(&capacity_pct)) {
+    return false;
+  }
+
+  // Pick the longest-running op which can yield. Ops which were already asked
+  // to yield, or which were preempted the last time they ran, are left alone.
+  MaintenanceOp* victim = nullptr;
+  for (const OpMapTy::value_type& val : ops_) {
+    MaintenanceOp* op = val.first;
+    if (op->priority() != MaintenanceOp::COMPACTION_PRIORITY || op->running_ == 0 ||
+        !op->preemptible() || op->preempted() || op->last_run_preempted_) {
+      continue;
+    }
+    if (!victim || op->running_since_ < victim->running_since_) {
+      victim = op;
+    }
+  }
+  if (!victim) {
+    return false;
+  }
+
+  // Look for a flush which is waiting for a thread.
+  MaintenanceOp* flush_op = nullptr;
+  for (OpMapTy::value_type& val : ops_) {
+    MaintenanceOp* op = val.first;
+    if (op->priority() != MaintenanceOp::FLUSH_PRIORITY || op->cancelled()) {
+      continue;
+    }
+    MaintenanceOpStats& stats = val.second;
+    stats.Clear();
+    op->UpdateStats(&stats);
+    if (stats.valid() && stats.runnable() && stats.ram_anchored() > 0) {
+      flush_op = op;
+      break;
+    }
+  }
+  if (!flush_op) {
+    return false;
+  }
+
+  LOG_WITH_PREFIX(INFO) << StringPrintf("Under memory pressure (current capacity is %.2f%%) "
+                                        "with no free threads; asking ", capacity_pct)
+                        << victim->name() << " to yield to " << flush_op->name();
+  victim->preempt_.Store(true);
+  return true;
+}
+
+void MaintenanceManager::DrainDiskIOState(const MonoTime& now, DiskIOState* state) {
+  if (state->last_update.Initialized()) {
+    double budget_bytes_per_sec =
+        static_cast<double>(FLAGS_maintenance_manager_disk_io_budget_mb_per_sec) * 1024 * 1024;
+    double elapsed_sec = (now - state->last_update).ToSeconds();
+    state->outstanding_bytes = std::max(
+        0.0, state->outstanding_bytes - elapsed_sec * budget_bytes_per_sec);
+  }
+  state->last_update = now;
+}
+
+bool MaintenanceManager::HasDiskIOBudget(const MaintenanceOpStats& stats) {
+  int32_t budget_mb_per_sec = FLAGS_maintenance_manager_disk_io_budget_mb_per_sec;
+  if (budget_mb_per_sec <= 0 ||
+      stats.data_dirs().empty() ||
+      stats.expected_read_bytes() + stats.expected_write_bytes() == 0) {
+    return true;
+  }
+  // A disk is considered busy when the ops already scheduled on it account
+  // for more than a second of its budget.
+  double budget_bytes = static_cast<double>(budget_mb_per_sec) * 1024 * 1024;
+  MonoTime now = MonoTime::Now();
+  for (const std::string& dir : stats.data_dirs()) {
+    DiskIOState* state = FindOrNull(disk_io_, dir);
+    if (!state) continue;
+    DrainDiskIOState(now, state);
+    if (state->outstanding_bytes >= budget_bytes) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void MaintenanceManager::ChargeDiskIOBudget(const MaintenanceOpStats& stats) {
+  if (FLAGS_maintenance_manager_disk_io_budget_mb_per_sec <= 0 ||
+      !stats.valid() || stats.data_dirs().empty()) {
+    return;
+  }
+  // Assume the op's I/O is spread evenly across its directories.
+  double bytes_per_dir = static_cast<double>(stats.expected_read_bytes() +
+                                             stats.expected_write_bytes()) /
+                         stats.data_dirs().size();
+  MonoTime now = MonoTime::Now();
+  for (const std::string& dir : stats.data_dirs()) {
+    DiskIOState* state = &disk_io_[dir];
+    DrainDiskIOState(now, state);
+    state->outstanding_bytes += bytes_per_dir;
+  }
+}
+
 void MaintenanceManager::LaunchOp(MaintenanceOp* op) {
   int64_t thread_id = Thread::CurrentThreadId();
   OpInstance op_instance;
@@ -477,7 +658,14 @@ void MaintenanceManager::LaunchOp(MaintenanceOp* op) {
     op->DurationHistogram()->Increment(op_instance.duration.ToMilliseconds());
 
     running_ops_--;
+    if (op->priority() == MaintenanceOp::COMPACTION_PRIORITY) {
+      running_compaction_ops_--;
+    }
     op->running_--;
+    if (op->running_ == 0) {
+      op->last_run_preempted_ = op->preempted();
+      op->preempt_.Store(false);
+    }
     op->cond_->Signal();
     cond_.Signal(); // wake up scheduler
   });
@@ -487,7 +675,14 @@ void MaintenanceManager::LaunchOp(MaintenanceOp* op) {
     ADOPT_TRACE(trace.get());
     TRACE_EVENT1("maintenance", "MaintenanceManager::LaunchOp",
                  "name", op->name());
-    op->Perform();
+    MaintenanceOp::current_op_ = op;
+    {
+      // Throttle the op's block I/O (see fs::ThrottleBackgroundIO()), unless
+      // it frees memory: flushes hold up writers and alters as they run.
+      ScopedBackgroundIO background_io(op->priority() != MaintenanceOp::FLUSH_PRIORITY);
+      op->Perform();
+    }
+    MaintenanceOp::current_op_ = nullptr;
   }
   LOG_WITH_PREFIX(INFO) << op->name() << " metrics: " << trace->MetricsAsJSON();
 }
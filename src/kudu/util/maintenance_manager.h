@@ -26,6 +26,7 @@
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <glog/logging.h>
@@ -109,6 +110,36 @@ class MaintenanceOpStats {
     perf_improvement_ = perf_improvement;
   }
 
+  int64_t expected_read_bytes() const {
+    DCHECK(valid_);
+    return expected_read_bytes_;
+  }
+
+  void set_expected_read_bytes(int64_t expected_read_bytes) {
+    UpdateLastModified();
+    expected_read_bytes_ = expected_read_bytes;
+  }
+
+  int64_t expected_write_bytes() const {
+    DCHECK(valid_);
+    return expected_write_bytes_;
+  }
+
+  void set_expected_write_bytes(int64_t expected_write_bytes) {
+    UpdateLastModified();
+    expected_write_bytes_ = expected_write_bytes;
+  }
+
+  const std::vector<std::string>& data_dirs() const {
+    DCHECK(valid_);
+    return data_dirs_;
+  }
+
+  void set_data_dirs(std::vector<std::string> data_dirs) {
+    UpdateLastModified();
+    data_dirs_ = std::move(data_dirs);
+  }
+
   const MonoTime& last_modified() const {
     DCHECK(valid_);
     return last_modified_;
@@ -149,6 +180,16 @@ class MaintenanceOpStats {
   // absolute scale (yet TBD).
   double perf_improvement_;
 
+  // Approximate number of bytes that this operation will read from and write
+  // to disk if it runs. May be 0.
+  int64_t expected_read_bytes_;
+  int64_t expected_write_bytes_;
+
+  // Opaque identifiers (e.g. UUIDs) of the data directories that this
+  // operation's I/O is spread across. May be empty, in which case the
+  // operation's I/O isn't accounted against any disk.
+  std::vector<std::string> data_dirs_;
+
   // The last time that the stats were modified.
   MonoTime last_modified_;
 };
@@ -181,7 +222,18 @@ class MaintenanceOp {
     HIGH_IO_USAGE // Everything else.
   };
 
-  explicit MaintenanceOp(std::string name, IOUsage io_usage);
+  // Scheduling class of the Op, from most to least urgent. Some of the
+  // manager's threads may be reserved for ops which are more urgent than
+  // COMPACTION_PRIORITY, and such ops may preempt running compaction-class ops
+  // when the server is under memory pressure.
+  enum PriorityClass {
+    FLUSH_PRIORITY,     // Ops which free memory, like MRS and DMS flushes.
+    LOG_GC_PRIORITY,    // Ops which free WAL segments.
+    COMPACTION_PRIORITY // Everything else.
+  };
+
+  MaintenanceOp(std::string name, IOUsage io_usage,
+                PriorityClass priority = COMPACTION_PRIORITY);
   virtual ~MaintenanceOp();
 
   // Unregister this op, if it is currently registered.
@@ -216,6 +268,8 @@ class MaintenanceOp {
 
   IOUsage io_usage() const { return io_usage_; }
 
+  PriorityClass priority() const { return priority_; }
+
   // Return true if the operation has been cancelled due to Unregister() pending.
   bool cancelled() const {
     return cancel_.Load();
@@ -229,9 +283,28 @@ class MaintenanceOp {
     cancel_.Store(true);
   }
 
+  // Return true if the maintenance manager has asked running instances of
+  // this op to stop early so that a more urgent op can use their threads.
+  bool preempted() const {
+    return preempt_.Load();
+  }
+
+  // Return true if running instances of this op poll CurrentOpPreempted()
+  // and stop soon after it returns true. Only such ops are ever preempted.
+  virtual bool preemptible() const { return false; }
+
+  // Return true if the op being performed by the calling thread, if any, has
+  // been preempted. Long-running ops may poll this at points where they can
+  // safely abort, e.g. between the blocks of a compaction.
+  static bool CurrentOpPreempted();
+
  private:
+  FRIEND_TEST(MaintenanceManagerTest, TestPreemption);
   DISALLOW_COPY_AND_ASSIGN(MaintenanceOp);
 
+  // The op being performed by the current thread, or null.
+  static __thread MaintenanceOp* current_op_;
+
   // The name of the operation.  Op names must be unique.
   const std::string name_;
 
@@ -243,6 +316,20 @@ class MaintenanceOp {
   // New operations will not be scheduled when this boolean is set.
   AtomicBool cancel_;
 
+  // Set when running instances of this op should yield their threads to
+  // more urgent ops. Cleared when no instance is running anymore.
+  AtomicBool preempt_;
+
+  // Whether 'preempt_' was set when the last instance of this op finished.
+  // Such an op is not preempted again until one of its runs completes, so
+  // that it can't be restarted from scratch forever under steady memory
+  // pressure. Protected by the MaintenanceManager's lock.
+  bool last_run_preempted_;
+
+  // When the oldest running instance of this op was launched, if any.
+  // Protected by the MaintenanceManager's lock.
+  MonoTime running_since_;
+
   // Condition variable which the UnregisterOp function can wait on.
   //
   // Note: 'cond_' is used with the MaintenanceManager's mutex. As such,
@@ -254,6 +341,8 @@ class MaintenanceOp {
   std::shared_ptr<MaintenanceManager> manager_;
 
   IOUsage io_usage_;
+
+  const PriorityClass priority_;
 };
 
 struct MaintenanceOpComparator {
@@ -300,9 +389,22 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
 
  private:
   FRIEND_TEST(MaintenanceManagerTest, TestLogRetentionPrioritization);
+  FRIEND_TEST(MaintenanceManagerTest, TestDiskIOBudget);
+  FRIEND_TEST(MaintenanceManagerTest, TestReservedThreads);
+  FRIEND_TEST(MaintenanceManagerTest, TestPreemption);
   typedef std::map<MaintenanceOp*, MaintenanceOpStats,
           MaintenanceOpComparator> OpMapTy;
 
+  // Tracks the I/O that has been scheduled on a single data directory.
+  struct DiskIOState {
+    // Bytes of I/O charged to the directory by launched ops which have not
+    // yet been "paid off" by the directory's I/O budget.
+    double outstanding_bytes = 0;
+
+    // The last time 'outstanding_bytes' was updated.
+    MonoTime last_update;
+  };
+
   // Return true if tests have currently disabled the maintenance
   // manager by way of changing the gflags at runtime.
   bool disabled_for_tests() const;
@@ -312,8 +414,31 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
   // find the best op, or null if there is nothing we want to run
   MaintenanceOp* FindBestOp();
 
+  // Return the number of threads which compaction-class ops may use. The rest
+  // are reserved for more urgent ops.
+  int32_t num_compaction_threads() const;
+
+  // If every thread is busy and the server is under memory pressure, ask the
+  // longest-running preemptible compaction-class op to yield so that a
+  // runnable op which frees memory can be scheduled. Returns true if an op
+  // was asked to yield.
+  bool MaybePreemptForFlush();
+
   void LaunchOp(MaintenanceOp* op);
 
+  // Return true if running an op with the given stats would not exceed the
+  // I/O budget of any of the data directories it touches, or if there is no
+  // such budget.
+  bool HasDiskIOBudget(const MaintenanceOpStats& stats);
+
+  // Charge the expected I/O of an op with the given stats, which is about
+  // to be launched, to the data directories it touches.
+  void ChargeDiskIOBudget(const MaintenanceOpStats& stats);
+
+  // Pay off the outstanding I/O of 'state' according to the configured
+  // per-disk budget and the time elapsed since its last update.
+  static void DrainDiskIOState(const MonoTime& now, DiskIOState* state);
+
   std::string LogPrefix() const;
 
   const int32_t num_threads_;
@@ -325,6 +450,8 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
   bool shutdown_;
   int32_t polling_interval_ms_;
   uint64_t running_ops_;
+  // The number of running ops in the COMPACTION_PRIORITY class.
+  uint64_t running_compaction_ops_;
   // Vector used as a circular buffer for recently completed ops. Elements need to be added at
   // the completed_ops_count_ % the vector's size and then the count needs to be incremented.
   std::vector<OpInstance> completed_ops_;
@@ -332,6 +459,10 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
   std::string server_uuid_;
   Random rand_;
 
+  // I/O accounting per data directory, keyed by the identifiers provided by
+  // MaintenanceOpStats::data_dirs().
+  std::unordered_map<std::string, DiskIOState> disk_io_;
+
   // Function which should return true if the server is under global memory pressure.
   // This is indirected for testing purposes.
   std::function<bool(double*)> memory_pressure_func_;
@@ -708,6 +708,11 @@ const string& WritablePBContainerFile::filename() const {
   return writer_->filename();
 }
 
+uint64_t WritablePBContainerFile::offset() {
+  std::lock_guard<Mutex> l(offset_lock_);
+  return offset_;
+}
+
 Status WritablePBContainerFile::AppendMsgToBuffer(const Message& msg, faststring* buf) {
   DCHECK(msg.IsInitialized()) << InitializationErrorMessage("serialize", msg);
   int data_len = msg.ByteSize();
@@ -826,6 +831,23 @@ Status ReadablePBContainerFile::ReadNextPB(Message* msg) {
   return ReadFullPB(reader_.get(), version_, &offset_, msg);
 }
 
+Status ReadablePBContainerFile::SkipTo(uint64_t offset) {
+  DCHECK_EQ(FileState::OPEN, state_);
+  if (offset < offset_) {
+    return Status::InvalidArgument(Substitute(
+        "cannot skip backwards from offset $0 to offset $1", offset_, offset));
+  }
+  uint64_t file_size;
+  RETURN_NOT_OK(reader_->Size(&file_size));
+  if (offset > file_size) {
+    return Status::Corruption(Substitute(
+        "cannot skip to offset $0 beyond the end of file $1 ($2 bytes)",
+        offset, reader_->filename(), file_size));
+  }
+  offset_ = offset;
+  return Status::OK();
+}
+
 Status ReadablePBContainerFile::GetPrototype(const Message** prototype) {
   if (!prototype_) {
     // Loading the schemas into a DescriptorDatabase (and not directly into
@@ -322,6 +322,10 @@ class WritablePBContainerFile {
   // Returns the path to the container's underlying file handle.
   const std::string& filename() const;
 
+  // Returns the offset just past the last appended message. Every message
+  // before that offset has been fully written, though not necessarily synced.
+  uint64_t offset();
+
  private:
   friend class TestPBUtil;
   FRIEND_TEST(TestPBUtil, TestPopulateDescriptorSet);
@@ -395,6 +399,13 @@ class ReadablePBContainerFile {
   // * On success, stores the result in '*msg' and returns OK.
   Status ReadNextPB(google::protobuf::Message* msg);
 
+  // Moves the read offset forward to 'offset', which must be the start of a
+  // record (e.g. a value previously returned by offset()). File must be open.
+  //
+  // Returns Status::InvalidArgument if 'offset' precedes the current offset,
+  // and Status::Corruption if it lies beyond the end of the file.
+  Status SkipTo(uint64_t offset);
+
   // Dumps any unread protobuf messages in the container to 'os'. Each
   // message's DebugString() method is invoked to produce its textual form.
   // File must be open.
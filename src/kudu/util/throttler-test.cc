@@ -73,4 +73,67 @@ TEST_F(ThrottlerTest, TestBurst) {
   ASSERT_FALSE(t0.Take(now, 1, 1));
 }
 
+TEST_F(ThrottlerTest, TestIOThrottlerRate) {
+  // 1MB/s: each 100KB request costs ~100ms.
+  const int64_t kRate = 1000 * 1000;
+  MonoTime now = MonoTime::Now();
+  IOThrottler t0;
+  // The first request is covered by the idle burst allowance.
+  ASSERT_EQ(0, t0.Take(now, 100 * 1000, kRate).ToMicroseconds());
+  // Subsequent requests at the same instant must wait for their predecessors.
+  ASSERT_EQ(100 * 1000, t0.Take(now, 100 * 1000, kRate).ToMicroseconds());
+  ASSERT_EQ(200 * 1000, t0.Take(now, 100 * 1000, kRate).ToMicroseconds());
+  // Requests larger than the burst are still admitted, just with a longer wait.
+  ASSERT_EQ(2200 * 1000, t0.Take(now, 2 * 1000 * 1000, kRate).ToMicroseconds());
+
+  // After a long idle period only the burst allowance has accumulated.
+  now += MonoDelta::FromSeconds(10);
+  ASSERT_EQ(0, t0.Take(now, 100 * 1000, kRate).ToMicroseconds());
+  ASSERT_EQ(100 * 1000, t0.Take(now, 100 * 1000, kRate).ToMicroseconds());
+}
+
+TEST_F(ThrottlerTest, TestIOThrottlerRateChange) {
+  MonoTime now = MonoTime::Now();
+  IOThrottler t0;
+  ASSERT_EQ(0, t0.Take(now, 100 * 1000, 1000 * 1000).ToMicroseconds());
+  // Disabling throttling admits everything immediately.
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(0, t0.Take(now, 1000 * 1000, 0).ToMicroseconds());
+  }
+  // A faster rate shortens the wait for subsequent requests.
+  ASSERT_EQ(10 * 1000, t0.Take(now, 100 * 1000, 10 * 1000 * 1000).ToMicroseconds());
+}
+
+TEST_F(ThrottlerTest, TestIOThrottlerBacklog) {
+  MonoTime now = MonoTime::Now();
+  const int64_t kRate = 1000 * 1000;
+  IOThrottler t0;
+  ASSERT_EQ(0, t0.Backlog(now).ToMicroseconds());
+  ASSERT_EQ(0, t0.Take(now, 100 * 1000, kRate).ToMicroseconds());
+  ASSERT_EQ(1000 * 1000, t0.Take(now, 1000 * 1000, kRate).ToMicroseconds());
+  // The backlog covers everything admitted so far, and is paid off over time.
+  ASSERT_EQ(1000 * 1000, t0.Backlog(now).ToMicroseconds());
+  ASSERT_EQ(500 * 1000,
+            t0.Backlog(now + MonoDelta::FromMilliseconds(500)).ToMicroseconds());
+  ASSERT_EQ(0, t0.Backlog(now + MonoDelta::FromSeconds(2)).ToMicroseconds());
+}
+
+TEST_F(ThrottlerTest, TestScopedBackgroundIO) {
+  ASSERT_FALSE(ScopedBackgroundIO::IsActive());
+  {
+    ScopedBackgroundIO outer;
+    ASSERT_TRUE(ScopedBackgroundIO::IsActive());
+    {
+      ScopedBackgroundIO inner(false);
+      ASSERT_TRUE(ScopedBackgroundIO::IsActive());
+    }
+    ASSERT_TRUE(ScopedBackgroundIO::IsActive());
+  }
+  ASSERT_FALSE(ScopedBackgroundIO::IsActive());
+  {
+    ScopedBackgroundIO disabled(false);
+    ASSERT_FALSE(ScopedBackgroundIO::IsActive());
+  }
+}
+
 } // namespace kudu
@@ -22,6 +22,8 @@
 
 namespace kudu {
 
+__thread bool ScopedBackgroundIO::in_background_io_ = false;
+
 Throttler::Throttler(MonoTime now, uint64_t op_rate, uint64_t byte_rate, double burst_factor) :
     next_refill_(now) {
   op_refill_ = op_rate / (MonoTime::kMicrosecondsPerSecond / kRefillPeriodMicros);
@@ -64,4 +66,41 @@ void Throttler::Refill(MonoTime now) {
   byte_token_ = std::min(byte_token_, byte_token_max_);
 }
 
+IOThrottler::IOThrottler()
+    : next_free_(MonoTime::Min()) {
+}
+
+MonoDelta IOThrottler::Take(MonoTime now, int64_t bytes, int64_t bytes_per_sec) {
+  if (bytes_per_sec <= 0 || bytes <= 0) {
+    return MonoDelta::FromMicroseconds(0);
+  }
+  int64_t cost_micros = bytes * MonoTime::kMicrosecondsPerSecond / bytes_per_sec;
+  std::lock_guard<simple_spinlock> lock(lock_);
+  // Cap the budget that may be saved up while idle.
+  MonoTime earliest = now - MonoDelta::FromMicroseconds(kMaxBurstMicros);
+  if (next_free_ < earliest) {
+    next_free_ = earliest;
+  }
+  next_free_ += MonoDelta::FromMicroseconds(cost_micros);
+  if (next_free_ <= now) {
+    return MonoDelta::FromMicroseconds(0);
+  }
+  return next_free_ - now;
+}
+
+void IOThrottler::Acquire(int64_t bytes, int64_t bytes_per_sec) {
+  MonoDelta delay = Take(MonoTime::Now(), bytes, bytes_per_sec);
+  if (delay.ToMicroseconds() > 0) {
+    SleepFor(delay);
+  }
+}
+
+MonoDelta IOThrottler::Backlog(MonoTime now) const {
+  std::lock_guard<simple_spinlock> lock(lock_);
+  if (next_free_ <= now) {
+    return MonoDelta::FromMicroseconds(0);
+  }
+  return next_free_ - now;
+}
+
 } // namespace kudu
@@ -19,6 +19,7 @@
 
 #include <cstdint>
 
+#include "kudu/gutil/macros.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
 
@@ -57,6 +58,68 @@ class Throttler {
   simple_spinlock lock_;
 };
 
+// A blocking byte-rate limiter for background block I/O.
+//
+// Unlike Throttler, callers are never refused: a request that exceeds the
+// available budget is admitted immediately and the caller then sleeps until
+// the budget has been paid back. This allows arbitrarily large reads and
+// writes to be charged, and lets the rate be changed between calls.
+//
+// Threads doing background work (e.g. maintenance ops) enter a
+// ScopedBackgroundIO; block managers then charge every read and write issued
+// by such threads to a single process-wide IOThrottler (see
+// fs::ThrottleBackgroundIO()). Foreground I/O is never throttled.
+class IOThrottler {
+ public:
+  // Up to this much unused budget may accumulate while idle.
+  enum {
+    kMaxBurstMicros = 100000
+  };
+
+  IOThrottler();
+
+  // Charges 'bytes' against a budget of 'bytes_per_sec' as of 'now', returning
+  // how long the caller must wait before issuing more I/O. A non-positive rate
+  // disables throttling.
+  MonoDelta Take(MonoTime now, int64_t bytes, int64_t bytes_per_sec);
+
+  // Like Take(), but sleeps for the returned delay.
+  void Acquire(int64_t bytes, int64_t bytes_per_sec);
+
+  // Returns how long until all of the bytes admitted so far, as of 'now',
+  // have been paid for.
+  MonoDelta Backlog(MonoTime now) const;
+
+ private:
+  // The time at which all previously admitted bytes have been paid for.
+  MonoTime next_free_;
+  mutable simple_spinlock lock_;
+};
+
+// Marks the block I/O issued by the current thread, for the lifetime of the
+// object, as background I/O subject to fs::ThrottleBackgroundIO().
+// Scopes nest; passing 'enable' as false leaves the current state unchanged,
+// which is convenient when propagating the state to helper threads.
+class ScopedBackgroundIO {
+ public:
+  explicit ScopedBackgroundIO(bool enable = true)
+      : prev_(in_background_io_) {
+    in_background_io_ = prev_ || enable;
+  }
+
+  ~ScopedBackgroundIO() {
+    in_background_io_ = prev_;
+  }
+
+  static bool IsActive() { return in_background_io_; }
+
+ private:
+  static __thread bool in_background_io_;
+  const bool prev_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedBackgroundIO);
+};
+
 } // namespace kudu
 
 #endif